@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Compares an engine_microbench JSON result against a stored baseline.
+
+usage: compare.py <baseline.json> <result.json> [--threshold <percent>]
+
+Prints the change in CPU time of every benchmark found in both files and exits
+with 1 if any of them got slower than the threshold (default 10%).
+"""
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    times = {}
+    for b in data["benchmarks"]:
+        # with --benchmark_repetitions only the mean is compared
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "mean":
+            continue
+        name = b.get("run_name", b["name"])
+        times[name] = b["cpu_time"] * {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}[b["time_unit"]]
+    return times
+
+
+def main(argv):
+    if len(argv) < 3:
+        print(__doc__)
+        return 2
+    threshold = 10.0
+    if "--threshold" in argv:
+        threshold = float(argv[argv.index("--threshold") + 1])
+
+    baseline = load(argv[1])
+    result = load(argv[2])
+
+    regressed = False
+    print("%-36s %14s %14s %9s" % ("benchmark", "baseline", "result", "change"))
+    for name in baseline:
+        if name not in result:
+            continue
+        change = (result[name] - baseline[name]) / baseline[name] * 100.0
+        flag = ""
+        if change > threshold:
+            flag = "  SLOWER"
+            regressed = True
+        elif change < -threshold:
+            flag = "  faster"
+        print("%-36s %12.3fus %12.3fus %+8.1f%%%s" % (name, baseline[name] * 1e6, result[name] * 1e6, change, flag))
+    return 1 if regressed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,174 @@
+#ifndef __ASSET_PACK_H__
+#define __ASSET_PACK_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+class Mapped_File;
+
+/**
+* @struct Packed_Asset
+* @brief	an entry of the open asset pack, the payload points into the mapping
+*/
+struct Packed_Asset
+{
+	const unsigned char *data;		/**< the payload as stored, 64 byte aligned in the pack */
+	size_t stored_size;				/**< size of the payload in the pack */
+	size_t size;					/**< size of the file, bigger than stored_size when the payload is compressed */
+	bool compressed;				/**< the payload was compressed with lz_compress */
+	uint64_t source_size;			/**< size of the loose file when it was packed */
+	int64_t source_mtime;			/**< modification time of the loose file when it was packed */
+};
+
+/**
+* @struct Asset_Pack_Statistics
+* @brief	what the assets were read from since the last reset
+*/
+struct Asset_Pack_Statistics
+{
+	unsigned int entries;					/**< files in the open pack */
+	unsigned long long pack_bytes;			/**< size of the open pack */
+	double open_ms;							/**< time spent mapping and checking the pack */
+	unsigned int pack_reads;				/**< assets read from the pack */
+	unsigned int loose_reads;				/**< assets read from loose files, because no pack is open, it doesn't have them or they were edited */
+	unsigned int stale;						/**< of the loose reads, assets whose loose file was edited since it was packed (s_check_sources) */
+	unsigned int missing;					/**< assets found nowhere */
+	unsigned long long bytes;				/**< bytes of the assets read */
+	unsigned long long decompressed_bytes;	/**< bytes that had to be decompressed, the rest was read in place */
+};
+
+/**
+* @class Asset_Pack
+* @brief	One archive of the shaders and resources the engine loads, mapped once at startup so loading them opens no files.
+*			The pack has a directory of its files, an open addressed hash table keyed by the FNV-1a hash of the normalized path relative to
+*			the pack's root, and each file's payload is 64 byte aligned so loaders can hand it to stbi, Assimp or GL without copying it.
+*			Payloads can be compressed with lz_compress, images whose format is compressed already (PNG, JPEG) are always stored as they are.
+*
+*			Loaders read through an Asset, which falls back to the loose file when no pack is open or the pack doesn't have the path.
+*			With s_check_sources it also stats the loose file and reads it instead when its size or modification time differs from the
+*			one recorded when it was packed, so an edited shader is picked up without repacking. Everything is static like the
+*			Texture_Registry; open and close must not be called while assets are read, finding assets is thread safe
+*/
+class Asset_Pack
+{
+public:
+
+	/**
+	* @brief	maps a pack and checks its header and directory, closing the one open before
+	* @param *filepath		the pack
+	* @param prefetch		start reading the whole pack in right away (Mapped_File::prefetch) instead of on first touch
+	* @return	false if the file doesn't exist or isn't a valid pack, an error is printed for the latter
+	*/
+	static bool open(const char *filepath, bool prefetch = false);
+
+	/**
+	* @brief	unmaps the pack, no Asset read from it may be alive
+	*/
+	static void close();
+
+	/**
+	* @brief	check if a pack is open
+	*/
+	static bool is_open();
+
+	/**
+	* @brief	looks a path up in the open pack
+	* @param *path		the path relative to the pack's root, spelled any way normalize_path resolves
+	* @param &asset		receives the entry
+	* @return	false if no pack is open or it doesn't have the path
+	*/
+	static bool find(const char *path, Packed_Asset &asset);
+
+	/**
+	* @brief	the size and modification time of a source file for the caches built from it, from the pack if it has the file and from stat
+	*			otherwise, or when s_check_sources finds the loose file edited
+	* @return	false if the file is in neither
+	*/
+	static bool source_info(const std::string &path, uint64_t &size, int64_t &mtime);
+
+	/**
+	* @brief	packs the files under directories of root, to a temporary file first which then replaces the old pack.
+	*			The caches the engine writes next to the sources (.meshcache, .ktx, .program) are left out, they are rebuilt per machine
+	* @param *filepath			the pack to write
+	* @param *root				the directory the paths in the pack are relative to
+	* @param &directories		the directories under root to pack, recursively
+	* @param compress			compress the payloads that get smaller by at least an eighth
+	* @return	false if a file couldn't be read or the pack couldn't be written, an error is printed
+	*/
+	static bool write(const char *filepath, const char *root, const std::vector<std::string> &directories, bool compress);
+
+	/**
+	* @brief	a copy of the statistics, safe to call from any thread
+	*/
+	static Asset_Pack_Statistics statistics();
+
+	/**
+	* @brief	resets the statistics, what the open pack has and the time it took to open are kept
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	static bool s_check_sources;	/**< packed assets whose loose file was edited since packing are read from it, on in debug builds */
+};
+
+/**
+* @class Asset
+* @brief	The bytes of a file the engine loads, from the open Asset_Pack if it has an up to date copy and from the loose file otherwise.
+*			Uncompressed packed files are read in place, loose files are mapped, and compressed packed files are decompressed
+*			into a buffer the asset owns, so the bytes are only valid while the asset is alive
+*/
+class Asset
+{
+public:
+
+	/**
+	* @brief	finds the file, check is_valid before using the data
+	* @param *path		the path relative to the working directory, which has to be the pack's root for the pack to be used. An empty path is no file
+	*/
+	Asset(const char *path);
+
+	/**
+	* @brief	unmaps the loose file
+	*/
+	~Asset();
+
+	/**
+	* @brief	check if the file was found
+	*/
+	bool is_valid() const { return m_data != NULL; }
+
+	/**
+	* @brief	the bytes of the file
+	*/
+	const unsigned char *data() const { return m_data; }
+
+	/**
+	* @brief	the size of the file in bytes
+	*/
+	size_t size() const { return m_size; }
+
+	/**
+	* @brief	check if the file was read from the pack
+	*/
+	bool is_packed() const { return m_packed; }
+
+private:
+
+	// not copyable, the mapping and buffer are owned
+	Asset(const Asset &);
+	Asset &operator=(const Asset &);
+
+	const unsigned char *m_data;				/**< the bytes, NULL if the file wasn't found */
+	size_t m_size;								/**< number of bytes */
+	bool m_packed;								/**< read from the pack */
+	Mapped_File *m_file;						/**< the mapped loose file, NULL when packed */
+	std::vector<unsigned char> m_buffer;		/**< the decompressed payload of a compressed packed file */
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+/**
+* @struct Camera_Keyframe
+* @brief	a point on a scripted camera path
+*/
+struct Camera_Keyframe
+{
+	float time;				/**< time in seconds the camera reaches this keyframe */
+	glm::vec3 position;		/**< world position of the camera */
+	float yaw;				/**< camera yaw in degrees */
+	float pitch;			/**< camera pitch in degrees */
+};
+
+/**
+* @class Camera_Path
+* @brief	A scripted camera path made of keyframes, linearly interpolated and looped so a replay renders the exact same frames every run
+*/
+class Camera_Path
+{
+public:
+
+	/**
+	* @brief	adds a keyframe to the end of the path, keyframes have to be added in increasing time
+	* @param time		time in seconds the camera reaches this keyframe
+	* @param position	world position of the camera
+	* @param yaw		camera yaw in degrees
+	* @param pitch		camera pitch in degrees
+	*/
+	void add_keyframe(float time, glm::vec3 position, float yaw, float pitch);
+
+	/**
+	* @brief	moves and rotates the camera to where the path is at the given time, wrapping around after the last keyframe
+	* @param &camera	the camera to update
+	* @param time		the simulated time in seconds
+	*/
+	void apply(Camera &camera, float time);
+
+	/**
+	* @brief	the default path used by the benchmarks, a slow orbit around the point shadow room
+	* @return	the path
+	*/
+	static Camera_Path orbit();
+
+private:
+	std::vector<Camera_Keyframe> m_keyframes;	/**< keyframes in increasing time */
+};
+
+/**
+* @struct Timing_Summary
+* @brief	summary statistics of a list of frame times in milliseconds
+*/
+struct Timing_Summary
+{
+	double mean;	/**< average */
+	double min;		/**< fastest frame */
+	double max;		/**< slowest frame */
+	double p50;		/**< median */
+	double p95;		/**< 95th percentile */
+	double p99;		/**< 99th percentile */
+};
+
+/**
+* @class Frame_Statistics
+* @brief	Records the time of every frame of a benchmark run and writes the summary, percentiles and histogram as JSON
+*/
+class Frame_Statistics
+{
+public:
+
+	/**
+	* @brief	constructor
+	* @param &name			name of the scenario the frames belong to
+	* @param bucket_width	width of each histogram bucket in milliseconds
+	*/
+	Frame_Statistics(const std::string &name, double bucket_width = 1.0);
+
+	/**
+	* @brief	records a frame
+	* @param cpu_ms		time spent on the CPU issuing the frame
+	* @param frame_ms	time until the frame was finished on the GPU
+	*/
+	void add_frame(double cpu_ms, double frame_ms);
+
+	/**
+	* @brief	number of frames recorded so far
+	*/
+	size_t frame_count() const { return m_cpu_times.size(); }
+
+	/**
+	* @brief	computes the summary of the recorded CPU times
+	*/
+	Timing_Summary cpu_summary() const { return summarize(m_cpu_times); }
+
+	/**
+	* @brief	computes the summary of the recorded frame times
+	*/
+	Timing_Summary frame_summary() const { return summarize(m_frame_times); }
+
+	/**
+	* @brief	prints the summary to stdout
+	*/
+	void print() const;
+
+	/**
+	* @brief	writes this scenario as a JSON object
+	* @param *file		the file to write to
+	* @param *extra		additional already formatted JSON members written into the object, may be NULL
+	*/
+	void write_json(FILE *file, const char *extra) const;
+
+	std::string m_name;		/**< name of the scenario */
+
+private:
+
+	/**
+	* @brief	calculates mean, min, max and nearest rank percentiles
+	* @param &times		the frame times in milliseconds
+	*/
+	static Timing_Summary summarize(const std::vector<double> &times);
+
+	double m_bucket_width;				/**< histogram bucket width in milliseconds */
+	std::vector<double> m_cpu_times;	/**< CPU time of every frame in milliseconds, in order */
+	std::vector<double> m_frame_times;	/**< finished frame time of every frame in milliseconds, in order */
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef __BLOCK_COMPRESSION_H__
+#define __BLOCK_COMPRESSION_H__
+
+#include <stddef.h>
+#include <vector>
+
+#include "mip_chain.h"
+
+class Thread_Pool;
+
+/**
+* @enum Block_Format
+* @brief	the block compressed formats the encoder writes, every one stores 4x4 pixel blocks
+*/
+enum Block_Format
+{
+	BLOCK_BC1 = 0,		/**< S3TC DXT1, RGB in 8 bytes per block (4 bits per pixel) */
+	BLOCK_BC3,			/**< S3TC DXT5, BC1 colors plus an interpolated alpha block, 16 bytes per block */
+	BLOCK_BC5			/**< RGTC2, two interpolated channels (red and green) in 16 bytes per block, for normal maps */
+};
+
+/**
+* @struct Compressed_Level
+* @brief	one mip level of a Compressed_Image
+*/
+struct Compressed_Level
+{
+	int width;			/**< width of the level in pixels */
+	int height;			/**< height of the level in pixels */
+	size_t offset;		/**< where the level's blocks start in the image's data */
+	size_t size;		/**< bytes of the level's blocks */
+};
+
+/**
+* @struct Compressed_Image
+* @brief	a block compressed image with its full mip chain, down to 1x1
+*/
+struct Compressed_Image
+{
+	Block_Format format;					/**< the format of every level */
+	int width;								/**< width of level 0 */
+	int height;								/**< height of level 0 */
+	std::vector<Compressed_Level> levels;	/**< the mip levels, level 0 first */
+	std::vector<unsigned char> data;		/**< the blocks of every level */
+};
+
+/**
+* @brief	bytes of one 4x4 block of a format
+*/
+inline size_t block_bytes(Block_Format format)
+{
+	return format == BLOCK_BC1 ? 8 : 16;
+}
+
+/**
+* @brief	encodes a BC1 block
+* @param *rgba		the 16 pixels of the block as RGBA, row by row
+* @param *block		receives the 8 bytes of the block
+*/
+void encode_bc1_block(const unsigned char *rgba, unsigned char *block);
+
+/**
+* @brief	encodes a BC3 block, the colors like BC1 and the alpha channel as an interpolated BC4 block
+* @param *rgba		the 16 pixels of the block as RGBA, row by row
+* @param *block		receives the 16 bytes of the block
+*/
+void encode_bc3_block(const unsigned char *rgba, unsigned char *block);
+
+/**
+* @brief	encodes a BC5 block from the red and green channels, blue and alpha are dropped
+* @param *rgba		the 16 pixels of the block as RGBA, row by row
+* @param *block		receives the 16 bytes of the block
+*/
+void encode_bc5_block(const unsigned char *rgba, unsigned char *block);
+
+/**
+* @brief	builds the mip chain of an image with downsample_rgba and block compresses every level. The blocks are encoded with SSE2 where the
+*			compiler targets it and spread over the pool's workers and the calling thread, which may be one of the workers
+* @param *pixels		the pixels as stbi_load returns them, 1 to 4 channels; gray is replicated to RGB
+* @param width			width of the image
+* @param height			height of the image
+* @param components		channels per pixel
+* @param format			the format to encode to
+* @param filter			how the mip levels are averaged
+* @param &image			receives the compressed image
+* @param *pool			the threads to encode on, NULL encodes on the calling thread alone
+*/
+void compress_image(const unsigned char *pixels, int width, int height, int components, Block_Format format, Mip_Filter filter, Compressed_Image &image, Thread_Pool *pool = NULL);
+
+#endif
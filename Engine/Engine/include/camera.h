@@ -109,6 +109,13 @@ public:
 	* @param	y_offset		the difference in zoom to be applied
 	*/
 	void process_mouse_scroll(float y_offset);
+
+	/**
+	* @brief	sets the camera's rotation directly instead of through mouse input, used to replay a scripted camera path
+	* @param	yaw			the new yaw in degrees
+	* @param	pitch		the new pitch in degrees
+	*/
+	void set_rotation(float yaw, float pitch);
 	
 
 private:
@@ -0,0 +1,41 @@
+#ifndef __COMPRESSION_H__
+#define __COMPRESSION_H__
+
+#include <stddef.h>
+#include <vector>
+
+/**
+* @brief	compresses a block with a small LZ77 codec in the style of LZ4 (greedy hash matching, 64 KB window, byte aligned tokens)
+*			it is meant for caches on disk, decompressing runs at close to memcpy speed
+* @param *source	the data to compress
+* @param size		size of the data in bytes
+* @param &output	receives the compressed data, replacing its contents
+*/
+void lz_compress(const unsigned char *source, size_t size, std::vector<unsigned char> &output);
+
+/**
+* @brief	decompresses a block made by lz_compress
+* @param *source			the compressed data
+* @param size				size of the compressed data in bytes
+* @param *destination		receives the decompressed data
+* @param destination_size	the exact size of the decompressed data
+* @return	false if the data is corrupt or doesn't decompress to exactly destination_size bytes
+*/
+bool lz_decompress(const unsigned char *source, size_t size, unsigned char *destination, size_t destination_size);
+
+/**
+* @brief	transposes an array of fixed size elements so byte b of every element is stored together
+*			the high bytes of floats and indices are very similar, grouping them gives the compressor much longer matches
+* @param *source		the elements
+* @param size			size of the array in bytes, bytes after the last whole element are copied as they are
+* @param stride			size of an element in bytes
+* @param *destination	receives the transposed array, size bytes
+*/
+void shuffle_bytes(const unsigned char *source, size_t size, size_t stride, unsigned char *destination);
+
+/**
+* @brief	undoes shuffle_bytes
+*/
+void unshuffle_bytes(const unsigned char *source, size_t size, size_t stride, unsigned char *destination);
+
+#endif
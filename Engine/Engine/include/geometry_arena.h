@@ -0,0 +1,137 @@
+#ifndef __GEOMETRY_ARENA_H__
+#define __GEOMETRY_ARENA_H__
+
+#include <stddef.h>
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+
+struct Arena_Page;
+
+/**
+* @struct Geometry_Range
+* @brief	the vertices and indices of one mesh inside a page of the Geometry_Arena. The arena owns it and moves the data when it
+*			defragments, so the offsets have to be read at draw time rather than kept
+*/
+struct Geometry_Range
+{
+	Arena_Page *page;			/**< the page holding the data */
+	Vertex_Format format;		/**< the layout of the vertices */
+	unsigned int vao;			/**< the page's vertex array, shared by every range of the page */
+	int base_vertex;			/**< the first vertex in the page's vertex buffer, added to every index */
+	size_t index_offset;		/**< where the indices start in the page's index buffer, in bytes */
+	unsigned int vertex_count;	/**< number of vertices */
+	unsigned int index_count;	/**< number of indices */
+	GLenum index_type;			/**< GL_UNSIGNED_INT or GL_UNSIGNED_SHORT */
+};
+
+/**
+* @struct Geometry_Arena_Statistics
+* @brief	how full the arena is and what it did since the last reset
+*/
+struct Geometry_Arena_Statistics
+{
+	unsigned int pages;					/**< pages allocated */
+	unsigned int ranges;				/**< ranges alive */
+	unsigned long long vertex_bytes;	/**< bytes of the vertex buffers */
+	unsigned long long index_bytes;		/**< bytes of the index buffers */
+	unsigned long long used_bytes;		/**< bytes of the buffers the ranges use */
+	unsigned int free_ranges;			/**< free ranges over every page's buffers, more than two per page means fragmentation */
+	unsigned int defragmentations;		/**< pages compacted */
+	unsigned long long moved_bytes;		/**< bytes copied by the compactions */
+	unsigned long long reclaimed_bytes;	/**< bytes of free space between ranges the compactions closed up, now free in one piece at the end of the buffers */
+};
+
+/**
+* @class Geometry_Arena
+* @brief	Large shared vertex and index buffers the meshes are sub-allocated from, so meshes of the same Vertex_Format share a vertex array
+*			and consecutive draws only bind it once. Every format has its own pages, each with one vertex buffer, one index buffer and the
+*			vertex array describing them; the ranges inside a page come from a TLSF Range_Allocator and are drawn with glDrawElementsBaseVertex.
+*			A mesh too big for a page gets a page of its own size, and a page is deleted with its last range. defragment compacts the pages
+*			whose free space is split, copying the ranges to the front of new buffers on the GPU.
+*
+*			Everything is static like the Texture_Registry since the buffers belong to the render context, call it on the GL thread only
+*/
+class Geometry_Arena
+{
+public:
+
+	/**
+	* @brief	copies a mesh's vertices and indices into a page with room for them
+	* @param format			the layout of the vertices
+	* @param *vertices		the vertices, vertex_count of them in the format's layout
+	* @param vertex_count	number of vertices
+	* @param *indices		the indices, relative to the first vertex
+	* @param index_count	number of indices
+	* @param index_type		GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+	* @return	the range, owned by the arena until it is released
+	*/
+	static Geometry_Range *allocate(Vertex_Format format, const void *vertices, unsigned int vertex_count, const void *indices, unsigned int index_count, GLenum index_type);
+
+	/**
+	* @brief	frees a range, deleting its page if it was the last one in it
+	*/
+	static void release(Geometry_Range *range);
+
+	/**
+	* @brief	draws a range, binding its page's vertex array unless it is bound_vao already
+	* @param *range			the range to draw
+	* @param &bound_vao		the vertex array the caller knows is bound, updated when it changes
+	*/
+	static void draw(const Geometry_Range *range, unsigned int &bound_vao);
+
+	/**
+	* @brief	draws a run of a range's indices, a level of detail of the mesh for example
+	* @param *range			the range to draw from
+	* @param first_index	the first index to draw, relative to the range
+	* @param index_count	number of indices to draw
+	* @param &bound_vao		the vertex array the caller knows is bound, updated when it changes
+	*/
+	static void draw(const Geometry_Range *range, unsigned int first_index, unsigned int index_count, unsigned int &bound_vao);
+
+	/**
+	* @brief	draws several runs of a range's indices with one glMultiDrawElementsBaseVertex, the visible meshlets of a mesh for example
+	* @param *range			the range to draw from
+	* @param *first_indices	the first index of each run, relative to the range
+	* @param *index_counts	number of indices of each run
+	* @param run_count		number of runs
+	* @param &bound_vao		the vertex array the caller knows is bound, updated when it changes
+	*/
+	static void draw(const Geometry_Range *range, const unsigned int *first_indices, const unsigned int *index_counts, unsigned int run_count, unsigned int &bound_vao);
+
+	/**
+	* @brief	compacts every page whose free space is split into more than one range, call it after releasing ranges
+	* @return	the number of pages compacted, the bytes it reclaimed are added to the statistics
+	*/
+	static unsigned int defragment();
+
+	/**
+	* @brief	the size of the buffers of a new page, ranges that don't fit get a page of their own size
+	* @param vertex_bytes	bytes of the vertex buffer
+	* @param index_bytes	bytes of the index buffer
+	*/
+	static void set_page_size(size_t vertex_bytes, size_t index_bytes);
+
+	/**
+	* @brief	a copy of the statistics
+	*/
+	static Geometry_Arena_Statistics statistics();
+
+	/**
+	* @brief	resets the defragmentation counters, the rest describes the arena as it is
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	/**
+	* @brief	bytes of one vertex of a format
+	*/
+	static size_t vertex_size(Vertex_Format format);
+};
+
+#endif
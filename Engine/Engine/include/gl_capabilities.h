@@ -0,0 +1,22 @@
+#ifndef __GL_CAPABILITIES_H__
+#define __GL_CAPABILITIES_H__
+
+/**
+* @class Gl_Capabilities
+* @brief	What the current context supports. The extension list is read on the first query and kept, the context the engine
+*			renders with is created once and its extensions can't change while the program runs.
+*
+*			Everything is static and must be called on the GL thread
+*/
+class Gl_Capabilities
+{
+public:
+
+	/**
+	* @brief	check if the context has an extension
+	* @param *name		the extension's name as glGetStringi lists it, "GL_KHR_parallel_shader_compile"
+	*/
+	static bool has_extension(const char *name);
+};
+
+#endif
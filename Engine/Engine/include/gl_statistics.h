@@ -0,0 +1,144 @@
+#ifndef __GL_STATISTICS_H__
+#define __GL_STATISTICS_H__
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+* @enum Gl_Call_Type
+* @brief	the groups the intercepted GL calls are counted in
+*/
+enum Gl_Call_Type
+{
+	DRAW_CALL = 0,		/**< glDraw* */
+	BIND_CALL,			/**< glBind*, glUseProgram and glActiveTexture */
+	UNIFORM_CALL,		/**< glUniform* */
+	UNIFORM_LOOKUP,		/**< glGetUniformLocation and glGetUniformBlockIndex */
+	STATE_CALL,			/**< glEnable, glDisable, glViewport, glDepthFunc and the other fixed function state */
+	UPLOAD_CALL,		/**< glBufferData, glBufferSubData, glTexImage2D, glTexSubImage2D and glCompressedTexImage2D */
+	OTHER_CALL,			/**< glClear, glBlitFramebuffer and program linking */
+	GL_CALL_TYPE_COUNT
+};
+
+/**
+* @struct Gl_Counters
+* @brief	number of intercepted calls of each type
+*/
+struct Gl_Counters
+{
+	unsigned long long calls[GL_CALL_TYPE_COUNT];		/**< calls of each type */
+	unsigned long long redundant[GL_CALL_TYPE_COUNT];	/**< calls that set the state to what it already was */
+	unsigned long long skipped[GL_CALL_TYPE_COUNT];		/**< calls the engine didn't make because its own shadow state already held the value */
+	unsigned long long upload_bytes;					/**< bytes handed to buffer and texture uploads */
+};
+
+/**
+* @class Gl_Statistics
+* @brief	Counts the GL calls made each frame and each pass by replacing the glad function pointers with wrappers.
+*			The wrappers keep a shadow copy of the bindings, the fixed function state and every uniform value so they can flag calls
+*			that are exact duplicates of the current state. Uniforms set on location -1 are counted as redundant too since they do nothing.
+*			State changed behind the wrappers' back, by another context or before install, is treated as unknown so it is never flagged.
+*
+*			Everything is static since there is only one set of glad pointers, install it from the thread that owns the render context;
+*			calls from other threads (a Texture_Uploader with its shared context) pass straight through uncounted
+*/
+class Gl_Statistics
+{
+public:
+
+	/**
+	* @brief	replaces the glad function pointers with the counting wrappers, call after glad is loaded
+	*/
+	static void install();
+
+	/**
+	* @brief	restores the original glad function pointers
+	*/
+	static void uninstall();
+
+	/**
+	* @brief	check if the wrappers are installed
+	*/
+	static bool is_installed() { return s_installed; }
+
+	/**
+	* @brief	starts counting a frame, calls outside of a frame only update the shadow state
+	*/
+	static void begin_frame();
+
+	/**
+	* @brief	adds the calls of the current frame to the totals and reports them as profiler counters
+	*/
+	static void end_frame();
+
+	/**
+	* @brief	counts the following calls of the frame towards a pass, does nothing when not installed
+	* @param *name		name of the pass, has to be a string literal or otherwise outlive the statistics
+	*/
+	static void begin_pass(const char *name);
+
+	/**
+	* @brief	stops counting towards the current pass
+	*/
+	static void end_pass();
+
+	/**
+	* @brief	counts a call the engine skipped since it would have been redundant, like a Shader setter given the value the uniform
+	*			already has. Does nothing outside a frame
+	*/
+	static void record_skipped(Gl_Call_Type type);
+
+	/**
+	* @brief	resets all totals
+	*/
+	static void reset();
+
+	/**
+	* @brief	the calls made by the frame that was ended last
+	*/
+	static const Gl_Counters &last_frame() { return s_last_frame; }
+
+	/**
+	* @brief	prints the calls per frame, per pass and the functions with redundant calls to stdout
+	*/
+	static void print();
+
+	/**
+	* @brief	formats the calls per frame as JSON object members ("gl_calls", "gl_passes" and "gl_redundant_functions") followed by a comma
+	* @param *indent	the indentation of each member
+	* @return	the formatted members
+	*/
+	static std::string json_members(const char *indent);
+
+	/**
+	* @brief	name used for a call type in the output
+	*/
+	static const char *type_name(Gl_Call_Type type);
+
+private:
+
+	/**
+	* @struct Pass_Counters
+	* @brief	totals of the calls made inside a pass
+	*/
+	struct Pass_Counters
+	{
+		const char *name;		/**< name of the pass */
+		Gl_Counters counters;	/**< calls summed over every frame */
+	};
+
+	friend struct Gl_Statistics_Recorder;
+
+	static bool s_installed;						/**< the wrappers are installed */
+	static bool s_in_frame;							/**< between begin_frame and end_frame */
+	static int s_current_pass;						/**< index into s_passes of the current pass, -1 outside a pass */
+	static unsigned int s_frames;					/**< number of frames ended since the last reset */
+	static Gl_Counters s_frame;						/**< calls of the current frame */
+	static Gl_Counters s_last_frame;				/**< calls of the last ended frame */
+	static Gl_Counters s_total;						/**< calls of every frame since the last reset */
+	static std::vector<Pass_Counters> s_passes;		/**< calls of every pass since the last reset */
+};
+
+#endif
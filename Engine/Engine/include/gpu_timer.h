@@ -0,0 +1,150 @@
+#ifndef __GPU_TIMER_H__
+#define __GPU_TIMER_H__
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+* @struct Gpu_Timing
+* @brief	accumulated GPU time of a named pass or of a single draw
+*/
+struct Gpu_Timing
+{
+	std::string name;			/**< name of the pass, for draws the pass the draw was made in */
+	unsigned int draw;			/**< order of the draw inside its pass, unused for passes */
+	unsigned int index_count;	/**< number of indices drawn, unused for passes */
+	double last_ms;				/**< most recent result */
+	double total_ms;			/**< sum of every result, divide by samples for the mean */
+	double min_ms;				/**< fastest result */
+	double max_ms;				/**< slowest result */
+	unsigned int samples;		/**< number of results */
+};
+
+/**
+* @class Gpu_Timer
+* @brief	Measures the GPU time of each render pass with GL_TIME_ELAPSED queries.
+*			The queries of a frame are kept in a ring several frames deep and only read back once the ring wraps around to them,
+*			by then the GPU is done with them so reading the results never stalls the pipeline. Results that still aren't available
+*			are dropped instead of waited on.
+*			With m_capture_draws set every Mesh::draw is also timed individually with a pair of GL_TIMESTAMP queries,
+*			timestamps are used because elapsed time queries can't be nested inside a pass.
+*
+*			The passes and draws report to the active timer through the static functions so the scene and meshes don't need to know about it,
+*			when there is no active timer they do nothing
+*/
+class Gpu_Timer
+{
+public:
+
+	/**
+	* @brief	constructor
+	* @param latency	number of frames a query stays in flight before it is read back
+	*/
+	Gpu_Timer(unsigned int latency = 4);
+
+	/**
+	* @brief	deletes every query object, also clears the active timer if it is this one
+	*/
+	~Gpu_Timer();
+
+	/**
+	* @brief	makes this the timer that begin_pass, end_pass, begin_draw and end_draw report to
+	*/
+	void make_active() { s_active = this; }
+
+	/**
+	* @brief	starts a new frame, reading back the results of the frame that was started latency frames ago
+	*/
+	void begin_frame();
+
+	/**
+	* @brief	waits for every query still in flight and reads back the results, stalls so only use it when finished measuring
+	*/
+	void resolve_all();
+
+	/**
+	* @brief	resets all accumulated results
+	*/
+	void reset();
+
+	/**
+	* @brief	prints the mean GPU time of each pass and, when captured, the slowest draws to stdout
+	*/
+	void print();
+
+	/**
+	* @brief	formats the results as JSON object members ("gpu_ms" and, when captured, "gpu_draws") followed by a comma
+	* @param *indent	the indentation of each member
+	* @return	the formatted members
+	*/
+	std::string json_members(const char *indent);
+
+	/**
+	* @brief	starts timing a pass on the active timer, passes can't be nested
+	* @param *name		name of the pass, has to be a string literal or otherwise outlive the frame
+	*/
+	static void begin_pass(const char *name);
+
+	/**
+	* @brief	stops timing the current pass on the active timer
+	*/
+	static void end_pass();
+
+	/**
+	* @brief	starts timing a single draw on the active timer if it is capturing draws
+	* @param index_count	the number of indices drawn, to tell draws apart in the results
+	*/
+	static void begin_draw(unsigned int index_count);
+
+	/**
+	* @brief	stops timing the current draw on the active timer
+	*/
+	static void end_draw();
+
+	std::vector<Gpu_Timing> m_passes;	/**< accumulated results of each pass in the order they were first seen */
+	std::vector<Gpu_Timing> m_draws;	/**< accumulated results of each draw, in draw order */
+	bool m_capture_draws;				/**< time every Mesh::draw individually */
+	unsigned int m_dropped_frames;		/**< frames whose results weren't ready in time and were discarded */
+
+private:
+
+	/**
+	* @struct Frame_Queries
+	* @brief	the query objects used by one frame of the ring
+	*/
+	struct Frame_Queries
+	{
+		std::vector<unsigned int> pass_queries;			/**< GL_TIME_ELAPSED query per pass */
+		std::vector<const char *> pass_names;			/**< name of each pass */
+		unsigned int pass_count;						/**< number of pass queries used this frame */
+		std::vector<unsigned int> draw_queries;			/**< begin and end GL_TIMESTAMP query per draw */
+		std::vector<const char *> draw_passes;			/**< pass each draw was made in */
+		std::vector<unsigned int> draw_index_counts;	/**< index count of each draw */
+		unsigned int draw_count;						/**< number of draws timed this frame */
+		bool pending;									/**< true while the results haven't been read back */
+	};
+
+	/**
+	* @brief	reads the results of a frame into m_passes and m_draws
+	* @param &frame		the frame to read
+	* @param wait		wait for the results instead of dropping the frame when they aren't available
+	*/
+	void read_back(Frame_Queries &frame, bool wait);
+
+	/**
+	* @brief	adds a result to the timing with the given name and draw number, creating it if it is new
+	*/
+	static void accumulate(std::vector<Gpu_Timing> &timings, const char *name, unsigned int draw, unsigned int index_count, double ms);
+
+	static Gpu_Timer *s_active;			/**< the timer the static functions report to */
+
+	std::vector<Frame_Queries> m_frames;	/**< ring of frames in flight */
+	unsigned int m_current;					/**< index of the frame being recorded in m_frames */
+	const char *m_current_pass;				/**< name of the pass being timed, NULL between passes */
+	bool m_frame_started;					/**< begin_frame has been called at least once */
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include <stddef.h>
+
+static const unsigned long long fnv1a_offset = 14695981039346656037ull;	/**< the 64 bit FNV-1a starting value */
+static const unsigned long long fnv1a_prime = 1099511628211ull;			/**< the 64 bit FNV-1a multiplier */
+
+/**
+* @brief	64 bit FNV-1a hash of a block of bytes, not cryptographic but cheap and well spread for cache keys
+* @param *data		the bytes to hash
+* @param size		number of bytes
+* @param hash		the hash to continue from, to hash several blocks as one
+*/
+inline unsigned long long fnv1a(const void *data, size_t size, unsigned long long hash = fnv1a_offset)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * fnv1a_prime;
+	return hash;
+}
+
+/**
+* @brief	64 bit FNV-1a hash of a zero terminated string
+*/
+inline unsigned long long fnv1a_string(const char *string, unsigned long long hash = fnv1a_offset)
+{
+	for (; *string; string++)
+		hash = (hash ^ (unsigned char)*string) * fnv1a_prime;
+	return hash;
+}
+
+/**
+* @brief	fnv1a_string as a constexpr function, a string literal used to initialize a constexpr variable is hashed at compile time
+*			(written as a single return so compilers with C++11 constexpr rules take it)
+*/
+constexpr unsigned long long fnv1a_literal(const char *string, unsigned long long hash = fnv1a_offset)
+{
+	return *string ? fnv1a_literal(string + 1, (hash ^ (unsigned char)*string) * fnv1a_prime) : hash;
+}
+
+/**
+* @brief	mixes a value into a hash, for keys made of several fields
+*/
+inline unsigned long long hash_combine(unsigned long long hash, unsigned long long value)
+{
+	return fnv1a(&value, sizeof(value), hash);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __HEADLESS_CONTEXT_H__
+#define __HEADLESS_CONTEXT_H__
+
+#include <glad/glad.h>
+
+#include "shared_context.h"
+
+#if defined(ENGINE_USE_OSMESA)
+#include <GL/osmesa.h>
+#include <vector>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/**
+* @class Headless_Context
+* @brief	Creates an OpenGL 3.3 core context without a window, using EGL (or OSMesa when built with ENGINE_USE_OSMESA).
+*			Mesa's llvmpipe works with both so the engine can be run and profiled on machines with no GPU or display.
+*			Nothing is presented, so everything has to be drawn into a framebuffer object, see m_framebuffer_object
+*/
+class Headless_Context
+{
+public:
+
+	/**
+	* @brief	creates the context, makes it current and loads the OpenGL functions with glad
+	*			also creates the color/depth framebuffer of the given size that stands in for the window
+	* @param width		width of the offscreen framebuffer
+	* @param height		height of the offscreen framebuffer
+	*/
+	Headless_Context(unsigned int width, unsigned int height);
+
+	/**
+	* @brief	destroys the offscreen framebuffer and the context
+	*/
+	~Headless_Context();
+
+	/**
+	* @brief	check if the context was created and glad loaded successfully
+	* @return	true if OpenGL calls can be made
+	*/
+	bool is_valid() { return m_valid; }
+
+	/**
+	* @brief	prints the OpenGL vendor, renderer and version strings of the current context
+	*/
+	void print_info();
+
+	/**
+	* @brief	creates a second context sharing this one's objects, for a loader thread to make current with Shared_Context::make_current
+	* @return	the context owned by the caller, NULL if it couldn't be created
+	*/
+	Shared_Context *create_shared_context();
+
+	unsigned int m_framebuffer_object;		/**< offscreen framebuffer standing in for the window's default framebuffer */
+
+private:
+
+	/**
+	* @brief	creates the platform specific context and makes it current
+	* @return	true on success
+	*/
+	bool create_context();
+
+	/**
+	* @brief	creates m_framebuffer_object with a color texture and a depth/stencil renderbuffer
+	*/
+	void create_framebuffer();
+
+	unsigned int m_width;					/**< width of the offscreen framebuffer */
+	unsigned int m_height;					/**< height of the offscreen framebuffer */
+	unsigned int m_color_texture;			/**< color attachment of m_framebuffer_object */
+	unsigned int m_depth_renderbuffer;		/**< depth/stencil attachment of m_framebuffer_object */
+	bool m_valid;							/**< true once the context is current and glad is loaded */
+
+#if defined(ENGINE_USE_OSMESA)
+	OSMesaContext m_context;				/**< the OSMesa context */
+	std::vector<unsigned char> m_buffer;	/**< OSMesa needs a client side buffer to make the context current with */
+#else
+	EGLDisplay m_display;					/**< the EGL display, either the default device or Mesa's surfaceless platform */
+	EGLConfig m_config;						/**< the config m_context was created with, shared contexts use it too */
+	EGLContext m_context;					/**< the EGL context, made current without a surface */
+#endif
+};
+
+#endif
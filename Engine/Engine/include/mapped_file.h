@@ -0,0 +1,80 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <stddef.h>
+
+/**
+* @class Mapped_File
+* @brief	A read only memory mapping of a whole file (mmap on Linux, MapViewOfFile on Windows).
+*			Pages are only read from disk when they are touched, so handing a pointer into the mapping straight to glBufferData
+*			copies the file once with no parsing or intermediate buffers
+*/
+class Mapped_File
+{
+public:
+
+	/**
+	* @brief	maps the file, check is_valid before using the data
+	* @param *filepath		the file to map
+	*/
+	Mapped_File(const char *filepath);
+
+	/**
+	* @brief	unmaps the file
+	*/
+	~Mapped_File();
+
+	/**
+	* @brief	check if the file was opened and mapped
+	*/
+	bool is_valid() const { return m_data != NULL; }
+
+	/**
+	* @brief	the start of the mapping
+	*/
+	const unsigned char *data() const { return m_data; }
+
+	/**
+	* @brief	the size of the file in bytes
+	*/
+	size_t size() const { return m_size; }
+
+	/**
+	* @brief	asks the OS to start reading the whole file in now (madvise MADV_WILLNEED), so the first touch of a page doesn't wait on the disk.
+	*			Windows has no such hint for views before 8, one byte of every page is read instead
+	*/
+	void prefetch() const;
+
+private:
+
+	// not copyable, the mapping is owned
+	Mapped_File(const Mapped_File &);
+	Mapped_File &operator=(const Mapped_File &);
+
+	const unsigned char *m_data;	/**< the mapped file, NULL if it couldn't be mapped */
+	size_t m_size;					/**< size of the mapping */
+#ifdef _WIN32
+	void *m_file;					/**< the file handle */
+	void *m_mapping;				/**< the file mapping handle */
+#endif
+};
+
+/**
+* @brief	moves a file written in full over the file it replaces in one step (rename, MoveFileEx on Windows), so a reader maps either
+*			the old file or the whole new one and never a half written one. A file mapped on Windows can't be replaced
+* @param *temporary_path	the new file, removed if it can't be moved
+* @param *path				the file to replace, created if it doesn't exist
+* @return	false if the file couldn't be replaced
+*/
+bool replace_file(const char *temporary_path, const char *path);
+
+/**
+* @brief	writes a file to <path>.tmp and replaces the file with it, see replace_file
+* @param *path		the file to write
+* @param *data		its contents
+* @param size		bytes of the contents
+* @return	false if the temporary file couldn't be written or the file couldn't be replaced, nothing is left behind
+*/
+bool write_file_replacing(const char *path, const void *data, size_t size);
+
+#endif
@@ -11,6 +11,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
+#include "span.h"
+
+struct Geometry_Range;
+struct Meshlet_Set;
 
 /**
 * @enum Texture_Type
@@ -36,6 +40,65 @@ struct vertex
 	glm::vec2 texture_coordinates;		/**< texture coordinates for this vertex (specifies what part of the texture image to sample from) */
 };
 
+/**
+* @enum Vertex_Format
+* @brief	how a Mesh stores its vertices and indices on the GPU, the CPU side is always struct vertex
+*/
+enum Vertex_Format
+{
+	VERTEX_FLOAT = 0,		/**< struct vertex as it is, 32 bytes, and 32 bit indices */
+	VERTEX_QUANTIZED		/**< struct quantized_vertex, 16 bytes, and 16 bit indices when the mesh has at most 65536 vertices */
+};
+
+/**
+* @enum Mesh_Residency
+* @brief	what happens to the CPU copy of a mesh's vertices and indices once they are uploaded
+*/
+enum Mesh_Residency
+{
+	RESIDENCY_DISCARD = 0,		/**< freed after the upload, the GPU copy is the only one */
+	RESIDENCY_KEEP,				/**< kept in m_vertices and m_indices for CPU queries (picking, collision) */
+	RESIDENCY_ON_DEMAND			/**< freed after the upload, Model::page_in reads it back from the model's Mesh_Cache when a query needs it */
+};
+
+/**
+* @struct Memory_Usage
+* @brief	the bytes something holds in system memory and on the GPU
+*/
+struct Memory_Usage
+{
+	size_t cpu_bytes;		/**< system memory, CPU copies of the data and the bookkeeping around it */
+	size_t gpu_bytes;		/**< buffers and textures */
+
+	Memory_Usage(size_t cpu_bytes = 0, size_t gpu_bytes = 0) : cpu_bytes(cpu_bytes), gpu_bytes(gpu_bytes) {}
+
+	Memory_Usage &operator+=(const Memory_Usage &other)
+	{
+		cpu_bytes += other.cpu_bytes;
+		gpu_bytes += other.gpu_bytes;
+		return *this;
+	}
+};
+
+/**
+* @struct quantized_vertex
+* @brief	the compact GPU layout of a vertex, decoded by the vertex shaders with the mesh_position_* and mesh_octahedral_normals uniforms Mesh::draw sets
+*/
+struct quantized_vertex
+{
+	unsigned short position[4];				/**< the position as 16 bit unorm within the mesh's bounding box, the 4th is padding */
+	short normal[2];						/**< the normal octahedral encoded as 16 bit snorm */
+	unsigned short texture_coordinates[2];	/**< the texture coordinates as half floats */
+};
+
+/**
+* @brief	quantizes a vertex to the compact layout
+* @param &v				the vertex
+* @param bounds_min		minimum corner of the mesh's bounding box
+* @param bounds_max		maximum corner of the mesh's bounding box
+*/
+quantized_vertex quantize_vertex(const vertex &v, glm::vec3 bounds_min, glm::vec3 bounds_max);
+
 /**
 * @struct contains the data for a texture
 */
@@ -46,53 +109,204 @@ struct texture
 	aiString path;			/**< the path of the texture to compare with other textures */
 };
 
+/**
+* @struct Mesh_Lod
+* @brief	one level of detail of a mesh, a run of its index buffer over the same vertices as every other level
+*/
+struct Mesh_Lod
+{
+	unsigned int first_index;	/**< where the level's triangles start in the index buffer */
+	unsigned int index_count;	/**< number of indices of the level */
+	float error;				/**< how far the level is from the full detail surface in object space units, 0 for the full detail */
+};
+
+/**
+* @struct Mesh_Data
+* @brief	the CPU side of a mesh as it is imported, before its buffers and textures exist
+*			it touches no GL so it can be built on any thread and turned into a Mesh on the GL thread later
+*/
+struct Mesh_Data
+{
+	std::vector<vertex> vertices;			/**< the final vertices */
+	std::vector<unsigned int> indices;		/**< the final triangle indices, every level of detail one after the other with the full detail first */
+	std::vector<Mesh_Lod> lods;				/**< the levels of detail in indices, empty if the indices are only the full detail */
+	std::vector<texture> textures;			/**< the material's textures, their ids are 0 until Model loads them */
+	glm::vec3 bounds_min;					/**< minimum corner of the bounding box of the vertex positions */
+	glm::vec3 bounds_max;					/**< maximum corner of the bounding box of the vertex positions */
+};
+
+/**
+* @brief	computes the axis aligned bounding box of the positions of the given vertices, zero if there are none
+* @param vertices		the vertices
+* @param &bounds_min	receives the minimum corner
+* @param &bounds_max	receives the maximum corner
+*/
+void vertex_bounds(Span<vertex> vertices, glm::vec3 &bounds_min, glm::vec3 &bounds_max);
+
 /**
 * @class Mesh
 * @brief	A simple Mesh class which will be used to load and draw Mesh data
 *			uses indexed drawing and can handle multiple textures per mesh
+*			the vertices and indices live in a range of the Geometry_Arena shared with the other meshes of the same format,
+*			a Mesh owns its range, so it can be moved (into a vector for example) but not copied
 */
 class Mesh 
 {
 public:
 
 	/**
-	* @brief	constructor gives the mesh all the necesarry data from the input parameters
+	* @brief	constructor gives the mesh all the necesarry data from the input parameters, the vectors are moved in so nothing is copied
 	*			also calls setup_mesh to initialize the buffers
-	* @param vertices	each vertex that makes up this Mesh
-	* @param indices	the indices to draw in order (each index refers to an individual vertex inside m_vertices)
-	* @param textures	all of the textures corresponding to this Mesh (diffuse, specular, and emission maps)
+	* @param &&vertices	each vertex that makes up this Mesh
+	* @param &&indices	the indices to draw in order (each index refers to an individual vertex inside m_vertices)
+	* @param &&textures	all of the textures corresponding to this Mesh (diffuse, specular, and emission maps)
+	* @param format		how the buffers store the vertices and indices
+	* @param residency	what happens to the CPU copy once it is uploaded
 	*/
-	Mesh(std::vector<vertex> vertices, std::vector<unsigned int> indices, std::vector<texture> textures);
+	Mesh(std::vector<vertex> &&vertices, std::vector<unsigned int> &&indices, std::vector<texture> &&textures, Vertex_Format format = VERTEX_FLOAT,
+		Mesh_Residency residency = RESIDENCY_DISCARD);
 
 	/**
-	* @brief	draws the mesh with the given shader program (binding each texture if enabled) and using glDrawElements
-	* @param shader			the shader program to draw this Mesh
+	* @brief	constructor for imported mesh data, the vectors are moved in and the bounds are taken as they are
+	* @param &&data		the mesh data, its texture ids have to be loaded already
+	* @param format		how the buffers store the vertices and indices
+	* @param residency	what happens to the CPU copy once it is uploaded
+	*/
+	Mesh(Mesh_Data &&data, Vertex_Format format = VERTEX_FLOAT, Mesh_Residency residency = RESIDENCY_DISCARD);
+
+	/**
+	* @brief	constructor for meshes read from a Mesh_Cache, uploads the vertices and indices straight from the given memory (usually the mapped cache file)
+	*			a CPU copy is only made for RESIDENCY_KEEP, m_vertices and m_indices stay empty otherwise
+	* @param vertices		the vertices to upload
+	* @param indices		the indices to upload
+	* @param &&textures		all of the textures corresponding to this Mesh
+	* @param bounds_min		the minimum corner of the mesh's bounding box, stored in the cache so it isn't recomputed
+	* @param bounds_max		the maximum corner of the mesh's bounding box
+	* @param lods			the levels of detail in indices, empty if the indices are only the full detail
+	* @param format			how the buffers store the vertices and indices
+	* @param residency		what happens to the CPU copy once it is uploaded
+	*/
+	Mesh(Span<vertex> vertices, Span<unsigned int> indices, std::vector<texture> &&textures, glm::vec3 bounds_min, glm::vec3 bounds_max, Span<Mesh_Lod> lods,
+		Vertex_Format format = VERTEX_FLOAT, Mesh_Residency residency = RESIDENCY_DISCARD);
+
+	/**
+	* @brief	takes over the other mesh's data and buffers, leaving it empty
+	*/
+	Mesh(Mesh &&other);
+	Mesh &operator=(Mesh &&other);
+
+	/**
+	* @brief	releases the range and the meshlets
+	*/
+	~Mesh();
+
+	/**
+	* @brief	draws the mesh with the given shader program (binding each texture if enabled) and using glDrawElementsBaseVertex,
+	*			or only its visible meshlets with glMultiDrawElementsBaseVertex when the Meshlet_Culler culled them for the picked level.
+	*			A quantized mesh sets the shader's decode uniforms for its draw and puts the float defaults back after it
+	* @param &shader		the shader program to draw this Mesh
 	* @param use_textures	flag to turn off binding textures
 	*/
-	void draw(Shader shader, bool use_textures);
+	void draw(const Shader &shader, bool use_textures) const;
+
+	/**
+	* @brief	draws the mesh without unbinding its vertex array afterwards, so a run of meshes in the same arena page binds it once
+	* @param &shader		the shader program to draw this Mesh
+	* @param use_textures	flag to turn off binding textures
+	* @param &bound_vao		the vertex array the caller knows is bound, updated when the mesh binds its own
+	*/
+	void draw(const Shader &shader, bool use_textures, unsigned int &bound_vao) const;
+
+	/**
+	* @brief	picks the coarsest level of detail whose error projects to at most threshold pixels, the mesh draws it until the next pick.
+	*			A finer level is picked as soon as the current one is over the threshold, a coarser one only once it is under
+	*			threshold * (1 - hysteresis), so a mesh sitting at the boundary keeps its level
+	* @param pixels_per_unit	how many pixels an object space unit of the mesh covers at its nearest point
+	* @param threshold			the screen space error allowed, in pixels
+	* @param hysteresis			the fraction of the threshold a coarser level has to stay under
+	* @return	true if the level changed
+	*/
+	bool select_lod(float pixels_per_unit, float threshold, float hysteresis);
+
+	/**
+	* @brief	the level of detail drawn, 0 is the full detail
+	*/
+	unsigned int get_lod() const { return m_lod; }
 
 	/**
 	* @brief	getter for the vertex array object, quick hack so we can get set an attribute as an instanced array
+	*			it is the arena page's vertex array, an attribute set on it applies to every mesh in the page
 	* @return	the mesh's vao
 	*/
-	unsigned int get_vao() { return vao; }
+	unsigned int get_vao() const;
+
+	/**
+	* @brief	bytes of the vertex and index buffers
+	*/
+	size_t buffer_bytes() const;
+
+	/**
+	* @brief	the system memory the mesh holds (its CPU copy, levels of detail, meshlets and texture bindings) and its vertex and index buffers.
+	*			The textures are counted by the Model, several meshes share them
+	*/
+	Memory_Usage memory_usage() const;
+
+	/**
+	* @brief	check if m_vertices and m_indices hold the mesh's data
+	*/
+	bool is_resident() const { return m_vertices.size() == m_vertex_count && m_indices.size() == m_index_count; }
+
+	/**
+	* @brief	gives the mesh its CPU copy back, usually read from the Mesh_Cache by Model::page_in
+	* @param &&vertices		the vertices the mesh was created with
+	* @param &&indices		the indices the mesh was created with
+	*/
+	void page_in(std::vector<vertex> &&vertices, std::vector<unsigned int> &&indices);
+
+	/**
+	* @brief	frees the CPU copy, unless the mesh's residency is RESIDENCY_KEEP
+	*/
+	void page_out();
 
 	// Mesh Data
 	std::vector<vertex> m_vertices; 			/**< a vector of all the vertices in this Mesh, each containing position, normal, and texture_coordinates */
 	std::vector<unsigned int> m_indices;		/**< a vector of all the vertex indices to be drawn (using glDrawElements) or this Mesh */
 	std::vector<texture> m_textures;			/**< all the textures for this Mesh */
+	unsigned int m_vertex_count;				/**< number of vertices in the vbo, also valid when m_vertices is empty */
+	unsigned int m_index_count;					/**< number of indices in the ebo with every level of detail, also valid when m_indices is empty */
+	std::vector<Mesh_Lod> m_lods;				/**< the levels of detail, at least the full detail one */
+	unsigned int m_lod;							/**< the level of detail drawn */
+	glm::vec3 m_bounds_min;						/**< minimum corner of the axis aligned bounding box of the vertex positions */
+	glm::vec3 m_bounds_max;						/**< maximum corner of the axis aligned bounding box of the vertex positions */
+	Vertex_Format m_format;						/**< how the buffers store the vertices */
+	GLenum m_index_type;						/**< GL_UNSIGNED_INT, or GL_UNSIGNED_SHORT for small quantized meshes */
+	Mesh_Residency m_residency;					/**< what happens to m_vertices and m_indices once they are uploaded */
+	Meshlet_Set *m_meshlets;					/**< the meshlets of every level of detail and the runs of the last cull, NULL without indices or once moved from */
 
 private:
 
+	// not copyable, the buffers are owned
+	Mesh(const Mesh &);
+	Mesh &operator=(const Mesh &);
+
 	/**
-	* @brief initializes the buffers for drawing and specifies the shader layout with vertex attribute pointers 
+	* @brief copies the vertices and indices into a range of the Geometry_Arena
+	*		 also sets m_vertex_count, m_index_count and m_index_type, quantizing the data first if m_format asks for it,
+	*		 gives m_lods the full detail level if it has none and splits every level into meshlets,
+	*		 then keeps or frees the CPU copy as m_residency says
+	* @param vertices		the vertex data to upload
+	* @param indices		the index data to upload
 	*/
-	void setup_mesh();
+	void setup_mesh(Span<vertex> vertices, Span<unsigned int> indices);
+
+	/**
+	* @brief builds and hashes the sampler uniform name of each texture once, so drawing doesn't build strings every frame
+	*/
+	void setup_texture_uniforms();
+
+	std::vector<Uniform_Name> m_texture_uniforms;	/**< the "material.<type>_map<N>" uniform for each texture in m_textures */
 
-	// Mesh buffers
-	unsigned int vao;		/**< the vertex array object with the attribute data */
-	unsigned int vbo;		/**< the vertex buffer object with all the vertex data */
-	unsigned int ebo;		/**< the element buffer object, which stores which vertices to draw */
+	Geometry_Range *m_range;	/**< where the vertices and indices are in the arena, NULL once moved from */
 
 };
 
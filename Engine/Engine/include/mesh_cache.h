@@ -0,0 +1,107 @@
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include "span.h"
+
+/**
+* @struct Cached_Mesh
+* @brief	one mesh read from a Mesh_Cache, the pointers are into the mapped file (or the cache's scratch buffer when it is compressed)
+*			and stay valid until the next read_mesh or until the cache is destroyed
+*/
+struct Cached_Mesh
+{
+	Span<vertex> vertices;			/**< the final vertices, ready for glBufferData */
+	Span<unsigned int> indices;		/**< the final triangle indices of every level of detail, ready for glBufferData */
+	Span<Mesh_Lod> lods;			/**< the levels of detail in indices, pointing into the mapped file */
+	unsigned int texture_first;		/**< the first of this mesh's textures in the cache's texture table */
+	unsigned int texture_count;		/**< number of textures this mesh uses */
+	glm::vec3 bounds_min;			/**< minimum corner of the mesh's bounding box */
+	glm::vec3 bounds_max;			/**< maximum corner of the mesh's bounding box */
+};
+
+/**
+* @class Mesh_Cache
+* @brief	A versioned binary copy of an imported model stored next to the source as <source>.meshcache.
+*			It holds the vertex and index arrays exactly as Model::import_mesh produced them, the material texture paths and the bounds of every mesh,
+*			so a reload maps the file and uploads from it without running Assimp. The cache is rebuilt when the size or modification time of the source or of
+*			a file the import read with it (an OBJ's material library),
+*			the import flags, the Mesh_Optimizer setting, the Mesh_Simplifier level count or ratio, the vertex layout or the format version change. The vertex and index streams can optionally be compressed (see s_compress)
+*/
+class Mesh_Cache
+{
+public:
+
+	/**
+	* @brief	maps <source_path>.meshcache and validates it against the source file, check is_valid before reading
+	* @param &source_path	the path of the model the cache was built from
+	* @param import_flags	the Assimp post processing flags the model is imported with
+	*/
+	Mesh_Cache(const std::string &source_path, unsigned int import_flags);
+
+	/**
+	* @brief	check if the cache exists, is up to date and is well formed
+	*/
+	bool is_valid() const { return m_valid; }
+
+	/**
+	* @brief	the number of meshes in the cache
+	*/
+	unsigned int mesh_count() const;
+
+	/**
+	* @brief	reads a mesh, decompressing its streams if the cache is compressed
+	* @param index		which mesh, less than mesh_count
+	* @param &mesh		receives the mesh
+	* @return	false if the streams are corrupt
+	*/
+	bool read_mesh(unsigned int index, Cached_Mesh &mesh);
+
+	/**
+	* @brief	the path of a texture in the texture table, as it was stored in the material
+	*/
+	const char *texture_path(unsigned int index) const;
+
+	/**
+	* @brief	the type of a texture in the texture table
+	*/
+	Texture_Type texture_type(unsigned int index) const;
+
+	/**
+	* @brief	writes the cache for a model, to a temporary file first which then replaces the old cache
+	* @param &source_path	the path of the model the meshes were imported from
+	* @param import_flags	the Assimp post processing flags the model was imported with
+	* @param &dependencies	the files the import read, their size and modification time are recorded (the source itself is skipped)
+	* @param &meshes		the imported meshes
+	* @return	false if the file couldn't be written, an error is printed
+	*/
+	static bool write(const std::string &source_path, unsigned int import_flags, const std::vector<std::string> &dependencies, const std::vector<Mesh_Data> &meshes);
+
+	/**
+	* @brief	the path of the cache file for a model
+	*/
+	static std::string cache_path(const std::string &source_path);
+
+	static bool s_enabled;		/**< Model reads and writes caches, on by default */
+	static bool s_compress;		/**< write compressed vertex and index streams, they are smaller but have to be decompressed instead of uploaded from the mapping */
+
+private:
+
+	/**
+	* @brief	checks the header, the tables and every stream's bounds against the file size
+	*/
+	bool validate(const std::string &source_path, unsigned int import_flags);
+
+	Mapped_File m_file;							/**< the mapped cache */
+	bool m_valid;								/**< if the cache can be read */
+	std::vector<unsigned char> m_scratch;		/**< decompressed streams of the last compressed mesh read */
+	std::vector<unsigned char> m_shuffled;		/**< decompressed stream before it is unshuffled */
+};
+
+#endif
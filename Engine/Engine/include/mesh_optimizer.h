@@ -0,0 +1,130 @@
+#ifndef __MESH_OPTIMIZER_H__
+#define __MESH_OPTIMIZER_H__
+
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "span.h"
+
+static const unsigned int vertex_cache_size = 16;		/**< entries of the FIFO post transform cache the meshes are analyzed with, what most GPUs reuse at least */
+
+/**
+* @struct Vertex_Cache_Analysis
+* @brief	how an index buffer uses the post transform vertex cache
+*/
+struct Vertex_Cache_Analysis
+{
+	unsigned int transformed;	/**< vertex shader invocations, the cache misses of the simulation */
+	float acmr;					/**< average cache miss ratio, transformed vertices per triangle: 3 without any reuse, around 0.6 at best for a regular grid */
+	float atvr;					/**< average transformed vertex ratio, transformed vertices per vertex: 1 is ideal */
+};
+
+/**
+* @struct Mesh_Optimization_Report
+* @brief	what Mesh_Optimizer::optimize did to one mesh
+*/
+struct Mesh_Optimization_Report
+{
+	std::string name;					/**< the mesh's name in the model */
+	unsigned int triangles;				/**< triangles after the degenerate ones were dropped */
+	unsigned int vertices_before;		/**< vertices as they were imported */
+	unsigned int vertices_after;		/**< vertices once the identical ones are welded */
+	Vertex_Cache_Analysis before;		/**< the imported order, its ATVR is against the welded vertex count so both sides compare */
+	Vertex_Cache_Analysis after;		/**< the optimized order */
+	double optimize_ms;					/**< time the optimization took */
+};
+
+/**
+* @struct Mesh_Optimizer_Statistics
+* @brief	the sum of the reports since the last reset
+*/
+struct Mesh_Optimizer_Statistics
+{
+	unsigned int meshes;						/**< meshes optimized */
+	unsigned long long triangles;				/**< their triangles */
+	unsigned long long vertices_before;			/**< their vertices as imported */
+	unsigned long long vertices_after;			/**< their vertices once welded */
+	unsigned long long transformed_before;		/**< vertex shader invocations of the imported order */
+	unsigned long long transformed_after;		/**< vertex shader invocations of the optimized order */
+	double optimize_ms;							/**< time spent optimizing, summed over the threads that imported */
+};
+
+/**
+* @brief	simulates a FIFO post transform cache over an index buffer
+* @param indices		the triangles
+* @param vertex_count	the number of vertices the ATVR is taken against
+* @param cache_size		entries of the simulated cache
+*/
+Vertex_Cache_Analysis analyze_vertex_cache(Span<unsigned int> indices, unsigned int vertex_count, unsigned int cache_size = vertex_cache_size);
+
+/**
+* @brief	merges the vertices that are bit for bit identical and drops the triangles that become degenerate, the surviving vertices keep their order
+* @return	the number of vertices removed
+*/
+unsigned int weld_vertices(std::vector<vertex> &vertices, std::vector<unsigned int> &indices);
+
+/**
+* @brief	reorders the triangles for the post transform cache with Forsyth's linear speed algorithm, scored against a 32 entry LRU cache
+* @param &indices		the triangles to reorder
+* @param vertex_count	the number of vertices they index
+*/
+void optimize_vertex_cache(std::vector<unsigned int> &indices, unsigned int vertex_count);
+
+/**
+* @brief	reorders clusters of a cache optimized index buffer so the triangles facing out of the mesh draw first and hide the ones behind them
+*			(Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). The clusters are cut wherever the
+*			cache is cold anyway and wherever their ACMR is within threshold of the whole run's, so the cache efficiency is mostly kept
+* @param &indices		the triangles, already optimized for the vertex cache
+* @param &vertices		the vertices they index
+* @param threshold		how much worse than the cache optimized order a cluster's ACMR may get, 1.05 allows 5%
+*/
+void optimize_overdraw(std::vector<unsigned int> &indices, const std::vector<vertex> &vertices, float threshold = 1.05f);
+
+/**
+* @brief	reorders the vertices in the order the triangles first use them so fetching them walks through memory, the unused ones are dropped
+*/
+void optimize_vertex_fetch(std::vector<vertex> &vertices, std::vector<unsigned int> &indices);
+
+/**
+* @class Mesh_Optimizer
+* @brief	The import time optimization of every mesh: the identical vertices are welded (Assimp's aiProcess_JoinIdenticalVertices isn't used),
+*			the triangles are reordered for the vertex cache and then for overdraw, and the vertices for fetch locality.
+*			Model runs it on every mesh it imports with Assimp, the Mesh_Cache stores the result so a cached load doesn't pay for it again.
+*			Everything is static like the Texture_Cache, optimize is thread safe
+*/
+class Mesh_Optimizer
+{
+public:
+
+	/**
+	* @brief	optimizes an imported mesh in place and records its report
+	* @param &data		the mesh, its bounds are updated
+	* @param *name		the mesh's name for the report
+	*/
+	static void optimize(Mesh_Data &data, const char *name);
+
+	/**
+	* @brief	a copy of the statistics, safe to call from any thread
+	*/
+	static Mesh_Optimizer_Statistics statistics();
+
+	/**
+	* @brief	a copy of the report of every mesh optimized since the last reset
+	*/
+	static std::vector<Mesh_Optimization_Report> reports();
+
+	/**
+	* @brief	resets the statistics and drops the reports
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics and the ACMR and ATVR of every mesh before and after to stdout
+	*/
+	static void print();
+
+	static bool s_enabled;		/**< Model optimizes the meshes it imports, on by default */
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __MESH_SIMPLIFIER_H__
+#define __MESH_SIMPLIFIER_H__
+
+#include <vector>
+
+#include "mesh.h"
+#include "span.h"
+
+static const unsigned int max_lod_count = 8;		/**< the most levels of detail a mesh can have, the full detail one included */
+
+/**
+* @struct Mesh_Simplifier_Statistics
+* @brief	the level of detail chains built and the levels picked since the last reset
+*/
+struct Mesh_Simplifier_Statistics
+{
+	unsigned int meshes;								/**< meshes given a chain */
+	unsigned long long level_triangles[max_lod_count];	/**< triangles of each level summed over the meshes, level 0 is the full detail */
+	unsigned int level_meshes[max_lod_count];			/**< meshes that got each level, simplification stops early when it can't reduce a mesh further */
+	double simplify_ms;									/**< time spent simplifying, summed over the threads that imported */
+	unsigned long long level_selections[max_lod_count];	/**< times Model::select_lods picked each level */
+	unsigned long long selected_triangles;				/**< triangles of the picked levels */
+	unsigned long long full_triangles;					/**< triangles the picked meshes have at full detail */
+	unsigned long long switches;						/**< picks that changed a mesh's level */
+};
+
+/**
+* @brief	simplifies a triangle mesh to about target_index_count indices by collapsing edges in order of their quadric error
+*			(Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"). A vertex only ever collapses onto one of its
+*			neighbours, so the result indexes the same vertices and can share their buffer. Vertices with several attribute sets at one
+*			position (texture seams) and non manifold ones are locked, open borders only collapse along themselves, and a collapse that
+*			would flip a triangle is skipped, so the result can stay above the target
+* @param vertices				the vertices
+* @param indices				the triangles to simplify
+* @param target_index_count		the number of indices to get down to
+* @param &error					receives the error of the result, the root mean square distance of the worst collapse in object space units
+* @return	the simplified triangles
+*/
+std::vector<unsigned int> simplify_mesh(Span<vertex> vertices, Span<unsigned int> indices, size_t target_index_count, float &error);
+
+/**
+* @class Mesh_Simplifier
+* @brief	Builds the level of detail chain of every imported mesh: each level is simplified from the one before it to s_lod_ratio of its
+*			triangles and appended to the mesh's index buffer, so every level shares the vertex buffer. The levels record their object space
+*			error, which Model::select_lods projects to pixels to pick a level per mesh every frame. Model runs it after the Mesh_Optimizer,
+*			the Mesh_Cache stores the chains. Everything is static like the Mesh_Optimizer, build_lods is thread safe
+*/
+class Mesh_Simplifier
+{
+public:
+
+	/**
+	* @brief	appends the levels of detail of a mesh to its indices and fills its lods
+	* @param &data		the mesh with its full detail indices and no lods yet
+	*/
+	static void build_lods(Mesh_Data &data);
+
+	/**
+	* @brief	records the levels a model picked for a frame, safe to call from any thread
+	* @param *level_selections		how many meshes picked each level, max_lod_count entries
+	* @param selected_triangles		triangles of the picked levels
+	* @param full_triangles			triangles of the same meshes at full detail
+	* @param switches				meshes whose level changed
+	*/
+	static void record_selections(const unsigned int *level_selections, unsigned int selected_triangles, unsigned int full_triangles, unsigned int switches);
+
+	/**
+	* @brief	a copy of the statistics, safe to call from any thread
+	*/
+	static Mesh_Simplifier_Statistics statistics();
+
+	/**
+	* @brief	resets the statistics
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	static unsigned int s_lod_count;		/**< levels per mesh with the full detail one, 1 turns the chains off, 4 by default */
+	static float s_lod_ratio;				/**< the triangles of each level relative to the one before it, 0.5 by default */
+	static float s_error_threshold;			/**< the screen space error in pixels a level may have to be picked, 1 by default */
+	static float s_hysteresis;				/**< the fraction of the threshold a coarser level has to stay under before a mesh switches to it, so a mesh at the boundary doesn't pop back and forth, 0.25 by default */
+};
+
+#endif
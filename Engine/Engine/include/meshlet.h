@@ -0,0 +1,139 @@
+#ifndef __MESHLET_H__
+#define __MESHLET_H__
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "span.h"
+
+static const unsigned int meshlet_max_vertices = 64;		/**< the most vertices a meshlet references */
+static const unsigned int meshlet_max_triangles = 124;		/**< the most triangles a meshlet has */
+
+/**
+* @struct Meshlet_Set
+* @brief	the meshlets of every level of detail of a mesh and the result of the last cull. Each meshlet is a run of the mesh's index buffer,
+*			so splitting a mesh doesn't change its indices and the visible runs draw straight from its arena range. The bounds are stored
+*			as a structure of arrays so the cull loop loads 4 meshlets at once
+*/
+struct Meshlet_Set
+{
+	std::vector<float> center_x, center_y, center_z;	/**< centers of the bounding spheres, in object space */
+	std::vector<float> radius;							/**< radii of the bounding spheres */
+	std::vector<float> cone_x, cone_y, cone_z;			/**< axes of the normal cones, the average direction the triangles face */
+	std::vector<float> cone_cutoff;						/**< sine of the angle between the axis and the normal furthest from it, 1 for a cone that can't be culled */
+	std::vector<unsigned int> first_index;				/**< where each meshlet's triangles start in the index buffer */
+	std::vector<unsigned int> index_count;				/**< number of indices of each meshlet */
+	std::vector<unsigned int> lod_meshlets;				/**< the first meshlet of each level of detail, and one past the last meshlet at the end */
+	std::vector<unsigned char> visible;					/**< whether each meshlet passed the last cull, only the culled level's entries are current */
+	std::vector<unsigned int> draw_first;				/**< first index of each run of adjacent visible meshlets */
+	std::vector<unsigned int> draw_count;				/**< number of indices of each run */
+	unsigned int draw_indices;							/**< number of indices of all the runs */
+	unsigned int draw_lod;								/**< the level the runs were culled for, the mesh draws the whole level when it picked another one since */
+
+	/**
+	* @brief	bytes of the set and its arrays
+	*/
+	size_t cpu_bytes() const;
+};
+
+/**
+* @brief	reorders the triangles of every level of detail of an imported mesh into meshlets that cull well: each one grows from a seed through
+*			the triangles sharing its vertices, preferring the ones that add the fewest vertices and face closest to its average normal, so it
+*			stays a compact patch with a narrow normal cone. A meshlet only ends with a triangle that doesn't fit in it, so build_meshlets splits
+*			the reordered indices into the same meshlets. Model runs it after the Mesh_Simplifier, it touches no GL and is thread safe
+* @param &data		the mesh with its levels of detail
+*/
+void cluster_meshlets(Mesh_Data &data);
+
+/**
+* @brief	splits every level of detail of a mesh into meshlets of at most meshlet_max_vertices vertices and meshlet_max_triangles triangles.
+*			The triangles are taken in the order of the index buffer, a meshlet ends where the next triangle doesn't fit, which finds the
+*			meshlets cluster_meshlets ordered the triangles into
+* @param vertices	the mesh's vertices
+* @param indices	the mesh's indices, every level of detail
+* @param lods		the levels of detail in indices, at least the full detail one
+* @return	the meshlets, the caller owns them. They are counted in the Meshlet_Culler statistics
+*/
+Meshlet_Set *build_meshlets(Span<vertex> vertices, Span<unsigned int> indices, Span<Mesh_Lod> lods);
+
+/**
+* @struct Meshlet_Cull_View
+* @brief	what a model is seen from, in the object space of its meshes
+*/
+struct Meshlet_Cull_View
+{
+	glm::vec4 planes[6];		/**< the frustum planes facing inwards, normalized so a point's distance is dot(plane.xyz, p) + plane.w */
+	glm::vec3 viewpoint;		/**< the eye, the cone test culls meshlets facing away from it */
+	bool frustum;				/**< false only runs the cone test, for views without a single frustum like the shadow cube map */
+};
+
+/**
+* @struct Meshlet_Culler_Statistics
+* @brief	the meshlets tested and culled since the last reset
+*/
+struct Meshlet_Culler_Statistics
+{
+	unsigned int meshes;					/**< meshes split into meshlets */
+	unsigned long long built_meshlets;		/**< meshlets built over every level of detail */
+	unsigned int passes;					/**< calls to cull */
+	unsigned long long meshlets;			/**< meshlets tested */
+	unsigned long long frustum_culled;		/**< meshlets outside the frustum */
+	unsigned long long cone_culled;			/**< meshlets inside the frustum but facing away from the viewpoint */
+	unsigned long long triangles;			/**< triangles of the tested levels */
+	unsigned long long drawn_triangles;		/**< triangles of the visible meshlets */
+	unsigned long long draw_runs;			/**< runs of adjacent visible meshlets, the draws the multi draws are made of */
+	double cull_ms;							/**< time spent culling */
+};
+
+/**
+* @class Meshlet_Culler
+* @brief	Culls the meshlets of a model's meshes on the CPU before a pass draws them: a meshlet whose bounding sphere is outside the frustum,
+*			or whose normal cone faces away from the viewpoint (so every triangle in it would be back face culled), isn't drawn. The visible
+*			meshlets of a mesh merge into runs that Mesh::draw submits with one glMultiDrawElementsBaseVertex. The meshlets of all the meshes
+*			are tested in blocks on a thread pool, 4 at a time with SSE2 where it is available. Everything is static like the Mesh_Simplifier
+*/
+class Meshlet_Culler
+{
+public:
+
+	/**
+	* @brief	moves a view into the object space of a model, the planes are taken from view_projection * transform
+	*			(Gribb and Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix")
+	* @param &transform			the model matrix
+	* @param &view_projection	the projection times the view matrix of the pass, unused without frustum
+	* @param viewpoint			the eye in world space
+	* @param frustum			whether to test the frustum
+	*/
+	static Meshlet_Cull_View object_view(const glm::mat4 &transform, const glm::mat4 &view_projection, glm::vec3 viewpoint, bool frustum);
+
+	/**
+	* @brief	culls the meshlets of the picked level of detail of each mesh and builds their draw runs, must be called on the GL thread
+	*			between picking the levels and drawing. Does nothing but make the meshes draw whole levels when s_enabled is off
+	* @param *meshes		the meshes
+	* @param mesh_count		number of meshes
+	* @param &view			the view in the meshes' object space
+	*/
+	static void cull(Mesh *meshes, size_t mesh_count, const Meshlet_Cull_View &view);
+
+	/**
+	* @brief	a copy of the statistics, safe to call from any thread
+	*/
+	static Meshlet_Culler_Statistics statistics();
+
+	/**
+	* @brief	resets the statistics
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	static bool s_enabled;				/**< culls the meshlets, on by default */
+	static unsigned int s_grain;		/**< the fewest meshlets a thread culls at once, 256 by default */
+};
+
+#endif
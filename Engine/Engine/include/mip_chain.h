@@ -0,0 +1,71 @@
+#ifndef __MIP_CHAIN_H__
+#define __MIP_CHAIN_H__
+
+#include <stddef.h>
+#include <vector>
+
+class Thread_Pool;
+
+/**
+* @enum Mip_Filter
+* @brief	how the mip levels of an image are averaged
+*/
+enum Mip_Filter
+{
+	MIP_FILTER_SRGB = 0,	/**< the color channels are averaged in linear light (decoded from sRGB and encoded again), alpha as it is; for color images */
+	MIP_FILTER_LINEAR		/**< every channel is averaged as it is stored; for data like normal maps */
+};
+
+/**
+* @struct Mip_Level
+* @brief	one level of a Mip_Chain
+*/
+struct Mip_Level
+{
+	int width;			/**< width of the level in pixels */
+	int height;			/**< height of the level in pixels */
+	size_t offset;		/**< where the level starts in the chain's pixels */
+};
+
+/**
+* @struct Mip_Chain
+* @brief	the mip levels below level 0 of an image, down to 1x1, as tightly packed RGBA rows
+*/
+struct Mip_Chain
+{
+	std::vector<Mip_Level> levels;			/**< level 1 first */
+	std::vector<unsigned char> pixels;		/**< the pixels of every level */
+};
+
+/**
+* @brief	halves an RGBA image with a 2x2 box filter, the last row or column of an odd size is repeated. SSE2 where the compiler targets it,
+*			the rows are spread over the pool's workers and the calling thread
+* @param *rgba			the pixels of the image
+* @param width			width of the image
+* @param height			height of the image
+* @param *out			receives out_width * out_height RGBA pixels
+* @param out_width		max(width / 2, 1)
+* @param out_height		max(height / 2, 1)
+* @param filter			how the channels are averaged
+* @param *pool			the threads to filter on, NULL filters on the calling thread alone
+*/
+void downsample_rgba(const unsigned char *rgba, int width, int height, unsigned char *out, int out_width, int out_height, Mip_Filter filter, Thread_Pool *pool = NULL);
+
+/**
+* @brief	copies stbi's pixels to RGBA, gray is replicated to RGB and missing alpha is opaque
+*/
+void expand_to_rgba(const unsigned char *pixels, int width, int height, int components, std::vector<unsigned char> &rgba);
+
+/**
+* @brief	builds every mip level of an image below level 0 on the CPU, so textures don't depend on the driver's glGenerateMipmap
+* @param *pixels		the pixels as stbi_load returns them, 1 to 4 channels
+* @param width			width of the image
+* @param height			height of the image
+* @param components		channels per pixel
+* @param filter			how the channels are averaged
+* @param &chain			receives the levels, empty for a 1x1 image
+* @param *pool			the threads to filter on, NULL filters on the calling thread alone
+*/
+void generate_mip_chain(const unsigned char *pixels, int width, int height, int components, Mip_Filter filter, Mip_Chain &chain, Thread_Pool *pool = NULL);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __MOCK_CONTEXT_H__
+#define __MOCK_CONTEXT_H__
+
+#include <glad/glad.h>
+
+/**
+* @class Mock_Context
+* @brief	Points every glad function the engine uses at a stub so the CPU side of the engine (model, texture and shader loading,
+*			uniform setters, scene setup) can run and be measured without a GPU, a display or even a GL driver.
+*			The stubs hand out object names, copy uploaded data into a scratch buffer the way a driver would, report every shader and
+*			framebuffer as complete and look uniform names up in a hash map per program, everything else does nothing.
+*			Only use it in a process that never creates a real context, it overwrites the glad function pointers
+*/
+class Mock_Context
+{
+public:
+
+	/**
+	* @brief	installs the stubs
+	*/
+	Mock_Context();
+
+	/**
+	* @brief	bytes copied by the buffer and texture upload stubs since the context was created
+	*/
+	static unsigned long long uploaded_bytes();
+
+	/**
+	* @brief	number of uniform name lookups made since the context was created
+	*/
+	static unsigned long long uniform_lookups();
+};
+
+#endif
@@ -12,15 +12,31 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "camera.h"
 #include "mesh.h"
+#include "texture_registry.h"
 
 /**
-* @brief	loads a texture with SOIL and returns the texture's ID
+* @brief	decodes and creates a texture, always, and returns the texture's ID. Models go through the Texture_Registry instead, this is the uncached path.
+*			When the Texture_Cache is enabled an up to date compressed copy of the image is created instead of decoding it
 * @param *filename			the filename of the texture
 * @param &directory			the directory path to the model files
 */
 unsigned int load_texture_from_filepath(const char *filename, const std::string &directory);
 
+/**
+* @brief	creates a mipmapped 2D texture from decoded pixels and returns the texture's ID, must be called on the GL thread.
+*			Every level is uploaded from a Mip_Chain built on the CPU, the driver's glGenerateMipmap isn't used
+* @param *data				the pixels as stbi_load returns them, NULL creates an empty texture (for images that failed to load)
+* @param width				width of the image
+* @param height				height of the image
+* @param nr_components		number of 8 bit channels per pixel
+* @param &parameters		the color space, wrap mode and mip filter
+* @param *mips				the levels below 0 if they were built already (on a worker), NULL builds them here with parameters.mip_filter
+*/
+unsigned int create_texture(const unsigned char *data, int width, int height, int nr_components, const Texture_Parameters &parameters = Texture_Parameters(),
+	const Mip_Chain *mips = NULL);
+
 /**
 * @class
 */
@@ -30,62 +46,182 @@ public:
 
 	/**
 	* @brief	constructor	loads from the given filepath using load_model
-	*			load_model recursivly traverses the aiScene object's nodes using process_mesh to load the actual data
-	*			process_mesh creates the actual mesh and process_node will add it to the m_mesh list
+	*			load_model recursivly traverses the aiScene object's nodes using import_mesh to load the actual data
+	*			import_mesh copies the mesh data, process_node collects it and create_mesh turns it into the Meshes of m_meshes
 	* @param *filepath		the path to the model, also used to gain the director path
 	*/
 	Model(char *filepath);
 
 	/**
-	* @brief	simple draw loops over each of the meshes to call their respective Draw function
-	* @param shader			the shade to use to draw the Meshes.
+	* @brief	releases the model's textures, must be called on the GL thread
+	*/
+	~Model();
+
+	/**
+	* @brief	simple draw loops over each of the meshes to call their respective Draw function, binding each arena page's vertex array once
+	* @param &shader		the shade to use to draw the Meshes.
 	* @param use_textures	flag to turn off binding textures when drawing the meshes
 	*/
-	void draw(Shader shader, bool use_textures);
+	void draw(const Shader &shader, bool use_textures) const;
+
+	/**
+	* @brief	draws the meshes without unbinding the vertex array at the end, for callers drawing more from the same arena page
+	* @param &shader		the shade to use to draw the Meshes.
+	* @param use_textures	flag to turn off binding textures when drawing the meshes
+	* @param &bound_vao		the vertex array the caller knows is bound, updated when a mesh binds another
+	*/
+	void draw(const Shader &shader, bool use_textures, unsigned int &bound_vao) const;
+
+	/**
+	* @brief	picks the level of detail of every mesh for the frame from how big its error would be on screen,
+	*			with Mesh_Simplifier::s_error_threshold and s_hysteresis, and records the picks in the Mesh_Simplifier statistics
+	* @param &transform			the model matrix the model is drawn with
+	* @param &camera			the camera the frame is seen through, its position and field of view
+	* @param viewport_height	the height of the viewport in pixels
+	*/
+	void select_lods(const glm::mat4 &transform, const Camera &camera, float viewport_height);
+
+	/**
+	* @brief	culls the meshlets of the picked level of detail of every mesh with the Meshlet_Culler, call it after select_lods before each pass draws the model
+	* @param &transform			the model matrix the model is drawn with
+	* @param &view_projection	the projection times the view matrix of the pass
+	* @param viewpoint			the eye of the pass in world space
+	* @param frustum			false for passes that don't see through view_projection's frustum (the shadow cube map), only back facing meshlets are culled then
+	*/
+	void cull_meshlets(const glm::mat4 &transform, const glm::mat4 &view_projection, glm::vec3 viewpoint, bool frustum);
+
+	/**
+	* @brief	makes the CPU copy of a mesh resident, reading it back from the model's Mesh_Cache if its residency is RESIDENCY_ON_DEMAND and it was paged out
+	* @param index		which mesh
+	* @return	false if the copy was discarded for good (RESIDENCY_DISCARD) or the cache has no matching mesh, an error is printed for the latter
+	*/
+	bool page_in(size_t index);
+
+	/**
+	* @brief	frees the CPU copy of a mesh once the queries that paged it in are done, meshes with RESIDENCY_KEEP keep theirs
+	* @param index		which mesh
+	*/
+	void page_out(size_t index);
+
+	/**
+	* @brief	the memory of the model's meshes, see Mesh::memory_usage
+	*/
+	Memory_Usage mesh_memory_usage() const;
+
+	/**
+	* @brief	the GPU memory of the textures the model holds, each counted once even if several meshes use it.
+	*			A texture shared with another model is counted in both. Must be called on the GL thread
+	*/
+	Memory_Usage texture_memory_usage() const;
+
+	/**
+	* @brief	everything the model holds, its meshes, its textures and the model itself. Must be called on the GL thread
+	*/
+	Memory_Usage memory_usage() const;
+
+	/**
+	* @brief	prints the memory of the model, of each mesh and of each texture to stdout. Must be called on the GL thread
+	*/
+	void print_memory_usage() const;
 
 	/**
 	* @brief	getter for the model's meshes array, quick hack so we can get set an attribute as an instanced array
-	* @return	the model's m_meshes
+	* @return	the model's m_meshes, by reference since the meshes own their buffers and vertex data
+	*/
+	const std::vector<Mesh> &get_meshes() const { return m_meshes; }
+
+	/**
+	* @brief	how the models create a texture of a type: block compressed through the Texture_Cache when it is enabled, normal maps as BC5
 	*/
-	std::vector<Mesh> get_meshes() { return m_meshes; }
+	static Texture_Parameters texture_parameters(Texture_Type type);
+
+	static Vertex_Format s_vertex_format;		/**< the format the models create their meshes in, VERTEX_FLOAT by default since the quantized one is lossy */
+	static Mesh_Residency s_mesh_residency;		/**< what the models' meshes do with their CPU copy once uploaded, RESIDENCY_DISCARD by default. RESIDENCY_ON_DEMAND needs the Mesh_Cache, without it the meshes keep their copy */
 
 private:
+	friend struct Model_Benchmark;				/**< the micro benchmarks time import_mesh and create_mesh on their own */
+	friend class Model_Loader;					/**< builds models from data imported on its worker threads */
+
 	// Model Data
-	std::vector<texture> m_textures_loaded;		/**< stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once. */
+	std::vector<texture> m_textures_loaded;		/**< the Texture_Registry reference the model holds for each texture its meshes use */
 	std::vector<Mesh> m_meshes;					/**< list of every mesh in this Model */
 	std::string m_directory;					/**< the directory that this model is inside of, this system will presume that all the textures are in the same directory */
+	std::string m_filepath;						/**< the path the model was loaded from, page_in finds its Mesh_Cache with it */
+
+	/**
+	* @brief	an empty model, Model_Loader fills it in once the model's data has been imported
+	*/
+	Model();
 
 	/**
 	* @brief	called by the constructor to start the process of loading using Assimp
 	*			Loads the aiScene and then saves the m_director from the given filepath.
 	*			Then starts the recursive loading using process_node
-	* @param filepath		the filepath to the model, also used to save the directory of the model
+	* @param &filepath		the filepath to the model, also used to save the directory of the model
+	*/
+	void load_model(const std::string &filepath);
+
+	/**
+	* @brief	loads the meshes from the model's Mesh_Cache instead of importing it, uploading straight from the mapped cache
+	* @param &filepath		the filepath to the model
+	* @return	false if there is no up to date cache, m_meshes is left empty and the model has to be imported
+	*/
+	bool load_cached_model(const std::string &filepath);
+
+	/**
+	* @brief	imports the model with Assimp and writes its Mesh_Cache (if caches are enabled), touches no GL so it can run on any thread
+	* @param &filepath		the filepath to the model
+	* @param &meshes		receives the imported meshes
+	* @return	false if the import failed, an error is printed
+	*/
+	static bool import_model(const std::string &filepath, std::vector<Mesh_Data> &meshes);
+
+	/**
+	* @brief	reads the model's meshes from its Mesh_Cache into memory, touches no GL so it can run on any thread
+	* @param &filepath		the filepath to the model
+	* @param &meshes		receives the meshes
+	* @return	false if there is no up to date cache
 	*/
-	void load_model(std::string filepath);
+	static bool read_cached_model(const std::string &filepath, std::vector<Mesh_Data> &meshes);
 
 	/**
-	* @brief	recursive function to load all the meshes in the model. 
-	*			Processes this node's meshes first then goes into its children nodes.
+	* @brief	recursive function to import all the meshes in the model. 
+	*			Processes this node's meshes first then goes into its children nodes, each one is run through the Mesh_Optimizer if it is enabled
+	*			and then given its levels of detail by the Mesh_Simplifier, whose triangles cluster_meshlets orders into meshlets.
 	* @param *node		the aiNode object that we are currently working with
-	* @param *scene		the aiScene object that contains all the data for the model, needed for process_mesh to get the mesh's material data
+	* @param *scene		the aiScene object that contains all the data for the model, needed for import_mesh to get the mesh's material data
+	* @param &meshes	the imported meshes are appended to it
 	*/
-	void process_node(aiNode *node, const aiScene *scene);
+	static void process_node(aiNode *node, const aiScene *scene, std::vector<Mesh_Data> &meshes);
 
 	/**
-	* @brief	loads all the mesh data from the Assimp object into my Mesh object and returns it
+	* @brief	copies all the mesh data from the Assimp object into a Mesh_Data and returns it, the textures only get their path and type
 	* @param *mesh		contains all the vertex data (position, normals, texture coordinates) and the indices list (called faces in the aiMesh) 
 	* @param *scene		contains all the material and texture data for the Mesh
 	*/
-	Mesh process_mesh(aiMesh *mesh, const aiScene *scene);
+	static Mesh_Data import_mesh(aiMesh *mesh, const aiScene *scene);
 
 	/**
-	* @brief	iterates over all the texture locations of the given texture type, retrieves the texture's file path and checks all material 
-	*			textures of a given type and loads the textures if they're not loaded yet. generates the texture and stores the information in a texture struct
+	* @brief	iterates over all the texture locations of the given texture type and retrieves the texture's file path
 	* @param *material		the material that contains the filepaths to the textures
 	* @param type			the texture type, needed to get the texture filepath from the material
 	* @param type_name		the texture type as an enumeration
+	* @param &textures		the mesh's textures, the material's textures of this type are appended to it
+	*/
+	static void load_material_textures(aiMaterial *material, aiTextureType type, Texture_Type type_name, std::vector<texture> &textures);
+
+	/**
+	* @brief	creates the Mesh for imported data on the GL thread, loading the textures that aren't loaded yet
+	* @param &&data		the imported mesh
+	*/
+	Mesh create_mesh(Mesh_Data &&data);
+
+	/**
+	* @brief	returns the texture for the given path from the Texture_Registry, which loads it only if no model or scene has it yet, and keeps the reference in m_textures_loaded
+	* @param *path			the path of the texture relative to m_directory, as stored in the material
+	* @param type			the texture type
 	*/
-	std::vector<texture> load_material_textures(aiMaterial *material, aiTextureType type, Texture_Type type_name);
+	texture get_texture(const char *path, Texture_Type type);
 
 
 };
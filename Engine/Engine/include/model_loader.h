@@ -0,0 +1,134 @@
+#ifndef __MODEL_LOADER_H__
+#define __MODEL_LOADER_H__
+
+#include <vector>
+
+#include "model.h"
+#include "texture_uploader.h"
+#include "thread_pool.h"
+
+struct Model_Request;
+
+/**
+* @class Model_Handle
+* @brief	The result of Model_Loader::load, it completes on a later Model_Loader::update.
+*			Until is_ready the caller draws nothing (or a placeholder); the handle owns the model, deleting it deletes the model or cancels the load
+*/
+class Model_Handle
+{
+public:
+
+	/**
+	* @brief	deletes the model, or cancels the load if it hasn't finished, must be called on the GL thread
+	*/
+	~Model_Handle();
+
+	/**
+	* @brief	check if the model is loaded and can be drawn
+	*/
+	bool is_ready() const { return m_model != NULL; }
+
+	/**
+	* @brief	check if the model failed to import, it will never be ready
+	*/
+	bool has_failed() const { return m_failed; }
+
+	/**
+	* @brief	the loaded model, NULL until is_ready
+	*/
+	Model *get() const { return m_model; }
+
+	/**
+	* @brief	milliseconds from load to the model being ready
+	*/
+	double load_ms() const { return m_load_ms; }
+
+private:
+	friend class Model_Loader;
+
+	Model_Handle(Model_Request *request);
+
+	// not copyable, the model is owned
+	Model_Handle(const Model_Handle &);
+	Model_Handle &operator=(const Model_Handle &);
+
+	Model_Request *m_request;	/**< the request while it is in flight, NULL once it is done or the loader is gone */
+	Model *m_model;				/**< the model once it is ready */
+	bool m_failed;				/**< if the import failed */
+	double m_load_ms;			/**< time from load to ready */
+};
+
+/**
+* @class Model_Loader
+* @brief	Loads models without blocking the GL thread. load returns a handle right away; a worker imports the model (from its Mesh_Cache or with Assimp)
+*			and every texture the Texture_Registry doesn't have yet is decoded through it as its own job, so one model's textures decode on all the workers at once.
+*			Only the GL work (texture uploads and mesh buffers) is left for update, which the GL thread calls once a frame with a time budget.
+*			The decoders build each image's mip chain on the CPU as well, so no glGenerateMipmap runs at load.
+*			With a Texture_Uploader the decoders hand their pixels to it instead, and update only has the mesh buffers left to create.
+*			With the Texture_Cache enabled the workers read (or build) the compressed images instead and update uploads them either way,
+*			they are a fraction of the size and come with their mip chain.
+*			The textures are decoded with the global Texture_Registry::set_flip_on_load setting, don't change it while loads are in flight
+*/
+class Model_Loader
+{
+public:
+
+	/**
+	* @brief	starts the worker threads
+	* @param thread_count	number of workers, 0 uses Thread_Pool::default_thread_count
+	* @param *uploader		uploads the textures on its own thread, NULL uploads them in update; not owned and it has to outlive the loader
+	*/
+	Model_Loader(unsigned int thread_count = 0, Texture_Uploader *uploader = NULL);
+
+	/**
+	* @brief	waits for the workers, deletes everything still in flight and fails the handles that weren't ready, must be called on the GL thread
+	*/
+	~Model_Loader();
+
+	/**
+	* @brief	starts loading a model in the background
+	* @param *filepath		the path to the model
+	* @return	the handle to poll, owned by the caller
+	*/
+	Model_Handle *load(const char *filepath);
+
+	/**
+	* @brief	runs queued GL uploads on the GL thread until the budget is used up, at least one runs per call so loading always progresses
+	*			requests are finished in the order they were made, skipping the ones still importing or decoding
+	* @param budget_ms		milliseconds to spend this frame
+	*/
+	void update(double budget_ms);
+
+	/**
+	* @brief	the number of models requested but not yet ready (or failed)
+	*/
+	unsigned int pending() const { return m_requests.size(); }
+
+	/**
+	* @brief	the number of worker threads
+	*/
+	unsigned int thread_count() const { return m_pool->thread_count(); }
+
+private:
+
+	// not copyable, the workers are owned
+	Model_Loader(const Model_Loader &);
+	Model_Loader &operator=(const Model_Loader &);
+
+	/**
+	* @brief	imports a request's model on a worker and queues the decode of each of its textures
+	*/
+	void import(Model_Request *request);
+
+	/**
+	* @brief	runs the next GL step of a request whose CPU work is done
+	* @return	true once the request is finished (ready, failed or cancelled) and can be deleted
+	*/
+	bool step(Model_Request *request);
+
+	Thread_Pool *m_pool;						/**< the workers that import and decode */
+	Texture_Uploader *m_uploader;				/**< uploads the decoded textures, NULL if update does */
+	std::vector<Model_Request *> m_requests;	/**< requests in flight, in the order they were made */
+};
+
+#endif
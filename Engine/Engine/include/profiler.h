@@ -0,0 +1,153 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <atomic>
+#include <string>
+
+/**
+* @struct Profile_Event
+* @brief	a single recorded zone, counter value or frame marker
+*/
+struct Profile_Event
+{
+	const char *name;		/**< name of the zone or counter, has to be a string literal */
+	char type;				/**< 'X' zone, 'C' counter, 'i' frame marker, matching the Chrome trace phases */
+	long long start_ns;		/**< time since the profiler started in nanoseconds */
+	long long duration_ns;	/**< length of the zone, 0 for counters and markers */
+	double value;			/**< value of the counter or number of the frame */
+};
+
+/**
+* @class Profiler
+* @brief	Records CPU zones, counters and frame markers from every thread and writes them as a Chrome trace
+*			(chrome://tracing or https://ui.perfetto.dev).
+*			Every thread records into its own list of fixed size blocks, only the recording thread ever writes to them
+*			and it publishes each event with an atomic count so recording never takes a lock.
+*			The buffers of a thread are registered once, under a mutex, the first time it records something and are kept
+*			until the program exits so the trace still has them after the thread is gone.
+*
+*			Use the PROFILE_ macros rather than calling this directly, they compile to nothing unless ENGINE_PROFILER is defined
+*			and otherwise only check the enabled flag while recording is off
+*/
+class Profiler
+{
+public:
+
+	/**
+	* @brief	starts or stops recording
+	*/
+	static void set_enabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+	/**
+	* @brief	check if recording
+	*/
+	static bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+	/**
+	* @brief	the current time in nanoseconds since the profiler started
+	*/
+	static long long now();
+
+	/**
+	* @brief	records a zone on the calling thread
+	* @param *name		name of the zone, has to be a string literal
+	* @param start_ns	when the zone began, from now()
+	* @param end_ns		when the zone ended, from now()
+	*/
+	static void zone(const char *name, long long start_ns, long long end_ns);
+
+	/**
+	* @brief	records the value of a counter
+	* @param *name		name of the counter, has to be a string literal
+	* @param value		the value
+	*/
+	static void counter(const char *name, double value);
+
+	/**
+	* @brief	marks the start of a new frame
+	*/
+	static void frame_marker();
+
+	/**
+	* @brief	names the calling thread in the trace
+	* @param *name		name of the thread
+	*/
+	static void set_thread_name(const char *name);
+
+	/**
+	* @brief	writes everything recorded so far by every thread as Chrome trace JSON
+	* @param *filepath	the file to write
+	* @return	false if the file couldn't be written
+	*/
+	static bool write_chrome_trace(const char *filepath);
+
+private:
+
+	static std::atomic<bool> s_enabled;			/**< recording flag checked by every zone */
+	static std::atomic<unsigned int> s_frame;	/**< number of frame markers recorded so far */
+};
+
+/**
+* @class Profile_Zone
+* @brief	records the time from its construction until it is destroyed or ended as a zone
+*/
+class Profile_Zone
+{
+public:
+
+	/**
+	* @brief	constructor, starts the zone
+	* @param *name		name of the zone, has to be a string literal
+	*/
+	Profile_Zone(const char *name) : m_name(name), m_start(Profiler::is_enabled() ? Profiler::now() : -1) {}
+
+	/**
+	* @brief	destructor, ends the zone if it wasn't ended yet
+	*/
+	~Profile_Zone() { end(); }
+
+	/**
+	* @brief	ends the zone before going out of scope
+	*/
+	void end()
+	{
+		if (m_start >= 0)
+			Profiler::zone(m_name, m_start, Profiler::now());
+		m_start = -1;
+	}
+
+private:
+	const char *m_name;		/**< name of the zone */
+	long long m_start;		/**< start time of the zone, negative when not recording */
+};
+
+#ifdef ENGINE_PROFILER
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+
+/** times the rest of the enclosing scope */
+#define PROFILE_ZONE(name) Profile_Zone PROFILE_CONCATENATE(profile_zone_, __LINE__)(name)
+/** starts a zone that is ended with PROFILE_END using the same id, for zones that don't match a scope */
+#define PROFILE_BEGIN(id, name) Profile_Zone profile_zone_##id(name)
+/** ends a zone started with PROFILE_BEGIN */
+#define PROFILE_END(id) profile_zone_##id.end()
+/** records the value of a counter */
+#define PROFILE_COUNTER(name, value) do { if (Profiler::is_enabled()) Profiler::counter(name, (double)(value)); } while (0)
+/** marks the start of a frame */
+#define PROFILE_FRAME() do { if (Profiler::is_enabled()) Profiler::frame_marker(); } while (0)
+/** names the calling thread */
+#define PROFILE_THREAD(name) Profiler::set_thread_name(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_BEGIN(id, name) ((void)0)
+#define PROFILE_END(id) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
+
+#endif
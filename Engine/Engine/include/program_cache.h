@@ -0,0 +1,93 @@
+#ifndef __PROGRAM_CACHE_H__
+#define __PROGRAM_CACHE_H__
+
+#include <string>
+
+/**
+* @struct Program_Cache_Statistics
+* @brief	what the program cache did since the last reset
+*/
+struct Program_Cache_Statistics
+{
+	unsigned int hits;				/**< programs restored from an up to date binary */
+	unsigned int misses;			/**< programs compiled because their binary was missing or stale */
+	unsigned int rejected;			/**< binaries the driver refused to load (a driver update changing the format), compiled instead */
+	unsigned int writes;			/**< binaries written after compiling */
+	double load_ms;					/**< time spent restoring the hits */
+	double compile_ms;				/**< time spent compiling and linking the misses */
+	double saved_ms;				/**< what compiling the hits took when they were cached, minus the time restoring them took */
+};
+
+/**
+* @class Program_Cache
+* @brief	Linked shader programs stored as driver binaries (glGetProgramBinary) next to their vertex shader as
+*			<vertex>.<fragment>[.<geometry>][.<defines hash>].program, so later runs restore them with glProgramBinary instead of compiling.
+*			A binary is keyed by the hash of the sources as they are passed to glShaderSource and of the driver's vendor, renderer
+*			and version strings, a change to either makes it stale and the program is compiled and cached again. The driver may still
+*			reject a binary with a matching key, the program is then compiled like a miss.
+*
+*			Everything is static like the Texture_Cache and must be called on the GL thread
+*/
+class Program_Cache
+{
+public:
+
+	/**
+	* @brief	check if the context can save and restore program binaries (GL 4.1 or ARB_get_program_binary, with at least one binary format)
+	*/
+	static bool is_supported();
+
+	/**
+	* @brief	the key of a program, the hash of its sources and the driver strings
+	* @param **sources		the source of each stage, in the order they are attached
+	* @param *lengths		the length of each source
+	* @param count			number of stages
+	*/
+	static unsigned long long key(const char *const *sources, const int *lengths, unsigned int count);
+
+	/**
+	* @brief	creates a program from its cached binary if it is up to date and the driver accepts it
+	* @param &cache_path	the cache file
+	* @param key			the key of the program's sources
+	* @return	the linked program, 0 if the program has to be compiled (counted as a miss or a rejected binary)
+	*/
+	static unsigned int load(const std::string &cache_path, unsigned long long key);
+
+	/**
+	* @brief	writes the binary of a program just linked, to a temporary file first which then replaces the old cache.
+	*			The program should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	* @param &cache_path	the cache file
+	* @param key			the key of the program's sources
+	* @param program		the linked program
+	* @param compile_ms		how long compiling and linking it took, counted in the statistics and recorded so the hits can report the time they saved
+	*/
+	static bool write(const std::string &cache_path, unsigned long long key, unsigned int program, double compile_ms);
+
+	/**
+	* @brief	the path of the cache file for a program
+	* @param *vertex_path		path to the vertex shader
+	* @param *fragment_path		path to the fragment shader
+	* @param *geometry_path		path to the geometry shader, empty if it has none
+	* @param *defines			the #define lines injected into the program, each variant of a shader gets its own file
+	*/
+	static std::string cache_path(const char *vertex_path, const char *fragment_path, const char *geometry_path, const char *defines);
+
+	/**
+	* @brief	a copy of the statistics
+	*/
+	static Program_Cache_Statistics statistics();
+
+	/**
+	* @brief	resets the statistics
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	static bool s_enabled;		/**< Shader restores and writes program binaries, on by default */
+};
+
+#endif
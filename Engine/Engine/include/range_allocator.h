@@ -0,0 +1,106 @@
+#ifndef __RANGE_ALLOCATOR_H__
+#define __RANGE_ALLOCATOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+* @class Range_Allocator
+* @brief	Hands out ranges of [0, capacity) with the TLSF scheme (Masmano et al., "TLSF: a New Dynamic Memory Allocator for Real-Time Systems"):
+*			the free ranges are kept in lists by size class, two levels of bitmaps find a list whose every range fits in constant time,
+*			and a freed range is merged with its free neighbours right away. It only does the bookkeeping, the units (vertices, bytes)
+*			and the memory behind them belong to the caller; the Geometry_Arena sub-allocates its buffers with it
+*/
+class Range_Allocator
+{
+public:
+
+	/**
+	* @brief	an allocator with everything free
+	* @param capacity	the size of the whole range
+	*/
+	Range_Allocator(size_t capacity = 0);
+
+	/**
+	* @brief	forgets every allocation and starts over with a new capacity
+	*/
+	void reset(size_t capacity);
+
+	/**
+	* @brief	allocates a range
+	* @param size		the units needed, more than 0
+	* @param &offset	receives the start of the range
+	* @return	false if no free range is big enough
+	*/
+	bool allocate(size_t size, size_t &offset);
+
+	/**
+	* @brief	frees a range allocate returned
+	* @param offset		the start of the range
+	*/
+	void free(size_t offset);
+
+	/**
+	* @brief	the size of the whole range
+	*/
+	size_t capacity() const { return m_capacity; }
+
+	/**
+	* @brief	the units allocated
+	*/
+	size_t used() const { return m_used; }
+
+	/**
+	* @brief	number of free ranges, 1 (or 0 when full) means the free space isn't fragmented
+	*/
+	unsigned int free_range_count() const { return m_free_count; }
+
+private:
+
+	static const int sl_bits = 4;						/**< each power of two is split into 2^sl_bits size classes */
+	static const int sl_count = 1 << sl_bits;
+	static const int fl_count = 40;						/**< enough classes for capacities up to 2^43 */
+
+	/**
+	* @struct Block
+	* @brief	a free or allocated range, linked to its neighbours in address order and, when free, to the other free ranges of its class
+	*/
+	struct Block
+	{
+		size_t offset;
+		size_t size;
+		int previous;			/**< the block before it in address order, -1 for the first */
+		int next;				/**< the block after it in address order, -1 for the last */
+		int previous_free;		/**< the free list links, only used while the block is free */
+		int next_free;
+		bool free;
+	};
+
+	/**
+	* @brief	the size class of a size, the one whose free list it goes into
+	*/
+	static void mapping(size_t size, int &fl, int &sl);
+
+	int new_block();
+	void insert_free(int block);
+	void remove_free(int block);
+
+	/**
+	* @brief	the first non empty free list of a class at least as big as fl/sl, -1 if there is none
+	*/
+	int find_free(int fl, int sl) const;
+
+	size_t m_capacity;								/**< the size of the whole range */
+	size_t m_used;									/**< the units allocated */
+	unsigned int m_free_count;						/**< number of free blocks */
+	std::vector<Block> m_blocks;					/**< every block, unused ones are chained through next */
+	int m_unused;									/**< the first unused entry of m_blocks, -1 for none */
+	int m_heads[fl_count][sl_count];				/**< the first free block of each class */
+	uint64_t m_fl_bitmap;							/**< the first levels with a non empty class */
+	uint32_t m_sl_bitmap[fl_count];					/**< the non empty classes of each first level */
+	std::unordered_map<size_t, int> m_allocated;	/**< the block of every allocated offset */
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef __SCENE_H__
+#define __SCENE_H__
+
+#include <vector>
+#include <string>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader.h"
+#include "shader_variants.h"
+#include "camera.h"
+#include "model.h"
+
+/**
+* @brief	utility function for loading a 2D texture from file through the Texture_Registry
+* @param *path				the filepath to the texture
+* @param gamma_correction	flag to store the texture in sRGB space so it is linearized when sampled
+* @return	the texture's id, give it back with Texture_Registry::release
+*/
+unsigned int load_texture(char const * path, bool gamma_correction);
+
+/**
+* @brief	loads the six faces of a cubemap texture from file
+* @param faces		the filepaths of each face in the order right, left, top, bottom, back, front
+* @return	the cubemap texture's id
+*/
+unsigned int load_cubemap(std::vector<std::string> faces);
+
+/**
+* @brief	builds the view projection matrix of each face of a point light's depth cubemap
+* @param light_position		world position of the light
+* @param aspect				aspect ratio of a cubemap face
+* @param near_plane			near plane of the light's projection
+* @param far_plane			far plane of the light's projection
+* @return	the six matrices in cubemap face order +x, -x, +y, -y, +z, -z
+*/
+std::vector<glm::mat4> shadow_transformations(glm::vec3 light_position, float aspect, float near_plane, float far_plane);
+
+/**
+* @class Scene
+* @brief	The point shadow scene, owns all the shaders, vertex arrays, textures and framebuffers needed to draw it.
+*			Drawing is split away from the window so the same frame can be rendered by the windowed application or a headless benchmark
+*/
+class Scene
+{
+public:
+
+	/**
+	* @brief	constructor compiles the shader programs, creates the vertex data and loads the textures and framebuffers for the scene
+	*			requires a current OpenGL context with glad already loaded
+	* @param width		width of the final image in pixels
+	* @param height		height of the final image in pixels
+	* @param samples	number of samples used for the multisampled framebuffer
+	*/
+	Scene(unsigned int width, unsigned int height, unsigned int samples);
+
+	/**
+	* @brief	releases every OpenGL object created by the scene
+	*/
+	~Scene();
+
+	/**
+	* @brief	renders one full frame: the depth cubemap pass, the lit multisampled pass, the resolve and the post-processing quad
+	* @param &camera				the camera to render the scene from
+	* @param current_time			total time in seconds, used to animate the scene
+	* @param output_framebuffer		the framebuffer the post-processing quad is drawn into (0 for the window)
+	*/
+	void render(Camera &camera, float current_time, unsigned int output_framebuffer);
+
+	int m_effect;				/**< which post-processing shader to use for the final quad, 0 for none and 1 for the kernel effect */
+	bool m_shadows;				/**< render the depth cubemap and draw with the point_shadow_mapping variant that samples it, on by default */
+	Model *m_model;				/**< optional model drawn into the room and the shadow map with m_model_transform, NULL to skip */
+	glm::mat4 m_model_transform;	/**< model matrix for m_model */
+
+private:
+
+	/**
+	* @brief	draws the room, the cubes and m_model with the given shader
+	* @param &shader			the shader program used to draw the scene
+	* @param current_time		total time in seconds, used to animate the center cube
+	* @param use_textures		flag to bind the model's textures, not needed for the depth pass
+	*/
+	void render_scene(Shader &shader, float current_time, bool use_textures);
+
+	/**
+	* @brief	the point_shadow_mapping variant for the current settings, set up the first time it is asked for
+	*/
+	Shader &point_shadows_shader();
+
+	// Settings
+	unsigned int m_width;			/**< width of the final image */
+	unsigned int m_height;			/**< height of the final image */
+	unsigned int m_shadow_width;	/**< width of each face in the depth cubemap */
+	unsigned int m_shadow_height;	/**< height of each face in the depth cubemap */
+	glm::vec3 m_light_position;		/**< world position of the point light */
+
+	// Shader Programs
+	Shader m_simple_shader;				/**< draws the screen quad without any effect */
+	Shader m_post_processing_shader;	/**< draws the screen quad with a kernel effect */
+	Shader m_skybox_shader;				/**< draws the skybox cubemap */
+	Shader m_lamp_shader;				/**< draws the light source */
+	Shader m_cube_map_depth_shader;		/**< renders the depth of the scene into the cubemap using a geometry shader */
+	Shader_Variants m_point_shadows_variants;	/**< draws the lit scene, specialized on m_shadows */
+	unsigned int m_point_shadows_set_up;		/**< bit per key of the variants point_shadows_shader() has set up */
+
+	// Vertex Arrays
+	unsigned int m_quad_vao, m_quad_vbo;		/**< screen quad */
+	unsigned int m_skybox_vao, m_skybox_vbo;	/**< skybox cube, positions only */
+	Geometry_Range *m_plane_range;				/**< floor plane with normals and texture coordinates, in the Geometry_Arena */
+	Geometry_Range *m_cube_range;				/**< unit cube with normals and texture coordinates, in the Geometry_Arena */
+	unsigned int m_ubo_matrices;				/**< uniform buffer holding the projection and view matrices */
+
+	// Textures
+	unsigned int m_skybox_texture;					/**< cubemap for the skybox */
+	unsigned int m_wood_texture;					/**< diffuse texture for every surface */
+	unsigned int m_wood_texture_gamma_corrected;	/**< sRGB version of the wood texture */
+
+	// Framebuffers
+	unsigned int m_depth_map_fbo;						/**< framebuffer for the depth cubemap pass */
+	unsigned int m_depth_cube_map;						/**< cubemap storing the linear depth from the light */
+	unsigned int m_framebuffer_object;					/**< multisampled framebuffer the lit scene is drawn into */
+	unsigned int m_texture_color_buffer_multisampled;	/**< color attachment of the multisampled framebuffer */
+	unsigned int m_renderbuffer_object;					/**< depth/stencil attachment of the multisampled framebuffer */
+	unsigned int m_intermediate_framebuffer_object;		/**< single sampled framebuffer the multisampled image is resolved into */
+	unsigned int m_screen_texture;						/**< color attachment of the intermediate framebuffer, sampled by the post-processing quad */
+};
+
+#endif
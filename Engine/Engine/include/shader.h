@@ -1,14 +1,17 @@
 #ifndef __SHADER_H__
 #define __SHADER_H__
 
-#include <glad/glad.h>; // include glad to get all the required OpenGL headers
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
   
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 #include <glm/glm.hpp>
+
+#include "hash.h"
   
 /**
 * @enum Shader_Type
@@ -23,8 +26,90 @@ enum Shader_Type
 };
 
 /**
-* @class Camera
-* @brief An abstract camera class that processes input and calculates the corresponding Eular Angles, Vectors and Matrices for use in OpenGL
+* @struct Uniform_Name
+* @brief	the name of a uniform as its FNV-1a hash. A constexpr Uniform_Name is hashed at compile time, so setting a uniform by it is a lookup
+*			in the shader's reflection table with no allocation and no glGetUniformLocation; a name built at runtime is hashed when converted
+*/
+struct Uniform_Name
+{
+	unsigned long long hash;	/**< fnv1a_string of the name */
+
+	constexpr Uniform_Name(const char *name) : hash(fnv1a_literal(name)) {}
+	Uniform_Name(const std::string &name) : hash(fnv1a_string(name.c_str())) {}
+};
+
+/**
+* @struct Uniform_Handle
+* @brief	a uniform of one Shader, the index of its entry in the reflection table. Setting a uniform by handle is one glUniform call
+*/
+struct Uniform_Handle
+{
+	int index;		/**< the entry, -1 for a uniform the program doesn't have, setting it does nothing */
+};
+
+/**
+* @struct Shader_Uniform
+* @brief	an active uniform of a linked program, outside the uniform blocks
+*/
+struct Shader_Uniform
+{
+	unsigned long long hash;	/**< hash of the name, an array has an entry for each "name[i]" and one for its bare name, the first element */
+	int location;				/**< the location glUniform takes */
+	GLenum type;				/**< GL_FLOAT_VEC3, GL_SAMPLER_2D, ... */
+	int size;					/**< the elements from this one to the end of the array, 1 for a single value */
+	int slot;					/**< index of its Shader_Uniform_Value, shared by the entries with the same location */
+};
+
+/**
+* @struct Shader_Uniform_Value
+* @brief	the value last set on a uniform location, kept so setting the same value again doesn't reach GL
+*/
+struct Shader_Uniform_Value
+{
+	int location;				/**< the location glUniform takes */
+	GLenum type;				/**< picks the glUniform function the value is uploaded with */
+	GLenum scalar;				/**< GL_FLOAT for the float, vector and matrix types and GL_INT for the rest, what the setters have to write */
+	unsigned int offset;		/**< first word of the value in the shadow copy */
+	unsigned int words;			/**< 32 bit words the value takes, 3 for a vec3 */
+	bool known;					/**< the value has been set since linking, before that the uniform holds its GLSL initializer */
+	bool dirty;					/**< set but not uploaded yet */
+	bool reported;				/**< a set of the wrong type was reported, the later ones are rejected without printing */
+};
+
+/**
+* @struct Shader_Uniform_Block
+* @brief	an active uniform block of a linked program
+*/
+struct Shader_Uniform_Block
+{
+	unsigned long long hash;	/**< hash of the block's name */
+	unsigned int index;			/**< the index glUniformBlockBinding takes */
+	int data_size;				/**< bytes the block needs bound */
+};
+
+/**
+* @struct Shader_Compile_Statistics
+* @brief	what compiling the programs the cache didn't restore cost the GL thread since the last reset
+*/
+struct Shader_Compile_Statistics
+{
+	unsigned int submitted;		/**< programs handed to the driver to compile and link */
+	unsigned int finished;		/**< of those, programs whose status has been checked */
+	unsigned int ready;			/**< of the finished, programs the driver was done with before they were needed */
+	double submit_ms;			/**< time spent submitting them, reading and preprocessing the sources included */
+	double wait_ms;				/**< time spent waiting for them to compile and link when they were first needed */
+};
+
+/**
+* @class Shader
+* @brief	A linked GLSL program with a reflection table of its uniforms and a CPU shadow copy of their values.
+*			The constructor only submits the compile and link, its status is checked and the program reflected the first time it's needed
+*			(use(), flush(), a uniform lookup or finish()), so the programs constructed together compile together. The driver compiles
+*			them on its own threads with GL_KHR_parallel_shader_compile, is_ready() then tells if one is done without waiting.
+*			A Shader owns its program's state on the CPU and isn't copyable.
+*			The setters only write the shadow copy, a value equal to the one already set is skipped (counted by Gl_Statistics::record_skipped)
+*			and a changed one is uploaded by the next use() or flush(), so setting a uniform several times between draws uploads it once.
+*			Uniforms have to be set through the Shader for the copy to stay true, a glUniform call made directly isn't seen by it
 */
 class Shader
 {
@@ -32,118 +117,229 @@ public:
     unsigned int m_program_id;	/**< the program id for the shader */
   
     /**
-	* @brief constructor to read, compile, and link a shader program written in GLSL
+	* @brief constructor to read, compile, and link a shader program written in GLSL, the compile and link are submitted without waiting for them
 	* @param *vertex_path		path to the vertex shader
 	* @param *fragment_path		path to the fragment shader
 	* @param *geometry_path		path to the geometry shader, default points to an empty array of characters (telling the constructor to ignore the geometry shader)
+	* @param *defines			#define lines injected into every stage right after its #version line, Shader_Variants builds them from a feature key.
+	*							The sources may also #include "file" relative to themselves, the files are read through Asset and expanded in place
 	*/
-    Shader(const GLchar* vertex_path, const GLchar* fragment_path, const GLchar* geometry_path = "");
+    Shader(const GLchar* vertex_path, const GLchar* fragment_path, const GLchar* geometry_path = "", const char *defines = "");
     
 	/**
-	* @brief activate the shader
+	* @brief activate the shader, uploading the uniforms set while it wasn't in use
 	*/
     void use();
 
+	/**
+	* @brief	uploads the uniforms changed since the last use() or flush(), call before drawing with the program in use
+	*/
+	void flush() const;
+
+	/**
+	* @brief	waits for the program to compile and link, printing the errors, caches its binary and reflects it. Done by the first call needing
+	*			the program, only call it to pick when the wait happens
+	*/
+	void finish() const { if (m_pending) finish_pending(); }
+
+	/**
+	* @brief	check if the program is done compiling and linking without waiting for it, so finish() won't block
+	* @return	always true without GL_KHR_parallel_shader_compile, the driver can't tell then
+	*/
+	bool is_ready() const;
+
+	/**
+	* @brief	check if the driver compiles on its own threads (GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile)
+	*/
+	static bool is_parallel_compile_supported();
+
+	/**
+	* @brief	a copy of the compile statistics
+	*/
+	static Shader_Compile_Statistics compile_statistics();
+
+	/**
+	* @brief	resets the compile statistics
+	*/
+	static void reset_compile_statistics();
+
+	/**
+	* @brief	prints the compile statistics to stdout
+	*/
+	static void print_compile_statistics();
+
+	/**
+	* @brief	looks a uniform up in the reflection table, do it once and keep the handle for uniforms set every frame
+	* @param name		the uniform's name, "array[i]" for an element of an array
+	* @return	the handle, with index -1 if the program has no such active uniform
+	*/
+	Uniform_Handle uniform(Uniform_Name name) const;
+
+	/**
+	* @brief	the index of a uniform block for glUniformBlockBinding
+	* @return	GL_INVALID_INDEX if the program has no such active block
+	*/
+	unsigned int uniform_block(Uniform_Name name) const;
+
+	/**
+	* @brief	the reflection table, sorted by hash
+	*/
+	const std::vector<Shader_Uniform> &uniforms() const { finish(); return m_uniforms; }
+
 	// uniform setters
 
     /**
 	* @brief utility function to set a uniform bool in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-    void set_bool(const std::string &name, bool value) const;  
+	void set_bool(Uniform_Handle uniform, bool value) const;
+	void set_bool(Uniform_Name name, bool value) const { set_bool(uniform(name), value); }
     
 	/**
 	* @brief utility function to set a uniform int in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_int(const std::string &name, int value) const;   
+	void set_int(Uniform_Handle uniform, int value) const;
+	void set_int(Uniform_Name name, int value) const { set_int(uniform(name), value); }
 
 	/**
 	* @brief utility function to set a uniform float in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-    void set_float(const std::string &name, float value) const;
+	void set_float(Uniform_Handle uniform, float value) const;
+	void set_float(Uniform_Name name, float value) const { set_float(uniform(name), value); }
 
 	/**
 	* @brief utility function to set a uniform vec2 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_vec2(const std::string &name, const glm::vec2 &value) const;
+	void set_vec2(Uniform_Handle uniform, const glm::vec2 &value) const;
+	void set_vec2(Uniform_Name name, const glm::vec2 &value) const { set_vec2(uniform(name), value); }
 
 	/**
 	* @brief utility function to set a uniform vec2 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param x			x value to set the uniform to
 	* @param y			y value to set the uniform to
 	*/
-	void set_vec2(const std::string &name, float x, float y) const;
+	void set_vec2(Uniform_Handle uniform, float x, float y) const;
+	void set_vec2(Uniform_Name name, float x, float y) const { set_vec2(uniform(name), x, y); }
 
 	/**
 	* @brief utility function to set a uniform vec3 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_vec3(const std::string &name, const glm::vec3 &value) const;
+	void set_vec3(Uniform_Handle uniform, const glm::vec3 &value) const;
+	void set_vec3(Uniform_Name name, const glm::vec3 &value) const { set_vec3(uniform(name), value); }
 
 	/**
 	* @brief utility function to set a uniform vec3 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param x			x value to set the uniform to
 	* @param y			y value to set the uniform to
 	* @param z			z value to set the uniform to
 	*/
-	void set_vec3(const std::string &name, float x, float y, float z) const;
+	void set_vec3(Uniform_Handle uniform, float x, float y, float z) const;
+	void set_vec3(Uniform_Name name, float x, float y, float z) const { set_vec3(uniform(name), x, y, z); }
 
 	/**
 	* @brief utility function to set a uniform vec4 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_vec4(const std::string &name, const glm::vec4 &value) const;
+	void set_vec4(Uniform_Handle uniform, const glm::vec4 &value) const;
+	void set_vec4(Uniform_Name name, const glm::vec4 &value) const { set_vec4(uniform(name), value); }
 
 	/**
 	* @brief utility function to set a uniform vec4 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param x			x value to set the uniform to
 	* @param y			y value to set the uniform to
 	* @param z			z value to set the uniform to
 	* @param w			w value to set the uniform to
 	*/
-	void set_vec4(const std::string &name, float x, float y, float z, float w) const;
+	void set_vec4(Uniform_Handle uniform, float x, float y, float z, float w) const;
+	void set_vec4(Uniform_Name name, float x, float y, float z, float w) const { set_vec4(uniform(name), x, y, z, w); }
 
 	/**
 	* @brief utility function to set a uniform mat2 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_mat2(const std::string &name, const glm::mat2 &mat) const;
+	void set_mat2(Uniform_Handle uniform, const glm::mat2 &mat) const;
+	void set_mat2(Uniform_Name name, const glm::mat2 &mat) const { set_mat2(uniform(name), mat); }
 
 	/**
 	* @brief utility function to set a uniform mat3 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_mat3(const std::string &name, const glm::mat3 &mat) const;
+	void set_mat3(Uniform_Handle uniform, const glm::mat3 &mat) const;
+	void set_mat3(Uniform_Name name, const glm::mat3 &mat) const { set_mat3(uniform(name), mat); }
 
 	/**
 	* @brief utility function to set a uniform mat4 in the shader
-	* @param &name		name of the uniform
+	* @param uniform		the uniform, a handle from uniform() or its name
 	* @param value		value to set the uniform to
 	*/
-	void set_mat4(const std::string &name, const glm::mat4 &mat) const;
+	void set_mat4(Uniform_Handle uniform, const glm::mat4 &mat) const;
+	void set_mat4(Uniform_Name name, const glm::mat4 &mat) const { set_mat4(uniform(name), mat); }
 
 private:
 
+	// not copyable, a copy would share the pending shader objects and keep its own shadow copy of the uniforms the program holds
+	Shader(const Shader &);
+	Shader &operator=(const Shader &);
+
+	// the reflection tables are filled when the program finishes linking, which the const lookups may wait for
+	mutable std::vector<Shader_Uniform> m_uniforms;				/**< the active uniforms, sorted by hash */
+	mutable std::vector<Shader_Uniform_Block> m_uniform_blocks;	/**< the active uniform blocks */
+
+	mutable bool m_pending;						/**< the compile and link are submitted and their status not checked yet */
+	mutable unsigned int m_stages[3];			/**< the vertex, fragment and geometry shader objects while pending, 0 for a missing stage */
+	mutable std::vector<std::string> m_stage_files[3];	/**< the files each stage is made of while pending, for the error messages */
+	std::string m_cache_path;					/**< where the binary is cached once linked, empty if it isn't */
+	unsigned long long m_cache_key;				/**< the key of the sources for the cache */
+	double m_submit_ms;							/**< time the constructor spent, counted with the wait in the compile time cached */
+
+	// the shadow copy is a cache of what GL holds, the const setters and flush update it
+	mutable std::vector<Shader_Uniform_Value> m_values;		/**< one per active uniform location */
+	mutable std::vector<unsigned int> m_value_words;		/**< the values, as raw 32 bit words */
+	mutable std::vector<int> m_dirty;						/**< the m_values set since the last flush */
+	mutable std::vector<std::string> m_value_names;			/**< the name of each of the m_values, for the error messages */
+
+	/**
+	* @brief	writes a value to the shadow copy, marking it for the next flush if it changed
+	* @param uniform		the uniform, nothing happens for a handle of -1
+	* @param *value			the value as 32 bit words, bools and ints as GLint and the rest as GLfloat
+	* @param words			words in the value
+	* @param scalar			GL_INT or GL_FLOAT, the type of the words; a value of the wrong size or scalar type for the uniform is rejected
+	*						like GL would and reported as ERROR::SHADER::UNIFORM_TYPE_MISMATCH
+	*/
+	void set_value(Uniform_Handle uniform, const void *value, unsigned int words, GLenum scalar) const;
+
+	/**
+	* @brief	fills the reflection tables from the linked program, every active uniform and array element and every uniform block
+	*/
+	void reflect() const;
+
+	/**
+	* @brief	checks the status of the submitted compile and link, then caches and reflects the program, see finish()
+	*/
+	void finish_pending() const;
+
 	/**
 	* @brief utility function for checking shader compilation/linking errors
 	* @param shader		shader to check for error
 	* @param type		the type of shader
+	* @return	true if it compiled or linked
 	*/
-	void check_compile_error(unsigned int shader, Shader_Type type);
+	static bool check_compile_error(unsigned int shader, Shader_Type type);
 };
   
 #endif
\ No newline at end of file
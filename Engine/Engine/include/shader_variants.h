@@ -0,0 +1,100 @@
+#ifndef __SHADER_VARIANTS_H__
+#define __SHADER_VARIANTS_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "shader.h"
+
+/**
+* @struct Shader_Feature
+* @brief	a compile time switch of a shader, defined as a macro holding its value in the key. The shader tests it with #if
+*/
+struct Shader_Feature
+{
+	const char *define;		/**< name of the macro, a string literal */
+	unsigned int bits;		/**< bits of the key the value takes, 1 for on/off and 3 for a light count up to 7 */
+};
+
+/**
+* @class Shader_Variants
+* @brief	The specialized programs of one set of shader files, compiled on demand. A variant is picked by a key packing the value of
+*			every feature, the first feature in the lowest bits, and is compiled with a "#define <feature> <value>" for each of them the
+*			first time it is asked for, or up front with warm_up(). Its branches on the features are then resolved by the GLSL preprocessor instead of at runtime.
+*			Each variant is cached by the Program_Cache under its own file.
+*
+*			The variants own their programs and delete them with the Shader_Variants, must be used on the GL thread
+*/
+class Shader_Variants
+{
+public:
+
+	/**
+	* @brief	nothing is compiled until a variant is asked for. The features' bits have to add up to 32 at most, a feature that doesn't fit
+	*			is reported (and asserted in debug builds) and left out of the key and the defines, the shader compiles with its default for it
+	* @param *vertex_path		path to the vertex shader
+	* @param *fragment_path		path to the fragment shader
+	* @param *geometry_path		path to the geometry shader, empty if it has none
+	* @param *features			the features of the shader, copied
+	* @param feature_count		number of features
+	*/
+	Shader_Variants(const char *vertex_path, const char *fragment_path, const char *geometry_path, const Shader_Feature *features, unsigned int feature_count);
+
+	/**
+	* @brief	deletes the program of every variant
+	*/
+	~Shader_Variants();
+
+	/**
+	* @brief	the part of a key holding one feature's value
+	* @param feature		index of the feature
+	* @param value			its value, one too big for the feature's bits is reported (and asserted in debug builds) and clamped
+	* @return	or it together with the other features' to make the key
+	*/
+	unsigned int key(unsigned int feature, unsigned int value) const;
+
+	/**
+	* @brief	the variant for a key, submitting its compile (or restoring it from the Program_Cache) the first time
+	* @param key	the features' values packed with key()
+	*/
+	Shader &get(unsigned int key);
+
+	/**
+	* @brief	submits the variants of a warm-up list without waiting for any of them, so they compile together while loading and
+	*			get() later finds them built
+	* @param *keys		the keys of the variants
+	* @param count		number of keys
+	*/
+	void warm_up(const unsigned int *keys, unsigned int count);
+
+	/**
+	* @brief	finishes the variants the driver is done with and leaves the others compiling, call it every frame of a loading screen
+	* @return	true once every variant submitted is finished
+	*/
+	bool poll();
+
+	/**
+	* @brief	the #define lines a variant is compiled with
+	*/
+	std::string defines(unsigned int key) const;
+
+	/**
+	* @brief	number of variants compiled so far
+	*/
+	size_t size() const { return m_variants.size(); }
+
+private:
+
+	Shader_Variants(const Shader_Variants &);
+	Shader_Variants &operator=(const Shader_Variants &);
+
+	std::string m_vertex_path;
+	std::string m_fragment_path;
+	std::string m_geometry_path;
+	std::vector<Shader_Feature> m_features;				/**< the features, with no bits for one that didn't fit in the key */
+	std::vector<unsigned int> m_shifts;					/**< first bit of each feature in the key */
+	std::unordered_map<unsigned int, Shader> m_variants;	/**< the compiled variants by key, the map never moves them */
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __SHARED_CONTEXT_H__
+#define __SHARED_CONTEXT_H__
+
+/**
+* @class Shared_Context
+* @brief	A hidden OpenGL context that shares textures and buffers with the render context, so another thread can create GL objects the render thread draws with.
+*			It is created on the render thread by whatever owns the render context (Headless_Context::create_shared_context, or a hidden GLFW window sharing with the main window)
+*			and then only made current and released on the thread that uses it
+*/
+class Shared_Context
+{
+public:
+
+	/**
+	* @brief	destroys the context, called after it was released on its thread
+	*/
+	virtual ~Shared_Context() {}
+
+	/**
+	* @brief	makes the context current on the calling thread
+	* @return	false if it couldn't be made current, an error is printed
+	*/
+	virtual bool make_current() = 0;
+
+	/**
+	* @brief	makes no context current on the calling thread, the thread that made it current calls it before exiting
+	*/
+	virtual void release() = 0;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __SPAN_H__
+#define __SPAN_H__
+
+#include <stddef.h>
+#include <vector>
+
+/**
+* @class Span
+* @brief	A read only view of contiguous elements owned by someone else (a vector, a mapped file, a C array), the engine is C++14 so this stands in for std::span.
+*			It is two words and is passed by value, the elements have to outlive it
+*/
+template <typename T>
+class Span
+{
+public:
+
+	/**
+	* @brief	an empty span
+	*/
+	Span() : m_data(NULL), m_size(0) {}
+
+	/**
+	* @brief	a span of count elements starting at data
+	*/
+	Span(const T *data, size_t count) : m_data(data), m_size(count) {}
+
+	/**
+	* @brief	a span of all the elements of a vector, it is invalidated when the vector reallocates
+	*/
+	Span(const std::vector<T> &vector) : m_data(vector.data()), m_size(vector.size()) {}
+
+	const T *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	size_t size_bytes() const { return m_size * sizeof(T); }
+	bool empty() const { return m_size == 0; }
+
+	const T &operator[](size_t index) const { return m_data[index]; }
+	const T *begin() const { return m_data; }
+	const T *end() const { return m_data + m_size; }
+
+private:
+
+	const T *m_data;	/**< the first element */
+	size_t m_size;		/**< number of elements */
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef __TEXTURE_CACHE_H__
+#define __TEXTURE_CACHE_H__
+
+#include <string>
+
+#include "block_compression.h"
+#include "texture_registry.h"
+
+class Thread_Pool;
+
+/**
+* @struct Texture_Cache_Statistics
+* @brief	what the texture cache did since the last reset
+*/
+struct Texture_Cache_Statistics
+{
+	unsigned int hits;					/**< images read from an up to date cache file */
+	unsigned int builds;				/**< images compressed and written because their cache was missing or stale */
+	unsigned int textures;				/**< compressed textures created */
+	double compress_ms;					/**< time spent compressing, summed over the threads that asked */
+	unsigned long long bytes;			/**< bytes of the compressed textures created, every mip level */
+	unsigned long long raw_bytes;		/**< what the same textures would take uncompressed (RGB8 for BC1 and BC5, RGBA8 for BC3) with their mip levels */
+};
+
+/**
+* @class Texture_Cache
+* @brief	Block compressed copies of the texture images, stored next to the source as <source>.ktx (KTX 1.1 with the full mip chain, built once
+*			on the CPU with mip_filter). A cache file records the source's size and modification time, the flip on load setting, how it was compressed
+*			and the encoder version, and is rebuilt from the source when any of them changed. Color images are compressed to BC1, or BC3 if they have
+*			alpha that isn't opaque everywhere, normal maps to BC5 which keeps X and Y and drops Z; a shader sampling one has to rebuild Z as sqrt(1 - x^2 - y^2).
+*
+*			Everything is static like the Texture_Registry, which goes through the cache for textures created with a Texture_Compression.
+*			Reading and building are thread safe, creating textures and is_supported have to be called on the GL thread
+*/
+class Texture_Cache
+{
+public:
+
+	/**
+	* @brief	reads the compressed image of a source from its cache, compressing the source and writing the cache first if it isn't up to date
+	* @param &source_path	the path of the image
+	* @param compression	how to compress it, not COMPRESS_NONE
+	* @param &image			receives the compressed image
+	* @param *pool			the threads to compress on, NULL uses a pool of the cache's own
+	* @return	false if the source couldn't be loaded
+	*/
+	static bool load(const std::string &source_path, Texture_Compression compression, Compressed_Image &image, Thread_Pool *pool = NULL);
+
+	/**
+	* @brief	reads the compressed image of a source if its cache exists and is up to date, never compresses
+	* @return	false if there is no usable cache
+	*/
+	static bool read(const std::string &source_path, Texture_Compression compression, Compressed_Image &image);
+
+	/**
+	* @brief	writes the cache of a source, to a temporary file first which then replaces the old cache
+	*/
+	static bool write(const std::string &source_path, Texture_Compression compression, const Compressed_Image &image);
+
+	/**
+	* @brief	the path of the cache file for an image
+	*/
+	static std::string cache_path(const std::string &source_path);
+
+	/**
+	* @brief	the block format a compression picks for an image, images with an alpha channel that is opaque everywhere get BC1 like the ones without
+	*/
+	static Block_Format block_format(Texture_Compression compression, const Decoded_Image &image);
+
+	/**
+	* @brief	the filter the mip chain of a compression is built with, color images are averaged in linear light and normal maps as stored
+	*/
+	static Mip_Filter mip_filter(Texture_Compression compression);
+
+	/**
+	* @brief	check if the context can sample the compressed formats (S3TC is an extension, RGTC is core), must be called on the GL thread
+	* @param srgb	if the sRGB variants of the S3TC formats are needed too
+	*/
+	static bool is_supported(bool srgb);
+
+	/**
+	* @brief	a copy of the statistics, safe to call from any thread
+	*/
+	static Texture_Cache_Statistics statistics();
+
+	/**
+	* @brief	resets the statistics
+	*/
+	static void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	static bool s_enabled;		/**< Model compresses its textures through the cache, off by default since the block formats are lossy */
+};
+
+/**
+* @brief	creates a 2D texture from a compressed image, one glCompressedTexImage2D per mip level, must be called on the GL thread
+* @param &image			the compressed image, its mip chain is used as it is
+* @param &parameters	the sRGB and wrap settings, RGTC has no sRGB variant so it is ignored for BC5
+* @return	the texture's ID
+*/
+unsigned int create_compressed_texture(const Compressed_Image &image, const Texture_Parameters &parameters = Texture_Parameters());
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef __TEXTURE_REGISTRY_H__
+#define __TEXTURE_REGISTRY_H__
+
+#include <stddef.h>
+#include <string>
+
+#include "mip_chain.h"
+
+/**
+* @enum Texture_Wrap
+* @brief	the wrap mode a texture is created with
+*/
+enum Texture_Wrap
+{
+	WRAP_REPEAT = 0,		/**< GL_REPEAT, what the model textures use */
+	WRAP_CLAMP_TO_EDGE,		/**< GL_CLAMP_TO_EDGE */
+	WRAP_CLAMP_IF_ALPHA		/**< GL_CLAMP_TO_EDGE for images with an alpha channel so transparent borders don't bleed, GL_REPEAT otherwise, what load_texture uses */
+};
+
+/**
+* @enum Texture_Compression
+* @brief	if and how a texture is block compressed through the Texture_Cache
+*/
+enum Texture_Compression
+{
+	COMPRESS_NONE = 0,		/**< uploaded as decoded */
+	COMPRESS_COLOR,			/**< BC1, or BC3 for images with alpha */
+	COMPRESS_NORMAL			/**< BC5, the X and Y of a normal map */
+};
+
+/**
+* @struct Texture_Parameters
+* @brief	how a texture is created from its image, part of the registry key so the same image can be loaded both ways
+*/
+struct Texture_Parameters
+{
+	bool srgb;				/**< the image is sRGB encoded, it is created as GL_SRGB or GL_SRGB_ALPHA so sampling it returns linear values */
+	Texture_Wrap wrap;		/**< the wrap mode on S and T */
+	Texture_Compression compression;	/**< created from the image's Texture_Cache file if the context supports the block formats, uncompressed otherwise */
+	Mip_Filter mip_filter;	/**< how the mip levels of an uncompressed texture are built on the CPU, the Texture_Cache picks it from the compression */
+
+	Texture_Parameters(bool srgb = false, Texture_Wrap wrap = WRAP_REPEAT, Texture_Compression compression = COMPRESS_NONE, Mip_Filter mip_filter = MIP_FILTER_SRGB)
+		: srgb(srgb), wrap(wrap), compression(compression), mip_filter(mip_filter) {}
+};
+
+/**
+* @struct Decoded_Image
+* @brief	an image decoded by the registry, shared by everyone who asked for the same file contents
+*/
+struct Decoded_Image
+{
+	unsigned char *pixels;		/**< the pixels as stbi_load returns them, NULL if the image failed to load */
+	int width;					/**< width of the image */
+	int height;					/**< height of the image */
+	int components;				/**< 8 bit channels per pixel */
+};
+
+/**
+* @struct Texture_Registry_Statistics
+* @brief	what the registry did since the program started
+*/
+struct Texture_Registry_Statistics
+{
+	unsigned long long lookups;			/**< texture lookups (acquire and find) */
+	unsigned long long texture_hits;	/**< lookups that found the texture already created */
+	unsigned long long decodes;			/**< images decoded */
+	unsigned long long image_hits;		/**< decodes saved by an image already in the decoded image cache */
+	unsigned long long content_hits;	/**< of those, hits on a file with another path but the same contents */
+	unsigned int textures;				/**< textures alive */
+	unsigned int images;				/**< decoded images in the cache */
+	unsigned long long image_bytes;		/**< pixel bytes of the decoded images in the cache */
+};
+
+/**
+* @class Texture_Registry
+* @brief	Process wide registry of the loaded 2D textures, so every model and scene sharing an image shares its texture and its decode.
+*			Textures are keyed by a hash of the normalized path, the Texture_Parameters and the flip on load setting, found in O(1) and reference counted;
+*			the last release deletes the texture. Under that the decoded images are keyed by a hash of the file contents, so a copy of an image under
+*			another path (or the same image created both as sRGB and linear) is decoded once. Decoded images stay cached while they are in use and
+*			afterwards until s_image_cache_bytes is exceeded, least recently used first.
+*
+*			Everything is static since there is one set of textures per process. The lookups and the decoded image cache are thread safe; creating and
+*			deleting textures (acquire and release) has to happen on the GL thread, see Model_Loader for loading from workers
+*/
+class Texture_Registry
+{
+public:
+
+	/**
+	* @brief	returns the texture for a path, creating it if it isn't loaded, and adds a reference to it. Must be called on the GL thread
+	* @param *path			the path of the image
+	* @param &parameters	how to create the texture
+	* @return	the texture's ID, an empty texture if the image failed to load (it is still registered so it isn't retried)
+	*/
+	static unsigned int acquire(const char *path, const Texture_Parameters &parameters = Texture_Parameters());
+
+	/**
+	* @brief	returns the texture for a path with a reference added if it is loaded, safe to call from any thread
+	* @return	the texture's ID, 0 if it isn't loaded
+	*/
+	static unsigned int find(const char *path, const Texture_Parameters &parameters = Texture_Parameters());
+
+	/**
+	* @brief	registers a texture created outside the registry (by a Texture_Uploader), with one reference, safe to call from any thread
+	* @param id				the texture created from the path's image
+	* @return	the registered texture, if another thread registered the same key first that one is returned with a reference added and the caller deletes id
+	*/
+	static unsigned int insert(const char *path, const Texture_Parameters &parameters, unsigned int id);
+
+	/**
+	* @brief	drops a reference to a texture returned by acquire, find or insert, deleting it with the last one. Must be called on the GL thread
+	*/
+	static void release(unsigned int id);
+
+	/**
+	* @brief	the GPU bytes of a texture with all its levels, queried from GL the first time and remembered while the texture is registered.
+	*			Must be called on the GL thread, works for textures the registry doesn't know too
+	* @param id		the texture
+	*/
+	static size_t gpu_bytes(unsigned int id);
+
+	/**
+	* @brief	returns the decoded image of a file with a reference added, decoding it only if no image with the same contents is cached.
+	*			Safe to call from any thread, a thread asking for an image another thread is decoding waits for it
+	* @param *path			the path of the image
+	* @return	the image, never NULL; its pixels are NULL if it failed to load
+	*/
+	static const Decoded_Image *decode(const char *path);
+
+	/**
+	* @brief	drops a reference to an image returned by decode, it stays cached while the cache is within s_image_cache_bytes
+	*/
+	static void release_image(const Decoded_Image *image);
+
+	/**
+	* @brief	frees every decoded image nobody holds a reference to
+	*/
+	static void trim_images();
+
+	/**
+	* @brief	sets if images are flipped vertically on load (stbi_set_flip_vertically_on_load), use this instead of calling stbi directly so the setting is part of the keys.
+	*			stbi only has the one global setting, don't change it while images are decoded on other threads
+	*/
+	static void set_flip_on_load(bool flip);
+
+	/**
+	* @brief	the current flip on load setting
+	*/
+	static bool flip_on_load();
+
+	/**
+	* @brief	resolves "." and ".." and repeated or back slashes so different spellings of a path find the same texture
+	*/
+	static std::string normalize_path(const char *path);
+
+	/**
+	* @brief	a copy of the statistics, safe to call from any thread
+	*/
+	static Texture_Registry_Statistics statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	static void print();
+
+	static size_t s_image_cache_bytes;		/**< pixel bytes of decoded images kept once nobody uses them, 0 frees them right away; default 64 MB */
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef __TEXTURE_UPLOADER_H__
+#define __TEXTURE_UPLOADER_H__
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mip_chain.h"
+#include "shared_context.h"
+#include "texture_registry.h"
+
+/**
+* @struct Texture_Upload_Statistics
+* @brief	what a Texture_Uploader did so far
+*/
+struct Texture_Upload_Statistics
+{
+	unsigned int textures;				/**< textures published */
+	unsigned int buffered_uploads;		/**< textures uploaded from a pixel buffer of the ring */
+	unsigned int direct_uploads;		/**< textures too large for a pixel buffer, uploaded from client memory */
+	unsigned int stalls;				/**< times a decoder had to wait for a free pixel buffer */
+	unsigned long long bytes;			/**< pixel bytes uploaded */
+	double busy_ms;						/**< time the upload thread spent in glTexImage2D (and glGenerateMipmap for uploads without a Mip_Chain) */
+	double latency_ms;					/**< summed time from upload to the texture being published */
+	unsigned int queue_depth;			/**< uploads submitted but not yet published */
+	unsigned int max_queue_depth;		/**< the deepest the queue got */
+
+	/**
+	* @brief	MB/s of pixels moved while the upload thread was busy
+	*/
+	double bandwidth_mb_s() const { return busy_ms > 0.0 ? bytes / (busy_ms * 1000.0) : 0.0; }
+};
+
+/**
+* @class Texture_Uploader
+* @brief	Uploads textures on its own thread through a Shared_Context, so no texture upload or mipmap generation runs on the render thread.
+*			It keeps a ring of mapped GL_PIXEL_UNPACK_BUFFERs: a decoder calling upload copies its pixels straight into a free one and goes back to decoding,
+*			the upload thread unmaps it, creates the texture and its mip levels from it and puts a glFenceSync after them.
+*			Only once the fence is signaled is the texture complete for every context; the completion callback then publishes its id and the buffer is mapped again for the next decoder
+*/
+class Texture_Uploader
+{
+public:
+
+	/**
+	* @brief	called on the upload thread with the id of a finished texture
+	*/
+	typedef std::function<void(unsigned int texture_id)> Completion;
+
+	/**
+	* @brief	starts the upload thread, makes the context current on it and maps the pixel buffers, returns once that is done
+	* @param *context		the context to upload with, owned by the uploader from now on
+	* @param buffer_count	number of pixel buffers in the ring, the most textures in flight between decoders and the GPU
+	* @param buffer_size	bytes of each pixel buffer, larger textures are uploaded from client memory
+	*/
+	Texture_Uploader(Shared_Context *context, unsigned int buffer_count = 4, unsigned int buffer_size = 8 << 20);
+
+	/**
+	* @brief	finishes every queued upload, then stops the thread and deletes the pixel buffers and the context
+	*/
+	~Texture_Uploader();
+
+	/**
+	* @brief	check if the upload thread got its context current, upload must not be called otherwise
+	*/
+	bool is_valid() const { return m_valid; }
+
+	/**
+	* @brief	queues a texture upload from any thread, the pixels are copied before it returns.
+	*			Blocks while every pixel buffer is in flight, which keeps fast decoders from running ahead of the GPU
+	* @param *pixels		the pixels as stbi_load returns them, NULL creates an empty texture (for images that failed to load) like create_texture
+	* @param width			width of the image
+	* @param height			height of the image
+	* @param components		number of 8 bit channels per pixel
+	* @param parameters		the internal format and wrap mode to create the texture with, like create_texture
+	* @param *mips			the levels below 0 built by the decoder, copied along with the pixels; NULL has the upload thread call glGenerateMipmap
+	* @param on_complete	called on the upload thread with the texture's id once it is complete
+	*/
+	void upload(const unsigned char *pixels, int width, int height, int components, const Texture_Parameters &parameters, const Mip_Chain *mips, Completion on_complete);
+
+	/**
+	* @brief	blocks until every upload queued so far is published
+	*/
+	void finish();
+
+	/**
+	* @brief	a copy of the statistics so far, safe to call from any thread
+	*/
+	Texture_Upload_Statistics statistics();
+
+	/**
+	* @brief	zeroes the statistics, except for the uploads still queued
+	*/
+	void reset_statistics();
+
+	/**
+	* @brief	prints the statistics to stdout
+	*/
+	void print();
+
+	/**
+	* @brief	the statistics as JSON object members (no surrounding braces), each line starting with indent
+	*/
+	std::string json_members(const char *indent);
+
+private:
+
+	/**
+	* @struct Pending_Upload
+	* @brief	a texture between upload and its fence being signaled
+	*/
+	struct Pending_Upload
+	{
+		int buffer;								/**< the pixel buffer of the ring taken by the upload, -1 for a texture too large for one */
+		std::vector<unsigned char> client_pixels;	/**< the pixels of a texture too large for a pixel buffer, or whose buffer could not be mapped; empty if they are in the buffer */
+		std::vector<Mip_Level> mip_levels;		/**< the levels below 0, their offsets are from mip_offset; empty to generate them */
+		size_t mip_offset;						/**< where the mip levels start after the pixels */
+		bool empty;								/**< the image failed to load, only the texture name is created */
+		int width, height, components;
+		Texture_Parameters parameters;
+		Completion on_complete;
+		long long submitted_ns;					/**< when upload was called, for the latency */
+		unsigned int texture;
+		GLsync fence;
+	};
+
+	// not copyable, the thread and the buffers are owned
+	Texture_Uploader(const Texture_Uploader &);
+	Texture_Uploader &operator=(const Texture_Uploader &);
+
+	/**
+	* @brief	the upload thread
+	*/
+	void run();
+
+	/**
+	* @brief	creates the texture of an upload and fences it, on the upload thread
+	*/
+	void start_upload(Pending_Upload *upload);
+
+	/**
+	* @brief	publishes the texture of an upload whose fence is signaled and returns its buffer to the ring, on the upload thread
+	*/
+	void finish_upload(Pending_Upload *upload);
+
+	Shared_Context *m_context;					/**< the context current on the upload thread */
+	unsigned int m_buffer_size;					/**< bytes of each pixel buffer */
+	std::vector<GLuint> m_buffers;				/**< the pixel buffers of the ring */
+	std::vector<unsigned char *> m_mapped;		/**< where each free buffer is mapped, NULL if mapping it failed, only written by the upload thread */
+
+	std::mutex m_mutex;							/**< guards everything below */
+	std::vector<int> m_free_buffers;			/**< buffers ready for a decoder, mapped unless the map failed */
+	std::condition_variable m_work_condition;	/**< wakes the upload thread */
+	std::condition_variable m_done_condition;	/**< wakes the decoders waiting for a buffer and finish */
+	std::deque<Pending_Upload *> m_queued;		/**< uploads waiting for the upload thread */
+	Texture_Upload_Statistics m_statistics;
+	bool m_started;								/**< the upload thread finished setting up */
+	bool m_valid;								/**< the upload thread has its context current */
+	bool m_stopping;							/**< the destructor is waiting for the thread */
+
+	std::thread m_thread;
+};
+
+#endif
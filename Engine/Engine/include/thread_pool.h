@@ -0,0 +1,75 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* @class Thread_Pool
+* @brief	A fixed set of worker threads running jobs from a shared FIFO queue.
+*			Jobs must not touch GL, only the thread that owns the context can; hand GL work back to it instead (see Model_Loader)
+*/
+class Thread_Pool
+{
+public:
+
+	/**
+	* @brief	starts the worker threads
+	* @param thread_count	number of workers, 0 picks default_thread_count
+	*/
+	Thread_Pool(unsigned int thread_count = 0);
+
+	/**
+	* @brief	runs every job still in the queue and joins the workers
+	*/
+	~Thread_Pool();
+
+	/**
+	* @brief	queues a job, it runs on the first free worker
+	* @param job		the job to run
+	*/
+	void submit(std::function<void()> job);
+
+	/**
+	* @brief	runs a job over the items [0, count) split into ranges, on the workers and the calling thread, and returns once every item is done.
+	*			The caller takes ranges itself while it waits, so it can be called from a job on the same pool without deadlocking
+	* @param count		number of items
+	* @param job		called with each range [begin, end) of items, from several threads at once
+	* @param grain		the fewest items in a range, so cheap items aren't split finer than the hand off costs
+	*/
+	void parallel_for(unsigned int count, std::function<void(unsigned int begin, unsigned int end)> job, unsigned int grain = 1);
+
+	/**
+	* @brief	the number of worker threads
+	*/
+	unsigned int thread_count() const { return m_threads.size(); }
+
+	/**
+	* @brief	one worker per hardware thread except the one the render thread runs on, at least one
+	*/
+	static unsigned int default_thread_count();
+
+private:
+
+	// not copyable, the threads are owned
+	Thread_Pool(const Thread_Pool &);
+	Thread_Pool &operator=(const Thread_Pool &);
+
+	/**
+	* @brief	the loop of a worker thread, runs jobs until the pool is destroyed and the queue is empty
+	* @param index		the worker's index, used to name its thread in the profiler
+	*/
+	void work(unsigned int index);
+
+	std::vector<std::thread> m_threads;				/**< the workers */
+	std::deque<std::function<void()> > m_jobs;		/**< jobs waiting for a worker */
+	std::mutex m_mutex;								/**< guards m_jobs and m_stopping */
+	std::condition_variable m_condition;			/**< wakes the workers when a job is queued or the pool stops */
+	bool m_stopping;								/**< set by the destructor, the workers exit once the queue is empty */
+};
+
+#endif
@@ -3,7 +3,11 @@ layout (location = 0) in vec3 a_position;
 
 uniform mat4 model;
 
+// set by Mesh::draw for quantized meshes
+uniform vec3 mesh_position_offset = vec3(0.0);
+uniform vec3 mesh_position_scale = vec3(1.0);
+
 void main()
 {
-	gl_Position = model * vec4(a_position, 1.0);
+	gl_Position = model * vec4(mesh_position_offset + a_position * mesh_position_scale, 1.0);
 }
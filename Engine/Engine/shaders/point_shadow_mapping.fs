@@ -1,6 +1,14 @@
 #version 330 core
 out vec4 frag_color;
 
+// compile time features, Shader_Variants defines them for each variant and these are the defaults of a plain Shader
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+#ifndef DIFFUSE_TEXTURE
+#define DIFFUSE_TEXTURE 1
+#endif
+
 in VS_OUT 
 {
     vec3 fragment_position;
@@ -8,14 +16,20 @@ in VS_OUT
     vec2 texture_coordinates;
 } fs_in;
 
+#if DIFFUSE_TEXTURE
 uniform sampler2D diffuse_texture;
-uniform samplerCube depth_cube_map;
+#else
+uniform vec3 diffuse_color;
+#endif
 
 uniform vec3 light_position;
 uniform vec3 view_position;
 
+#include "shadow_lighting.glsl"
+
+#if SHADOWS
+uniform samplerCube depth_cube_map;
 uniform float far_plane;
-uniform bool shadows;
 
 // array of offset direction for sampling
 vec3 grid_sampling_disk[20] = vec3[]
@@ -51,34 +65,27 @@ float shadow_calculation(vec3 frag_position)
 	
 	return shadow;
 }
+#endif
 
 void main()
 {
+#if DIFFUSE_TEXTURE
 	vec3 color = texture(diffuse_texture, fs_in.texture_coordinates).rgb;
+#else
+	vec3 color = diffuse_color;
+#endif
 	vec3 normal = normalize(fs_in.normal);
-	vec3 light_color = vec3(0.3);
-
-	// ambient component
-	vec3 ambient_component = 0.3 * color;
-
-	// diffuse component
 	vec3 light_direction = normalize(light_position - fs_in.fragment_position);
-	float diff = max(dot(light_direction, normal), 0.0);
-	vec3 diffuse_component = diff * light_color;
-
-	// specular component
 	vec3 view_direction = normalize(view_position - fs_in.fragment_position);
-	vec3 reflect_direction = reflect(-light_direction, normal);
-	float spec = 0.0f;
-	vec3 halfway_direction = normalize(light_direction + view_direction);
-	spec = pow(max(dot(normal, halfway_direction), 0.0), 64.0);
-	vec3 specular_component = spec * light_color;
 
 	// calculate shadow
-	float shadow = shadows ? shadow_calculation(fs_in.fragment_position) : 0.0;
-	vec3 lighting = (ambient_component + (1.0 - shadow) * (diffuse_component + specular_component)) * color;
+#if SHADOWS
+	float shadow = shadow_calculation(fs_in.fragment_position);
+#else
+	float shadow = 0.0;
+#endif
 
-	frag_color = vec4(lighting, 1.0);
+	frag_color = vec4(shadow_lighting(color, normal, light_direction, view_direction, shadow), 1.0);
 	
 	// this will visualize the depth_cube_map for debugging
 	//vec3 frag_to_light = fs_in.fragment_position - light_position;
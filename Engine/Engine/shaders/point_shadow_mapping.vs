@@ -18,13 +18,30 @@ layout (std140) uniform matrices
 uniform mat4 model;
 uniform bool reverse_normals;
 
+// set by Mesh::draw for quantized meshes, the defaults pass float vertices through
+uniform vec3 mesh_position_offset = vec3(0.0);
+uniform vec3 mesh_position_scale = vec3(1.0);
+uniform bool mesh_octahedral_normals = false;
+
+vec3 decode_octahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
-	vs_out.fragment_position = vec3(model * vec4(a_position, 1.0));
+	vec3 position = mesh_position_offset + a_position * mesh_position_scale;
+	vec3 normal = mesh_octahedral_normals ? decode_octahedral(a_normal.xy) : a_normal;
+
+	vs_out.fragment_position = vec3(model * vec4(position, 1.0));
 	if(reverse_normals)
-		vs_out.normal = transpose(inverse(mat3(model))) * (-1.0 * a_normal);
+		vs_out.normal = transpose(inverse(mat3(model))) * (-1.0 * normal);
 	else
-		vs_out.normal = transpose(inverse(mat3(model))) * a_normal;
+		vs_out.normal = transpose(inverse(mat3(model))) * normal;
 	vs_out.texture_coordinates = a_texture_coordinates;
-	gl_Position = projection * view * model * vec4(a_position, 1.0);
+	gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
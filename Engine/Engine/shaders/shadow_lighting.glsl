@@ -0,0 +1,21 @@
+// Blinn-Phong lighting of a surface by one white light, shared by shadow_mapping.fs and point_shadow_mapping.fs.
+// shadow is the fraction of the light blocked at the fragment, it takes away the diffuse and specular but not the ambient
+vec3 shadow_lighting(vec3 color, vec3 normal, vec3 light_direction, vec3 view_direction, float shadow)
+{
+	vec3 light_color = vec3(0.3);
+
+	// ambient component
+	vec3 ambient_component = 0.3 * color;
+
+	// diffuse component
+	float diff = max(dot(light_direction, normal), 0.0);
+	vec3 diffuse_component = diff * light_color;
+
+	// specular component
+	float spec = 0.0f;
+	vec3 halfway_direction = normalize(light_direction + view_direction);
+	spec = pow(max(dot(normal, halfway_direction), 0.0), 64.0);
+	vec3 specular_component = spec * light_color;
+
+	return (ambient_component + (1.0 - shadow) * (diffuse_component + specular_component)) * color;
+}
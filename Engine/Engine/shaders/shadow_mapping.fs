@@ -15,6 +15,8 @@ uniform sampler2D shadow_map;
 uniform vec3 light_position;
 uniform vec3 view_position;
 
+#include "shadow_lighting.glsl"
+
 float shadow_calculation(vec4 fragment_position_light_space, vec3 light_direction, vec3 normal)
 {
 	// perform perspective divide
@@ -53,27 +55,11 @@ void main()
 {
 	vec3 color = texture(diffuse_texture, fs_in.texture_coordinates).rgb;
 	vec3 normal = normalize(fs_in.normal);
-	vec3 light_color = vec3(0.3);
-
-	// ambient component
-	vec3 ambient_component = 0.3 * color;
-
-	// diffuse component
 	vec3 light_direction = normalize(light_position - fs_in.fragment_position);
-	float diff = max(dot(light_direction, normal), 0.0);
-	vec3 diffuse_component = diff * light_color;
-
-	// specular component
 	vec3 view_direction = normalize(view_position - fs_in.fragment_position);
-	vec3 reflect_direction = reflect(-light_direction, normal);
-	float spec = 0.0f;
-	vec3 halfway_direction = normalize(light_direction + view_direction);
-	spec = pow(max(dot(normal, halfway_direction), 0.0), 64.0);
-	vec3 specular_component = spec * light_color;
 
 	// calculate shadow
 	float shadow = shadow_calculation(fs_in.fragment_position_light_space, light_direction, fs_in.normal);
-	vec3 lighting = (ambient_component + (1.0 - shadow) * (diffuse_component + specular_component)) * color;
 
-	frag_color = vec4(lighting, 1.0);
+	frag_color = vec4(shadow_lighting(color, normal, light_direction, view_direction, shadow), 1.0);
 }
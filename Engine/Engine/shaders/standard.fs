@@ -46,7 +46,10 @@ struct Spot_Light {
     float attenuation_quadratic;
 };
 
+// a compile time feature, a variant can define it to the number of point lights it draws
+#ifndef MAX_POINT_LIGHTS
 #define MAX_POINT_LIGHTS 4
+#endif
 
 in vec3 fragment_position;
 in vec3 normal;
@@ -54,7 +57,9 @@ in vec2 texture_coordinates;
   
 uniform Material material;
 uniform Directional_Light directional_light;
+#if MAX_POINT_LIGHTS > 0
 uniform Point_Light point_lights[MAX_POINT_LIGHTS];
+#endif
 uniform Spot_Light spot_light;
 
 uniform vec3 camera_pos;
@@ -75,8 +80,10 @@ void main()
     vec4 result = calulate_directional_light(directional_light, norm, view_direction);
 
 	// phase 2: Point lights
+#if MAX_POINT_LIGHTS > 0
     for(int i = 0; i < MAX_POINT_LIGHTS; i++)
         result += calulate_point_light(point_lights[i], norm, fragment_position, view_direction);    
+#endif
 
 	// phase 3: spot light
     result += calculate_spot_light(spot_light, norm, fragment_position, view_direction);
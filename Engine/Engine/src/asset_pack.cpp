@@ -0,0 +1,497 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include "asset_pack.h"
+#include "compression.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "texture_registry.h"
+
+//	File format ----------------------------------------------------------------
+//	header | payloads (each 64 byte aligned) | directory slots | path strings
+//	the directory is an open addressed hash table with linear probing, slot_count is a power of two at least twice the number of files.
+//	everything is little endian, bump pack_version when any of it changes
+
+static const char pack_magic[8] = { 'E', 'A', 'S', 'S', 'E', 'T', 'P', 'K' };
+static const uint32_t pack_version = 1;
+static const uint32_t compressed_flag = 1;
+static const uint32_t empty_slot = 0xffffffff;
+static const size_t payload_alignment = 64;
+
+struct Pack_Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t slot_count;
+	uint32_t reserved;
+	uint64_t slots_offset;
+	uint64_t strings_offset;
+	uint64_t strings_size;
+	uint64_t file_size;
+};
+
+struct Pack_Slot
+{
+	uint64_t path_hash;			/**< fnv1a_string of the normalized path */
+	uint32_t path_offset;		/**< offset of the nul terminated path in the strings, empty_slot for a free slot */
+	uint32_t flags;				/**< compressed_flag if the payload is compressed */
+	uint64_t offset;
+	uint64_t stored_size;		/**< size of the payload in the pack */
+	uint64_t size;				/**< size of the file */
+	uint64_t source_size;		/**< size of the loose file when it was packed */
+	int64_t source_mtime;		/**< modification time of the loose file when it was packed */
+};
+
+// the open pack, only changed by open and close
+static Mapped_File *pack_file = NULL;
+static const Pack_Header *pack_header = NULL;
+static const Pack_Slot *pack_slots = NULL;
+static const char *pack_strings = NULL;
+
+static std::mutex statistics_mutex;
+static Asset_Pack_Statistics counters;
+
+#ifdef NDEBUG
+bool Asset_Pack::s_check_sources = false;
+#else
+bool Asset_Pack::s_check_sources = true;
+#endif
+
+static size_t align_up(size_t value)
+{
+	return (value + payload_alignment - 1) & ~(payload_alignment - 1);
+}
+
+/**
+* @brief	checks the header, the directory and every payload's bounds against the file size
+*/
+static bool validate(const Mapped_File &file)
+{
+	size_t size = file.size();
+	if (size < sizeof(Pack_Header))
+		return false;
+
+	const Pack_Header *header = (const Pack_Header *)file.data();
+	if (memcmp(header->magic, pack_magic, sizeof(pack_magic)) != 0 || header->version != pack_version || header->file_size != size)
+		return false;
+
+	if (header->slot_count == 0 || (header->slot_count & (header->slot_count - 1)) != 0 || header->entry_count >= header->slot_count
+		|| header->slots_offset > size || header->slot_count > (size - header->slots_offset) / sizeof(Pack_Slot)
+		|| header->slots_offset % sizeof(uint64_t) != 0
+		|| header->strings_offset > size || header->strings_size > size - header->strings_offset)
+		return false;
+
+	// the strings have to end with a terminator so no path can run past them
+	if (header->entry_count && (header->strings_size == 0 || file.data()[header->strings_offset + header->strings_size - 1] != '\0'))
+		return false;
+
+	const Pack_Slot *slots = (const Pack_Slot *)(file.data() + header->slots_offset);
+	unsigned int entries = 0;
+	for (unsigned int i = 0; i < header->slot_count; i++)
+	{
+		const Pack_Slot &slot = slots[i];
+		if (slot.path_offset == empty_slot)
+			continue;
+		if (slot.path_offset >= header->strings_size || slot.offset > size || slot.stored_size > size - slot.offset
+			|| (!(slot.flags & compressed_flag) && slot.stored_size != slot.size))
+			return false;
+		entries++;
+	}
+	return entries == header->entry_count;
+}
+
+bool Asset_Pack::open(const char *filepath, bool prefetch)
+{
+	PROFILE_ZONE("Asset_Pack::open");
+	close();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Mapped_File *file = new Mapped_File(filepath);
+	if (!file->is_valid())
+	{
+		delete file;
+		return false;
+	}
+	if (!validate(*file))
+	{
+		printf("ERROR::ASSET_PACK::INVALID_PACK %s\n", filepath);
+		delete file;
+		return false;
+	}
+	if (prefetch)
+		file->prefetch();
+
+	pack_file = file;
+	pack_header = (const Pack_Header *)file->data();
+	pack_slots = (const Pack_Slot *)(file->data() + pack_header->slots_offset);
+	pack_strings = (const char *)file->data() + pack_header->strings_offset;
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.entries = pack_header->entry_count;
+	counters.pack_bytes = file->size();
+	counters.open_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+void Asset_Pack::close()
+{
+	delete pack_file;
+	pack_file = NULL;
+	pack_header = NULL;
+	pack_slots = NULL;
+	pack_strings = NULL;
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.entries = 0;
+	counters.pack_bytes = 0;
+}
+
+bool Asset_Pack::is_open()
+{
+	return pack_file != NULL;
+}
+
+bool Asset_Pack::find(const char *path, Packed_Asset &asset)
+{
+	if (!pack_file)
+		return false;
+
+	std::string normalized = Texture_Registry::normalize_path(path);
+	unsigned long long hash = fnv1a_string(normalized.c_str());
+	unsigned int mask = pack_header->slot_count - 1;
+	for (unsigned int i = (unsigned int)hash & mask;; i = (i + 1) & mask)
+	{
+		const Pack_Slot &slot = pack_slots[i];
+		if (slot.path_offset == empty_slot)
+			return false;
+		if (slot.path_hash != hash || strcmp(pack_strings + slot.path_offset, normalized.c_str()) != 0)
+			continue;
+
+		asset.data = pack_file->data() + slot.offset;
+		asset.stored_size = (size_t)slot.stored_size;
+		asset.size = (size_t)slot.size;
+		asset.compressed = (slot.flags & compressed_flag) != 0;
+		asset.source_size = slot.source_size;
+		asset.source_mtime = slot.source_mtime;
+		return true;
+	}
+}
+
+/**
+* @brief	check if the loose file of a packed asset was edited since it was packed, always false without Asset_Pack::s_check_sources.
+*			A missing loose file isn't, a shipped build only has the pack
+*/
+static bool is_stale(const char *path, const Packed_Asset &asset)
+{
+	if (!Asset_Pack::s_check_sources)
+		return false;
+	struct stat info;
+	return stat(path, &info) == 0 && ((uint64_t)info.st_size != asset.source_size || (int64_t)info.st_mtime != asset.source_mtime);
+}
+
+bool Asset_Pack::source_info(const std::string &path, uint64_t &size, int64_t &mtime)
+{
+	Packed_Asset asset;
+	if (find(path.c_str(), asset) && !is_stale(path.c_str(), asset))
+	{
+		size = asset.source_size;
+		mtime = asset.source_mtime;
+		return true;
+	}
+
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	size = (uint64_t)info.st_size;
+	mtime = (int64_t)info.st_mtime;
+	return true;
+}
+
+//	Writing --------------------------------------------------------------------
+
+/**
+* @brief	appends the files under a directory to files, with their paths relative to the root
+* @param &root			the root with a trailing slash
+* @param &directory		the directory relative to the root, without a trailing slash, empty for the root itself
+* @param &files			receives the relative paths
+*/
+static void list_files(const std::string &root, const std::string &directory, std::vector<std::string> &files)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((root + directory + "/*").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+		return;
+	do
+	{
+		std::string name = found.cFileName;
+		if (name == "." || name == "..")
+			continue;
+		std::string path = directory.empty() ? name : directory + '/' + name;
+		if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			list_files(root, path, files);
+		else
+			files.push_back(path);
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+#else
+	DIR *dir = opendir((root + directory).c_str());
+	if (!dir)
+		return;
+	while (dirent *found = readdir(dir))
+	{
+		std::string name = found->d_name;
+		if (name == "." || name == "..")
+			continue;
+
+		struct stat info;
+		std::string path = directory.empty() ? name : directory + '/' + name;
+		if (stat((root + path).c_str(), &info) != 0)
+			continue;
+		if (S_ISDIR(info.st_mode))
+			list_files(root, path, files);
+		else if (S_ISREG(info.st_mode))
+			files.push_back(path);
+	}
+	closedir(dir);
+#endif
+}
+
+static bool ends_with(const std::string &string, const char *suffix)
+{
+	size_t length = strlen(suffix);
+	return string.size() >= length && string.compare(string.size() - length, length, suffix) == 0;
+}
+
+/**
+* @brief	the engine's own caches, which are built per machine and not packed
+*/
+static bool is_cache(const std::string &path)
+{
+	return ends_with(path, ".meshcache") || ends_with(path, ".ktx") || ends_with(path, ".program") || ends_with(path, ".tmp");
+}
+
+/**
+* @brief	images whose format is compressed already, lz_compress would only waste the time to try
+*/
+static bool is_compressed_format(const std::string &path)
+{
+	std::string lower = path;
+	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	return ends_with(lower, ".png") || ends_with(lower, ".jpg") || ends_with(lower, ".jpeg");
+}
+
+static bool write_padding(FILE *file, size_t &offset)
+{
+	static const unsigned char zeros[payload_alignment] = {};
+	size_t padding = align_up(offset) - offset;
+	offset += padding;
+	return fwrite(zeros, 1, padding, file) == padding;
+}
+
+bool Asset_Pack::write(const char *filepath, const char *root, const std::vector<std::string> &directories, bool compress)
+{
+	PROFILE_ZONE("Asset_Pack::write");
+
+	std::string root_path = root;
+	if (!root_path.empty() && root_path[root_path.size() - 1] != '/' && root_path[root_path.size() - 1] != '\\')
+		root_path += '/';
+
+	std::vector<std::string> files;
+	for (int i = 0; i < directories.size(); i++)
+		list_files(root_path, Texture_Registry::normalize_path(directories[i].c_str()), files);
+	files.erase(std::remove_if(files.begin(), files.end(), is_cache), files.end());
+	std::sort(files.begin(), files.end());
+
+	unsigned int slot_count = 1;
+	while (slot_count < files.size() * 2 + 1)
+		slot_count *= 2;
+	std::vector<Pack_Slot> slots(slot_count);
+	for (int i = 0; i < slot_count; i++)
+		slots[i].path_offset = empty_slot;
+	std::string strings;
+
+	// streamed to a temporary file, replace_file then swaps it in
+	std::string temporary_path = std::string(filepath) + ".tmp";
+	FILE *file = fopen(temporary_path.c_str(), "wb");
+	if (!file)
+	{
+		printf("ERROR::ASSET_PACK::FILE_NOT_WRITABLE %s\n", temporary_path.c_str());
+		return false;
+	}
+
+	Pack_Header header;
+	memset(&header, 0, sizeof(header));
+	bool written = fwrite(&header, 1, sizeof(header), file) == sizeof(header);
+	size_t offset = sizeof(header);
+
+	std::vector<unsigned char> compressed;
+	for (int i = 0; i < files.size() && written; i++)
+	{
+		std::string source_path = root_path + files[i];
+
+		// empty files can't be mapped, they are packed with no payload
+		struct stat info;
+		Mapped_File source(source_path.c_str());
+		if (stat(source_path.c_str(), &info) != 0 || (!source.is_valid() && info.st_size != 0))
+		{
+			printf("ERROR::ASSET_PACK::FILE_NOT_READ %s\n", source_path.c_str());
+			written = false;
+			break;
+		}
+
+		const unsigned char *payload = source.data();
+		size_t stored_size = source.size();
+		uint32_t flags = 0;
+		if (compress && stored_size && !is_compressed_format(files[i]))
+		{
+			compressed.clear();
+			lz_compress(source.data(), source.size(), compressed);
+			if (compressed.size() <= source.size() - source.size() / 8)
+			{
+				payload = compressed.data();
+				stored_size = compressed.size();
+				flags = compressed_flag;
+			}
+		}
+
+		written = written && write_padding(file, offset) && fwrite(payload, 1, stored_size, file) == stored_size;
+
+		unsigned long long hash = fnv1a_string(files[i].c_str());
+		unsigned int slot = (unsigned int)hash & (slot_count - 1);
+		while (slots[slot].path_offset != empty_slot)
+			slot = (slot + 1) & (slot_count - 1);
+		slots[slot].path_hash = hash;
+		slots[slot].path_offset = (uint32_t)strings.size();
+		slots[slot].flags = flags;
+		slots[slot].offset = offset;
+		slots[slot].stored_size = stored_size;
+		slots[slot].size = source.size();
+		slots[slot].source_size = (uint64_t)info.st_size;
+		slots[slot].source_mtime = (int64_t)info.st_mtime;
+		strings.append(files[i].c_str(), files[i].size() + 1);
+		offset += stored_size;
+	}
+
+	written = written && write_padding(file, offset);
+	memcpy(header.magic, pack_magic, sizeof(pack_magic));
+	header.version = pack_version;
+	header.entry_count = (uint32_t)files.size();
+	header.slot_count = slot_count;
+	header.slots_offset = offset;
+	header.strings_offset = offset + slots.size() * sizeof(Pack_Slot);
+	header.strings_size = strings.size();
+	header.file_size = header.strings_offset + strings.size();
+
+	written = written && fwrite(slots.data(), sizeof(Pack_Slot), slots.size(), file) == slots.size()
+		&& fwrite(strings.data(), 1, strings.size(), file) == strings.size()
+		&& fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), file) == sizeof(header);
+	written = fclose(file) == 0 && written;
+
+	// the pack being replaced may be the open one, its mapping stays valid until it is closed (Windows refuses to replace it)
+	if (!written)
+		remove(temporary_path.c_str());
+	if (!written || !replace_file(temporary_path.c_str(), filepath))
+	{
+		printf("ERROR::ASSET_PACK::FILE_NOT_WRITTEN %s\n", filepath);
+		return false;
+	}
+
+	return true;
+}
+
+Asset_Pack_Statistics Asset_Pack::statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return counters;
+}
+
+void Asset_Pack::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	Asset_Pack_Statistics open = counters;
+	memset(&counters, 0, sizeof(counters));
+	counters.entries = open.entries;
+	counters.pack_bytes = open.pack_bytes;
+	counters.open_ms = open.open_ms;
+}
+
+void Asset_Pack::print()
+{
+	Asset_Pack_Statistics s = statistics();
+	if (s.entries)
+		printf("asset pack: %u files (%.1f MB) opened in %.2f ms, ", s.entries, s.pack_bytes / 1e6, s.open_ms);
+	else
+		printf("asset pack: none, ");
+	printf("%u assets read from the pack and %u from loose files (%u edited since packing, %.1f MB, %.1f MB decompressed), %u missing\n",
+		s.pack_reads, s.loose_reads, s.stale, s.bytes / 1e6, s.decompressed_bytes / 1e6, s.missing);
+}
+
+//	Asset ----------------------------------------------------------------------
+
+Asset::Asset(const char *path)
+	: m_data(NULL), m_size(0), m_packed(false), m_file(NULL)
+{
+	// no file, like the geometry shader a Shader doesn't have, it isn't counted as missing
+	if (!*path)
+		return;
+
+	Packed_Asset packed;
+	bool stale = false;
+	if (Asset_Pack::find(path, packed) && !(stale = is_stale(path, packed)))
+	{
+		m_packed = true;
+		m_size = packed.size;
+		m_data = packed.data;
+		if (packed.compressed)
+		{
+			PROFILE_ZONE("Asset::decompress");
+			m_buffer.resize(packed.size);
+			m_data = lz_decompress(packed.data, packed.stored_size, m_buffer.data(), m_buffer.size()) ? m_buffer.data() : NULL;
+			if (!m_data)
+				printf("ERROR::ASSET_PACK::CORRUPT_PAYLOAD %s\n", path);
+		}
+	}
+	else
+	{
+		m_file = new Mapped_File(path);
+		m_data = m_file->data();
+		m_size = m_file->size();
+	}
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	if (!m_data)
+		counters.missing++;
+	else if (m_packed)
+		counters.pack_reads++;
+	else
+		counters.loose_reads++;
+	if (m_data && stale)
+		counters.stale++;
+	if (m_data)
+		counters.bytes += m_size;
+	if (m_data && m_packed && !m_buffer.empty())
+		counters.decompressed_bytes += m_size;
+}
+
+Asset::~Asset()
+{
+	delete m_file;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+/**
+* @brief	prints the command line options for the packer
+*/
+void print_usage()
+{
+	printf("usage: asset_packer [options] <pack> <root> <directory>...\n");
+	printf("  packs the files under each directory of root (relative paths, e.g. shaders resources) into one Asset_Pack\n");
+	printf("  --compress         compress the files that get smaller by at least an eighth, images are stored as they are\n");
+}
+
+int main(int argc, char **argv)
+{
+	bool compress = false;
+	std::vector<const char *> arguments;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--compress") == 0)
+			compress = true;
+		else if (argv[i][0] == '-')
+		{
+			print_usage();
+			return 1;
+		}
+		else
+			arguments.push_back(argv[i]);
+	}
+	if (arguments.size() < 3)
+	{
+		print_usage();
+		return 1;
+	}
+
+	std::vector<std::string> directories(arguments.begin() + 2, arguments.end());
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!Asset_Pack::write(arguments[0], arguments[1], directories, compress))
+		return 1;
+	double write_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (!Asset_Pack::open(arguments[0]))
+		return 1;
+	Asset_Pack_Statistics statistics = Asset_Pack::statistics();
+	printf("packed %u files into %s (%.1f MB) in %.0f ms\n", statistics.entries, arguments[0], statistics.pack_bytes / 1e6, write_ms);
+	Asset_Pack::close();
+	return 0;
+}
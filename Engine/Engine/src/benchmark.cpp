@@ -0,0 +1,157 @@
+#include <math.h>
+#include <algorithm>
+
+#include <glm/gtc/constants.hpp>
+
+#include "benchmark.h"
+
+
+void Camera_Path::add_keyframe(float time, glm::vec3 position, float yaw, float pitch)
+{
+	Camera_Keyframe k;
+	k.time = time;
+	k.position = position;
+	k.yaw = yaw;
+	k.pitch = pitch;
+	m_keyframes.push_back(k);
+}
+
+void Camera_Path::apply(Camera &camera, float time)
+{
+	if (m_keyframes.empty())
+		return;
+
+	// loop the path so any number of frames can be replayed
+	float duration = m_keyframes.back().time;
+	if (duration > 0.0f)
+		time = fmodf(time, duration);
+
+	int next = 0;
+	while (next < (int)m_keyframes.size() - 1 && m_keyframes[next].time <= time)
+		next++;
+	int previous = next > 0 ? next - 1 : 0;
+
+	const Camera_Keyframe &a = m_keyframes[previous];
+	const Camera_Keyframe &b = m_keyframes[next];
+	float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 0.0f;
+	t = glm::clamp(t, 0.0f, 1.0f);
+
+	camera.m_position = glm::mix(a.position, b.position, t);
+	camera.set_rotation(glm::mix(a.yaw, b.yaw, t), glm::mix(a.pitch, b.pitch, t));
+}
+
+Camera_Path Camera_Path::orbit()
+{
+	Camera_Path path;
+
+	// circles the room looking at its center, the yaw of each keyframe points back at the origin
+	const int steps = 8;
+	const float radius = 3.5f;
+	const float period = 16.0f;
+	for (int i = 0; i <= steps; i++)
+	{
+		float angle = glm::two_pi<float>() * i / steps;
+		glm::vec3 position(radius * sin(angle), 0.5f + 0.5f * sin(2.0f * angle), radius * cos(angle));
+		float yaw = glm::degrees(angle) + 90.0f;
+		path.add_keyframe(period * i / steps, position, -yaw, -15.0f);
+	}
+
+	return path;
+}
+
+Frame_Statistics::Frame_Statistics(const std::string &name, double bucket_width)
+	: m_name(name), m_bucket_width(bucket_width)
+{
+}
+
+void Frame_Statistics::add_frame(double cpu_ms, double frame_ms)
+{
+	m_cpu_times.push_back(cpu_ms);
+	m_frame_times.push_back(frame_ms);
+}
+
+/**
+* @brief	nearest rank percentile of an already sorted list
+*/
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+Timing_Summary Frame_Statistics::summarize(const std::vector<double> &times)
+{
+	Timing_Summary s = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (times.empty())
+		return s;
+
+	std::vector<double> sorted = times;
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+		total += sorted[i];
+
+	s.mean = total / sorted.size();
+	s.min = sorted.front();
+	s.max = sorted.back();
+	s.p50 = percentile(sorted, 50.0);
+	s.p95 = percentile(sorted, 95.0);
+	s.p99 = percentile(sorted, 99.0);
+	return s;
+}
+
+void Frame_Statistics::print() const
+{
+	Timing_Summary cpu = cpu_summary();
+	Timing_Summary frame = frame_summary();
+
+	printf("%s, %u frames\n", m_name.c_str(), (unsigned int)frame_count());
+	printf("             mean      p50      p95      p99      max\n");
+	printf("  cpu   %8.3f %8.3f %8.3f %8.3f %8.3f ms\n", cpu.mean, cpu.p50, cpu.p95, cpu.p99, cpu.max);
+	printf("  frame %8.3f %8.3f %8.3f %8.3f %8.3f ms\n", frame.mean, frame.p50, frame.p95, frame.p99, frame.max);
+}
+
+/**
+* @brief	writes a Timing_Summary as the members of a JSON object
+*/
+static void write_summary(FILE *file, const char *name, const Timing_Summary &s)
+{
+	fprintf(file, "\t\t\t\"%s\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f },\n",
+		name, s.mean, s.min, s.max, s.p50, s.p95, s.p99);
+}
+
+void Frame_Statistics::write_json(FILE *file, const char *extra) const
+{
+	fprintf(file, "\t\t{\n");
+	fprintf(file, "\t\t\t\"name\": \"%s\",\n", m_name.c_str());
+	fprintf(file, "\t\t\t\"frames\": %u,\n", (unsigned int)frame_count());
+	if (extra)
+		fprintf(file, "%s", extra);
+	write_summary(file, "cpu_ms", cpu_summary());
+	write_summary(file, "frame_ms", frame_summary());
+
+	// histogram of the frame times in fixed width buckets starting at 0 so runs of different builds line up
+	size_t bucket_count = 0;
+	for (size_t i = 0; i < m_frame_times.size(); i++)
+		bucket_count = std::max(bucket_count, (size_t)(m_frame_times[i] / m_bucket_width) + 1);
+	std::vector<unsigned int> buckets(bucket_count, 0);
+	for (size_t i = 0; i < m_frame_times.size(); i++)
+		buckets[(size_t)(m_frame_times[i] / m_bucket_width)]++;
+
+	fprintf(file, "\t\t\t\"histogram\": { \"bucket_ms\": %.4f, \"counts\": [", m_bucket_width);
+	for (size_t i = 0; i < buckets.size(); i++)
+		fprintf(file, "%s%u", i ? ", " : "", buckets[i]);
+	fprintf(file, "] },\n");
+
+	fprintf(file, "\t\t\t\"cpu_times_ms\": [");
+	for (size_t i = 0; i < m_cpu_times.size(); i++)
+		fprintf(file, "%s%.4f", i ? ", " : "", m_cpu_times[i]);
+	fprintf(file, "],\n");
+
+	fprintf(file, "\t\t\t\"frame_times_ms\": [");
+	for (size_t i = 0; i < m_frame_times.size(); i++)
+		fprintf(file, "%s%.4f", i ? ", " : "", m_frame_times[i]);
+	fprintf(file, "]\n");
+	fprintf(file, "\t\t}");
+}
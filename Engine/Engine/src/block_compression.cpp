@@ -0,0 +1,380 @@
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "block_compression.h"
+#include "mip_chain.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+static const unsigned int color_index_order[4] = { 1, 3, 2, 0 };	/**< BC1 index of each step from color1 to color0 */
+
+static void write_16(unsigned char *out, unsigned int value)
+{
+	out[0] = value & 0xff;
+	out[1] = (value >> 8) & 0xff;
+}
+
+static void write_32(unsigned char *out, unsigned int value)
+{
+	write_16(out, value & 0xffff);
+	write_16(out + 2, value >> 16);
+}
+
+/**
+* @brief	rounds an 8 bit RGB color to 5:6:5
+*/
+static unsigned int pack_565(const int *color)
+{
+	unsigned int r = (color[0] * 31 + 127) / 255;
+	unsigned int g = (color[1] * 63 + 127) / 255;
+	unsigned int b = (color[2] * 31 + 127) / 255;
+	return (r << 11) | (g << 5) | b;
+}
+
+/**
+* @brief	the 8 bit RGB color the GPU expands a 5:6:5 color to
+*/
+static void unpack_565(unsigned int packed, int *color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+/**
+* @brief	picks the two endpoint colors of a block: the pixels furthest apart along the principal axis of the block's colors, inset by a sixteenth
+*			of their distance so the interpolated colors land on the pixels instead of past them
+*/
+static void color_endpoints(const unsigned char *rgba, int *max_color, int *min_color)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += rgba[i * 4 + c];
+	for (int c = 0; c < 3; c++)
+		mean[c] /= 16.0f;
+
+	// covariance rr, rg, rb, gg, gb, bb
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float r = rgba[i * 4] - mean[0];
+		float g = rgba[i * 4 + 1] - mean[1];
+		float b = rgba[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// a few power iterations find the principal axis well enough for 16 pixels
+	float axis[3] = { covariance[0] + covariance[1] + covariance[2], covariance[1] + covariance[3] + covariance[4], covariance[2] + covariance[4] + covariance[5] };
+	for (int iteration = 0; iteration < 4; iteration++)
+	{
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float largest = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+		if (largest < 1e-6f)
+			break;
+		axis[0] = x / largest;
+		axis[1] = y / largest;
+		axis[2] = z / largest;
+	}
+
+	int lowest = 0, highest = 0;
+	float lowest_projection = 0.0f, highest_projection = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float projection = rgba[i * 4] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2];
+		if (i == 0 || projection < lowest_projection)
+			lowest = i, lowest_projection = projection;
+		if (i == 0 || projection > highest_projection)
+			highest = i, highest_projection = projection;
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		int high = rgba[highest * 4 + c];
+		int low = rgba[lowest * 4 + c];
+		int inset = (high - low) / 16;
+		max_color[c] = high - inset;
+		min_color[c] = low + inset;
+	}
+}
+
+/**
+* @brief	the 2 bit index of every pixel of a block between two different endpoint colors: the pixel is projected onto the line from color1 to color0
+*			and rounded to the nearest of the 4 steps, 6 * dot >= (2k - 1) * length^2 means the pixel is at least at step k
+* @return	the indices, pixel 0 in the lowest bits
+*/
+static unsigned int color_indices(const unsigned char *rgba, const int *color0, const int *color1)
+{
+	int axis[3] = { color0[0] - color1[0], color0[1] - color1[1], color0[2] - color1[2] };
+	int length_squared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	int steps[16];
+
+#ifdef BLOCK_COMPRESSION_SSE2
+	// 4 pixels at a time, widened to 16 bits; madd pairs RG and B0 of each pixel into 32 bit sums
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i base = _mm_setr_epi16((short)color1[0], (short)color1[1], (short)color1[2], 0, (short)color1[0], (short)color1[1], (short)color1[2], 0);
+	const __m128i direction = _mm_setr_epi16((short)axis[0], (short)axis[1], (short)axis[2], 0, (short)axis[0], (short)axis[1], (short)axis[2], 0);
+	const __m128i step1 = _mm_set1_epi32(length_squared - 1);
+	const __m128i step2 = _mm_set1_epi32(3 * length_squared - 1);
+	const __m128i step3 = _mm_set1_epi32(5 * length_squared - 1);
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(rgba + i * 4));
+		__m128i low = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), base), direction);
+		__m128i high = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), base), direction);
+		__m128 red_green = _mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 blue = _mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1));
+		__m128i dot = _mm_add_epi32(_mm_castps_si128(red_green), _mm_castps_si128(blue));
+		dot = _mm_add_epi32(_mm_slli_epi32(dot, 2), _mm_slli_epi32(dot, 1));
+
+		// the compares are -1 where true, so their sum is minus the step
+		__m128i step = _mm_add_epi32(_mm_add_epi32(_mm_cmpgt_epi32(dot, step1), _mm_cmpgt_epi32(dot, step2)), _mm_cmpgt_epi32(dot, step3));
+		_mm_storeu_si128((__m128i *)(steps + i), _mm_sub_epi32(zero, step));
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		int dot = 6 * ((rgba[i * 4] - color1[0]) * axis[0] + (rgba[i * 4 + 1] - color1[1]) * axis[1] + (rgba[i * 4 + 2] - color1[2]) * axis[2]);
+		steps[i] = (dot >= length_squared) + (dot >= 3 * length_squared) + (dot >= 5 * length_squared);
+	}
+#endif
+
+	unsigned int indices = 0;
+	for (int i = 0; i < 16; i++)
+		indices |= color_index_order[steps[i]] << (i * 2);
+	return indices;
+}
+
+/**
+* @brief	encodes the 8 byte color block shared by BC1 and BC3
+*/
+static void encode_color_block(const unsigned char *rgba, unsigned char *block)
+{
+	int max_color[3], min_color[3];
+	color_endpoints(rgba, max_color, min_color);
+
+	// color0 > color1 selects the 4 color mode in BC1, BC3 always uses it
+	unsigned int color0 = pack_565(max_color);
+	unsigned int color1 = pack_565(min_color);
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	unsigned int indices = 0;
+	if (color0 != color1)
+	{
+		int expanded0[3], expanded1[3];
+		unpack_565(color0, expanded0);
+		unpack_565(color1, expanded1);
+		indices = color_indices(rgba, expanded0, expanded1);
+	}
+
+	write_16(block, color0);
+	write_16(block + 2, color1);
+	write_32(block + 4, indices);
+}
+
+/**
+* @brief	encodes one channel of a block as an 8 byte BC4 block (the alpha block of BC3, the halves of BC5): the channel's minimum and maximum
+*			with 6 values interpolated between them, each pixel rounded to the nearest of the 8
+*/
+static void encode_channel_block(const unsigned char *rgba, int channel, unsigned char *block)
+{
+	unsigned char values[16];
+	for (int i = 0; i < 16; i++)
+		values[i] = rgba[i * 4 + channel];
+
+	int low, high;
+	int steps[16];
+#ifdef BLOCK_COMPRESSION_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i all = _mm_loadu_si128((const __m128i *)values);
+	__m128i minimum = _mm_min_epu8(all, _mm_srli_si128(all, 8));
+	__m128i maximum = _mm_max_epu8(all, _mm_srli_si128(all, 8));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 2));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 2));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 1));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 1));
+	low = _mm_cvtsi128_si32(minimum) & 0xff;
+	high = _mm_cvtsi128_si32(maximum) & 0xff;
+
+	if (high > low)
+	{
+		// 14 * (value - low) >= (2k - 1) * range means the value is at least at step k of 7, the products fit in 16 bits
+		int range = high - low;
+		const __m128i base = _mm_set1_epi16((short)low);
+		const __m128i scale = _mm_set1_epi16(14);
+		__m128i halves[2] = { _mm_unpacklo_epi8(all, zero), _mm_unpackhi_epi8(all, zero) };
+		for (int half = 0; half < 2; half++)
+		{
+			__m128i scaled = _mm_mullo_epi16(_mm_sub_epi16(halves[half], base), scale);
+			__m128i step = zero;
+			for (int k = 1; k <= 7; k++)
+				step = _mm_add_epi16(step, _mm_cmpgt_epi16(scaled, _mm_set1_epi16((short)((2 * k - 1) * range - 1))));
+			step = _mm_sub_epi16(zero, step);
+
+			_mm_storeu_si128((__m128i *)(steps + half * 8), _mm_unpacklo_epi16(step, zero));
+			_mm_storeu_si128((__m128i *)(steps + half * 8 + 4), _mm_unpackhi_epi16(step, zero));
+		}
+	}
+#else
+	low = 255, high = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		low = std::min(low, (int)values[i]);
+		high = std::max(high, (int)values[i]);
+	}
+
+	if (high > low)
+	{
+		int range = high - low;
+		for (int i = 0; i < 16; i++)
+		{
+			int scaled = 14 * (values[i] - low);
+			steps[i] = 0;
+			for (int k = 1; k <= 7; k++)
+				steps[i] += scaled >= (2 * k - 1) * range;
+		}
+	}
+#endif
+
+	// endpoint0 > endpoint1 selects the 8 value mode, index 0 is the maximum, 1 the minimum and 2 to 7 run from the maximum down
+	unsigned long long indices = 0;
+	if (high > low)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			unsigned long long index = steps[i] == 7 ? 0 : steps[i] == 0 ? 1 : 8 - steps[i];
+			indices |= index << (i * 3);
+		}
+	}
+
+	block[0] = (unsigned char)high;
+	block[1] = (unsigned char)low;
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+void encode_bc1_block(const unsigned char *rgba, unsigned char *block)
+{
+	encode_color_block(rgba, block);
+}
+
+void encode_bc3_block(const unsigned char *rgba, unsigned char *block)
+{
+	encode_channel_block(rgba, 3, block);
+	encode_color_block(rgba, block + 8);
+}
+
+void encode_bc5_block(const unsigned char *rgba, unsigned char *block)
+{
+	encode_channel_block(rgba, 0, block);
+	encode_channel_block(rgba, 1, block + 8);
+}
+
+/**
+* @brief	runs job over [0, count) on the pool, or on the calling thread without one
+*/
+static void for_ranges(Thread_Pool *pool, unsigned int count, const std::function<void(unsigned int, unsigned int)> &job)
+{
+	if (pool)
+		pool->parallel_for(count, job);
+	else
+		job(0, count);
+}
+
+/**
+* @brief	encodes every block of an RGBA level, a row of blocks at a time; blocks past the edge repeat the last row and column
+*/
+static void encode_level(const std::vector<unsigned char> &level, int width, int height, Block_Format format, unsigned char *out, Thread_Pool *pool)
+{
+	int blocks_wide = (width + 3) / 4;
+	int blocks_high = (height + 3) / 4;
+	size_t bytes = block_bytes(format);
+
+	for_ranges(pool, blocks_high, [&](unsigned int begin, unsigned int end)
+	{
+		unsigned char rgba[64];
+		for (unsigned int by = begin; by < end; by++)
+		{
+			for (int bx = 0; bx < blocks_wide; bx++)
+			{
+				for (int y = 0; y < 4; y++)
+				{
+					const unsigned char *row = &level[(size_t)std::min((int)by * 4 + y, height - 1) * width * 4];
+					if (bx * 4 + 3 < width)
+						memcpy(rgba + y * 16, row + bx * 16, 16);
+					else
+						for (int x = 0; x < 4; x++)
+							memcpy(rgba + y * 16 + x * 4, row + std::min(bx * 4 + x, width - 1) * 4, 4);
+				}
+
+				unsigned char *block = out + ((size_t)by * blocks_wide + bx) * bytes;
+				if (format == BLOCK_BC1)
+					encode_bc1_block(rgba, block);
+				else if (format == BLOCK_BC3)
+					encode_bc3_block(rgba, block);
+				else
+					encode_bc5_block(rgba, block);
+			}
+		}
+	});
+}
+
+void compress_image(const unsigned char *pixels, int width, int height, int components, Block_Format format, Mip_Filter filter, Compressed_Image &image, Thread_Pool *pool)
+{
+	PROFILE_ZONE("compress_image");
+
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.levels.clear();
+
+	size_t size = 0;
+	for (int level_width = width, level_height = height;; level_width = std::max(level_width / 2, 1), level_height = std::max(level_height / 2, 1))
+	{
+		Compressed_Level level;
+		level.width = level_width;
+		level.height = level_height;
+		level.offset = size;
+		level.size = (size_t)((level_width + 3) / 4) * ((level_height + 3) / 4) * block_bytes(format);
+		image.levels.push_back(level);
+		size += level.size;
+		if (level_width == 1 && level_height == 1)
+			break;
+	}
+	image.data.resize(size);
+
+	std::vector<unsigned char> level, next;
+	expand_to_rgba(pixels, width, height, components, level);
+	for (int i = 0; i < image.levels.size(); i++)
+	{
+		const Compressed_Level &current = image.levels[i];
+		encode_level(level, current.width, current.height, format, &image.data[current.offset], pool);
+		if (i + 1 < image.levels.size())
+		{
+			const Compressed_Level &below = image.levels[i + 1];
+			next.resize((size_t)below.width * below.height * 4);
+			downsample_rgba(&level[0], current.width, current.height, &next[0], below.width, below.height, filter, pool);
+			level.swap(next);
+		}
+	}
+}
@@ -67,6 +67,13 @@ void Camera::process_mouse_scroll(float y_offset)
 		m_zoom = 45.0f;
 }
 
+void Camera::set_rotation(float yaw, float pitch)
+{
+	m_yaw = yaw;
+	m_pitch = pitch;
+	update_camera_vectors();
+}
+
 void Camera::update_camera_vectors()
 {
 	// Calculate the new Front vector
@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "compression.h"
+
+static const size_t min_match = 4;			// shortest match worth a token
+static const size_t max_offset = 65535;		// offsets are stored in 16 bits
+static const int hash_bits = 14;
+
+/**
+* @brief	reads 4 bytes without alignment requirements
+*/
+static unsigned int read32(const unsigned char *p)
+{
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static unsigned int hash32(unsigned int value)
+{
+	return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+/**
+* @brief	writes the remainder of a length that didn't fit in its 4 bit token field, 255 per byte
+*/
+static void write_length(std::vector<unsigned char> &output, size_t length)
+{
+	while (length >= 255)
+	{
+		output.push_back(255);
+		length -= 255;
+	}
+	output.push_back((unsigned char)length);
+}
+
+/**
+* @brief	writes a sequence: token, literals, and the match unless it is the last sequence of the block
+*/
+static void write_sequence(std::vector<unsigned char> &output, const unsigned char *literals, size_t literal_length, size_t offset, size_t match_length)
+{
+	size_t match_code = match_length ? match_length - min_match : 0;
+	unsigned char token = (unsigned char)((literal_length < 15 ? literal_length : 15) << 4 | (match_code < 15 ? match_code : 15));
+	output.push_back(token);
+	if (literal_length >= 15)
+		write_length(output, literal_length - 15);
+	output.insert(output.end(), literals, literals + literal_length);
+
+	if (!match_length)
+		return;
+
+	output.push_back((unsigned char)(offset & 0xFF));
+	output.push_back((unsigned char)(offset >> 8));
+	if (match_code >= 15)
+		write_length(output, match_code - 15);
+}
+
+void lz_compress(const unsigned char *source, size_t size, std::vector<unsigned char> &output)
+{
+	output.clear();
+	output.reserve(size / 2 + 16);
+
+	std::vector<long long> table((size_t)1 << hash_bits, -1);
+	size_t anchor = 0;
+	size_t position = 0;
+	while (position + min_match <= size)
+	{
+		unsigned int sequence = read32(source + position);
+		unsigned int h = hash32(sequence);
+		long long candidate = table[h];
+		table[h] = position;
+
+		if (candidate < 0 || position - candidate > max_offset || read32(source + candidate) != sequence)
+		{
+			position++;
+			continue;
+		}
+
+		size_t length = min_match;
+		while (position + length < size && source[candidate + length] == source[position + length])
+			length++;
+
+		write_sequence(output, source + anchor, position - anchor, position - candidate, length);
+		position += length;
+		anchor = position;
+	}
+
+	// the block always ends with a sequence of only literals, possibly empty
+	write_sequence(output, source + anchor, size - anchor, 0, 0);
+}
+
+/**
+* @brief	reads a length extension, returns false if it runs past the end of the input
+*/
+static bool read_length(const unsigned char *&p, const unsigned char *end, size_t &length)
+{
+	unsigned char byte;
+	do
+	{
+		if (p >= end)
+			return false;
+		byte = *p++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+bool lz_decompress(const unsigned char *source, size_t size, unsigned char *destination, size_t destination_size)
+{
+	const unsigned char *p = source;
+	const unsigned char *end = source + size;
+	unsigned char *out = destination;
+	unsigned char *out_end = destination + destination_size;
+
+	while (p < end)
+	{
+		unsigned char token = *p++;
+
+		size_t literal_length = token >> 4;
+		if (literal_length == 15 && !read_length(p, end, literal_length))
+			return false;
+		if ((size_t)(end - p) < literal_length || (size_t)(out_end - out) < literal_length)
+			return false;
+		memcpy(out, p, literal_length);
+		p += literal_length;
+		out += literal_length;
+
+		// the last sequence has no match
+		if (p == end)
+			break;
+
+		if (end - p < 2)
+			return false;
+		size_t offset = p[0] | (p[1] << 8);
+		p += 2;
+		size_t match_length = token & 0x0F;
+		if (match_length == 15 && !read_length(p, end, match_length))
+			return false;
+		match_length += min_match;
+
+		if (offset == 0 || offset > (size_t)(out - destination) || (size_t)(out_end - out) < match_length)
+			return false;
+
+		// matches can overlap the bytes they produce, copy forwards one byte at a time when they do
+		const unsigned char *match = out - offset;
+		if (offset >= match_length)
+			memcpy(out, match, match_length);
+		else
+			for (size_t i = 0; i < match_length; i++)
+				out[i] = match[i];
+		out += match_length;
+	}
+
+	return out == out_end;
+}
+
+void shuffle_bytes(const unsigned char *source, size_t size, size_t stride, unsigned char *destination)
+{
+	size_t count = size / stride;
+	for (size_t b = 0; b < stride; b++)
+		for (size_t i = 0; i < count; i++)
+			destination[b * count + i] = source[i * stride + b];
+	memcpy(destination + count * stride, source + count * stride, size - count * stride);
+}
+
+void unshuffle_bytes(const unsigned char *source, size_t size, size_t stride, unsigned char *destination)
+{
+	size_t count = size / stride;
+	for (size_t b = 0; b < stride; b++)
+		for (size_t i = 0; i < count; i++)
+			destination[i * stride + b] = source[b * count + i];
+	memcpy(destination + count * stride, source + count * stride, size - count * stride);
+}
@@ -0,0 +1,666 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include <unistd.h>
+
+#include <glad/glad.h>
+
+#include <stb_image.h>
+
+#include "asset_pack.h"
+#include "camera.h"
+#include "model.h"
+#include "model_loader.h"
+#include "scene.h"
+#include "texture_cache.h"
+#include "program_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet.h"
+#include "geometry_arena.h"
+#include "benchmark.h"
+#include "gpu_timer.h"
+#include "gl_statistics.h"
+#include "profiler.h"
+#include "headless_context.h"
+
+/**
+* @struct Benchmark_Scenario
+* @brief	a named configuration of the scene to replay
+*/
+struct Benchmark_Scenario
+{
+	const char *name;			/**< name used on the command line and in the results */
+	unsigned int samples;		/**< MSAA samples of the scene framebuffer, clamped to GL_MAX_SAMPLES */
+	int effect;					/**< post-processing effect, see Scene::m_effect */
+	const char *model_path;		/**< model placed in the room, NULL for none */
+};
+
+//	Scenarios ------------------------------------------------------------------
+const Benchmark_Scenario scenarios[] = {
+	{ "point_shadows",		4, 0, NULL },	// the scene as the application draws it
+	{ "msaa_resolve",		8, 0, NULL },	// doubles the samples so the multisampled pass and the glBlitFramebuffer resolve dominate
+	{ "kernel_post_effect",	4, 1, NULL },	// the 3x3 kernel post-processing quad instead of the plain one
+	{ "nanosuit",			4, 0, "resources/objects/nanosuit/nanosuit.obj" }
+};
+const unsigned int scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
+
+/**
+* @struct Load_Statistics
+* @brief	how long a scenario's model took to load, and with --async-load how the frames rendered while it streamed in did
+*/
+struct Load_Statistics
+{
+	double load_ms;				/**< time from requesting the model to it being drawable */
+	unsigned int frames;		/**< frames rendered while the model streamed in, 0 for a blocking load */
+	double worst_frame_ms;		/**< the longest of those frames */
+	size_t buffer_bytes;		/**< bytes of the model's vertex and index buffers */
+	Geometry_Arena_Statistics arena;	/**< the geometry arena with the scene and the model in it */
+	Geometry_Arena_Statistics unloaded;	/**< the geometry arena once the scene was unloaded and the model's pages compacted */
+	double defragment_ms;		/**< time Geometry_Arena::defragment took after the scene was unloaded */
+	Memory_Usage meshes;		/**< the memory of the model's meshes */
+	Memory_Usage textures;		/**< the memory of the model's textures */
+	Memory_Usage total;			/**< everything the model holds */
+	size_t paged_in_cpu_bytes;	/**< the model's system memory with every mesh paged in, for --mesh-residency on-demand */
+	double page_in_ms;			/**< time to page every mesh in from the Mesh_Cache */
+};
+
+//	Settings ------------------------------------------------------------------
+unsigned int screen_width = 1280;
+unsigned int screen_height = 720;
+unsigned int frame_count = 300;
+unsigned int warmup_frames = 10;
+float time_step = 1.0f / 60.0f;
+double bucket_width = 1.0;
+const char *asset_directory = ENGINE_ASSET_DIRECTORY;
+const char *output_path = NULL;
+const char *trace_path = NULL;
+bool gpu_timers = true;
+bool per_draw_timers = false;
+bool gl_statistics = false;
+bool async_load = false;
+double upload_budget_ms = 2.0;
+unsigned int loader_threads = 0;
+bool upload_thread = false;
+bool compress_textures = false;
+bool optimize_meshes = true;
+bool quantize_vertices = false;
+Mesh_Residency mesh_residency = RESIDENCY_DISCARD;
+unsigned int lod_count = 4;
+float lod_threshold = 1.0f;
+bool meshlet_culling = true;
+bool program_cache = true;
+bool shadows = true;
+const char *pack_path = NULL;
+bool prefetch_pack = false;
+std::vector<std::string> selected_scenarios;
+
+/**
+* @brief	prints the command line options for the benchmark
+*/
+void print_usage()
+{
+	printf("usage: engine_bench [options]\n");
+	printf("  --scenario <name>  scenario to run, can be repeated (default all)\n");
+	printf("  --frames <n>       number of measured frames per scenario (default %u)\n", frame_count);
+	printf("  --warmup <n>       number of frames rendered before measuring (default %u)\n", warmup_frames);
+	printf("  --width <n>        width of the offscreen framebuffer (default %u)\n", screen_width);
+	printf("  --height <n>       height of the offscreen framebuffer (default %u)\n", screen_height);
+	printf("  --step <seconds>   simulated time between frames (default %.4f)\n", time_step);
+	printf("  --bucket <ms>      width of the frame time histogram buckets (default %.2f)\n", bucket_width);
+	printf("  --output <file>    write the results as JSON\n");
+	printf("  --trace <file>     record a CPU profile of every scenario and write it as a Chrome trace\n");
+	printf("  --no-gpu-timers    don't time the passes with GPU queries\n");
+	printf("  --per-draw         also time every Mesh::draw on the GPU\n");
+	printf("  --gl-stats         count the GL calls of every frame and pass, adds the interception overhead to the CPU time\n");
+	printf("  --async-load       stream the scenario's model in with Model_Loader while rendering, instead of loading it before the first frame\n");
+	printf("  --upload-budget <ms>  GL upload time per frame for --async-load (default %.1f)\n", upload_budget_ms);
+	printf("  --loader-threads <n>  worker threads for --async-load (default one per hardware thread but one)\n");
+	printf("  --upload-thread    upload the --async-load textures from a shared context on a Texture_Uploader thread instead of in the frame budget\n");
+	printf("  --compress-textures  create the model textures block compressed from their Texture_Cache files, building the missing ones\n");
+	printf("  --quantize-vertices  create the model meshes in the compact VERTEX_QUANTIZED format\n");
+	printf("  --mesh-residency <discard|keep|on-demand>  what the model meshes do with their CPU copy once uploaded (default discard)\n");
+	printf("  --no-mesh-optimizer  import the scenario models without welding and reordering their meshes\n");
+	printf("  --lod-count <n>    levels of detail per mesh with the full detail one, 1 turns them off (default 4)\n");
+	printf("  --lod-threshold <pixels>  screen space error a level of detail may have to be drawn (default 1.0)\n");
+	printf("  --no-meshlet-culling  draw every meshlet of the model instead of culling them on the CPU each pass\n");
+	printf("  --no-program-cache  compile the shader programs instead of restoring their binaries from the Program_Cache\n");
+	printf("  --no-shadows       skip the depth cubemap pass and draw the lit pass with its shader variant compiled without shadow lookups\n");
+	printf("  --assets <dir>     directory containing shaders/ and resources/ (default %s)\n", asset_directory);
+	printf("  --pack <file>      read the assets from an Asset_Pack of the assets directory (the asset_pack target builds one), falling back to the loose files\n");
+	printf("  --prefetch-pack    ask the OS to read the whole --pack in when it is opened\n");
+	printf("scenarios:");
+	for (unsigned int i = 0; i < scenario_count; i++)
+		printf(" %s", scenarios[i].name);
+	printf("\n");
+}
+
+/**
+* @brief	reads the command line options into the settings
+* @return	false if the options were invalid or help was requested
+*/
+bool parse_arguments(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--scenario") == 0 && has_value)
+			selected_scenarios.push_back(argv[++i]);
+		else if (strcmp(argv[i], "--frames") == 0 && has_value)
+			frame_count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--warmup") == 0 && has_value)
+			warmup_frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--width") == 0 && has_value)
+			screen_width = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--height") == 0 && has_value)
+			screen_height = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--step") == 0 && has_value)
+			time_step = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--bucket") == 0 && has_value)
+			bucket_width = atof(argv[++i]);
+		else if (strcmp(argv[i], "--output") == 0 && has_value)
+			output_path = argv[++i];
+		else if (strcmp(argv[i], "--trace") == 0 && has_value)
+			trace_path = argv[++i];
+		else if (strcmp(argv[i], "--assets") == 0 && has_value)
+			asset_directory = argv[++i];
+		else if (strcmp(argv[i], "--no-gpu-timers") == 0)
+			gpu_timers = false;
+		else if (strcmp(argv[i], "--per-draw") == 0)
+			per_draw_timers = true;
+		else if (strcmp(argv[i], "--gl-stats") == 0)
+			gl_statistics = true;
+		else if (strcmp(argv[i], "--async-load") == 0)
+			async_load = true;
+		else if (strcmp(argv[i], "--upload-budget") == 0 && has_value)
+			upload_budget_ms = atof(argv[++i]);
+		else if (strcmp(argv[i], "--loader-threads") == 0 && has_value)
+			loader_threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--upload-thread") == 0)
+			upload_thread = true;
+		else if (strcmp(argv[i], "--compress-textures") == 0)
+			compress_textures = true;
+		else if (strcmp(argv[i], "--quantize-vertices") == 0)
+			quantize_vertices = true;
+		else if (strcmp(argv[i], "--mesh-residency") == 0 && has_value)
+		{
+			const char *residency = argv[++i];
+			if (strcmp(residency, "discard") == 0)
+				mesh_residency = RESIDENCY_DISCARD;
+			else if (strcmp(residency, "keep") == 0)
+				mesh_residency = RESIDENCY_KEEP;
+			else if (strcmp(residency, "on-demand") == 0)
+				mesh_residency = RESIDENCY_ON_DEMAND;
+			else
+				return false;
+		}
+		else if (strcmp(argv[i], "--no-mesh-optimizer") == 0)
+			optimize_meshes = false;
+		else if (strcmp(argv[i], "--lod-count") == 0 && has_value)
+			lod_count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--lod-threshold") == 0 && has_value)
+			lod_threshold = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--no-meshlet-culling") == 0)
+			meshlet_culling = false;
+		else if (strcmp(argv[i], "--no-program-cache") == 0)
+			program_cache = false;
+		else if (strcmp(argv[i], "--no-shadows") == 0)
+			shadows = false;
+		else if (strcmp(argv[i], "--pack") == 0 && has_value)
+			pack_path = argv[++i];
+		else if (strcmp(argv[i], "--prefetch-pack") == 0)
+			prefetch_pack = true;
+		else
+			return false;
+	}
+
+	for (unsigned int i = 0; i < selected_scenarios.size(); i++)
+	{
+		bool found = false;
+		for (unsigned int j = 0; j < scenario_count; j++)
+			found |= selected_scenarios[i] == scenarios[j].name;
+		if (!found)
+		{
+			printf("unknown scenario %s\n", selected_scenarios[i].c_str());
+			return false;
+		}
+	}
+
+	return frame_count > 0 && screen_width > 0 && screen_height > 0 && time_step > 0.0f && bucket_width > 0.0;
+}
+
+/**
+* @brief	check if a scenario was selected on the command line
+*/
+bool is_selected(const char *name)
+{
+	if (selected_scenarios.empty())
+		return true;
+	for (unsigned int i = 0; i < selected_scenarios.size(); i++)
+		if (selected_scenarios[i] == name)
+			return true;
+	return false;
+}
+
+/**
+* @brief	replays the scripted camera path through the scene with a fixed simulated clock and records every frame
+* @param &scenario		the scenario to run
+* @param &context		the headless context holding the framebuffer that stands in for the window
+* @param &statistics	receives the time of every measured frame
+* @param *gpu_timer		times the passes of every measured frame, may be NULL
+* @param *loader		streams the model in while the first frames render, NULL to load it before rendering
+* @param &load			receives how the model load went
+* @return	the MSAA samples the scene was created with, the scenario's clamped to GL_MAX_SAMPLES
+*/
+unsigned int run_scenario(const Benchmark_Scenario &scenario, Headless_Context &context, Frame_Statistics &statistics, Gpu_Timer *gpu_timer, Model_Loader *loader, Load_Statistics &load)
+{
+	int max_samples = 1;
+	glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+	unsigned int samples = scenario.samples < (unsigned int)max_samples ? scenario.samples : (unsigned int)max_samples;
+
+	PROFILE_BEGIN(setup, scenario.name);
+	Scene *scene = new Scene(screen_width, screen_height, samples);
+	scene->m_effect = scenario.effect;
+	scene->m_shadows = shadows;
+
+	load.load_ms = 0.0;
+	load.frames = 0;
+	load.worst_frame_ms = 0.0;
+	load.buffer_bytes = 0;
+	load.paged_in_cpu_bytes = 0;
+	load.page_in_ms = 0.0;
+	load.defragment_ms = 0.0;
+
+	Model *model = NULL;
+	Model_Handle *handle = NULL;
+	if (scenario.model_path)
+	{
+		scene->m_model_transform = glm::scale(glm::translate(glm::mat4(), glm::vec3(0.0f, -5.0f, 0.0f)), glm::vec3(0.35f));
+		if (loader)
+			handle = loader->load(scenario.model_path);
+		else
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			model = new Model((char *)scenario.model_path);
+			load.load_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			scene->m_model = model;
+		}
+	}
+
+	PROFILE_END(setup);
+
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+	Camera_Path path = Camera_Path::orbit();
+
+	// the scene keeps rendering without the model while it streams in, these frames aren't part of the replay
+	while (handle && !handle->is_ready() && !handle->has_failed())
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		PROFILE_FRAME();
+		loader->update(upload_budget_ms);
+		path.apply(camera, 0.0f);
+		scene->render(camera, 0.0f, context.m_framebuffer_object);
+		glFinish();
+
+		double frame_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		load.frames++;
+		if (frame_ms > load.worst_frame_ms)
+			load.worst_frame_ms = frame_ms;
+	}
+	if (handle)
+	{
+		load.load_ms = handle->load_ms();
+		scene->m_model = handle->get();
+	}
+	if (scene->m_model)
+	{
+		const std::vector<Mesh> &meshes = scene->m_model->get_meshes();
+		for (size_t i = 0; i < meshes.size(); i++)
+			load.buffer_bytes += meshes[i].buffer_bytes();
+
+		Model *loaded = scene->m_model;
+		load.meshes = loaded->mesh_memory_usage();
+		load.textures = loaded->texture_memory_usage();
+		load.total = loaded->memory_usage();
+
+		// what a CPU query over the whole model costs with on demand residency, and what it holds while the copies are in
+		if (mesh_residency == RESIDENCY_ON_DEMAND)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < meshes.size(); i++)
+				loaded->page_in(i);
+			load.page_in_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			load.paged_in_cpu_bytes = loaded->memory_usage().cpu_bytes;
+			for (size_t i = 0; i < meshes.size(); i++)
+				loaded->page_out(i);
+		}
+	}
+	load.arena = Geometry_Arena::statistics();
+
+	// the clock only ever advances by time_step so every run renders the exact same frames
+	unsigned int frame = 0;
+	for (; frame < warmup_frames; frame++)
+	{
+		float current_time = frame * time_step;
+		PROFILE_FRAME();
+		if (gpu_timer)
+			gpu_timer->begin_frame();
+		Gl_Statistics::begin_frame();
+		path.apply(camera, current_time);
+		scene->render(camera, current_time, context.m_framebuffer_object);
+		Gl_Statistics::end_frame();
+	}
+	glFinish();
+
+	// the warmup frames still in flight are read back with the first measured frames, drop them so only measured frames count
+	if (gpu_timer)
+	{
+		gpu_timer->resolve_all();
+		gpu_timer->reset();
+	}
+	Gl_Statistics::reset();
+
+	for (unsigned int i = 0; i < frame_count; i++, frame++)
+	{
+		float current_time = frame * time_step;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		PROFILE_FRAME();
+		if (gpu_timer)
+			gpu_timer->begin_frame();
+		Gl_Statistics::begin_frame();
+		path.apply(camera, current_time);
+		scene->render(camera, current_time, context.m_framebuffer_object);
+		Gl_Statistics::end_frame();
+		std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+
+		// there is no swap to wait on the GPU for us, finish so the frame time includes the GPU work
+		PROFILE_BEGIN(finish, "glFinish");
+		glFinish();
+		PROFILE_END(finish);
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+		double frame_ms = std::chrono::duration<double, std::milli>(end - start).count();
+		statistics.add_frame(std::chrono::duration<double, std::milli>(submitted - start).count(), frame_ms);
+		PROFILE_COUNTER("frame_ms", frame_ms);
+	}
+
+	if (gpu_timer)
+		gpu_timer->resolve_all();
+
+	// unloading the scene leaves a hole where its floor and cube were in front of the model's ranges, compact them like a level change keeping the model would
+	delete scene;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	Geometry_Arena::defragment();
+	glFinish();
+	load.defragment_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	load.unloaded = Geometry_Arena::statistics();
+
+	delete model;
+	delete handle;
+	return samples;
+}
+
+int main(int argc, char **argv)
+{
+	if (!parse_arguments(argc, argv))
+	{
+		print_usage();
+		return 1;
+	}
+
+	// opened before changing directory so a relative --pack is where it was given
+	if (pack_path && !Asset_Pack::open(pack_path, prefetch_pack))
+	{
+		printf("Failed to open the asset pack %s\n", pack_path);
+		return 1;
+	}
+
+	// the shaders and textures are loaded with paths relative to the project directory
+	if (chdir(asset_directory) != 0)
+	{
+		printf("Failed to change directory to %s\n", asset_directory);
+		return 1;
+	}
+
+	Headless_Context context(screen_width, screen_height);
+	if (!context.is_valid())
+		return 1;
+	context.print_info();
+
+	Texture_Registry::set_flip_on_load(true);
+	Texture_Cache::s_enabled = compress_textures;
+	Mesh_Optimizer::s_enabled = optimize_meshes;
+	Mesh_Simplifier::s_lod_count = lod_count;
+	Mesh_Simplifier::s_error_threshold = lod_threshold;
+	Meshlet_Culler::s_enabled = meshlet_culling;
+	Program_Cache::s_enabled = program_cache;
+	Model::s_vertex_format = quantize_vertices ? VERTEX_QUANTIZED : VERTEX_FLOAT;
+	Model::s_mesh_residency = mesh_residency;
+
+	PROFILE_THREAD("main");
+	if (trace_path)
+	{
+#ifndef ENGINE_PROFILER
+		printf("built without ENGINE_PROFILER, the trace will be empty\n");
+#endif
+		Profiler::set_enabled(true);
+	}
+
+	std::vector<Frame_Statistics> results;
+	std::vector<unsigned int> result_scenarios;
+	std::vector<unsigned int> result_samples;
+	std::vector<std::string> result_members;
+
+	// the wrappers are installed before any scene is created so the shadow state follows every binding the scenes make
+	if (gl_statistics)
+		Gl_Statistics::install();
+
+	Model_Loader *loader = NULL;
+	Texture_Uploader *uploader = NULL;
+	if (async_load)
+	{
+		if (upload_thread)
+		{
+			Shared_Context *shared_context = context.create_shared_context();
+			if (shared_context)
+				uploader = new Texture_Uploader(shared_context);
+			if (!uploader || !uploader->is_valid())
+			{
+				printf("Failed to start the texture upload thread\n");
+				return 1;
+			}
+		}
+
+		loader = new Model_Loader(loader_threads, uploader);
+		printf("streaming models with %u loader threads, %.1f ms upload budget per frame", loader->thread_count(), upload_budget_ms);
+		printf(uploader ? ", textures uploaded on their own thread\n" : "\n");
+	}
+
+	for (unsigned int i = 0; i < scenario_count; i++)
+	{
+		if (!is_selected(scenarios[i].name))
+			continue;
+
+		Gpu_Timer *gpu_timer = NULL;
+		if (gpu_timers)
+		{
+			gpu_timer = new Gpu_Timer();
+			gpu_timer->m_capture_draws = per_draw_timers;
+			gpu_timer->make_active();
+		}
+
+		if (uploader)
+			uploader->reset_statistics();
+		Texture_Cache::reset_statistics();
+		Mesh_Optimizer::reset_statistics();
+		Mesh_Simplifier::reset_statistics();
+		Meshlet_Culler::reset_statistics();
+		Asset_Pack::reset_statistics();
+		Program_Cache::reset_statistics();
+		Shader::reset_compile_statistics();
+		Geometry_Arena::reset_statistics();
+
+		Frame_Statistics statistics(scenarios[i].name, bucket_width);
+		Load_Statistics load;
+		unsigned int samples = run_scenario(scenarios[i], context, statistics, gpu_timer, loader, load);
+		statistics.print();
+
+		results.push_back(statistics);
+		result_scenarios.push_back(i);
+		result_samples.push_back(samples);
+
+		if (gpu_timer)
+		{
+			gpu_timer->print();
+			result_members.push_back(gpu_timer->json_members("\t\t\t"));
+			delete gpu_timer;
+		}
+		else
+			result_members.push_back("");
+
+		char members[512];
+		if (scenarios[i].model_path)
+		{
+			printf("model loaded in %.2f ms, %.2f MB of vertex and index buffers", load.load_ms, load.buffer_bytes / 1e6);
+			if (loader)
+				printf(", %u frames rendered while streaming (worst %.2f ms)", load.frames, load.worst_frame_ms);
+			printf("\n");
+
+			snprintf(members, sizeof(members), "\t\t\t\"model_load\": { \"async\": %s, \"threads\": %u, \"ms\": %.4f, \"frames\": %u, \"worst_frame_ms\": %.4f, \"buffer_bytes\": %zu },\n",
+				loader ? "true" : "false", loader ? loader->thread_count() : 0, load.load_ms, load.frames, load.worst_frame_ms, load.buffer_bytes);
+			result_members.back() += members;
+
+			Geometry_Arena_Statistics &arena = load.arena;
+			Geometry_Arena_Statistics &unloaded = load.unloaded;
+			printf("geometry arena: %u ranges in %u pages, %.2f MB used of %.2f MB, %u free ranges\n",
+				arena.ranges, arena.pages, arena.used_bytes / 1e6, (arena.vertex_bytes + arena.index_bytes) / 1e6, arena.free_ranges);
+			printf("  after unloading the scene: %u pages defragmented in %.2f ms, %.2f MB moved, %.1f KB reclaimed, %u free ranges\n",
+				unloaded.defragmentations, load.defragment_ms, unloaded.moved_bytes / 1e6, unloaded.reclaimed_bytes / 1e3, unloaded.free_ranges);
+			snprintf(members, sizeof(members), "\t\t\t\"geometry_arena\": { \"pages\": %u, \"ranges\": %u, \"used_bytes\": %llu, \"buffer_bytes\": %llu, \"free_ranges\": %u, "
+				"\"defragmented_pages\": %u, \"moved_bytes\": %llu, \"reclaimed_bytes\": %llu, \"defragment_ms\": %.3f },\n",
+				arena.pages, arena.ranges, arena.used_bytes, arena.vertex_bytes + arena.index_bytes, arena.free_ranges,
+				unloaded.defragmentations, unloaded.moved_bytes, unloaded.reclaimed_bytes, load.defragment_ms);
+			result_members.back() += members;
+
+			printf("model memory: %.2f MB CPU (meshes %.2f MB), %.2f MB GPU (buffers %.2f MB, textures %.2f MB)", load.total.cpu_bytes / 1e6, load.meshes.cpu_bytes / 1e6,
+				load.total.gpu_bytes / 1e6, load.meshes.gpu_bytes / 1e6, load.textures.gpu_bytes / 1e6);
+			if (mesh_residency == RESIDENCY_ON_DEMAND)
+				printf(", %.2f MB CPU with every mesh paged in (%.2f ms)", load.paged_in_cpu_bytes / 1e6, load.page_in_ms);
+			printf("\n");
+			const char *residency_names[] = { "discard", "keep", "on-demand" };
+			snprintf(members, sizeof(members), "\t\t\t\"memory\": { \"residency\": \"%s\", \"cpu_bytes\": %zu, \"mesh_cpu_bytes\": %zu, \"gpu_bytes\": %zu, \"buffer_bytes\": %zu, \"texture_bytes\": %zu, \"paged_in_cpu_bytes\": %zu, \"page_in_ms\": %.3f },\n",
+				residency_names[mesh_residency], load.total.cpu_bytes, load.meshes.cpu_bytes, load.total.gpu_bytes, load.meshes.gpu_bytes, load.textures.gpu_bytes,
+				load.paged_in_cpu_bytes, load.page_in_ms);
+			result_members.back() += members;
+
+			Mesh_Optimizer::print();
+			Mesh_Optimizer_Statistics optimizer = Mesh_Optimizer::statistics();
+			snprintf(members, sizeof(members), "\t\t\t\"mesh_optimizer\": { \"meshes\": %u, \"triangles\": %llu, \"vertices_before\": %llu, \"vertices_after\": %llu, \"transformed_before\": %llu, \"transformed_after\": %llu, \"ms\": %.3f },\n",
+				optimizer.meshes, optimizer.triangles, optimizer.vertices_before, optimizer.vertices_after, optimizer.transformed_before, optimizer.transformed_after, optimizer.optimize_ms);
+			result_members.back() += members;
+
+			Mesh_Simplifier::print();
+			Mesh_Simplifier_Statistics lods = Mesh_Simplifier::statistics();
+			snprintf(members, sizeof(members), "\t\t\t\"mesh_lods\": { \"levels\": %u, \"threshold\": %.2f, \"triangles_drawn\": %.4f, \"switches\": %llu, \"simplify_ms\": %.3f },\n",
+				lod_count, lod_threshold, lods.full_triangles ? (double)lods.selected_triangles / lods.full_triangles : 1.0, lods.switches, lods.simplify_ms);
+			result_members.back() += members;
+
+			Meshlet_Culler::print();
+			Meshlet_Culler_Statistics meshlets = Meshlet_Culler::statistics();
+			snprintf(members, sizeof(members), "\t\t\t\"meshlets\": { \"culling\": %s, \"meshlets\": %llu, \"tested\": %llu, \"frustum_culled\": %llu, \"cone_culled\": %llu, \"triangles_drawn\": %.4f, \"cull_ms\": %.3f },\n",
+				meshlet_culling ? "true" : "false", meshlets.built_meshlets, meshlets.meshlets, meshlets.frustum_culled, meshlets.cone_culled,
+				meshlets.triangles ? (double)meshlets.drawn_triangles / meshlets.triangles : 1.0, meshlets.cull_ms);
+			result_members.back() += members;
+
+			Texture_Registry::print();
+			if (compress_textures)
+			{
+				Texture_Cache::print();
+				Texture_Cache_Statistics cache = Texture_Cache::statistics();
+				snprintf(members, sizeof(members), "\t\t\t\"texture_cache\": { \"textures\": %u, \"bytes\": %llu, \"raw_bytes\": %llu, \"hits\": %u, \"builds\": %u, \"compress_ms\": %.3f },\n",
+					cache.textures, cache.bytes, cache.raw_bytes, cache.hits, cache.builds, cache.compress_ms);
+				result_members.back() += members;
+			}
+			if (uploader)
+			{
+				uploader->print();
+				result_members.back() += uploader->json_members("\t\t\t");
+			}
+		}
+
+		snprintf(members, sizeof(members), "\t\t\t\"shadows\": %s,\n", shadows ? "true" : "false");
+		result_members.back() += members;
+
+		// every scenario builds the scene's programs, with or without a model
+		Program_Cache::print();
+		Program_Cache_Statistics programs = Program_Cache::statistics();
+		snprintf(members, sizeof(members), "\t\t\t\"program_cache\": { \"enabled\": %s, \"hits\": %u, \"misses\": %u, \"rejected\": %u, \"load_ms\": %.3f, \"compile_ms\": %.3f, \"saved_ms\": %.3f },\n",
+			program_cache ? "true" : "false", programs.hits, programs.misses, programs.rejected, programs.load_ms, programs.compile_ms, programs.saved_ms);
+		result_members.back() += members;
+
+		Shader::print_compile_statistics();
+		Shader_Compile_Statistics compiles = Shader::compile_statistics();
+		snprintf(members, sizeof(members), "\t\t\t\"shader_compiles\": { \"parallel\": %s, \"submitted\": %u, \"finished\": %u, \"ready\": %u, \"submit_ms\": %.3f, \"wait_ms\": %.3f },\n",
+			Shader::is_parallel_compile_supported() ? "true" : "false", compiles.submitted, compiles.finished, compiles.ready, compiles.submit_ms, compiles.wait_ms);
+		result_members.back() += members;
+
+		// the shaders and the scene's own textures are read for every scenario, with or without a model
+		Asset_Pack::print();
+		Asset_Pack_Statistics assets = Asset_Pack::statistics();
+		snprintf(members, sizeof(members), "\t\t\t\"assets\": { \"pack\": %s, \"pack_bytes\": %llu, \"pack_reads\": %u, \"loose_reads\": %u, \"stale\": %u, \"missing\": %u, \"bytes\": %llu, \"decompressed_bytes\": %llu },\n",
+			Asset_Pack::is_open() ? "true" : "false", assets.pack_bytes, assets.pack_reads, assets.loose_reads, assets.stale, assets.missing, assets.bytes, assets.decompressed_bytes);
+		result_members.back() += members;
+
+		if (gl_statistics)
+		{
+			Gl_Statistics::print();
+			result_members.back() += Gl_Statistics::json_members("\t\t\t");
+		}
+	}
+
+	delete loader;
+	delete uploader;
+
+	if (trace_path && Profiler::write_chrome_trace(trace_path))
+		printf("profile written to %s\n", trace_path);
+
+	if (output_path)
+	{
+		FILE *file = fopen(output_path, "w");
+		if (!file)
+		{
+			printf("Failed to open %s for writing\n", output_path);
+			return 1;
+		}
+
+		fprintf(file, "{\n");
+		fprintf(file, "\t\"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+		fprintf(file, "\t\"width\": %u,\n", screen_width);
+		fprintf(file, "\t\"height\": %u,\n", screen_height);
+		fprintf(file, "\t\"warmup_frames\": %u,\n", warmup_frames);
+		fprintf(file, "\t\"time_step\": %.6f,\n", time_step);
+		fprintf(file, "\t\"scenarios\": [\n");
+		for (unsigned int i = 0; i < results.size(); i++)
+		{
+			const Benchmark_Scenario &scenario = scenarios[result_scenarios[i]];
+			char members[256];
+			snprintf(members, sizeof(members), "\t\t\t\"samples\": %u,\n\t\t\t\"effect\": %d,\n\t\t\t\"model\": \"%s\",\n",
+				result_samples[i], scenario.effect, scenario.model_path ? scenario.model_path : "");
+			std::string extra = members + result_members[i];
+			results[i].write_json(file, extra.c_str());
+			fprintf(file, "%s\n", i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "\t]\n");
+		fprintf(file, "}\n");
+		fclose(file);
+
+		printf("results written to %s\n", output_path);
+	}
+
+	return 0;
+}
@@ -0,0 +1,557 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "gl_statistics.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet.h"
+#include "model.h"
+#include "model_loader.h"
+#include "scene.h"
+#include "shader.h"
+#include "texture_cache.h"
+#include "mock_context.h"
+
+//	Allocation counting ------------------------------------------------------------
+
+static std::atomic<unsigned long long> allocations(0);		/**< calls to operator new since the program started */
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+/**
+* @brief	adds the heap allocations made since start as the allocs counter, averaged per iteration
+*/
+static void report_allocations(benchmark::State &state, unsigned long long start)
+{
+	state.counters["allocs"] = benchmark::Counter((double)(allocations.load(std::memory_order_relaxed) - start), benchmark::Counter::kAvgIterations);
+}
+
+/**
+* @struct Model_Benchmark
+* @brief	a model and the Assimp scene it was imported from, so the meshes can be processed without the import
+*/
+struct Model_Benchmark
+{
+	Model *model;					/**< the model the meshes are processed for, its textures are already loaded */
+	Assimp::Importer importer;		/**< keeps the imported scene alive */
+	const aiScene *scene;			/**< the imported scene */
+	unsigned int vertex_count;		/**< vertices in all the meshes of the scene */
+
+	Model_Benchmark(const char *filepath)
+	{
+		model = new Model((char *)filepath);
+		scene = importer.ReadFile(filepath, aiProcess_Triangulate | aiProcess_FlipUVs);
+		vertex_count = 0;
+		for (unsigned int i = 0; scene && i < scene->mNumMeshes; i++)
+			vertex_count += scene->mMeshes[i]->mNumVertices;
+	}
+
+	~Model_Benchmark()
+	{
+		delete model;
+	}
+
+	/**
+	* @brief	imports every mesh of the scene without optimizing or creating it
+	*/
+	void import_meshes(std::vector<Mesh_Data> &meshes)
+	{
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			meshes.push_back(Model::import_mesh(scene->mMeshes[i], scene));
+	}
+
+	/**
+	* @brief	imports every mesh of the scene and creates its Mesh
+	*/
+	void process_meshes()
+	{
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+		{
+			Mesh mesh = model->create_mesh(Model::import_mesh(scene->mMeshes[i], scene));
+			benchmark::DoNotOptimize(mesh);
+		}
+	}
+};
+
+//	Model loading --------------------------------------------------------------
+
+static const size_t image_cache_bytes = Texture_Registry::s_image_cache_bytes;	// the default, the cold load benchmarks turn the decoded image cache off
+
+static void process_mesh(benchmark::State &state, const char *filepath)
+{
+	Model_Benchmark model(filepath);
+	if (!model.scene)
+	{
+		state.SkipWithError("failed to import the model");
+		return;
+	}
+
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+		model.process_meshes();
+	report_allocations(state, start);
+
+	state.SetItemsProcessed(state.iterations() * model.vertex_count);
+	state.counters["meshes"] = model.scene->mNumMeshes;
+	state.counters["vertices"] = model.vertex_count;
+}
+BENCHMARK_CAPTURE(process_mesh, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(process_mesh, planet, "resources/objects/planet/planet.obj")->Unit(benchmark::kMillisecond);
+
+static void optimize_mesh(benchmark::State &state, const char *filepath)
+{
+	// the import time weld, vertex cache, overdraw and vertex fetch passes over every mesh of the model, on copies of the imported data
+	Model_Benchmark model(filepath);
+	if (!model.scene)
+	{
+		state.SkipWithError("failed to import the model");
+		return;
+	}
+
+	std::vector<Mesh_Data> imported;
+	model.import_meshes(imported);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < imported.size(); i++)
+		{
+			Mesh_Data data = imported[i];
+			Mesh_Optimizer::optimize(data, "");
+			benchmark::DoNotOptimize(data.indices.data());
+		}
+	}
+	Mesh_Optimizer::reset_statistics();
+
+	state.SetItemsProcessed(state.iterations() * model.vertex_count);
+}
+BENCHMARK_CAPTURE(optimize_mesh, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(optimize_mesh, planet, "resources/objects/planet/planet.obj")->Unit(benchmark::kMillisecond);
+
+static void build_lods(benchmark::State &state, const char *filepath)
+{
+	// the level of detail chain of every optimized mesh of the model, on copies so every iteration starts from the full detail
+	Model_Benchmark model(filepath);
+	if (!model.scene)
+	{
+		state.SkipWithError("failed to import the model");
+		return;
+	}
+
+	std::vector<Mesh_Data> imported;
+	model.import_meshes(imported);
+	unsigned long long triangles = 0;
+	for (size_t i = 0; i < imported.size(); i++)
+	{
+		Mesh_Optimizer::optimize(imported[i], "");
+		triangles += imported[i].indices.size() / 3;
+	}
+	Mesh_Optimizer::reset_statistics();
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i < imported.size(); i++)
+		{
+			Mesh_Data data = imported[i];
+			Mesh_Simplifier::build_lods(data);
+			benchmark::DoNotOptimize(data.indices.data());
+		}
+	}
+	Mesh_Simplifier::reset_statistics();
+
+	state.SetItemsProcessed(state.iterations() * triangles);
+}
+BENCHMARK_CAPTURE(build_lods, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(build_lods, planet, "resources/objects/planet/planet.obj")->Unit(benchmark::kMillisecond);
+
+static void load_model(benchmark::State &state, const char *filepath)
+{
+	// always imports with Assimp, and decodes the textures again since no decoded image is kept
+	Mesh_Cache::s_enabled = false;
+	Texture_Registry::s_image_cache_bytes = 0;
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+	{
+		Model model((char *)filepath);
+		benchmark::DoNotOptimize(model);
+	}
+	report_allocations(state, start);
+	Mesh_Cache::s_enabled = true;
+	Texture_Registry::s_image_cache_bytes = image_cache_bytes;
+}
+BENCHMARK_CAPTURE(load_model, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(load_model, planet, "resources/objects/planet/planet.obj")->Unit(benchmark::kMillisecond);
+
+static void load_model_cached(benchmark::State &state, const char *filepath, bool compress)
+{
+	// the first load writes the cache, every iteration after it reads the cache and decodes the textures
+	Mesh_Cache::s_compress = compress;
+	Texture_Registry::s_image_cache_bytes = 0;
+	remove(Mesh_Cache::cache_path(filepath).c_str());
+	{
+		Model model((char *)filepath);
+	}
+
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+	{
+		Model model((char *)filepath);
+		benchmark::DoNotOptimize(model);
+	}
+	report_allocations(state, start);
+
+	FILE *file = fopen(Mesh_Cache::cache_path(filepath).c_str(), "rb");
+	if (file)
+	{
+		fseek(file, 0, SEEK_END);
+		state.counters["cache_bytes"] = ftell(file);
+		fclose(file);
+	}
+	Mesh_Cache::s_compress = false;
+	Texture_Registry::s_image_cache_bytes = image_cache_bytes;
+}
+BENCHMARK_CAPTURE(load_model_cached, nanosuit, "resources/objects/nanosuit/nanosuit.obj", false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(load_model_cached, nanosuit_compressed, "resources/objects/nanosuit/nanosuit.obj", true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(load_model_cached, planet, "resources/objects/planet/planet.obj", false)->Unit(benchmark::kMillisecond);
+
+static void load_model_shared_textures(benchmark::State &state, const char *filepath)
+{
+	// a second copy of a model that is already loaded, from its mesh cache, every texture is found in the Texture_Registry
+	Model loaded((char *)filepath);
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+	{
+		Model model((char *)filepath);
+		benchmark::DoNotOptimize(model);
+	}
+	report_allocations(state, start);
+}
+BENCHMARK_CAPTURE(load_model_shared_textures, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMillisecond);
+
+static void model_draw(benchmark::State &state, const char *filepath)
+{
+	// the per frame CPU cost of drawing a loaded model with its textures bound
+	Model model((char *)filepath);
+	Shader shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+		model.draw(shader, true);
+	report_allocations(state, start);
+}
+BENCHMARK_CAPTURE(model_draw, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMicrosecond);
+
+static void cull_meshlets(benchmark::State &state, const char *filepath)
+{
+	// the per pass CPU cost of culling the full detail meshlets of a loaded model, seen from the engine_bench camera
+	Model model((char *)filepath);
+	glm::mat4 transform = glm::scale(glm::translate(glm::mat4(), glm::vec3(0.0f, -5.0f, 0.0f)), glm::vec3(0.35f));
+	glm::mat4 view_projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	unsigned long long meshlets = 0;
+	for (size_t i = 0; i < model.get_meshes().size(); i++)
+		meshlets += model.get_meshes()[i].m_meshlets->lod_meshlets[1];
+
+	for (auto _ : state)
+		model.cull_meshlets(transform, view_projection, glm::vec3(0.0f, 0.0f, 3.0f), true);
+	Meshlet_Culler::reset_statistics();
+
+	state.SetItemsProcessed(state.iterations() * meshlets);
+}
+BENCHMARK_CAPTURE(cull_meshlets, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Unit(benchmark::kMicrosecond);
+
+static void load_model_async(benchmark::State &state, const char *filepath)
+{
+	// the whole load through Model_Loader with state.range(0) workers and no upload budget, the textures decode in parallel
+	Mesh_Cache::s_enabled = false;
+	Texture_Registry::s_image_cache_bytes = 0;
+	Model_Loader loader(state.range(0));
+	for (auto _ : state)
+	{
+		Model_Handle *handle = loader.load(filepath);
+		while (!handle->is_ready() && !handle->has_failed())
+		{
+			loader.update(1000.0);
+			std::this_thread::yield();
+		}
+		benchmark::DoNotOptimize(handle->get());
+		delete handle;
+	}
+	Mesh_Cache::s_enabled = true;
+	Texture_Registry::s_image_cache_bytes = image_cache_bytes;
+	state.counters["threads"] = loader.thread_count();
+}
+BENCHMARK_CAPTURE(load_model_async, nanosuit, "resources/objects/nanosuit/nanosuit.obj")->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//	Textures ------------------------------------------------------------------
+
+static void texture_decode(benchmark::State &state, const char *filename, const char *directory)
+{
+	unsigned long long uploaded = Mock_Context::uploaded_bytes();
+	for (auto _ : state)
+	{
+		unsigned int id = load_texture_from_filepath(filename, directory);
+		benchmark::DoNotOptimize(id);
+	}
+	state.SetBytesProcessed(Mock_Context::uploaded_bytes() - uploaded);
+}
+BENCHMARK_CAPTURE(texture_decode, nanosuit_body, "body_dif.png", "resources/objects/nanosuit")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(texture_decode, planet, "planet_Quom1200.png", "resources/objects/planet")->Unit(benchmark::kMillisecond);
+
+static void texture_load_compressed(benchmark::State &state, const char *filename, const char *directory)
+{
+	// the same load as texture_decode from an up to date Texture_Cache file, built once before timing
+	std::string filepath = std::string(directory) + '/' + filename;
+	Compressed_Image image;
+	Texture_Cache::load(filepath, COMPRESS_COLOR, image);
+
+	Texture_Cache::s_enabled = true;
+	unsigned long long uploaded = Mock_Context::uploaded_bytes();
+	for (auto _ : state)
+	{
+		unsigned int id = load_texture_from_filepath(filename, directory);
+		benchmark::DoNotOptimize(id);
+	}
+	state.SetBytesProcessed(Mock_Context::uploaded_bytes() - uploaded);
+	Texture_Cache::s_enabled = false;
+}
+BENCHMARK_CAPTURE(texture_load_compressed, nanosuit_body, "body_dif.png", "resources/objects/nanosuit")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(texture_load_compressed, planet, "planet_Quom1200.png", "resources/objects/planet")->Unit(benchmark::kMillisecond);
+
+static void texture_compress(benchmark::State &state, const char *filepath, Block_Format format, Mip_Filter filter)
+{
+	// the mip chain and every block of it, on the calling thread and range(0) - 1 workers
+	int width, height, components;
+	unsigned char *pixels = stbi_load(filepath, &width, &height, &components, 0);
+	Thread_Pool *pool = state.range(0) > 1 ? new Thread_Pool(state.range(0) - 1) : NULL;
+	Compressed_Image image;
+	for (auto _ : state)
+	{
+		compress_image(pixels, width, height, components, format, filter, image, pool);
+		benchmark::DoNotOptimize(image.data.data());
+	}
+	state.SetItemsProcessed(state.iterations() * width * height);
+	delete pool;
+	stbi_image_free(pixels);
+}
+BENCHMARK_CAPTURE(texture_compress, bc1, "resources/objects/nanosuit/body_dif.png", BLOCK_BC1, MIP_FILTER_SRGB)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(texture_compress, bc3, "resources/objects/nanosuit/body_dif.png", BLOCK_BC3, MIP_FILTER_SRGB)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(texture_compress, bc5, "resources/objects/nanosuit/body_showroom_ddn.png", BLOCK_BC5, MIP_FILTER_LINEAR)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void texture_mip_chain(benchmark::State &state, const char *filepath, Mip_Filter filter)
+{
+	// every level below level 0 on the CPU, what a texture created without the Texture_Cache pays instead of glGenerateMipmap
+	int width, height, components;
+	unsigned char *pixels = stbi_load(filepath, &width, &height, &components, 0);
+	Mip_Chain chain;
+	for (auto _ : state)
+	{
+		generate_mip_chain(pixels, width, height, components, filter, chain);
+		benchmark::DoNotOptimize(chain.pixels.data());
+	}
+	state.SetItemsProcessed(state.iterations() * width * height);
+	stbi_image_free(pixels);
+}
+BENCHMARK_CAPTURE(texture_mip_chain, srgb, "resources/objects/nanosuit/body_dif.png", MIP_FILTER_SRGB)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(texture_mip_chain, linear, "resources/objects/nanosuit/body_showroom_ddn.png", MIP_FILTER_LINEAR)->Unit(benchmark::kMillisecond);
+
+static void texture_registry_acquire(benchmark::State &state)
+{
+	// the lookup of a texture that is already loaded, what every mesh after the first pays for a shared texture
+	unsigned int held = Texture_Registry::acquire("resources/objects/nanosuit/body_dif.png");
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+	{
+		unsigned int id = Texture_Registry::acquire("resources/objects/nanosuit/./body_dif.png");
+		Texture_Registry::release(id);
+	}
+	report_allocations(state, start);
+	Texture_Registry::release(held);
+}
+BENCHMARK(texture_registry_acquire);
+
+//	Shader uniforms -----------------------------------------------------------
+
+static void shader_set_mat4(benchmark::State &state)
+{
+	Shader shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
+	glm::mat4 model;
+	for (auto _ : state)
+		shader.set_mat4("model", model);
+}
+BENCHMARK(shader_set_mat4);
+
+static void shader_set_mat4_handle(benchmark::State &state)
+{
+	// the name resolved once, each set indexes the reflection table
+	Shader shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
+	Uniform_Handle model_uniform = shader.uniform("model");
+	glm::mat4 model;
+	for (auto _ : state)
+		shader.set_mat4(model_uniform, model);
+}
+BENCHMARK(shader_set_mat4_handle);
+
+static void shader_set_mat4_changed(benchmark::State &state)
+{
+	// the other set_mat4 benchmarks set the value the shadow copy already has, this one changes it and uploads it with flush
+	Shader shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
+	Uniform_Handle model_uniform = shader.uniform("model");
+	glm::mat4 model;
+	for (auto _ : state)
+	{
+		model[3][0] += 1.0f;
+		shader.set_mat4(model_uniform, model);
+		shader.flush();
+	}
+}
+BENCHMARK(shader_set_mat4_changed);
+
+static void shader_set_vec3(benchmark::State &state)
+{
+	Shader shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
+	glm::vec3 position(1.0f, 2.0f, 3.0f);
+	for (auto _ : state)
+		shader.set_vec3("light_position", position);
+}
+BENCHMARK(shader_set_vec3);
+
+static void shader_set_mistyped(benchmark::State &state)
+{
+	// a float set on a sampler has the right size but the wrong type, it must be rejected before the shadow copy so the flush uploads nothing
+	Shader shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
+	Uniform_Handle depth_cube_map = shader.uniform("depth_cube_map");
+	Gl_Statistics::install();
+	Gl_Statistics::begin_frame();
+	for (auto _ : state)
+	{
+		shader.set_float(depth_cube_map, 1.0f);
+		shader.flush();
+	}
+	Gl_Statistics::end_frame();
+	unsigned long long uniform_calls = Gl_Statistics::last_frame().calls[UNIFORM_CALL];
+	Gl_Statistics::uninstall();
+	if (uniform_calls)
+		state.SkipWithError("a mistyped set reached glUniform");
+}
+BENCHMARK(shader_set_mistyped);
+
+static void shader_set_shadow_matrices(benchmark::State &state)
+{
+	// the six matrices are uploaded by building each array element's name every frame, hashing the built string
+	Shader shader("shaders/cube_map_depth.vs", "shaders/cube_map_depth.fs", "shaders/cube_map_depth.gs");
+	std::vector<glm::mat4> matrices = shadow_transformations(glm::vec3(-2.0f, 4.0f, -1.0f), 1.0f, 1.0f, 25.0f);
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+	{
+		for (int i = 0; i < 6; i++)
+			shader.set_mat4("shadow_matrices[" + std::to_string(i) + "]", matrices[i]);
+	}
+	report_allocations(state, start);
+}
+BENCHMARK(shader_set_shadow_matrices);
+
+static void shader_set_shadow_matrices_hashed(benchmark::State &state)
+{
+	// the way the scene sets them, the element names are hashed at compile time
+	static constexpr Uniform_Name shadow_matrix_uniforms[6] = { "shadow_matrices[0]", "shadow_matrices[1]", "shadow_matrices[2]",
+		"shadow_matrices[3]", "shadow_matrices[4]", "shadow_matrices[5]" };
+	Shader shader("shaders/cube_map_depth.vs", "shaders/cube_map_depth.fs", "shaders/cube_map_depth.gs");
+	std::vector<glm::mat4> matrices = shadow_transformations(glm::vec3(-2.0f, 4.0f, -1.0f), 1.0f, 1.0f, 25.0f);
+	unsigned long long start = allocations.load();
+	for (auto _ : state)
+	{
+		for (int i = 0; i < 6; i++)
+			shader.set_mat4(shadow_matrix_uniforms[i], matrices[i]);
+	}
+	report_allocations(state, start);
+}
+BENCHMARK(shader_set_shadow_matrices_hashed);
+
+//	Camera ---------------------------------------------------------------------
+
+static void camera_update_vectors(benchmark::State &state)
+{
+	// set_rotation is a plain assignment followed by update_camera_vectors
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+	float yaw = -90.0f;
+	for (auto _ : state)
+	{
+		camera.set_rotation(yaw, -15.0f);
+		yaw += 0.1f;
+		benchmark::DoNotOptimize(camera.m_front);
+	}
+}
+BENCHMARK(camera_update_vectors);
+
+static void camera_view_matrix(benchmark::State &state)
+{
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+	for (auto _ : state)
+	{
+		glm::mat4 view = camera.get_view_matrix();
+		benchmark::DoNotOptimize(view);
+	}
+}
+BENCHMARK(camera_view_matrix);
+
+static void shadow_matrices(benchmark::State &state)
+{
+	glm::vec3 light_position(-2.0f, 4.0f, -1.0f);
+	for (auto _ : state)
+	{
+		std::vector<glm::mat4> matrices = shadow_transformations(light_position, 1.0f, 1.0f, 25.0f);
+		benchmark::DoNotOptimize(matrices);
+	}
+}
+BENCHMARK(shadow_matrices);
+
+int main(int argc, char **argv)
+{
+	// the models, textures and shaders are loaded with paths relative to the project directory
+	if (chdir(ENGINE_ASSET_DIRECTORY) != 0)
+	{
+		printf("Failed to change directory to %s\n", ENGINE_ASSET_DIRECTORY);
+		return 1;
+	}
+
+	Mock_Context context;
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "geometry_arena.h"
+#include "profiler.h"
+#include "range_allocator.h"
+
+static const size_t index_unit = 4;		/**< the index allocators count in 4 byte units so 16 and 32 bit indices stay aligned */
+
+/**
+* @struct Arena_Page
+* @brief	one vertex buffer and one index buffer of a format, the vertex array over them and the ranges allocated in them
+*/
+struct Arena_Page
+{
+	Vertex_Format format;
+	unsigned int vao;
+	unsigned int vbo;
+	unsigned int ebo;
+	Range_Allocator vertices;				/**< counts in vertices */
+	Range_Allocator indices;				/**< counts in index_unit */
+	std::vector<Geometry_Range *> ranges;	/**< the ranges alive in the page */
+};
+
+static std::vector<Arena_Page *> pages;
+static size_t page_vertex_bytes = 4 << 20;
+static size_t page_index_bytes = 2 << 20;
+static unsigned int defragmentations = 0;
+static unsigned long long moved_bytes = 0;
+static unsigned long long reclaimed_bytes = 0;
+
+size_t Geometry_Arena::vertex_size(Vertex_Format format)
+{
+	return format == VERTEX_QUANTIZED ? sizeof(quantized_vertex) : sizeof(vertex);
+}
+
+static size_t index_units(unsigned int index_count, GLenum index_type)
+{
+	size_t bytes = (size_t)index_count * (index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int));
+	return (bytes + index_unit - 1) / index_unit;
+}
+
+/**
+* @brief	points the page's vertex array at its current buffers, in the layout of its format
+*/
+static void setup_vertex_array(Arena_Page *page)
+{
+	glBindVertexArray(page->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, page->vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ebo);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	if (page->format == VERTEX_QUANTIZED)
+	{
+		// normalized positions, octahedral normals (z reads as 0) and half float texture coordinates
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(quantized_vertex), (void*)offsetof(quantized_vertex, position));
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(quantized_vertex), (void*)offsetof(quantized_vertex, normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(quantized_vertex), (void*)offsetof(quantized_vertex, texture_coordinates));
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, position));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, normal));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, texture_coordinates));
+	}
+	glBindVertexArray(0);
+}
+
+/**
+* @brief	creates the buffers of a page with their contents undefined
+*/
+static void create_buffers(Arena_Page *page)
+{
+	glGenBuffers(1, &page->vbo);
+	glGenBuffers(1, &page->ebo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page->vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, page->vertices.capacity() * Geometry_Arena::vertex_size(page->format), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page->ebo);
+	glBufferData(GL_COPY_WRITE_BUFFER, page->indices.capacity() * index_unit, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+static Arena_Page *create_page(Vertex_Format format, size_t vertex_capacity, size_t index_capacity)
+{
+	PROFILE_ZONE("Geometry_Arena::create_page");
+
+	Arena_Page *page = new Arena_Page();
+	page->format = format;
+	page->vertices.reset(vertex_capacity);
+	page->indices.reset(index_capacity);
+	glGenVertexArrays(1, &page->vao);
+	create_buffers(page);
+	setup_vertex_array(page);
+	pages.push_back(page);
+	return page;
+}
+
+Geometry_Range *Geometry_Arena::allocate(Vertex_Format format, const void *vertices, unsigned int vertex_count, const void *indices, unsigned int index_count, GLenum index_type)
+{
+	PROFILE_ZONE("Geometry_Arena::allocate");
+
+	// the first page of the format with room for both, a new one otherwise
+	size_t units = index_units(index_count, index_type);
+	size_t vertex_offset = 0, index_offset = 0;
+	Arena_Page *page = NULL;
+	for (size_t i = 0; i < pages.size() && !page; i++)
+	{
+		if (pages[i]->format != format || !pages[i]->vertices.allocate(std::max(vertex_count, 1u), vertex_offset))
+			continue;
+		if (!pages[i]->indices.allocate(std::max(units, (size_t)1), index_offset))
+		{
+			pages[i]->vertices.free(vertex_offset);
+			continue;
+		}
+		page = pages[i];
+	}
+	if (!page)
+	{
+		size_t vertex_capacity = std::max(page_vertex_bytes / vertex_size(format), (size_t)vertex_count);
+		size_t index_capacity = std::max(page_index_bytes / index_unit, units);
+		page = create_page(format, vertex_capacity, index_capacity);
+		page->vertices.allocate(std::max(vertex_count, 1u), vertex_offset);
+		page->indices.allocate(std::max(units, (size_t)1), index_offset);
+	}
+
+	Geometry_Range *range = new Geometry_Range();
+	range->page = page;
+	range->format = format;
+	range->vao = page->vao;
+	range->base_vertex = (int)vertex_offset;
+	range->index_offset = index_offset * index_unit;
+	range->vertex_count = vertex_count;
+	range->index_count = index_count;
+	range->index_type = index_type;
+	page->ranges.push_back(range);
+
+	// the copy targets leave the vertex array's element buffer alone
+	size_t stride = vertex_size(format);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page->vbo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, vertex_offset * stride, (size_t)vertex_count * stride, vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page->ebo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, range->index_offset, (size_t)index_count * (index_type == GL_UNSIGNED_SHORT ? 2 : 4), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return range;
+}
+
+void Geometry_Arena::release(Geometry_Range *range)
+{
+	if (!range)
+		return;
+
+	Arena_Page *page = range->page;
+	page->vertices.free((size_t)range->base_vertex);
+	page->indices.free(range->index_offset / index_unit);
+	page->ranges.erase(std::find(page->ranges.begin(), page->ranges.end(), range));
+	delete range;
+
+	if (page->ranges.empty())
+	{
+		glDeleteVertexArrays(1, &page->vao);
+		glDeleteBuffers(1, &page->vbo);
+		glDeleteBuffers(1, &page->ebo);
+		pages.erase(std::find(pages.begin(), pages.end(), page));
+		delete page;
+	}
+}
+
+void Geometry_Arena::draw(const Geometry_Range *range, unsigned int &bound_vao)
+{
+	draw(range, 0, range->index_count, bound_vao);
+}
+
+void Geometry_Arena::draw(const Geometry_Range *range, unsigned int first_index, unsigned int index_count, unsigned int &bound_vao)
+{
+	if (range->vao != bound_vao)
+	{
+		glBindVertexArray(range->vao);
+		bound_vao = range->vao;
+	}
+	size_t offset = range->index_offset + (size_t)first_index * (range->index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int));
+	glDrawElementsBaseVertex(GL_TRIANGLES, index_count, range->index_type, (void *)offset, range->base_vertex);
+}
+
+void Geometry_Arena::draw(const Geometry_Range *range, const unsigned int *first_indices, const unsigned int *index_counts, unsigned int run_count, unsigned int &bound_vao)
+{
+	if (run_count == 1)
+		return draw(range, first_indices[0], index_counts[0], bound_vao);
+	if (range->vao != bound_vao)
+	{
+		glBindVertexArray(range->vao);
+		bound_vao = range->vao;
+	}
+
+	// the offsets are only known now since defragment moves the ranges, the arrays are reused from draw to draw on the GL thread
+	static std::vector<GLsizei> counts;
+	static std::vector<const void *> offsets;
+	static std::vector<GLint> base_vertices;
+	counts.resize(run_count);
+	offsets.resize(run_count);
+	base_vertices.assign(run_count, range->base_vertex);
+	size_t index_size = range->index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	for (unsigned int i = 0; i < run_count; i++)
+	{
+		counts[i] = (GLsizei)index_counts[i];
+		offsets[i] = (const void *)(range->index_offset + (size_t)first_indices[i] * index_size);
+	}
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), range->index_type, offsets.data(), (GLsizei)run_count, base_vertices.data());
+}
+
+unsigned int Geometry_Arena::defragment()
+{
+	PROFILE_ZONE("Geometry_Arena::defragment");
+
+	unsigned int compacted = 0;
+	for (size_t p = 0; p < pages.size(); p++)
+	{
+		// a page whose free space is one range at the end of each buffer (or none) is as compact as it gets
+		Arena_Page *page = pages[p];
+		if (page->vertices.free_range_count() <= 1 && page->indices.free_range_count() <= 1)
+			continue;
+
+		// the ranges keep their order, each moves down to the end of the one before it in fresh buffers
+		std::vector<Geometry_Range *> ranges = page->ranges;
+		std::sort(ranges.begin(), ranges.end(), [](const Geometry_Range *a, const Geometry_Range *b) { return a->base_vertex < b->base_vertex; });
+		unsigned int old_vbo = page->vbo, old_ebo = page->ebo;
+		page->vertices.reset(page->vertices.capacity());
+		page->indices.reset(page->indices.capacity());
+		create_buffers(page);
+
+		// the ends of the highest ranges before and after, what they moved down by was free space between ranges
+		size_t stride = vertex_size(page->format);
+		size_t old_vertex_end = 0, old_index_end = 0, vertex_end = 0, index_end = 0;
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			Geometry_Range *range = ranges[i];
+			size_t units = std::max(index_units(range->index_count, range->index_type), (size_t)1);
+			size_t vertex_offset, index_offset;
+			old_vertex_end = std::max(old_vertex_end, (size_t)range->base_vertex + std::max(range->vertex_count, 1u));
+			old_index_end = std::max(old_index_end, range->index_offset / index_unit + units);
+			page->vertices.allocate(std::max(range->vertex_count, 1u), vertex_offset);
+			page->indices.allocate(units, index_offset);
+			vertex_end = std::max(vertex_end, vertex_offset + std::max(range->vertex_count, 1u));
+			index_end = std::max(index_end, index_offset + units);
+
+			glBindBuffer(GL_COPY_READ_BUFFER, old_vbo);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, page->vbo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)range->base_vertex * stride, vertex_offset * stride, (size_t)range->vertex_count * stride);
+			glBindBuffer(GL_COPY_READ_BUFFER, old_ebo);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, page->ebo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range->index_offset, index_offset * index_unit, units * index_unit);
+			moved_bytes += (size_t)range->vertex_count * stride + units * index_unit;
+
+			range->base_vertex = (int)vertex_offset;
+			range->index_offset = index_offset * index_unit;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &old_vbo);
+		if (old_vertex_end > vertex_end)
+			reclaimed_bytes += (old_vertex_end - vertex_end) * stride;
+		if (old_index_end > index_end)
+			reclaimed_bytes += (old_index_end - index_end) * index_unit;
+		glDeleteBuffers(1, &old_ebo);
+
+		// the vertex array keeps its name so the ranges' vao stays valid
+		setup_vertex_array(page);
+		compacted++;
+	}
+
+	defragmentations += compacted;
+	return compacted;
+}
+
+void Geometry_Arena::set_page_size(size_t vertex_bytes, size_t index_bytes)
+{
+	page_vertex_bytes = vertex_bytes;
+	page_index_bytes = index_bytes;
+}
+
+Geometry_Arena_Statistics Geometry_Arena::statistics()
+{
+	Geometry_Arena_Statistics s;
+	memset(&s, 0, sizeof(s));
+	s.pages = (unsigned int)pages.size();
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		const Arena_Page *page = pages[i];
+		size_t stride = vertex_size(page->format);
+		s.ranges += (unsigned int)page->ranges.size();
+		s.vertex_bytes += page->vertices.capacity() * stride;
+		s.index_bytes += page->indices.capacity() * index_unit;
+		s.used_bytes += page->vertices.used() * stride + page->indices.used() * index_unit;
+		s.free_ranges += page->vertices.free_range_count() + page->indices.free_range_count();
+	}
+	s.defragmentations = defragmentations;
+	s.moved_bytes = moved_bytes;
+	s.reclaimed_bytes = reclaimed_bytes;
+	return s;
+}
+
+void Geometry_Arena::reset_statistics()
+{
+	defragmentations = 0;
+	moved_bytes = 0;
+	reclaimed_bytes = 0;
+}
+
+void Geometry_Arena::print()
+{
+	Geometry_Arena_Statistics s = statistics();
+	printf("geometry arena: %u ranges in %u pages, %.2f MB used of %.2f MB, %u free ranges, %u pages defragmented (%.2f MB moved, %.2f MB reclaimed)\n",
+		s.ranges, s.pages, s.used_bytes / 1e6, (s.vertex_bytes + s.index_bytes) / 1e6, s.free_ranges, s.defragmentations, s.moved_bytes / 1e6, s.reclaimed_bytes / 1e6);
+}
@@ -0,0 +1,37 @@
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gl_capabilities.h"
+
+/**
+* @brief	the context's extensions, sorted for the binary search
+*/
+static const std::vector<std::string> &extensions()
+{
+	static std::vector<std::string> names;
+	static bool listed = false;
+	if (!listed)
+	{
+		listed = true;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+			if (extension)
+				names.push_back(extension);
+		}
+		std::sort(names.begin(), names.end());
+	}
+	return names;
+}
+
+bool Gl_Capabilities::has_extension(const char *name)
+{
+	const std::vector<std::string> &names = extensions();
+	return std::binary_search(names.begin(), names.end(), std::string(name));
+}
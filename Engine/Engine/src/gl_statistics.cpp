@@ -0,0 +1,1045 @@
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+#include "gl_statistics.h"
+#include "profiler.h"
+
+bool Gl_Statistics::s_installed = false;
+bool Gl_Statistics::s_in_frame = false;
+int Gl_Statistics::s_current_pass = -1;
+unsigned int Gl_Statistics::s_frames = 0;
+Gl_Counters Gl_Statistics::s_frame;
+Gl_Counters Gl_Statistics::s_last_frame;
+Gl_Counters Gl_Statistics::s_total;
+std::vector<Gl_Statistics::Pass_Counters> Gl_Statistics::s_passes;
+
+//	Intercepted functions ------------------------------------------------------
+
+/**
+* @enum Gl_Function
+* @brief	index of each intercepted function in the function table
+*/
+enum Gl_Function
+{
+	FN_DRAW_ARRAYS = 0, FN_DRAW_ELEMENTS, FN_DRAW_ARRAYS_INSTANCED, FN_DRAW_ELEMENTS_INSTANCED, FN_DRAW_ELEMENTS_BASE_VERTEX, FN_MULTI_DRAW_ELEMENTS_BASE_VERTEX,
+	FN_USE_PROGRAM, FN_BIND_VERTEX_ARRAY, FN_BIND_BUFFER, FN_BIND_BUFFER_BASE, FN_BIND_BUFFER_RANGE, FN_ACTIVE_TEXTURE, FN_BIND_TEXTURE,
+	FN_BIND_FRAMEBUFFER, FN_BIND_RENDERBUFFER,
+	FN_UNIFORM_1I, FN_UNIFORM_1F, FN_UNIFORM_2F, FN_UNIFORM_2FV, FN_UNIFORM_3F, FN_UNIFORM_3FV, FN_UNIFORM_4F, FN_UNIFORM_4FV,
+	FN_UNIFORM_MATRIX_2FV, FN_UNIFORM_MATRIX_3FV, FN_UNIFORM_MATRIX_4FV,
+	FN_GET_UNIFORM_LOCATION, FN_GET_UNIFORM_BLOCK_INDEX,
+	FN_ENABLE, FN_DISABLE, FN_DEPTH_FUNC, FN_DEPTH_MASK, FN_CULL_FACE, FN_BLEND_FUNC, FN_VIEWPORT, FN_CLEAR_COLOR,
+	FN_BUFFER_DATA, FN_BUFFER_SUB_DATA, FN_TEX_IMAGE_2D, FN_TEX_SUB_IMAGE_2D, FN_COMPRESSED_TEX_IMAGE_2D,
+	FN_CLEAR, FN_BLIT_FRAMEBUFFER, FN_LINK_PROGRAM,
+	FUNCTION_COUNT
+};
+
+/**
+* @struct Gl_Function_Info
+* @brief	name and call type of an intercepted function
+*/
+struct Gl_Function_Info
+{
+	const char *name;		/**< the GL function name */
+	Gl_Call_Type type;		/**< what it is counted as */
+};
+
+static const Gl_Function_Info function_info[FUNCTION_COUNT] = {
+	{ "glDrawArrays", DRAW_CALL }, { "glDrawElements", DRAW_CALL }, { "glDrawArraysInstanced", DRAW_CALL },
+	{ "glDrawElementsInstanced", DRAW_CALL }, { "glDrawElementsBaseVertex", DRAW_CALL }, { "glMultiDrawElementsBaseVertex", DRAW_CALL },
+	{ "glUseProgram", BIND_CALL }, { "glBindVertexArray", BIND_CALL }, { "glBindBuffer", BIND_CALL }, { "glBindBufferBase", BIND_CALL },
+	{ "glBindBufferRange", BIND_CALL }, { "glActiveTexture", BIND_CALL }, { "glBindTexture", BIND_CALL },
+	{ "glBindFramebuffer", BIND_CALL }, { "glBindRenderbuffer", BIND_CALL },
+	{ "glUniform1i", UNIFORM_CALL }, { "glUniform1f", UNIFORM_CALL }, { "glUniform2f", UNIFORM_CALL }, { "glUniform2fv", UNIFORM_CALL },
+	{ "glUniform3f", UNIFORM_CALL }, { "glUniform3fv", UNIFORM_CALL }, { "glUniform4f", UNIFORM_CALL }, { "glUniform4fv", UNIFORM_CALL },
+	{ "glUniformMatrix2fv", UNIFORM_CALL }, { "glUniformMatrix3fv", UNIFORM_CALL }, { "glUniformMatrix4fv", UNIFORM_CALL },
+	{ "glGetUniformLocation", UNIFORM_LOOKUP }, { "glGetUniformBlockIndex", UNIFORM_LOOKUP },
+	{ "glEnable", STATE_CALL }, { "glDisable", STATE_CALL }, { "glDepthFunc", STATE_CALL }, { "glDepthMask", STATE_CALL },
+	{ "glCullFace", STATE_CALL }, { "glBlendFunc", STATE_CALL }, { "glViewport", STATE_CALL }, { "glClearColor", STATE_CALL },
+	{ "glBufferData", UPLOAD_CALL }, { "glBufferSubData", UPLOAD_CALL }, { "glTexImage2D", UPLOAD_CALL }, { "glTexSubImage2D", UPLOAD_CALL },
+	{ "glCompressedTexImage2D", UPLOAD_CALL },
+	{ "glClear", OTHER_CALL }, { "glBlitFramebuffer", OTHER_CALL }, { "glLinkProgram", OTHER_CALL }
+};
+
+static unsigned long long function_calls[FUNCTION_COUNT];		// calls of each function inside frames since the last reset
+static unsigned long long function_redundant[FUNCTION_COUNT];	// redundant calls of each function inside frames since the last reset
+
+//	Shadow state ---------------------------------------------------------------
+
+static const GLuint unknown = 0xFFFFFFFF;	// state that hasn't been set through the wrappers yet
+
+/**
+* @struct Shadow_State
+* @brief	the GL state as last set through the wrappers
+*/
+struct Shadow_State
+{
+	GLuint program;
+	GLuint vertex_array;
+	GLuint draw_framebuffer;
+	GLuint read_framebuffer;
+	GLuint renderbuffer;
+	GLenum active_texture;
+	GLenum depth_func;
+	GLuint depth_mask;
+	GLenum cull_face;
+	GLenum blend_source, blend_destination;
+	GLint viewport[4];
+	GLfloat clear_color[4];
+	bool viewport_known;
+	bool clear_color_known;
+	std::map<GLenum, GLuint> buffers;							// buffer bound to each target
+	std::map<std::pair<GLenum, GLenum>, GLuint> textures;		// texture bound to each (unit, target)
+	std::map<GLenum, bool> capabilities;						// glEnable / glDisable
+	std::unordered_map<unsigned long long, std::string> uniforms;	// raw value of each (program, location)
+};
+
+static Shadow_State state;
+
+/**
+* @brief	forgets all the state so nothing set before install is flagged as redundant
+*/
+static void clear_state()
+{
+	state.program = state.vertex_array = state.draw_framebuffer = state.read_framebuffer = state.renderbuffer = unknown;
+	state.active_texture = state.depth_func = state.depth_mask = state.cull_face = unknown;
+	state.blend_source = state.blend_destination = unknown;
+	state.viewport_known = state.clear_color_known = false;
+	state.buffers.clear();
+	state.textures.clear();
+	state.capabilities.clear();
+	state.uniforms.clear();
+}
+
+/**
+* @brief	compares a value with the shadow copy and updates it
+* @return	true if the value was already set
+*/
+template <typename T>
+static bool update(T &shadow, T value)
+{
+	bool same = shadow == value;
+	shadow = value;
+	return same;
+}
+
+/**
+* @brief	forgets the uniform values of a program, after it is linked or deleted
+*/
+static void forget_uniforms(GLuint program)
+{
+	for (std::unordered_map<unsigned long long, std::string>::iterator it = state.uniforms.begin(); it != state.uniforms.end();)
+	{
+		if ((GLuint)(it->first >> 32) == program)
+			it = state.uniforms.erase(it);
+		else
+			++it;
+	}
+}
+
+/**
+* @struct Gl_Statistics_Recorder
+* @brief	adds the intercepted calls to the counters of the current frame and pass
+*/
+struct Gl_Statistics_Recorder
+{
+	static void record(Gl_Function function, bool redundant, unsigned long long bytes = 0)
+	{
+		if (!Gl_Statistics::s_in_frame)
+			return;
+
+		Gl_Call_Type type = function_info[function].type;
+		function_calls[function]++;
+		Gl_Statistics::s_frame.calls[type]++;
+		Gl_Statistics::s_frame.upload_bytes += bytes;
+		if (redundant)
+		{
+			function_redundant[function]++;
+			Gl_Statistics::s_frame.redundant[type]++;
+		}
+
+		if (Gl_Statistics::s_current_pass >= 0)
+		{
+			Gl_Counters &pass = Gl_Statistics::s_passes[Gl_Statistics::s_current_pass].counters;
+			pass.calls[type]++;
+			pass.upload_bytes += bytes;
+			if (redundant)
+				pass.redundant[type]++;
+		}
+	}
+
+	static void record_skipped(Gl_Call_Type type)
+	{
+		Gl_Statistics::s_frame.skipped[type]++;
+		if (Gl_Statistics::s_current_pass >= 0)
+			Gl_Statistics::s_passes[Gl_Statistics::s_current_pass].counters.skipped[type]++;
+	}
+};
+
+/**
+* @brief	records a uniform upload, comparing the raw value with the last one set on the same program and location
+*/
+static void record_uniform(Gl_Function function, GLint location, const void *value, size_t size)
+{
+	bool redundant = location < 0;
+	if (location >= 0 && state.program != unknown)
+	{
+		std::string &shadow = state.uniforms[((unsigned long long)state.program << 32) | (GLuint)location];
+		redundant = shadow.size() == size && memcmp(shadow.data(), value, size) == 0;
+		shadow.assign((const char *)value, size);
+	}
+	Gl_Statistics_Recorder::record(function, redundant);
+}
+
+/**
+* @brief	size in bytes of a pixel in the given format and type
+*/
+static unsigned int pixel_size(GLenum format, GLenum type)
+{
+	if (type == GL_UNSIGNED_INT_24_8 || type == GL_UNSIGNED_INT_8_8_8_8 || type == GL_UNSIGNED_INT_2_10_10_10_REV)
+		return 4;
+
+	unsigned int components = 4;
+	switch (format)
+	{
+	case GL_RED: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: components = 1; break;
+	case GL_RG: components = 2; break;
+	case GL_RGB: case GL_BGR: components = 3; break;
+	}
+
+	switch (type)
+	{
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components * 2;
+	case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: return components * 4;
+	default: return components;
+	}
+}
+
+/**
+* @brief	bytes a texture upload reads, 0 when it only allocates storage
+*/
+static unsigned long long texture_upload_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+	std::map<GLenum, GLuint>::iterator unpack = state.buffers.find(GL_PIXEL_UNPACK_BUFFER);
+	bool from_buffer = unpack != state.buffers.end() && unpack->second != 0;
+	if (!pixels && !from_buffer)
+		return 0;
+	return (unsigned long long)width * height * pixel_size(format, type);
+}
+
+//	Wrappers ------------------------------------------------------------------
+
+static std::thread::id recording_thread;		// the thread that installed the wrappers, its context is the one the shadow state follows
+
+/**
+* @brief	check if the call comes from the thread whose context is shadowed, other threads (like a Texture_Uploader's) have their own context and go straight to the driver
+*/
+static bool is_recording_thread()
+{
+	return std::this_thread::get_id() == recording_thread;
+}
+
+static PFNGLDRAWARRAYSPROC real_glDrawArrays;
+static PFNGLDRAWELEMENTSPROC real_glDrawElements;
+static PFNGLDRAWARRAYSINSTANCEDPROC real_glDrawArraysInstanced;
+static PFNGLDRAWELEMENTSINSTANCEDPROC real_glDrawElementsInstanced;
+static PFNGLDRAWELEMENTSBASEVERTEXPROC real_glDrawElementsBaseVertex;
+static PFNGLMULTIDRAWELEMENTSBASEVERTEXPROC real_glMultiDrawElementsBaseVertex;
+static PFNGLUSEPROGRAMPROC real_glUseProgram;
+static PFNGLBINDVERTEXARRAYPROC real_glBindVertexArray;
+static PFNGLBINDBUFFERPROC real_glBindBuffer;
+static PFNGLBINDBUFFERBASEPROC real_glBindBufferBase;
+static PFNGLBINDBUFFERRANGEPROC real_glBindBufferRange;
+static PFNGLACTIVETEXTUREPROC real_glActiveTexture;
+static PFNGLBINDTEXTUREPROC real_glBindTexture;
+static PFNGLBINDFRAMEBUFFERPROC real_glBindFramebuffer;
+static PFNGLBINDRENDERBUFFERPROC real_glBindRenderbuffer;
+static PFNGLUNIFORM1IPROC real_glUniform1i;
+static PFNGLUNIFORM1FPROC real_glUniform1f;
+static PFNGLUNIFORM2FPROC real_glUniform2f;
+static PFNGLUNIFORM2FVPROC real_glUniform2fv;
+static PFNGLUNIFORM3FPROC real_glUniform3f;
+static PFNGLUNIFORM3FVPROC real_glUniform3fv;
+static PFNGLUNIFORM4FPROC real_glUniform4f;
+static PFNGLUNIFORM4FVPROC real_glUniform4fv;
+static PFNGLUNIFORMMATRIX2FVPROC real_glUniformMatrix2fv;
+static PFNGLUNIFORMMATRIX3FVPROC real_glUniformMatrix3fv;
+static PFNGLUNIFORMMATRIX4FVPROC real_glUniformMatrix4fv;
+static PFNGLGETUNIFORMLOCATIONPROC real_glGetUniformLocation;
+static PFNGLGETUNIFORMBLOCKINDEXPROC real_glGetUniformBlockIndex;
+static PFNGLENABLEPROC real_glEnable;
+static PFNGLDISABLEPROC real_glDisable;
+static PFNGLDEPTHFUNCPROC real_glDepthFunc;
+static PFNGLDEPTHMASKPROC real_glDepthMask;
+static PFNGLCULLFACEPROC real_glCullFace;
+static PFNGLBLENDFUNCPROC real_glBlendFunc;
+static PFNGLVIEWPORTPROC real_glViewport;
+static PFNGLCLEARCOLORPROC real_glClearColor;
+static PFNGLBUFFERDATAPROC real_glBufferData;
+static PFNGLBUFFERSUBDATAPROC real_glBufferSubData;
+static PFNGLTEXIMAGE2DPROC real_glTexImage2D;
+static PFNGLTEXSUBIMAGE2DPROC real_glTexSubImage2D;
+static PFNGLCOMPRESSEDTEXIMAGE2DPROC real_glCompressedTexImage2D;
+static PFNGLCLEARPROC real_glClear;
+static PFNGLBLITFRAMEBUFFERPROC real_glBlitFramebuffer;
+static PFNGLLINKPROGRAMPROC real_glLinkProgram;
+static PFNGLDELETEPROGRAMPROC real_glDeleteProgram;
+static PFNGLDELETEVERTEXARRAYSPROC real_glDeleteVertexArrays;
+static PFNGLDELETEBUFFERSPROC real_glDeleteBuffers;
+static PFNGLDELETETEXTURESPROC real_glDeleteTextures;
+static PFNGLDELETEFRAMEBUFFERSPROC real_glDeleteFramebuffers;
+
+static void APIENTRY wrapped_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	if (!is_recording_thread())
+		return real_glDrawArrays(mode, first, count);
+	Gl_Statistics_Recorder::record(FN_DRAW_ARRAYS, false);
+	real_glDrawArrays(mode, first, count);
+}
+
+static void APIENTRY wrapped_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+	if (!is_recording_thread())
+		return real_glDrawElements(mode, count, type, indices);
+	Gl_Statistics_Recorder::record(FN_DRAW_ELEMENTS, false);
+	real_glDrawElements(mode, count, type, indices);
+}
+
+static void APIENTRY wrapped_glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count)
+{
+	if (!is_recording_thread())
+		return real_glDrawArraysInstanced(mode, first, count, instance_count);
+	Gl_Statistics_Recorder::record(FN_DRAW_ARRAYS_INSTANCED, false);
+	real_glDrawArraysInstanced(mode, first, count, instance_count);
+}
+
+static void APIENTRY wrapped_glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instance_count)
+{
+	if (!is_recording_thread())
+		return real_glDrawElementsInstanced(mode, count, type, indices, instance_count);
+	Gl_Statistics_Recorder::record(FN_DRAW_ELEMENTS_INSTANCED, false);
+	real_glDrawElementsInstanced(mode, count, type, indices, instance_count);
+}
+
+static void APIENTRY wrapped_glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint base_vertex)
+{
+	if (!is_recording_thread())
+		return real_glDrawElementsBaseVertex(mode, count, type, indices, base_vertex);
+	Gl_Statistics_Recorder::record(FN_DRAW_ELEMENTS_BASE_VERTEX, false);
+	real_glDrawElementsBaseVertex(mode, count, type, indices, base_vertex);
+}
+
+static void APIENTRY wrapped_glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei draw_count, const GLint *base_vertex)
+{
+	if (!is_recording_thread())
+		return real_glMultiDrawElementsBaseVertex(mode, count, type, indices, draw_count, base_vertex);
+	Gl_Statistics_Recorder::record(FN_MULTI_DRAW_ELEMENTS_BASE_VERTEX, false);
+	real_glMultiDrawElementsBaseVertex(mode, count, type, indices, draw_count, base_vertex);
+}
+
+static void APIENTRY wrapped_glUseProgram(GLuint program)
+{
+	if (!is_recording_thread())
+		return real_glUseProgram(program);
+	Gl_Statistics_Recorder::record(FN_USE_PROGRAM, update(state.program, program));
+	real_glUseProgram(program);
+}
+
+static void APIENTRY wrapped_glBindVertexArray(GLuint vertex_array)
+{
+	if (!is_recording_thread())
+		return real_glBindVertexArray(vertex_array);
+	bool redundant = update(state.vertex_array, vertex_array);
+	// the element array binding is part of the vertex array
+	if (!redundant)
+		state.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+	Gl_Statistics_Recorder::record(FN_BIND_VERTEX_ARRAY, redundant);
+	real_glBindVertexArray(vertex_array);
+}
+
+static void APIENTRY wrapped_glBindBuffer(GLenum target, GLuint buffer)
+{
+	if (!is_recording_thread())
+		return real_glBindBuffer(target, buffer);
+	std::map<GLenum, GLuint>::iterator it = state.buffers.find(target);
+	bool redundant = it != state.buffers.end() && it->second == buffer;
+	state.buffers[target] = buffer;
+	Gl_Statistics_Recorder::record(FN_BIND_BUFFER, redundant);
+	real_glBindBuffer(target, buffer);
+}
+
+static void APIENTRY wrapped_glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	if (!is_recording_thread())
+		return real_glBindBufferBase(target, index, buffer);
+	// the indexed binding points aren't tracked, only the generic binding they also change
+	state.buffers[target] = buffer;
+	Gl_Statistics_Recorder::record(FN_BIND_BUFFER_BASE, false);
+	real_glBindBufferBase(target, index, buffer);
+}
+
+static void APIENTRY wrapped_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	if (!is_recording_thread())
+		return real_glBindBufferRange(target, index, buffer, offset, size);
+	state.buffers[target] = buffer;
+	Gl_Statistics_Recorder::record(FN_BIND_BUFFER_RANGE, false);
+	real_glBindBufferRange(target, index, buffer, offset, size);
+}
+
+static void APIENTRY wrapped_glActiveTexture(GLenum texture)
+{
+	if (!is_recording_thread())
+		return real_glActiveTexture(texture);
+	Gl_Statistics_Recorder::record(FN_ACTIVE_TEXTURE, update(state.active_texture, texture));
+	real_glActiveTexture(texture);
+}
+
+static void APIENTRY wrapped_glBindTexture(GLenum target, GLuint texture)
+{
+	if (!is_recording_thread())
+		return real_glBindTexture(target, texture);
+	bool redundant = false;
+	if (state.active_texture != unknown)
+	{
+		std::pair<GLenum, GLenum> key(state.active_texture, target);
+		std::map<std::pair<GLenum, GLenum>, GLuint>::iterator it = state.textures.find(key);
+		redundant = it != state.textures.end() && it->second == texture;
+		state.textures[key] = texture;
+	}
+	Gl_Statistics_Recorder::record(FN_BIND_TEXTURE, redundant);
+	real_glBindTexture(target, texture);
+}
+
+static void APIENTRY wrapped_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	if (!is_recording_thread())
+		return real_glBindFramebuffer(target, framebuffer);
+	bool redundant;
+	if (target == GL_FRAMEBUFFER)
+	{
+		redundant = state.draw_framebuffer == framebuffer && state.read_framebuffer == framebuffer;
+		state.draw_framebuffer = state.read_framebuffer = framebuffer;
+	}
+	else if (target == GL_DRAW_FRAMEBUFFER)
+		redundant = update(state.draw_framebuffer, framebuffer);
+	else
+		redundant = update(state.read_framebuffer, framebuffer);
+	Gl_Statistics_Recorder::record(FN_BIND_FRAMEBUFFER, redundant);
+	real_glBindFramebuffer(target, framebuffer);
+}
+
+static void APIENTRY wrapped_glBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+	if (!is_recording_thread())
+		return real_glBindRenderbuffer(target, renderbuffer);
+	Gl_Statistics_Recorder::record(FN_BIND_RENDERBUFFER, update(state.renderbuffer, renderbuffer));
+	real_glBindRenderbuffer(target, renderbuffer);
+}
+
+static void APIENTRY wrapped_glUniform1i(GLint location, GLint v0)
+{
+	if (!is_recording_thread())
+		return real_glUniform1i(location, v0);
+	record_uniform(FN_UNIFORM_1I, location, &v0, sizeof(v0));
+	real_glUniform1i(location, v0);
+}
+
+static void APIENTRY wrapped_glUniform1f(GLint location, GLfloat v0)
+{
+	if (!is_recording_thread())
+		return real_glUniform1f(location, v0);
+	record_uniform(FN_UNIFORM_1F, location, &v0, sizeof(v0));
+	real_glUniform1f(location, v0);
+}
+
+static void APIENTRY wrapped_glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+	if (!is_recording_thread())
+		return real_glUniform2f(location, v0, v1);
+	GLfloat v[2] = { v0, v1 };
+	record_uniform(FN_UNIFORM_2F, location, v, sizeof(v));
+	real_glUniform2f(location, v0, v1);
+}
+
+static void APIENTRY wrapped_glUniform2fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	if (!is_recording_thread())
+		return real_glUniform2fv(location, count, value);
+	record_uniform(FN_UNIFORM_2FV, location, value, count * 2 * sizeof(GLfloat));
+	real_glUniform2fv(location, count, value);
+}
+
+static void APIENTRY wrapped_glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	if (!is_recording_thread())
+		return real_glUniform3f(location, v0, v1, v2);
+	GLfloat v[3] = { v0, v1, v2 };
+	record_uniform(FN_UNIFORM_3F, location, v, sizeof(v));
+	real_glUniform3f(location, v0, v1, v2);
+}
+
+static void APIENTRY wrapped_glUniform3fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	if (!is_recording_thread())
+		return real_glUniform3fv(location, count, value);
+	record_uniform(FN_UNIFORM_3FV, location, value, count * 3 * sizeof(GLfloat));
+	real_glUniform3fv(location, count, value);
+}
+
+static void APIENTRY wrapped_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+	if (!is_recording_thread())
+		return real_glUniform4f(location, v0, v1, v2, v3);
+	GLfloat v[4] = { v0, v1, v2, v3 };
+	record_uniform(FN_UNIFORM_4F, location, v, sizeof(v));
+	real_glUniform4f(location, v0, v1, v2, v3);
+}
+
+static void APIENTRY wrapped_glUniform4fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	if (!is_recording_thread())
+		return real_glUniform4fv(location, count, value);
+	record_uniform(FN_UNIFORM_4FV, location, value, count * 4 * sizeof(GLfloat));
+	real_glUniform4fv(location, count, value);
+}
+
+static void APIENTRY wrapped_glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	if (!is_recording_thread())
+		return real_glUniformMatrix2fv(location, count, transpose, value);
+	record_uniform(FN_UNIFORM_MATRIX_2FV, location, value, count * 4 * sizeof(GLfloat));
+	real_glUniformMatrix2fv(location, count, transpose, value);
+}
+
+static void APIENTRY wrapped_glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	if (!is_recording_thread())
+		return real_glUniformMatrix3fv(location, count, transpose, value);
+	record_uniform(FN_UNIFORM_MATRIX_3FV, location, value, count * 9 * sizeof(GLfloat));
+	real_glUniformMatrix3fv(location, count, transpose, value);
+}
+
+static void APIENTRY wrapped_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	if (!is_recording_thread())
+		return real_glUniformMatrix4fv(location, count, transpose, value);
+	record_uniform(FN_UNIFORM_MATRIX_4FV, location, value, count * 16 * sizeof(GLfloat));
+	real_glUniformMatrix4fv(location, count, transpose, value);
+}
+
+static GLint APIENTRY wrapped_glGetUniformLocation(GLuint program, const GLchar *name)
+{
+	if (!is_recording_thread())
+		return real_glGetUniformLocation(program, name);
+	Gl_Statistics_Recorder::record(FN_GET_UNIFORM_LOCATION, false);
+	return real_glGetUniformLocation(program, name);
+}
+
+static GLuint APIENTRY wrapped_glGetUniformBlockIndex(GLuint program, const GLchar *name)
+{
+	if (!is_recording_thread())
+		return real_glGetUniformBlockIndex(program, name);
+	Gl_Statistics_Recorder::record(FN_GET_UNIFORM_BLOCK_INDEX, false);
+	return real_glGetUniformBlockIndex(program, name);
+}
+
+static void APIENTRY wrapped_glEnable(GLenum capability)
+{
+	if (!is_recording_thread())
+		return real_glEnable(capability);
+	std::map<GLenum, bool>::iterator it = state.capabilities.find(capability);
+	bool redundant = it != state.capabilities.end() && it->second;
+	state.capabilities[capability] = true;
+	Gl_Statistics_Recorder::record(FN_ENABLE, redundant);
+	real_glEnable(capability);
+}
+
+static void APIENTRY wrapped_glDisable(GLenum capability)
+{
+	if (!is_recording_thread())
+		return real_glDisable(capability);
+	std::map<GLenum, bool>::iterator it = state.capabilities.find(capability);
+	bool redundant = it != state.capabilities.end() && !it->second;
+	state.capabilities[capability] = false;
+	Gl_Statistics_Recorder::record(FN_DISABLE, redundant);
+	real_glDisable(capability);
+}
+
+static void APIENTRY wrapped_glDepthFunc(GLenum func)
+{
+	if (!is_recording_thread())
+		return real_glDepthFunc(func);
+	Gl_Statistics_Recorder::record(FN_DEPTH_FUNC, update(state.depth_func, func));
+	real_glDepthFunc(func);
+}
+
+static void APIENTRY wrapped_glDepthMask(GLboolean flag)
+{
+	if (!is_recording_thread())
+		return real_glDepthMask(flag);
+	Gl_Statistics_Recorder::record(FN_DEPTH_MASK, update(state.depth_mask, (GLuint)flag));
+	real_glDepthMask(flag);
+}
+
+static void APIENTRY wrapped_glCullFace(GLenum mode)
+{
+	if (!is_recording_thread())
+		return real_glCullFace(mode);
+	Gl_Statistics_Recorder::record(FN_CULL_FACE, update(state.cull_face, mode));
+	real_glCullFace(mode);
+}
+
+static void APIENTRY wrapped_glBlendFunc(GLenum source, GLenum destination)
+{
+	if (!is_recording_thread())
+		return real_glBlendFunc(source, destination);
+	bool redundant = state.blend_source == source && state.blend_destination == destination;
+	state.blend_source = source;
+	state.blend_destination = destination;
+	Gl_Statistics_Recorder::record(FN_BLEND_FUNC, redundant);
+	real_glBlendFunc(source, destination);
+}
+
+static void APIENTRY wrapped_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (!is_recording_thread())
+		return real_glViewport(x, y, width, height);
+	GLint v[4] = { x, y, width, height };
+	bool redundant = state.viewport_known && memcmp(state.viewport, v, sizeof(v)) == 0;
+	memcpy(state.viewport, v, sizeof(v));
+	state.viewport_known = true;
+	Gl_Statistics_Recorder::record(FN_VIEWPORT, redundant);
+	real_glViewport(x, y, width, height);
+}
+
+static void APIENTRY wrapped_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	if (!is_recording_thread())
+		return real_glClearColor(red, green, blue, alpha);
+	GLfloat c[4] = { red, green, blue, alpha };
+	bool redundant = state.clear_color_known && memcmp(state.clear_color, c, sizeof(c)) == 0;
+	memcpy(state.clear_color, c, sizeof(c));
+	state.clear_color_known = true;
+	Gl_Statistics_Recorder::record(FN_CLEAR_COLOR, redundant);
+	real_glClearColor(red, green, blue, alpha);
+}
+
+static void APIENTRY wrapped_glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+	if (!is_recording_thread())
+		return real_glBufferData(target, size, data, usage);
+	Gl_Statistics_Recorder::record(FN_BUFFER_DATA, false, data ? size : 0);
+	real_glBufferData(target, size, data, usage);
+}
+
+static void APIENTRY wrapped_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	if (!is_recording_thread())
+		return real_glBufferSubData(target, offset, size, data);
+	Gl_Statistics_Recorder::record(FN_BUFFER_SUB_DATA, false, size);
+	real_glBufferSubData(target, offset, size, data);
+}
+
+static void APIENTRY wrapped_glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+{
+	if (!is_recording_thread())
+		return real_glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+	Gl_Statistics_Recorder::record(FN_TEX_IMAGE_2D, false, texture_upload_bytes(width, height, format, type, pixels));
+	real_glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY wrapped_glTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+	if (!is_recording_thread())
+		return real_glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+	Gl_Statistics_Recorder::record(FN_TEX_SUB_IMAGE_2D, false, texture_upload_bytes(width, height, format, type, pixels));
+	real_glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+static void APIENTRY wrapped_glCompressedTexImage2D(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height, GLint border, GLsizei size, const void *data)
+{
+	if (!is_recording_thread())
+		return real_glCompressedTexImage2D(target, level, internal_format, width, height, border, size, data);
+	Gl_Statistics_Recorder::record(FN_COMPRESSED_TEX_IMAGE_2D, false, data ? size : 0);
+	real_glCompressedTexImage2D(target, level, internal_format, width, height, border, size, data);
+}
+
+static void APIENTRY wrapped_glClear(GLbitfield mask)
+{
+	if (!is_recording_thread())
+		return real_glClear(mask);
+	Gl_Statistics_Recorder::record(FN_CLEAR, false);
+	real_glClear(mask);
+}
+
+static void APIENTRY wrapped_glBlitFramebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum filter)
+{
+	if (!is_recording_thread())
+		return real_glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+	Gl_Statistics_Recorder::record(FN_BLIT_FRAMEBUFFER, false);
+	real_glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+}
+
+static void APIENTRY wrapped_glLinkProgram(GLuint program)
+{
+	if (!is_recording_thread())
+		return real_glLinkProgram(program);
+	// linking resets every uniform to its default value
+	forget_uniforms(program);
+	Gl_Statistics_Recorder::record(FN_LINK_PROGRAM, false);
+	real_glLinkProgram(program);
+}
+
+// deleting a bound object unbinds it, the deletes aren't counted but forget the state they change
+
+static void APIENTRY wrapped_glDeleteProgram(GLuint program)
+{
+	if (!is_recording_thread())
+		return real_glDeleteProgram(program);
+	forget_uniforms(program);
+	if (state.program == program)
+		state.program = unknown;
+	real_glDeleteProgram(program);
+}
+
+static void APIENTRY wrapped_glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+	if (!is_recording_thread())
+		return real_glDeleteVertexArrays(n, arrays);
+	for (GLsizei i = 0; i < n; i++)
+		if (state.vertex_array == arrays[i])
+			state.vertex_array = unknown;
+	real_glDeleteVertexArrays(n, arrays);
+}
+
+static void APIENTRY wrapped_glDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+	if (!is_recording_thread())
+		return real_glDeleteBuffers(n, buffers);
+	state.buffers.clear();
+	real_glDeleteBuffers(n, buffers);
+}
+
+static void APIENTRY wrapped_glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+	if (!is_recording_thread())
+		return real_glDeleteTextures(n, textures);
+	state.textures.clear();
+	real_glDeleteTextures(n, textures);
+}
+
+static void APIENTRY wrapped_glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	if (!is_recording_thread())
+		return real_glDeleteFramebuffers(n, framebuffers);
+	state.draw_framebuffer = state.read_framebuffer = unknown;
+	real_glDeleteFramebuffers(n, framebuffers);
+}
+
+//	Gl_Statistics --------------------------------------------------------------
+
+// swaps a glad pointer with its wrapper, functions the driver doesn't have stay NULL
+#define INSTALL_WRAPPER(function) if (glad_##function) { real_##function = glad_##function; glad_##function = wrapped_##function; }
+#define UNINSTALL_WRAPPER(function) if (real_##function) { glad_##function = real_##function; real_##function = NULL; }
+
+void Gl_Statistics::install()
+{
+	if (s_installed)
+		return;
+
+	clear_state();
+	reset();
+	recording_thread = std::this_thread::get_id();
+
+	INSTALL_WRAPPER(glDrawArrays);
+	INSTALL_WRAPPER(glDrawElements);
+	INSTALL_WRAPPER(glDrawArraysInstanced);
+	INSTALL_WRAPPER(glDrawElementsInstanced);
+	INSTALL_WRAPPER(glDrawElementsBaseVertex);
+	INSTALL_WRAPPER(glMultiDrawElementsBaseVertex);
+	INSTALL_WRAPPER(glUseProgram);
+	INSTALL_WRAPPER(glBindVertexArray);
+	INSTALL_WRAPPER(glBindBuffer);
+	INSTALL_WRAPPER(glBindBufferBase);
+	INSTALL_WRAPPER(glBindBufferRange);
+	INSTALL_WRAPPER(glActiveTexture);
+	INSTALL_WRAPPER(glBindTexture);
+	INSTALL_WRAPPER(glBindFramebuffer);
+	INSTALL_WRAPPER(glBindRenderbuffer);
+	INSTALL_WRAPPER(glUniform1i);
+	INSTALL_WRAPPER(glUniform1f);
+	INSTALL_WRAPPER(glUniform2f);
+	INSTALL_WRAPPER(glUniform2fv);
+	INSTALL_WRAPPER(glUniform3f);
+	INSTALL_WRAPPER(glUniform3fv);
+	INSTALL_WRAPPER(glUniform4f);
+	INSTALL_WRAPPER(glUniform4fv);
+	INSTALL_WRAPPER(glUniformMatrix2fv);
+	INSTALL_WRAPPER(glUniformMatrix3fv);
+	INSTALL_WRAPPER(glUniformMatrix4fv);
+	INSTALL_WRAPPER(glGetUniformLocation);
+	INSTALL_WRAPPER(glGetUniformBlockIndex);
+	INSTALL_WRAPPER(glEnable);
+	INSTALL_WRAPPER(glDisable);
+	INSTALL_WRAPPER(glDepthFunc);
+	INSTALL_WRAPPER(glDepthMask);
+	INSTALL_WRAPPER(glCullFace);
+	INSTALL_WRAPPER(glBlendFunc);
+	INSTALL_WRAPPER(glViewport);
+	INSTALL_WRAPPER(glClearColor);
+	INSTALL_WRAPPER(glBufferData);
+	INSTALL_WRAPPER(glBufferSubData);
+	INSTALL_WRAPPER(glTexImage2D);
+	INSTALL_WRAPPER(glTexSubImage2D);
+	INSTALL_WRAPPER(glCompressedTexImage2D);
+	INSTALL_WRAPPER(glClear);
+	INSTALL_WRAPPER(glBlitFramebuffer);
+	INSTALL_WRAPPER(glLinkProgram);
+	INSTALL_WRAPPER(glDeleteProgram);
+	INSTALL_WRAPPER(glDeleteVertexArrays);
+	INSTALL_WRAPPER(glDeleteBuffers);
+	INSTALL_WRAPPER(glDeleteTextures);
+	INSTALL_WRAPPER(glDeleteFramebuffers);
+
+	s_installed = true;
+}
+
+void Gl_Statistics::uninstall()
+{
+	if (!s_installed)
+		return;
+
+	UNINSTALL_WRAPPER(glDrawArrays);
+	UNINSTALL_WRAPPER(glDrawElements);
+	UNINSTALL_WRAPPER(glDrawArraysInstanced);
+	UNINSTALL_WRAPPER(glDrawElementsInstanced);
+	UNINSTALL_WRAPPER(glDrawElementsBaseVertex);
+	UNINSTALL_WRAPPER(glMultiDrawElementsBaseVertex);
+	UNINSTALL_WRAPPER(glUseProgram);
+	UNINSTALL_WRAPPER(glBindVertexArray);
+	UNINSTALL_WRAPPER(glBindBuffer);
+	UNINSTALL_WRAPPER(glBindBufferBase);
+	UNINSTALL_WRAPPER(glBindBufferRange);
+	UNINSTALL_WRAPPER(glActiveTexture);
+	UNINSTALL_WRAPPER(glBindTexture);
+	UNINSTALL_WRAPPER(glBindFramebuffer);
+	UNINSTALL_WRAPPER(glBindRenderbuffer);
+	UNINSTALL_WRAPPER(glUniform1i);
+	UNINSTALL_WRAPPER(glUniform1f);
+	UNINSTALL_WRAPPER(glUniform2f);
+	UNINSTALL_WRAPPER(glUniform2fv);
+	UNINSTALL_WRAPPER(glUniform3f);
+	UNINSTALL_WRAPPER(glUniform3fv);
+	UNINSTALL_WRAPPER(glUniform4f);
+	UNINSTALL_WRAPPER(glUniform4fv);
+	UNINSTALL_WRAPPER(glUniformMatrix2fv);
+	UNINSTALL_WRAPPER(glUniformMatrix3fv);
+	UNINSTALL_WRAPPER(glUniformMatrix4fv);
+	UNINSTALL_WRAPPER(glGetUniformLocation);
+	UNINSTALL_WRAPPER(glGetUniformBlockIndex);
+	UNINSTALL_WRAPPER(glEnable);
+	UNINSTALL_WRAPPER(glDisable);
+	UNINSTALL_WRAPPER(glDepthFunc);
+	UNINSTALL_WRAPPER(glDepthMask);
+	UNINSTALL_WRAPPER(glCullFace);
+	UNINSTALL_WRAPPER(glBlendFunc);
+	UNINSTALL_WRAPPER(glViewport);
+	UNINSTALL_WRAPPER(glClearColor);
+	UNINSTALL_WRAPPER(glBufferData);
+	UNINSTALL_WRAPPER(glBufferSubData);
+	UNINSTALL_WRAPPER(glTexImage2D);
+	UNINSTALL_WRAPPER(glTexSubImage2D);
+	UNINSTALL_WRAPPER(glCompressedTexImage2D);
+	UNINSTALL_WRAPPER(glClear);
+	UNINSTALL_WRAPPER(glBlitFramebuffer);
+	UNINSTALL_WRAPPER(glLinkProgram);
+	UNINSTALL_WRAPPER(glDeleteProgram);
+	UNINSTALL_WRAPPER(glDeleteVertexArrays);
+	UNINSTALL_WRAPPER(glDeleteBuffers);
+	UNINSTALL_WRAPPER(glDeleteTextures);
+	UNINSTALL_WRAPPER(glDeleteFramebuffers);
+
+	s_installed = false;
+	s_in_frame = false;
+	s_current_pass = -1;
+}
+
+void Gl_Statistics::begin_frame()
+{
+	if (!s_installed)
+		return;
+
+	memset(&s_frame, 0, sizeof(s_frame));
+	s_in_frame = true;
+}
+
+void Gl_Statistics::end_frame()
+{
+	if (!s_in_frame)
+		return;
+
+	s_in_frame = false;
+	s_current_pass = -1;
+	s_last_frame = s_frame;
+	s_frames++;
+
+	unsigned long long redundant = 0;
+	for (int i = 0; i < GL_CALL_TYPE_COUNT; i++)
+	{
+		s_total.calls[i] += s_frame.calls[i];
+		s_total.redundant[i] += s_frame.redundant[i];
+		s_total.skipped[i] += s_frame.skipped[i];
+		redundant += s_frame.redundant[i];
+	}
+	s_total.upload_bytes += s_frame.upload_bytes;
+
+	PROFILE_COUNTER("gl_draws", s_frame.calls[DRAW_CALL]);
+	PROFILE_COUNTER("gl_binds", s_frame.calls[BIND_CALL]);
+	PROFILE_COUNTER("gl_uniforms", s_frame.calls[UNIFORM_CALL]);
+	PROFILE_COUNTER("gl_uniform_lookups", s_frame.calls[UNIFORM_LOOKUP]);
+	PROFILE_COUNTER("gl_state_changes", s_frame.calls[STATE_CALL]);
+	PROFILE_COUNTER("gl_upload_bytes", s_frame.upload_bytes);
+	PROFILE_COUNTER("gl_redundant", redundant);
+	PROFILE_COUNTER("gl_skipped_uniforms", s_frame.skipped[UNIFORM_CALL]);
+}
+
+void Gl_Statistics::begin_pass(const char *name)
+{
+	if (!s_in_frame)
+		return;
+
+	for (unsigned int i = 0; i < s_passes.size(); i++)
+	{
+		if (strcmp(s_passes[i].name, name) == 0)
+		{
+			s_current_pass = i;
+			return;
+		}
+	}
+
+	Pass_Counters pass;
+	pass.name = name;
+	memset(&pass.counters, 0, sizeof(pass.counters));
+	s_passes.push_back(pass);
+	s_current_pass = s_passes.size() - 1;
+}
+
+void Gl_Statistics::record_skipped(Gl_Call_Type type)
+{
+	if (!s_in_frame || !is_recording_thread())
+		return;
+	Gl_Statistics_Recorder::record_skipped(type);
+}
+
+void Gl_Statistics::end_pass()
+{
+	s_current_pass = -1;
+}
+
+void Gl_Statistics::reset()
+{
+	s_frames = 0;
+	memset(&s_frame, 0, sizeof(s_frame));
+	memset(&s_last_frame, 0, sizeof(s_last_frame));
+	memset(&s_total, 0, sizeof(s_total));
+	memset(function_calls, 0, sizeof(function_calls));
+	memset(function_redundant, 0, sizeof(function_redundant));
+	s_passes.clear();
+	s_current_pass = -1;
+}
+
+const char *Gl_Statistics::type_name(Gl_Call_Type type)
+{
+	static const char *names[GL_CALL_TYPE_COUNT] = { "draws", "binds", "uniforms", "uniform_lookups", "state_changes", "uploads", "other" };
+	return names[type];
+}
+
+void Gl_Statistics::print()
+{
+	if (s_frames == 0)
+		return;
+
+	printf("gl calls per frame (mean of %u frames)\n", s_frames);
+	printf("  %-20s %10s %10s %10s\n", "", "calls", "redundant", "skipped");
+	for (int i = 0; i < GL_CALL_TYPE_COUNT; i++)
+		printf("  %-20s %10.1f %10.1f %10.1f\n", type_name((Gl_Call_Type)i), (double)s_total.calls[i] / s_frames, (double)s_total.redundant[i] / s_frames,
+			(double)s_total.skipped[i] / s_frames);
+	printf("  %-20s %10.0f bytes\n", "upload", (double)s_total.upload_bytes / s_frames);
+
+	for (unsigned int i = 0; i < s_passes.size(); i++)
+	{
+		const Gl_Counters &c = s_passes[i].counters;
+		printf("  %-20s draws %.1f, binds %.1f (%.1f redundant), uniforms %.1f (%.1f redundant, %.1f skipped), lookups %.1f, state %.1f (%.1f redundant)\n",
+			s_passes[i].name, (double)c.calls[DRAW_CALL] / s_frames, (double)c.calls[BIND_CALL] / s_frames, (double)c.redundant[BIND_CALL] / s_frames,
+			(double)c.calls[UNIFORM_CALL] / s_frames, (double)c.redundant[UNIFORM_CALL] / s_frames, (double)c.skipped[UNIFORM_CALL] / s_frames,
+			(double)c.calls[UNIFORM_LOOKUP] / s_frames,
+			(double)c.calls[STATE_CALL] / s_frames, (double)c.redundant[STATE_CALL] / s_frames);
+	}
+
+	printf("redundant calls per frame\n");
+	for (int i = 0; i < FUNCTION_COUNT; i++)
+		if (function_redundant[i])
+			printf("  %-24s %8.1f of %8.1f\n", function_info[i].name, (double)function_redundant[i] / s_frames, (double)function_calls[i] / s_frames);
+}
+
+/**
+* @brief	formats counters divided by the frame count as a JSON object
+*/
+static std::string counters_json(const Gl_Counters &c, unsigned int frames)
+{
+	std::string json = "{";
+	char value[192];
+	for (int i = 0; i < GL_CALL_TYPE_COUNT; i++)
+	{
+		const char *name = Gl_Statistics::type_name((Gl_Call_Type)i);
+		snprintf(value, sizeof(value), " \"%s\": %.2f, \"redundant_%s\": %.2f, \"skipped_%s\": %.2f,", name,
+			(double)c.calls[i] / frames, name, (double)c.redundant[i] / frames, name, (double)c.skipped[i] / frames);
+		json += value;
+	}
+	snprintf(value, sizeof(value), " \"upload_bytes\": %.0f }", (double)c.upload_bytes / frames);
+	json += value;
+	return json;
+}
+
+std::string Gl_Statistics::json_members(const char *indent)
+{
+	if (s_frames == 0)
+		return "";
+
+	std::string json;
+	json += indent;
+	json += "\"gl_calls\": " + counters_json(s_total, s_frames) + ",\n";
+
+	json += indent;
+	json += "\"gl_passes\": {";
+	for (unsigned int i = 0; i < s_passes.size(); i++)
+	{
+		json += i ? ",\n" : "\n";
+		json += indent;
+		json += "\t\"";
+		json += s_passes[i].name;
+		json += "\": " + counters_json(s_passes[i].counters, s_frames);
+	}
+	json += "\n";
+	json += indent;
+	json += "},\n";
+
+	json += indent;
+	json += "\"gl_redundant_functions\": {";
+	bool first = true;
+	for (int i = 0; i < FUNCTION_COUNT; i++)
+	{
+		if (!function_redundant[i])
+			continue;
+		char value[128];
+		snprintf(value, sizeof(value), "%s \"%s\": %.2f", first ? "" : ",", function_info[i].name, (double)function_redundant[i] / s_frames);
+		json += value;
+		first = false;
+	}
+	json += " },\n";
+
+	return json;
+}
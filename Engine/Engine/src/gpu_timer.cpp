@@ -0,0 +1,275 @@
+#include <string.h>
+#include <algorithm>
+
+#include "gpu_timer.h"
+
+Gpu_Timer *Gpu_Timer::s_active = NULL;
+
+
+Gpu_Timer::Gpu_Timer(unsigned int latency)
+	: m_capture_draws(false), m_dropped_frames(0), m_current(0), m_current_pass(NULL), m_frame_started(false)
+{
+	m_frames.resize(latency > 1 ? latency : 2);
+	for (unsigned int i = 0; i < m_frames.size(); i++)
+	{
+		m_frames[i].pass_count = 0;
+		m_frames[i].draw_count = 0;
+		m_frames[i].pending = false;
+	}
+}
+
+Gpu_Timer::~Gpu_Timer()
+{
+	for (unsigned int i = 0; i < m_frames.size(); i++)
+	{
+		if (!m_frames[i].pass_queries.empty())
+			glDeleteQueries(m_frames[i].pass_queries.size(), &m_frames[i].pass_queries[0]);
+		if (!m_frames[i].draw_queries.empty())
+			glDeleteQueries(m_frames[i].draw_queries.size(), &m_frames[i].draw_queries[0]);
+	}
+
+	if (s_active == this)
+		s_active = NULL;
+}
+
+void Gpu_Timer::begin_frame()
+{
+	if (m_current_pass)
+		end_pass();
+
+	if (m_frame_started)
+		m_current = (m_current + 1) % m_frames.size();
+	m_frame_started = true;
+
+	// this slot was recorded m_frames.size() frames ago, read it back before reusing its queries
+	Frame_Queries &frame = m_frames[m_current];
+	if (frame.pending)
+		read_back(frame, false);
+
+	frame.pass_count = 0;
+	frame.draw_count = 0;
+	frame.pass_names.clear();
+	frame.draw_passes.clear();
+	frame.draw_index_counts.clear();
+}
+
+void Gpu_Timer::resolve_all()
+{
+	if (m_current_pass)
+		end_pass();
+
+	// read the oldest frames first so the results stay in order
+	for (unsigned int i = 1; i <= m_frames.size(); i++)
+	{
+		Frame_Queries &frame = m_frames[(m_current + i) % m_frames.size()];
+		if (frame.pending)
+			read_back(frame, true);
+	}
+}
+
+void Gpu_Timer::reset()
+{
+	m_passes.clear();
+	m_draws.clear();
+	m_dropped_frames = 0;
+}
+
+void Gpu_Timer::read_back(Frame_Queries &frame, bool wait)
+{
+	frame.pending = false;
+
+	if (!wait)
+	{
+		// the draws are made inside the passes so the last pass finishes last, if it isn't available the frame is dropped rather than stalling on it
+		unsigned int last_query = 0;
+		if (frame.pass_count > 0)
+			last_query = frame.pass_queries[frame.pass_count - 1];
+		else if (frame.draw_count > 0)
+			last_query = frame.draw_queries[frame.draw_count * 2 - 1];
+
+		if (last_query)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				m_dropped_frames++;
+				return;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < frame.pass_count; i++)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(frame.pass_queries[i], GL_QUERY_RESULT, &elapsed);
+		accumulate(m_passes, frame.pass_names[i], 0, 0, elapsed / 1000000.0);
+	}
+
+	unsigned int draw_in_pass = 0;
+	for (unsigned int i = 0; i < frame.draw_count; i++)
+	{
+		if (i > 0 && frame.draw_passes[i] != frame.draw_passes[i - 1])
+			draw_in_pass = 0;
+
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(frame.draw_queries[i * 2], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.draw_queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+		accumulate(m_draws, frame.draw_passes[i], draw_in_pass++, frame.draw_index_counts[i], (end - start) / 1000000.0);
+	}
+}
+
+void Gpu_Timer::accumulate(std::vector<Gpu_Timing> &timings, const char *name, unsigned int draw, unsigned int index_count, double ms)
+{
+	for (unsigned int i = 0; i < timings.size(); i++)
+	{
+		Gpu_Timing &t = timings[i];
+		if (t.draw == draw && t.name == name)
+		{
+			t.last_ms = ms;
+			t.total_ms += ms;
+			t.min_ms = std::min(t.min_ms, ms);
+			t.max_ms = std::max(t.max_ms, ms);
+			t.samples++;
+			return;
+		}
+	}
+
+	Gpu_Timing t;
+	t.name = name;
+	t.draw = draw;
+	t.index_count = index_count;
+	t.last_ms = t.total_ms = t.min_ms = t.max_ms = ms;
+	t.samples = 1;
+	timings.push_back(t);
+}
+
+void Gpu_Timer::print()
+{
+	printf("gpu time per pass (mean of %u frames, %u dropped)\n", m_passes.empty() ? 0 : m_passes[0].samples, m_dropped_frames);
+	double total = 0.0;
+	for (unsigned int i = 0; i < m_passes.size(); i++)
+	{
+		double mean = m_passes[i].total_ms / m_passes[i].samples;
+		total += mean;
+		printf("  %-20s %8.3f ms  (min %.3f, max %.3f)\n", m_passes[i].name.c_str(), mean, m_passes[i].min_ms, m_passes[i].max_ms);
+	}
+	printf("  %-20s %8.3f ms\n", "total", total);
+
+	if (m_draws.empty())
+		return;
+
+	// only the slowest few draws, a model can have a lot of meshes
+	std::vector<Gpu_Timing> draws = m_draws;
+	std::sort(draws.begin(), draws.end(), [](const Gpu_Timing &a, const Gpu_Timing &b) { return a.total_ms / a.samples > b.total_ms / b.samples; });
+	unsigned int shown = std::min((unsigned int)draws.size(), 10u);
+	printf("slowest of %u draws\n", (unsigned int)draws.size());
+	for (unsigned int i = 0; i < shown; i++)
+		printf("  %-20s #%-4u %8u indices %8.3f ms\n", draws[i].name.c_str(), draws[i].draw, draws[i].index_count, draws[i].total_ms / draws[i].samples);
+}
+
+std::string Gpu_Timer::json_members(const char *indent)
+{
+	std::string json;
+	char line[512];
+
+	json += indent;
+	json += "\"gpu_ms\": {";
+	for (unsigned int i = 0; i < m_passes.size(); i++)
+	{
+		const Gpu_Timing &t = m_passes[i];
+		snprintf(line, sizeof(line), "%s \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"samples\": %u }",
+			i ? "," : "", t.name.c_str(), t.total_ms / t.samples, t.min_ms, t.max_ms, t.samples);
+		json += line;
+	}
+	json += " },\n";
+
+	snprintf(line, sizeof(line), "%s\"gpu_dropped_frames\": %u,\n", indent, m_dropped_frames);
+	json += line;
+
+	if (m_draws.empty())
+		return json;
+
+	json += indent;
+	json += "\"gpu_draws\": [";
+	for (unsigned int i = 0; i < m_draws.size(); i++)
+	{
+		const Gpu_Timing &t = m_draws[i];
+		snprintf(line, sizeof(line), "%s\n%s\t{ \"pass\": \"%s\", \"draw\": %u, \"indices\": %u, \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f }",
+			i ? "," : "", indent, t.name.c_str(), t.draw, t.index_count, t.total_ms / t.samples, t.min_ms, t.max_ms);
+		json += line;
+	}
+	json += "\n";
+	json += indent;
+	json += "],\n";
+
+	return json;
+}
+
+void Gpu_Timer::begin_pass(const char *name)
+{
+	Gpu_Timer *timer = s_active;
+	if (!timer || !timer->m_frame_started)
+		return;
+
+	// elapsed time queries can't overlap, close the previous pass if it was left open
+	if (timer->m_current_pass)
+		end_pass();
+
+	Frame_Queries &frame = timer->m_frames[timer->m_current];
+	if (frame.pass_count == frame.pass_queries.size())
+	{
+		unsigned int query;
+		glGenQueries(1, &query);
+		frame.pass_queries.push_back(query);
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, frame.pass_queries[frame.pass_count]);
+	frame.pass_names.push_back(name);
+	frame.pass_count++;
+	frame.pending = true;
+
+	timer->m_current_pass = name;
+}
+
+void Gpu_Timer::end_pass()
+{
+	Gpu_Timer *timer = s_active;
+	if (!timer || !timer->m_current_pass)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	timer->m_current_pass = NULL;
+}
+
+void Gpu_Timer::begin_draw(unsigned int index_count)
+{
+	Gpu_Timer *timer = s_active;
+	if (!timer || !timer->m_capture_draws || !timer->m_frame_started)
+		return;
+
+	Frame_Queries &frame = timer->m_frames[timer->m_current];
+	if (frame.draw_count * 2 == frame.draw_queries.size())
+	{
+		unsigned int queries[2];
+		glGenQueries(2, queries);
+		frame.draw_queries.push_back(queries[0]);
+		frame.draw_queries.push_back(queries[1]);
+	}
+
+	glQueryCounter(frame.draw_queries[frame.draw_count * 2], GL_TIMESTAMP);
+	frame.draw_passes.push_back(timer->m_current_pass ? timer->m_current_pass : "none");
+	frame.draw_index_counts.push_back(index_count);
+	frame.pending = true;
+}
+
+void Gpu_Timer::end_draw()
+{
+	Gpu_Timer *timer = s_active;
+	if (!timer || !timer->m_capture_draws || !timer->m_frame_started)
+		return;
+
+	Frame_Queries &frame = timer->m_frames[timer->m_current];
+	glQueryCounter(frame.draw_queries[frame.draw_count * 2 + 1], GL_TIMESTAMP);
+	frame.draw_count++;
+}
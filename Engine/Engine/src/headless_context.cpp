@@ -0,0 +1,265 @@
+#include <stdio.h>
+
+#include "headless_context.h"
+
+
+Headless_Context::Headless_Context(unsigned int width, unsigned int height)
+	: m_framebuffer_object(0), m_width(width), m_height(height), m_color_texture(0), m_depth_renderbuffer(0), m_valid(false)
+{
+	if (!create_context())
+		return;
+
+#if defined(ENGINE_USE_OSMESA)
+	if (!gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress))
+#else
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+#endif
+	{
+		printf("Failed to initialize GLAD\n");
+		return;
+	}
+
+	m_valid = true;
+	create_framebuffer();
+}
+
+Headless_Context::~Headless_Context()
+{
+	if (m_valid)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer_object);
+		glDeleteTextures(1, &m_color_texture);
+		glDeleteRenderbuffers(1, &m_depth_renderbuffer);
+	}
+
+#if defined(ENGINE_USE_OSMESA)
+	if (m_context)
+		OSMesaDestroyContext(m_context);
+#else
+	if (m_context != EGL_NO_CONTEXT)
+	{
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(m_display, m_context);
+	}
+	if (m_display != EGL_NO_DISPLAY)
+		eglTerminate(m_display);
+#endif
+}
+
+void Headless_Context::print_info()
+{
+	printf("GL_VENDOR:   %s\n", glGetString(GL_VENDOR));
+	printf("GL_RENDERER: %s\n", glGetString(GL_RENDERER));
+	printf("GL_VERSION:  %s\n", glGetString(GL_VERSION));
+}
+
+#if defined(ENGINE_USE_OSMESA)
+
+/**
+* @class Osmesa_Shared_Context
+* @brief	an OSMesa context sharing with the Headless_Context, made current with its own 1x1 buffer
+*/
+class Osmesa_Shared_Context : public Shared_Context
+{
+public:
+	Osmesa_Shared_Context(OSMesaContext context) : m_context(context), m_pixel(0) {}
+	~Osmesa_Shared_Context() { OSMesaDestroyContext(m_context); }
+
+	bool make_current()
+	{
+		if (!OSMesaMakeCurrent(m_context, &m_pixel, GL_UNSIGNED_BYTE, 1, 1))
+		{
+			printf("ERROR::HEADLESS_CONTEXT:: OSMesaMakeCurrent failed for the shared context\n");
+			return false;
+		}
+		return true;
+	}
+
+	void release() { OSMesaMakeCurrent(NULL, NULL, GL_UNSIGNED_BYTE, 0, 0); }
+
+private:
+	OSMesaContext m_context;
+	unsigned int m_pixel;		// the buffer OSMesa insists on
+};
+
+Shared_Context *Headless_Context::create_shared_context()
+{
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 3,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+
+	OSMesaContext context = OSMesaCreateContextAttribs(attributes, m_context);
+	if (!context)
+	{
+		printf("ERROR::HEADLESS_CONTEXT:: OSMesaCreateContextAttribs failed for the shared context\n");
+		return NULL;
+	}
+	return new Osmesa_Shared_Context(context);
+}
+
+bool Headless_Context::create_context()
+{
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 24,
+		OSMESA_STENCIL_BITS, 8,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 3,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+
+	m_context = OSMesaCreateContextAttribs(attributes, NULL);
+	if (!m_context)
+	{
+		printf("ERROR::HEADLESS_CONTEXT:: OSMesaCreateContextAttribs failed\n");
+		return false;
+	}
+
+	// OSMesa can't be made current without a buffer even though we only draw into framebuffer objects
+	m_buffer.resize(m_width * m_height * 4);
+	if (!OSMesaMakeCurrent(m_context, &m_buffer[0], GL_UNSIGNED_BYTE, m_width, m_height))
+	{
+		printf("ERROR::HEADLESS_CONTEXT:: OSMesaMakeCurrent failed\n");
+		return false;
+	}
+
+	return true;
+}
+
+#else
+
+static const EGLint context_attributes[] = {
+	EGL_CONTEXT_MAJOR_VERSION, 3,
+	EGL_CONTEXT_MINOR_VERSION, 3,
+	EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+	EGL_NONE
+};
+
+/**
+* @class Egl_Shared_Context
+* @brief	an EGL context sharing with the Headless_Context, made current without a surface like it
+*/
+class Egl_Shared_Context : public Shared_Context
+{
+public:
+	Egl_Shared_Context(EGLDisplay display, EGLContext context) : m_display(display), m_context(context) {}
+	~Egl_Shared_Context() { eglDestroyContext(m_display, m_context); }
+
+	bool make_current()
+	{
+		eglBindAPI(EGL_OPENGL_API);
+		if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+		{
+			printf("ERROR::HEADLESS_CONTEXT:: eglMakeCurrent failed for the shared context (0x%x)\n", eglGetError());
+			return false;
+		}
+		return true;
+	}
+
+	void release() { eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+private:
+	EGLDisplay m_display;
+	EGLContext m_context;
+};
+
+Shared_Context *Headless_Context::create_shared_context()
+{
+	EGLContext context = eglCreateContext(m_display, m_config, m_context, context_attributes);
+	if (context == EGL_NO_CONTEXT)
+	{
+		printf("ERROR::HEADLESS_CONTEXT:: eglCreateContext failed for the shared context (0x%x)\n", eglGetError());
+		return NULL;
+	}
+	return new Egl_Shared_Context(m_display, context);
+}
+
+bool Headless_Context::create_context()
+{
+	m_display = EGL_NO_DISPLAY;
+	m_context = EGL_NO_CONTEXT;
+
+	EGLint major, minor;
+	m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor))
+	{
+		// with no X or wayland display around fall back to Mesa's surfaceless platform
+		PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (get_platform_display)
+			m_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+		if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor))
+		{
+			printf("ERROR::HEADLESS_CONTEXT:: could not initialize an EGL display (0x%x)\n", eglGetError());
+			m_display = EGL_NO_DISPLAY;
+			return false;
+		}
+	}
+
+	const EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+
+	EGLint config_count = 0;
+	eglChooseConfig(m_display, config_attributes, &m_config, 1, &config_count);
+	if (config_count == 0)
+	{
+		// we never draw to an EGL surface so a context without a config is fine where it is supported
+		m_config = (EGLConfig)0;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	m_context = eglCreateContext(m_display, m_config, EGL_NO_CONTEXT, context_attributes);
+	if (m_context == EGL_NO_CONTEXT)
+	{
+		printf("ERROR::HEADLESS_CONTEXT:: eglCreateContext failed (0x%x)\n", eglGetError());
+		return false;
+	}
+
+	if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+	{
+		printf("ERROR::HEADLESS_CONTEXT:: eglMakeCurrent failed (0x%x)\n", eglGetError());
+		return false;
+	}
+
+	return true;
+}
+
+#endif
+
+void Headless_Context::create_framebuffer()
+{
+	glGenFramebuffers(1, &m_framebuffer_object);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer_object);
+
+		glGenTextures(1, &m_color_texture);
+		glBindTexture(GL_TEXTURE_2D, m_color_texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color_texture, 0);
+
+		glGenRenderbuffers(1, &m_depth_renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_depth_renderbuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth_renderbuffer);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
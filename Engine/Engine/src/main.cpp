@@ -11,18 +11,19 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "asset_pack.h"
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "scene.h"
+#include "gpu_timer.h"
+#include "profiler.h"
 
 //	Forward Declarations ------------------------------------------------------------------
 void process_input(GLFWwindow *window);
 void mouse_callback(GLFWwindow* window, double x_pos, double y_pos);
 void scroll_callback(GLFWwindow* window, double x_offset, double y_offset);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-unsigned int load_texture(char const * path, bool gamma_correction);
-unsigned int load_cubemap(std::vector<std::string> faces);
-void render_scene(Shader shader, unsigned int quad_vao, unsigned int cube_vao);
 
 //	Settings ------------------------------------------------------------------
 const unsigned int screen_width = 1280;
@@ -42,10 +43,17 @@ bool first_mouse = true;
 
 //	Post-processing ---------------------------------------------------------
 int effect = 0;
+bool shadows = true;	// 3 and 4 switch the lit pass between its shadowed and unshadowed shader variant
+
+//	Profiling ---------------------------------------------------------------
+const char *trace_path = "trace.json";	// written when a capture started with P is stopped
+bool profile_key_down = false;
 
 
 int main()
 {
+	PROFILE_THREAD("main");
+
 	// --------------------------------------------------------------------------
 	//	window configuration ----------------------------------------------------
 	// --------------------------------------------------------------------------
@@ -79,384 +87,24 @@ int main()
 		return -1;
 	}
 
-	stbi_set_flip_vertically_on_load(true);
-
-	// camera/view transformation
-	glm::mat4 view;
-	glm::mat4 projection;
-
-	// --------------------------------------------------------------------------
-	//	Shader Programs ---------------------------------------------------------
-	// --------------------------------------------------------------------------
-
-	Shader simple_shader("shaders/simple.vs", "shaders/simple.fs");
-	Shader post_processing_shader("shaders/simple.vs", "shaders/kernel.fs");
-	Shader skybox_shader("shaders/skybox.vs", "shaders/skybox.fs");
-	Shader lamp_shader("shaders/lamp.vs", "shaders/lamp.fs");
-
-	// shadows (depth map debugging)
-	Shader cube_map_depth_shader("shaders/cube_map_depth.vs", "shaders/cube_map_depth.fs", "shaders/cube_map_depth.gs");
-	Shader point_shadows_shader("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs");
-
-	// --------------------------------------------------------------------------
-	//	vertex data -------------------------------------------------------------
-	// --------------------------------------------------------------------------
-
-	// vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
-	float simple_quad_vertices[] = {
-		// positions   // texCoords
-		-1.0f,  1.0f,  0.0f, 1.0f,
-		-1.0f, -1.0f,  0.0f, 0.0f,
-		1.0f, -1.0f,  1.0f, 0.0f,
-
-		-1.0f,  1.0f,  0.0f, 1.0f,
-		1.0f, -1.0f,  1.0f, 0.0f,
-		1.0f,  1.0f,  1.0f, 1.0f
-	};
-
-	float skybox_vertices[] = {
-		// positions          
-		-1.0f,  1.0f, -1.0f,
-		-1.0f, -1.0f, -1.0f,
-		1.0f, -1.0f, -1.0f,
-		1.0f, -1.0f, -1.0f,
-		1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-
-		-1.0f, -1.0f,  1.0f,
-		-1.0f, -1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f,
-
-		1.0f, -1.0f, -1.0f,
-		1.0f, -1.0f,  1.0f,
-		1.0f,  1.0f,  1.0f,
-		1.0f,  1.0f,  1.0f,
-		1.0f,  1.0f, -1.0f,
-		1.0f, -1.0f, -1.0f,
-
-		-1.0f, -1.0f,  1.0f,
-		-1.0f,  1.0f,  1.0f,
-		1.0f,  1.0f,  1.0f,
-		1.0f,  1.0f,  1.0f,
-		1.0f, -1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f,
-
-		-1.0f,  1.0f, -1.0f,
-		1.0f,  1.0f, -1.0f,
-		1.0f,  1.0f,  1.0f,
-		1.0f,  1.0f,  1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f,  1.0f, -1.0f,
-
-		-1.0f, -1.0f, -1.0f,
-		-1.0f, -1.0f,  1.0f,
-		1.0f, -1.0f, -1.0f,
-		1.0f, -1.0f, -1.0f,
-		-1.0f, -1.0f,  1.0f,
-		1.0f, -1.0f,  1.0f
-	};
-
-	std::vector<std::string> skybox_faces_filepaths = {
-		"resources/textures/skybox/right.jpg",
-		"resources/textures/skybox/left.jpg",
-		"resources/textures/skybox/top.jpg",
-		"resources/textures/skybox/bottom.jpg",
-		"resources/textures/skybox/back.jpg",
-		"resources/textures/skybox/front.jpg"
-	};
-
-	// depth mapping
-	float plane_vertices[] = {
-		// positions            // normals         // texcoords
-		25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
-		-25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,   0.0f,  0.0f,
-		-25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
-
-		25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
-		-25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
-		25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,  25.0f, 25.0f
-	};
-
-	// cubes
-	float cube_vertices[] = {
-		// positions        // normals            // texels
-		// back face
-		-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-		1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-		1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
-		1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-		-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-		-1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
-		// front face
-		-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-		1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
-		1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-		1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-		-1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
-		-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-		// left face
-		-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-		-1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
-		-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-		-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-		-1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-		-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-		// right face
-		1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-		1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-		1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
-		1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-		1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-		1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
-		// bottom face
-		-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-		1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
-		1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-		1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-		-1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-		-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-		// top face
-		-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-		1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-		1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
-		1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-		-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-		-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
-	};
-
-	// lighting info
-	glm::vec3 light_pos(-2.0f, 4.0f, -1.0f);
-
-	// --------------------------------------------------------------------------
-	//	vertex array buffer configurations --------------------------------------
-	// --------------------------------------------------------------------------
-
-	// screen quad vao
-	unsigned int quad_vao, quad_vbo;
-
-	glGenVertexArrays(1, &quad_vao);
-	glGenBuffers(1, &quad_vbo);
-
-	glBindVertexArray(quad_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(simple_quad_vertices), &simple_quad_vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	// skybox vbo, vao, and vertices
-	unsigned int skybox_vao, skybox_vbo;
+	Texture_Registry::set_flip_on_load(true);
 
-	glGenVertexArrays(1, &skybox_vao);
-	glGenBuffers(1, &skybox_vbo);
-
-	glBindVertexArray(skybox_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, skybox_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skybox_vertices), &skybox_vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	// depth debug quad vao
-	unsigned int debug_quad_vao, debug_quad_vbo;
-
-	glGenVertexArrays(1, &debug_quad_vao);
-	glGenBuffers(1, &debug_quad_vbo);
-
-	glBindVertexArray(debug_quad_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, debug_quad_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(plane_vertices), &plane_vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
-	// cube vao
-	unsigned int cube_vao, cube_vbo;
-
-	glGenVertexArrays(1, &cube_vao);
-	glGenBuffers(1, &cube_vbo);
-
-	glBindVertexArray(cube_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, cube_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), &cube_vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
-	glBindVertexArray(0);
+	// reads the shaders and resources from the pack the asset_pack target builds when there is one, from the loose files otherwise.
+	// Debug builds also read the loose files edited since packing (Asset_Pack::s_check_sources), release builds need a repack
+	if (Asset_Pack::open("assets.pack", true))
+		printf("Reading the assets from assets.pack\n");
 
 	// --------------------------------------------------------------------------
-	//	Uniform Buffer Objects Configuration -----------------------------------------------
+	//	Scene -------------------------------------------------------------------
 	// --------------------------------------------------------------------------
-	
-	// first set the uniform block of the vertex shaders equal to the binding point (0)
-	unsigned int uniform_block_index_skybox = glGetUniformBlockIndex(skybox_shader.m_program_id, "matrices");
-	unsigned int uniform_block_index_shadows = glGetUniformBlockIndex(point_shadows_shader.m_program_id, "matrices");
-	unsigned int uniform_block_index_lamp = glGetUniformBlockIndex(lamp_shader.m_program_id, "matrices");
-
-	glUniformBlockBinding(skybox_shader.m_program_id, uniform_block_index_skybox, 0);
-	glUniformBlockBinding(point_shadows_shader.m_program_id, uniform_block_index_shadows, 0);
-	glUniformBlockBinding(lamp_shader.m_program_id, uniform_block_index_lamp, 0);
-	
-	// next create the actual uniform buffer object and bind the buffer to the binding point (0)
-	unsigned int ubo_matrices;
-	glGenBuffers(1, &ubo_matrices);
-
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
-	glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-	glBindBufferRange(GL_UNIFORM_BUFFER, 0, ubo_matrices, 0, 2 * sizeof(glm::mat4));
-
-	// now fill the buffer using glBufferSubData 
-	// which lets you insert/update certain parts of a buffer but the buffer needs to have enough allocated 
-	// memory which we have already done in the previous step
-	
-	// this is an example of how it works positioned next to the code that created the ubo so I can find it easily
-	// I still need to do this in each game loop
-	projection = glm::perspective(glm::radians(camera.m_zoom), (float)screen_width / (float)screen_height, 0.1f, 100.0f);
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-	view = camera.get_view_matrix();
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
-	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(projection));
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-	// --------------------------------------------------------------------------
-	//	load models -------------------------------------------------------------
-	// --------------------------------------------------------------------------
-
-
-	// --------------------------------------------------------------------------
-	//	load textures -----------------------------------------------------------
-	// --------------------------------------------------------------------------
+	// compiles the shader programs and creates the vertex data, textures and framebuffers of the point shadow scene
+	Scene *scene = new Scene(screen_width, screen_height, samples);
 
-	// not sure why these are don't need to be flipped but loading them unflipped fixes this quick issue
-	stbi_set_flip_vertically_on_load(false);
-	unsigned int skybox_texture = load_cubemap(skybox_faces_filepaths);
-	stbi_set_flip_vertically_on_load(true);
-	unsigned int wood_texture = load_texture("resources/textures/wood.png", false);
-	unsigned int wood_texture_gamma_corrected = load_texture("resources/textures/wood.png", true);
-
-	// --------------------------------------------------------------------------
-	//	framebuffer configuration -----------------------------------------------
-	// --------------------------------------------------------------------------
-
-	// depth map fbo
-	const unsigned int shadow_width = 1024, shadow_height = 1024;
-	unsigned int depth_map_fbo;
-	glGenFramebuffers(1, &depth_map_fbo);
-
-	// create depth cubemap texture
-	unsigned int depth_cube_map;
-	glGenTextures(1, &depth_cube_map);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, depth_cube_map);
-	for(int i = 0; i < 6; i++)
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, shadow_width, shadow_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	
-	// you need a border color for 2d shadow maps but not cubemaps
-	//float border_color[] = { 1.0, 1.0, 1.0, 1.0 };
-	//glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border_color);
-
-	//attach the depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depth_map_fbo);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_cube_map, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-
-	// configure MSAA frambuffer
-	unsigned int framebuffer_object;
-	glGenFramebuffers(1, &framebuffer_object);
-	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_object);
-
-		// create color buffer texture
-		unsigned int texture_color_buffer_multisampled;
-		glGenTextures(1, &texture_color_buffer_multisampled);
-		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture_color_buffer_multisampled);
-			glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, GL_RGB, screen_width, screen_height, GL_TRUE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
-		// attach the color buffer texture to the currently bound framebuffer object
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, texture_color_buffer_multisampled, 0);
-
-		// create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
-		unsigned int renderbuffer_object;
-		glGenRenderbuffers(1, &renderbuffer_object);
-		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer_object);
-			glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, screen_width, screen_height);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-		// attach the renderbuffer to the currently bound framebuffer object
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffer_object);
-		
-		// now check that the framebuffer object is complete and we can use it
-		// in order to be complete it needs the following
-		//	1. We have to attach at least one buffer (color, depth or stencil buffer).
-		//	2. There should be at least one color attachment.
-		//	3. All attachments should be complete as well(reserved memory).
-		//	4. Each buffer should have the same number of samples.
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-
-	// unbind the framebuffer to make sure we're not accidentally rendering to the wrong framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	//configure second post-processing framebuffer
-	unsigned int intermediate_framebuffer_object;
-	glGenFramebuffers(1, &intermediate_framebuffer_object);
-	glBindFramebuffer(GL_FRAMEBUFFER, intermediate_framebuffer_object);
-
-		//create a color attachment texture
-		unsigned int screen_texture;
-		glGenTextures(1, &screen_texture);
-		glBindTexture(GL_TEXTURE_2D, screen_texture);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screen_width, screen_height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screen_texture, 0); // we only need a color buffer here
-
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-	
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	glEnable(GL_MULTISAMPLE);
-
-	simple_shader.use();
-	simple_shader.set_int("screen_texture", 0);
-
-	post_processing_shader.use();
-	post_processing_shader.set_int("screen_texture", 0);
-
-	point_shadows_shader.use();
-	point_shadows_shader.set_int("diffuse_texture", 0);
-	point_shadows_shader.set_int("depth_cube_map", 1);
-
-	glEnable(GL_DEPTH_TEST);
+	// times every pass of the scene on the GPU without stalling, the results are printed to the console every few seconds
+	Gpu_Timer *gpu_timer = new Gpu_Timer();
+	gpu_timer->make_active();
+	float last_gpu_report = 0.0f;
 
 	// --------------------------------------------------------------------------
 	//	Main Loop ---------------------------------------------------------------
@@ -476,145 +124,29 @@ int main()
 		//	Draw Scene --------------------------------------------------------------
 		// --------------------------------------------------------------------------
 
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// 0. create depth cubemap transformation matrices
-		float near_plane = 1.0f;
-		float far_plane = 25.0f;
-		glm::mat4 shadow_projection = glm::perspective(glm::radians(90.0f), (float)shadow_width / (float)shadow_height, near_plane, far_plane);
-		std::vector<glm::mat4> shadow_transformations;
-
-		shadow_transformations.push_back(shadow_projection * glm::lookAt(light_pos, light_pos + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-		shadow_transformations.push_back(shadow_projection * glm::lookAt(light_pos, light_pos + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-		shadow_transformations.push_back(shadow_projection * glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
-		shadow_transformations.push_back(shadow_projection * glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-		shadow_transformations.push_back(shadow_projection * glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-		shadow_transformations.push_back(shadow_projection * glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-
-
-		// 1. render depth of scene to cubemap (from light's perspective )
-		glViewport(0, 0, shadow_width, shadow_height);
-		glBindFramebuffer(GL_FRAMEBUFFER, depth_map_fbo);
-			
-			glEnable(GL_DEPTH_TEST);
-
-			glClear(GL_DEPTH_BUFFER_BIT);
-			cube_map_depth_shader.use();
-
-			cube_map_depth_shader.set_float("far_plane", far_plane);
-			cube_map_depth_shader.set_vec3("light_position", light_pos);
-			for (int i = 0; i < 6; i++)
-				cube_map_depth_shader.set_mat4("shadow_matrices[" + std::to_string(i) + "]", shadow_transformations[i]);
-
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, wood_texture);
-
-			render_scene(cube_map_depth_shader, debug_quad_vao, cube_vao);
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// reset viewport 
-		glViewport(0, 0, screen_width, screen_height);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// 2. render scene to normal framebuffer
-
-		// bind to framebuffer and draw scene using the generated depth/shadow map
-		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_object);
-
-			glEnable(GL_DEPTH_TEST);
-			glDepthFunc(GL_LESS);
-
-			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-			// update the projection and view matrices inside the uniform block
-			projection = glm::perspective(glm::radians(camera.m_zoom), (float)screen_width / (float)screen_height, 0.1f, 1000.0f);
-			glBindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
-			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-			glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-			view = camera.get_view_matrix();
-			glBindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
-			glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-			glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-			point_shadows_shader.use();
-			point_shadows_shader.set_vec3("view_position", camera.m_position);
-			point_shadows_shader.set_vec3("light_position", light_pos);
-			point_shadows_shader.set_bool("shadows", true);
-			point_shadows_shader.set_float("far_plane", far_plane);
-
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, wood_texture);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, depth_cube_map);
-
-			render_scene(point_shadows_shader, debug_quad_vao, cube_vao);
-
-			lamp_shader.use();
-			glm::mat4 model = glm::mat4();
-			model = glm::translate(model, light_pos);
-			model = glm::scale(model, glm::vec3(0.25f));
-			lamp_shader.set_mat4("model", model);
-			glBindVertexArray(cube_vao);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-			glBindVertexArray(0);
-			
-			/*
-			glDepthFunc(GL_LEQUAL);
-			skybox_shader.use();
-			glm::mat4 view_no_translation = glm::mat4(glm::mat3(camera.get_view_matrix()));
-			skybox_shader.set_mat4("view_no_translation", view_no_translation);
-			glBindVertexArray(skybox_vao);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_texture);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-			glDepthFunc(GL_LESS);
-			*/
-			
-
-		// --------------------------------------------------------------------------
-		//	Finished Drawing "Scene" ------------------------------------------------
-		// --------------------------------------------------------------------------
-
-		// after drawing scene blit multisampled buffers to normal colorbuffer of intermediate fbo
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_object);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, intermediate_framebuffer_object);
-		glBlitFramebuffer(0, 0, screen_width, screen_height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-
-		// next render qaud with the scene's visuals as it's texture image
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
-		glDisable(GL_DEPTH_TEST);
+		PROFILE_FRAME();
+		PROFILE_COUNTER("delta_time_ms", delta_time * 1000.0f);
+		gpu_timer->begin_frame();
+		scene->m_effect = effect;
+		scene->m_shadows = shadows;
+		scene->render(camera, current_time, 0);
 
-		switch (effect)
+		if (current_time - last_gpu_report > 5.0f)
 		{
-		case 0:
-			simple_shader.use();
-			break;
-		case 1:
-			post_processing_shader.use();
-			break;
+			gpu_timer->print();
+			gpu_timer->reset();
+			last_gpu_report = current_time;
 		}
 
-		glBindVertexArray(quad_vao);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, screen_texture);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
 		// END OF DRAW SAWP BUFFERS
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
-	// optional: de-allocate all resources once they've outlived their purpose:
-	// ------------------------------------------------------------------------
-	glDeleteVertexArrays(1, &quad_vao);
-	glDeleteBuffers(1, &quad_vbo);
-
-	glDeleteFramebuffers(1, &framebuffer_object);
+	// de-allocate all the scene's resources while the context is still alive
+	delete gpu_timer;
+	delete scene;
+	Asset_Pack::close();
 
 	glfwTerminate();
 	return 0;
@@ -637,6 +169,20 @@ void process_input(GLFWwindow *window)
 		effect = 0;
 	if (glfwGetKey(window, GLFW_KEY_2))
 		effect = 1;
+	if (glfwGetKey(window, GLFW_KEY_3))
+		shadows = true;
+	if (glfwGetKey(window, GLFW_KEY_4))
+		shadows = false;
+
+	// P starts a CPU profile capture and pressing it again writes it out as a Chrome trace
+	bool profile_key = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+	if (profile_key && !profile_key_down)
+	{
+		Profiler::set_enabled(!Profiler::is_enabled());
+		if (!Profiler::is_enabled() && Profiler::write_chrome_trace(trace_path))
+			printf("profile written to %s\n", trace_path);
+	}
+	profile_key_down = profile_key;
 }
 
 void mouse_callback(GLFWwindow* window, double x_pos, double y_pos)
@@ -668,119 +214,3 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	// height will be significantly larger than specified on retina displays.
 	glViewport(0, 0, width, height);
 }
-
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int load_texture(char const * path, bool gamma_correction)
-{
-	unsigned int texture_id;
-	glGenTextures(1, &texture_id);
-
-	int width, height, nr_components;
-	unsigned char *data = stbi_load(path, &width, &height, &nr_components, 0);
-	if (data)
-	{
-		GLenum internal_format, data_format;
-		if (nr_components == 1)
-			internal_format = data_format = GL_RED;
-		else if (nr_components == 3)
-		{
-			internal_format = (gamma_correction ? GL_SRGB : GL_RGB);
-			data_format = GL_RGB;
-		}
-		else if (nr_components == 4)
-		{
-			internal_format = (gamma_correction ? GL_SRGB_ALPHA : GL_RGBA);
-			data_format = GL_RGBA;
-		}
-
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, data_format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, data_format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, data_format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return texture_id;
-}
-
-unsigned int load_cubemap(std::vector<std::string> faces)
-{
-	unsigned int texture_id;
-	glGenTextures(1, &texture_id);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
-
-	int width, height, nr_channels;
-	for (int i = 0; i < faces.size(); i++)
-	{
-		unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nr_channels, 0);
-		if (data)
-		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		}
-		else
-		{
-			printf("Cubemap texture failed to load at filepath: %s\n", faces[i]);
-			stbi_image_free(data);
-		}
-	}
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	return texture_id;
-}
-
-void render_scene(Shader shader, unsigned int quad_vao, unsigned int cube_vao)
-{
-	// room
-	glm::mat4 model;
-	model = glm::scale(model, glm::vec3(5.0f));
-	shader.set_mat4("model", model);
-	glDisable(GL_CULL_FACE);
-	shader.set_bool("reverse_normals", 1);
-	glBindVertexArray(cube_vao);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-	shader.set_bool("reverse_normals", 0);
-	glEnable(GL_CULL_FACE);
-	// cubes
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0f));
-	model = glm::scale(model, glm::vec3((sin(current_time) + 1.0) / 2.0));
-	shader.set_mat4("model", model);
-	glBindVertexArray(cube_vao);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
-	model = glm::scale(model, glm::vec3(0.5f));
-	shader.set_mat4("model", model);
-	glBindVertexArray(cube_vao);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
-	model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)));
-	model = glm::scale(model, glm::vec3(0.25f));
-	shader.set_mat4("model", model);
-	glBindVertexArray(cube_vao);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-}
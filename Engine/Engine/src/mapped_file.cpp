@@ -0,0 +1,128 @@
+#include <stdio.h>
+
+#include <string>
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+Mapped_File::Mapped_File(const char *filepath)
+	: m_data(NULL), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(NULL)
+{
+	m_file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+		return;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!m_mapping)
+		return;
+
+	m_data = (const unsigned char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data)
+		m_size = (size_t)size.QuadPart;
+}
+
+Mapped_File::~Mapped_File()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+}
+
+void Mapped_File::prefetch() const
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	volatile unsigned char sum = 0;
+	for (size_t offset = 0; offset < m_size; offset += info.dwPageSize)
+		sum += m_data[offset];
+}
+
+bool replace_file(const char *temporary_path, const char *path)
+{
+	// rename doesn't replace an existing file on Windows, and removing it first would leave a moment with no file at all
+	if (MoveFileExA(temporary_path, path, MOVEFILE_REPLACE_EXISTING))
+		return true;
+	remove(temporary_path);
+	return false;
+}
+
+#else
+
+Mapped_File::Mapped_File(const char *filepath)
+	: m_data(NULL), m_size(0)
+{
+	int file = open(filepath, O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			m_data = (const unsigned char *)data;
+			m_size = info.st_size;
+		}
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	close(file);
+}
+
+Mapped_File::~Mapped_File()
+{
+	if (m_data)
+		munmap((void *)m_data, m_size);
+}
+
+void Mapped_File::prefetch() const
+{
+	if (m_data)
+		madvise((void *)m_data, m_size, MADV_WILLNEED);
+}
+
+bool replace_file(const char *temporary_path, const char *path)
+{
+	if (rename(temporary_path, path) == 0)
+		return true;
+	remove(temporary_path);
+	return false;
+}
+
+#endif
+
+bool write_file_replacing(const char *path, const void *data, size_t size)
+{
+	std::string temporary_path = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary_path.c_str(), "wb");
+	if (!file)
+		return false;
+	bool written = fwrite(data, 1, size, file) == size;
+	written = fclose(file) == 0 && written;
+	if (!written)
+	{
+		remove(temporary_path.c_str());
+		return false;
+	}
+	return replace_file(temporary_path.c_str(), path);
+}
@@ -1,108 +1,323 @@
+#include <math.h>
+#include <string>
+#include <utility>
+
+#include <glm/gtc/packing.hpp>
+
 #include "mesh.h"
+#include "geometry_arena.h"
+#include "gpu_timer.h"
+#include "meshlet.h"
+#include "profiler.h"
+
+// the decode uniforms of the quantized layout, hashed at compile time
+static constexpr Uniform_Name position_offset_uniform("mesh_position_offset");
+static constexpr Uniform_Name position_scale_uniform("mesh_position_scale");
+static constexpr Uniform_Name octahedral_normals_uniform("mesh_octahedral_normals");
 
-Mesh::Mesh(std::vector<vertex> vertices, std::vector<unsigned int> indices, std::vector<texture> textures)
+void vertex_bounds(Span<vertex> vertices, glm::vec3 &bounds_min, glm::vec3 &bounds_max)
 {
-	m_vertices = vertices;
-	m_indices = indices;
-	m_textures = textures;
+	bounds_min = glm::vec3(0.0f);
+	bounds_max = glm::vec3(0.0f);
+	if (vertices.empty())
+		return;
 
-	setup_mesh();
+	bounds_min = bounds_max = vertices[0].position;
+	for (int i = 1; i < vertices.size(); i++)
+	{
+		bounds_min = glm::min(bounds_min, vertices[i].position);
+		bounds_max = glm::max(bounds_max, vertices[i].position);
+	}
 }
 
-void Mesh::draw(Shader shader, bool use_textures)
+quantized_vertex quantize_vertex(const vertex &v, glm::vec3 bounds_min, glm::vec3 bounds_max)
 {
-	if (use_textures)
+	quantized_vertex q;
+	glm::vec3 extent = bounds_max - bounds_min;
+	for (int i = 0; i < 3; i++)
+		q.position[i] = glm::packUnorm1x16(extent[i] > 0.0f ? (v.position[i] - bounds_min[i]) / extent[i] : 0.0f);
+	q.position[3] = 0;
+
+	// the normal is projected onto the octahedron |x| + |y| + |z| = 1, the lower half is folded over the diagonals
+	glm::vec3 n = v.normal;
+	float length = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	glm::vec2 octahedral = length > 0.0f ? glm::vec2(n.x, n.y) / length : glm::vec2(0.0f);
+	if (length > 0.0f && n.z < 0.0f)
+	{
+		octahedral = glm::vec2((1.0f - fabsf(octahedral.y)) * (octahedral.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - fabsf(octahedral.x)) * (octahedral.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	q.normal[0] = (short)glm::packSnorm1x16(octahedral.x);
+	q.normal[1] = (short)glm::packSnorm1x16(octahedral.y);
+
+	q.texture_coordinates[0] = glm::packHalf1x16(v.texture_coordinates.x);
+	q.texture_coordinates[1] = glm::packHalf1x16(v.texture_coordinates.y);
+	return q;
+}
+
+Mesh::Mesh(std::vector<vertex> &&vertices, std::vector<unsigned int> &&indices, std::vector<texture> &&textures, Vertex_Format format, Mesh_Residency residency)
+	: m_vertices(std::move(vertices)), m_indices(std::move(indices)), m_textures(std::move(textures)), m_lod(0), m_format(format), m_residency(residency)
+{
+	vertex_bounds(m_vertices, m_bounds_min, m_bounds_max);
+	setup_texture_uniforms();
+	setup_mesh(m_vertices, m_indices);
+}
+
+Mesh::Mesh(Mesh_Data &&data, Vertex_Format format, Mesh_Residency residency)
+	: m_vertices(std::move(data.vertices)), m_indices(std::move(data.indices)), m_textures(std::move(data.textures)),
+	m_lods(std::move(data.lods)), m_lod(0), m_bounds_min(data.bounds_min), m_bounds_max(data.bounds_max), m_format(format), m_residency(residency)
+{
+	setup_texture_uniforms();
+	setup_mesh(m_vertices, m_indices);
+}
+
+Mesh::Mesh(Span<vertex> vertices, Span<unsigned int> indices, std::vector<texture> &&textures, glm::vec3 bounds_min, glm::vec3 bounds_max, Span<Mesh_Lod> lods,
+	Vertex_Format format, Mesh_Residency residency)
+	: m_textures(std::move(textures)), m_lods(lods.begin(), lods.end()), m_lod(0), m_bounds_min(bounds_min), m_bounds_max(bounds_max), m_format(format), m_residency(residency)
+{
+	setup_texture_uniforms();
+	setup_mesh(vertices, indices);
+}
+
+Mesh::Mesh(Mesh &&other)
+	: m_vertices(std::move(other.m_vertices)), m_indices(std::move(other.m_indices)), m_textures(std::move(other.m_textures)),
+	m_vertex_count(other.m_vertex_count), m_index_count(other.m_index_count), m_lods(std::move(other.m_lods)), m_lod(other.m_lod), m_bounds_min(other.m_bounds_min), m_bounds_max(other.m_bounds_max),
+	m_format(other.m_format), m_index_type(other.m_index_type), m_residency(other.m_residency),
+	m_meshlets(other.m_meshlets), m_texture_uniforms(std::move(other.m_texture_uniforms)), m_range(other.m_range)
+{
+	other.m_vertex_count = 0;
+	other.m_index_count = 0;
+	other.m_meshlets = NULL;
+	other.m_range = NULL;
+}
+
+Mesh &Mesh::operator=(Mesh &&other)
+{
+	// swapping hands this mesh's old range and meshlets to other, which deletes them when it is destroyed
+	std::swap(m_vertices, other.m_vertices);
+	std::swap(m_indices, other.m_indices);
+	std::swap(m_textures, other.m_textures);
+	std::swap(m_vertex_count, other.m_vertex_count);
+	std::swap(m_index_count, other.m_index_count);
+	std::swap(m_lods, other.m_lods);
+	std::swap(m_lod, other.m_lod);
+	std::swap(m_bounds_min, other.m_bounds_min);
+	std::swap(m_bounds_max, other.m_bounds_max);
+	std::swap(m_format, other.m_format);
+	std::swap(m_index_type, other.m_index_type);
+	std::swap(m_residency, other.m_residency);
+	std::swap(m_meshlets, other.m_meshlets);
+	std::swap(m_texture_uniforms, other.m_texture_uniforms);
+	std::swap(m_range, other.m_range);
+	return *this;
+}
+
+Mesh::~Mesh()
+{
+	// moved from meshes don't own a range
+	Geometry_Arena::release(m_range);
+	delete m_meshlets;
+}
+
+unsigned int Mesh::get_vao() const
+{
+	return m_range ? m_range->vao : 0;
+}
+
+void Mesh::setup_texture_uniforms()
+{
+	int diffuse_num = 1;
+	int specular_num = 1;
+	int emission_num = 1;
+	int normal_num = 1;
+	int height_num = 1;
+	int reflection_num = 1;
+
+	m_texture_uniforms.reserve(m_textures.size());
+	for (int i = 0; i < m_textures.size(); i++)
 	{
-		int diffuse_num = 1;
-		int specular_num = 1;
-		int emission_num = 1;
-		int normal_num = 1;
-		int height_num = 1;
-		int reflection_num = 1;
+		std::string name;
+
+		switch (m_textures[i].type)
+		{
+		case DIFFUSE_MAP:
+			name = "diffuse_map" + std::to_string(diffuse_num++);
+			break;
+		case SPECULAR_MAP:
+			name = "specular_map" + std::to_string(specular_num++);
+			break;
+		case EMISSION_MAP:
+			name = "emission_map" + std::to_string(emission_num++);
+			break;
+		case NORMAL_MAP:
+			name = "normal_map" + std::to_string(normal_num++);
+			break;
+		case HEIGHT_MAP:
+			name = "height_map" + std::to_string(height_num++);
+			break;
+		case REFLECTION_MAP:
+			name = "reflection_map" + std::to_string(reflection_num++);
+			break;
+		}
+
+		m_texture_uniforms.push_back(Uniform_Name("material." + name));
+	}
+}
+
+void Mesh::draw(const Shader &shader, bool use_textures) const
+{
+	unsigned int bound_vao = 0;
+	draw(shader, use_textures, bound_vao);
+	glBindVertexArray(0);
+}
+
+void Mesh::draw(const Shader &shader, bool use_textures, unsigned int &bound_vao) const
+{
+	PROFILE_ZONE("Mesh::draw");
+
+	// every meshlet of the level was culled
+	bool culled = m_meshlets && m_meshlets->draw_lod == m_lod;
+	if (culled && m_meshlets->draw_first.empty())
+		return;
 
+	if (use_textures)
+	{
 		for (int i = 0; i < m_textures.size(); i++)
 		{
 			glActiveTexture(GL_TEXTURE0 + i);
-
-			std::string name;
-
-			switch (m_textures[i].type)
-			{
-			case DIFFUSE_MAP:
-				name = "diffuse_map" + diffuse_num++;
-				break;
-			case SPECULAR_MAP:
-				name = "specular_map" + specular_num++;
-				break;
-			case EMISSION_MAP:
-				name = "emission_map" + emission_num++;
-				break;
-			case NORMAL_MAP:
-				name = "normal_map" + normal_num++;
-				break;
-			case HEIGHT_MAP:
-				name = "height_map" + height_num++;
-				break;
-			case REFLECTION_MAP:
-				name = "reflection_map" + reflection_num++;
-				break;
-			}
-
-			shader.set_float("material." + name, i);
+			shader.set_int(m_texture_uniforms[i], i);
 			glBindTexture(GL_TEXTURE_2D, m_textures[i].id);
 		}
 
 		glActiveTexture(GL_TEXTURE0);
 	}
 
-	// draw mesh
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
-}
+	// the shaders decode the positions as mesh_position_offset + position * mesh_position_scale
+	if (m_format == VERTEX_QUANTIZED)
+	{
+		shader.set_vec3(position_offset_uniform, m_bounds_min);
+		shader.set_vec3(position_scale_uniform, m_bounds_max - m_bounds_min);
+		shader.set_bool(octahedral_normals_uniform, true);
+	}
 
-void Mesh::setup_mesh()
-{
-	// create the buffers
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ebo);
+	shader.flush();
+
+	// draw the visible meshlets of the picked level of detail, or all of it if they weren't culled for it
+	if (culled)
+	{
+		Gpu_Timer::begin_draw(m_meshlets->draw_indices);
+		Geometry_Arena::draw(m_range, m_meshlets->draw_first.data(), m_meshlets->draw_count.data(), (unsigned int)m_meshlets->draw_first.size(), bound_vao);
+	}
+	else
+	{
+		const Mesh_Lod &lod = m_lods[m_lod];
+		Gpu_Timer::begin_draw(lod.index_count);
+		Geometry_Arena::draw(m_range, lod.first_index, lod.index_count, bound_vao);
+	}
+	Gpu_Timer::end_draw();
 
-	// we are now using vao
-	glBindVertexArray(vao);
+	// back to the float layout for whatever else the shader draws
+	if (m_format == VERTEX_QUANTIZED)
+	{
+		shader.set_vec3(position_offset_uniform, glm::vec3(0.0f));
+		shader.set_vec3(position_scale_uniform, glm::vec3(1.0f));
+		shader.set_bool(octahedral_normals_uniform, false);
+	}
+}
 
-	/////////// load data into vertex buffers
+bool Mesh::select_lod(float pixels_per_unit, float threshold, float hysteresis)
+{
+	unsigned int lod = 0;
+	while (lod + 1 < m_lods.size() && m_lods[lod + 1].error * pixels_per_unit <= threshold)
+		lod++;
 
-	/////////// we are now using this vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	/////////// load the vertices into vbo
-	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(vertex), &m_vertices[0], GL_STATIC_DRAW);
+	// coarser only with some margin, finer right away
+	while (lod > m_lod && m_lods[lod].error * pixels_per_unit > threshold * (1.0f - hysteresis))
+		lod--;
 
-	/////////// we are now using this ebo
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	/////////// load the indices into the ebo
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
+	bool changed = lod != m_lod;
+	m_lod = lod;
+	return changed;
+}
 
-	/////////// end of loading data
+size_t Mesh::buffer_bytes() const
+{
+	size_t vertex_size = m_format == VERTEX_QUANTIZED ? sizeof(quantized_vertex) : sizeof(vertex);
+	size_t index_size = m_index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	return (size_t)m_vertex_count * vertex_size + (size_t)m_index_count * index_size;
+}
 
+void Mesh::setup_mesh(Span<vertex> vertices, Span<unsigned int> indices)
+{
+	m_vertex_count = vertices.size();
+	m_index_count = indices.size();
+	m_index_type = GL_UNSIGNED_INT;
+	if (m_lods.empty())
+	{
+		Mesh_Lod full;
+		full.first_index = 0;
+		full.index_count = m_index_count;
+		full.error = 0.0f;
+		m_lods.push_back(full);
+	}
 
+	// the quantized copies only live until they are copied into the arena
+	std::vector<quantized_vertex> quantized_vertices;
+	std::vector<unsigned short> short_indices;
+	const void *vertex_data = vertices.data();
+	const void *index_data = indices.data();
+	if (m_format == VERTEX_QUANTIZED)
+	{
+		PROFILE_ZONE("Mesh::quantize");
+		quantized_vertices.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+			quantized_vertices[i] = quantize_vertex(vertices[i], m_bounds_min, m_bounds_max);
+		vertex_data = quantized_vertices.data();
 
-	/////////// set the vertex attribute pointers
+		if (vertices.size() <= 65536)
+		{
+			short_indices.assign(indices.begin(), indices.end());
+			index_data = short_indices.data();
+			m_index_type = GL_UNSIGNED_SHORT;
+		}
+	}
 
-	/////////// vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)0);
+	m_meshlets = m_index_count ? build_meshlets(vertices, indices, m_lods) : NULL;
+	m_range = Geometry_Arena::allocate(m_format, vertex_data, m_vertex_count, index_data, m_index_count, m_index_type);
 
-	/////////// vertex normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, normal));
+	// the spans may point into a mapped cache that goes away, a mesh that keeps its data copies it
+	if (m_residency == RESIDENCY_KEEP && m_vertices.empty())
+	{
+		m_vertices.assign(vertices.begin(), vertices.end());
+		m_indices.assign(indices.begin(), indices.end());
+	}
+	page_out();
+}
 
-	/////////// vertex texture coordinates
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, texture_coordinates));
+void Mesh::page_in(std::vector<vertex> &&vertices, std::vector<unsigned int> &&indices)
+{
+	m_vertices = std::move(vertices);
+	m_indices = std::move(indices);
+}
 
-	/////////// end of vertex attribute pointers
+void Mesh::page_out()
+{
+	// swapping with empty vectors frees the memory, clear would keep the capacity
+	if (m_residency == RESIDENCY_KEEP)
+		return;
+	std::vector<vertex>().swap(m_vertices);
+	std::vector<unsigned int>().swap(m_indices);
+}
 
-	// we are no longer using vao
-	glBindVertexArray(0);
+Memory_Usage Mesh::memory_usage() const
+{
+	Memory_Usage usage(sizeof(Mesh), buffer_bytes());
+	usage.cpu_bytes += m_vertices.capacity() * sizeof(vertex) + m_indices.capacity() * sizeof(unsigned int);
+	usage.cpu_bytes += m_textures.capacity() * sizeof(texture) + m_lods.capacity() * sizeof(Mesh_Lod);
+	usage.cpu_bytes += m_texture_uniforms.capacity() * sizeof(Uniform_Name);
+	if (m_meshlets)
+		usage.cpu_bytes += m_meshlets->cpu_bytes();
+	if (m_range)
+		usage.cpu_bytes += sizeof(Geometry_Range);
+	return usage;
 }
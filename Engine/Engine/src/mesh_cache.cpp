@@ -0,0 +1,395 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "mesh_cache.h"
+#include "asset_pack.h"
+#include "compression.h"
+#include "mapped_file.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+
+bool Mesh_Cache::s_enabled = true;
+bool Mesh_Cache::s_compress = false;
+
+//	File format ----------------------------------------------------------------
+//	header | mesh records | texture records | dependency records | texture and dependency path strings | vertex and index streams (each 16 byte aligned)
+//	everything is little endian and written in the engine's own layout, bump cache_version when any of it changes
+
+static const char cache_magic[8] = { 'E', 'M', 'S', 'H', 'C', 'A', 'C', 'H' };
+static const uint32_t cache_version = 4;		// 4: the files the import read besides the source are recorded
+static const uint32_t compressed_flag = 1;
+static const uint32_t optimized_flag = 2;
+static const size_t stream_alignment = 16;
+
+struct Cache_Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;				/**< compressed_flag if the streams are compressed, optimized_flag if the meshes went through the Mesh_Optimizer */
+	uint64_t source_size;		/**< size of the source model when the cache was built */
+	int64_t source_mtime;		/**< modification time of the source model when the cache was built */
+	uint32_t import_flags;		/**< the Assimp post processing flags */
+	uint32_t vertex_size;		/**< sizeof(vertex) */
+	uint32_t lod_count;			/**< Mesh_Simplifier::s_lod_count the levels of detail were built with */
+	float lod_ratio;			/**< Mesh_Simplifier::s_lod_ratio the levels of detail were built with */
+	uint32_t mesh_count;
+	uint32_t texture_count;
+	uint32_t dependency_count;
+	uint32_t padding;
+	uint64_t meshes_offset;
+	uint64_t textures_offset;
+	uint64_t dependencies_offset;
+	uint64_t strings_offset;
+	uint64_t strings_size;
+	uint64_t file_size;
+};
+
+struct Cache_Mesh_Record
+{
+	uint64_t vertex_offset;
+	uint64_t vertex_stored_size;	/**< size of the vertex stream in the file, smaller than vertex_count * vertex_size when compressed */
+	uint64_t index_offset;
+	uint64_t index_stored_size;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t texture_first;
+	uint32_t texture_count;
+	float bounds[6];				/**< min xyz, max xyz */
+	uint32_t lod_count;				/**< levels of detail in the index stream, the full detail one included */
+	Mesh_Lod lods[max_lod_count];	/**< the first lod_count are used */
+};
+
+struct Cache_Texture_Record
+{
+	uint32_t type;
+	uint32_t path_offset;			/**< offset of the nul terminated path in the strings */
+};
+
+struct Cache_Dependency_Record
+{
+	uint64_t source_size;			/**< size of the file when the cache was built */
+	int64_t source_mtime;			/**< modification time of the file when the cache was built */
+	uint32_t path_offset;			/**< offset of the nul terminated path in the strings */
+	uint32_t padding;
+};
+
+static size_t align_up(size_t value)
+{
+	return (value + stream_alignment - 1) & ~(stream_alignment - 1);
+}
+
+static const Cache_Header *header_of(const Mapped_File &file)
+{
+	return (const Cache_Header *)file.data();
+}
+
+static const Cache_Mesh_Record *mesh_records_of(const Mapped_File &file)
+{
+	return (const Cache_Mesh_Record *)(file.data() + header_of(file)->meshes_offset);
+}
+
+static const Cache_Texture_Record *texture_records_of(const Mapped_File &file)
+{
+	return (const Cache_Texture_Record *)(file.data() + header_of(file)->textures_offset);
+}
+
+static const Cache_Dependency_Record *dependency_records_of(const Mapped_File &file)
+{
+	return (const Cache_Dependency_Record *)(file.data() + header_of(file)->dependencies_offset);
+}
+
+//	Reading --------------------------------------------------------------------
+
+Mesh_Cache::Mesh_Cache(const std::string &source_path, unsigned int import_flags)
+	: m_file(cache_path(source_path).c_str())
+{
+	m_valid = m_file.is_valid() && validate(source_path, import_flags);
+}
+
+bool Mesh_Cache::validate(const std::string &source_path, unsigned int import_flags)
+{
+	uint64_t source_size;
+	int64_t source_mtime;
+	if (!Asset_Pack::source_info(source_path, source_size, source_mtime))
+		return false;
+
+	size_t size = m_file.size();
+	if (size < sizeof(Cache_Header))
+		return false;
+
+	const Cache_Header *header = header_of(m_file);
+	if (memcmp(header->magic, cache_magic, sizeof(cache_magic)) != 0 || header->version != cache_version)
+		return false;
+
+	// the source changed, or was imported differently, since the cache was built
+	if (header->source_size != source_size || header->source_mtime != source_mtime
+		|| header->import_flags != import_flags || header->vertex_size != sizeof(vertex) || header->file_size != size
+		|| ((header->flags & optimized_flag) != 0) != Mesh_Optimizer::s_enabled
+		|| header->lod_count != Mesh_Simplifier::s_lod_count || header->lod_ratio != Mesh_Simplifier::s_lod_ratio)
+		return false;
+
+	if (header->meshes_offset > size || header->mesh_count > (size - header->meshes_offset) / sizeof(Cache_Mesh_Record)
+		|| header->textures_offset > size || header->texture_count > (size - header->textures_offset) / sizeof(Cache_Texture_Record)
+		|| header->dependencies_offset > size || header->dependency_count > (size - header->dependencies_offset) / sizeof(Cache_Dependency_Record)
+		|| header->strings_offset > size || header->strings_size > size - header->strings_offset
+		|| header->meshes_offset % stream_alignment != 0 || header->textures_offset % stream_alignment != 0
+		|| header->dependencies_offset % sizeof(uint64_t) != 0)
+		return false;
+
+	// the strings have to end with a terminator so no path can run past them
+	if ((header->texture_count || header->dependency_count)
+		&& (header->strings_size == 0 || m_file.data()[header->strings_offset + header->strings_size - 1] != '\0'))
+		return false;
+
+	// a file the import read besides the source, like an OBJ's material library, changed since the cache was built
+	const Cache_Dependency_Record *dependencies = dependency_records_of(m_file);
+	for (unsigned int i = 0; i < header->dependency_count; i++)
+	{
+		if (dependencies[i].path_offset >= header->strings_size)
+			return false;
+		uint64_t dependency_size;
+		int64_t dependency_mtime;
+		const char *path = (const char *)m_file.data() + header->strings_offset + dependencies[i].path_offset;
+		if (!Asset_Pack::source_info(path, dependency_size, dependency_mtime)
+			|| dependency_size != dependencies[i].source_size || dependency_mtime != dependencies[i].source_mtime)
+			return false;
+	}
+
+	const Cache_Texture_Record *textures = texture_records_of(m_file);
+	for (unsigned int i = 0; i < header->texture_count; i++)
+	{
+		if (textures[i].path_offset >= header->strings_size || textures[i].type > REFLECTION_MAP)
+			return false;
+	}
+
+	bool compressed = (header->flags & compressed_flag) != 0;
+	const Cache_Mesh_Record *meshes = mesh_records_of(m_file);
+	for (unsigned int i = 0; i < header->mesh_count; i++)
+	{
+		const Cache_Mesh_Record &mesh = meshes[i];
+		uint64_t vertex_size = (uint64_t)mesh.vertex_count * sizeof(vertex);
+		uint64_t index_size = (uint64_t)mesh.index_count * sizeof(unsigned int);
+
+		if (mesh.vertex_offset > size || mesh.vertex_stored_size > size - mesh.vertex_offset
+			|| mesh.index_offset > size || mesh.index_stored_size > size - mesh.index_offset
+			|| mesh.vertex_offset % stream_alignment != 0 || mesh.index_offset % stream_alignment != 0
+			|| mesh.texture_first > header->texture_count || mesh.texture_count > header->texture_count - mesh.texture_first)
+			return false;
+
+		if (!compressed && (mesh.vertex_stored_size != vertex_size || mesh.index_stored_size != index_size))
+			return false;
+
+		if (mesh.lod_count == 0 || mesh.lod_count > max_lod_count)
+			return false;
+		for (unsigned int j = 0; j < mesh.lod_count; j++)
+			if (mesh.lods[j].first_index > mesh.index_count || mesh.lods[j].index_count > mesh.index_count - mesh.lods[j].first_index)
+				return false;
+	}
+
+	return true;
+}
+
+unsigned int Mesh_Cache::mesh_count() const
+{
+	return m_valid ? header_of(m_file)->mesh_count : 0;
+}
+
+bool Mesh_Cache::read_mesh(unsigned int index, Cached_Mesh &mesh)
+{
+	const Cache_Mesh_Record &record = mesh_records_of(m_file)[index];
+
+	mesh.texture_first = record.texture_first;
+	mesh.texture_count = record.texture_count;
+	mesh.bounds_min = glm::vec3(record.bounds[0], record.bounds[1], record.bounds[2]);
+	mesh.bounds_max = glm::vec3(record.bounds[3], record.bounds[4], record.bounds[5]);
+	mesh.lods = Span<Mesh_Lod>(record.lods, record.lod_count);
+
+	const unsigned char *vertex_stream = m_file.data() + record.vertex_offset;
+	const unsigned char *index_stream = m_file.data() + record.index_offset;
+
+	if (!(header_of(m_file)->flags & compressed_flag))
+	{
+		// no copy at all, the pointers go straight to glBufferData
+		mesh.vertices = Span<vertex>((const vertex *)vertex_stream, record.vertex_count);
+		mesh.indices = Span<unsigned int>((const unsigned int *)index_stream, record.index_count);
+		return true;
+	}
+
+	size_t vertex_size = (size_t)record.vertex_count * sizeof(vertex);
+	size_t index_size = (size_t)record.index_count * sizeof(unsigned int);
+	size_t index_start = align_up(vertex_size);
+	m_scratch.resize(index_start + index_size);
+	m_shuffled.resize(vertex_size > index_size ? vertex_size : index_size);
+
+	// the streams were shuffled with a 4 byte stride (every member of vertex is a float) before being compressed
+	if (!lz_decompress(vertex_stream, record.vertex_stored_size, m_shuffled.data(), vertex_size))
+		return false;
+	unshuffle_bytes(m_shuffled.data(), vertex_size, 4, m_scratch.data());
+
+	if (!lz_decompress(index_stream, record.index_stored_size, m_shuffled.data(), index_size))
+		return false;
+	unshuffle_bytes(m_shuffled.data(), index_size, 4, m_scratch.data() + index_start);
+
+	mesh.vertices = Span<vertex>((const vertex *)m_scratch.data(), record.vertex_count);
+	mesh.indices = Span<unsigned int>((const unsigned int *)(m_scratch.data() + index_start), record.index_count);
+	return true;
+}
+
+const char *Mesh_Cache::texture_path(unsigned int index) const
+{
+	const Cache_Header *header = header_of(m_file);
+	return (const char *)m_file.data() + header->strings_offset + texture_records_of(m_file)[index].path_offset;
+}
+
+Texture_Type Mesh_Cache::texture_type(unsigned int index) const
+{
+	return (Texture_Type)texture_records_of(m_file)[index].type;
+}
+
+//	Writing --------------------------------------------------------------------
+
+std::string Mesh_Cache::cache_path(const std::string &source_path)
+{
+	return source_path + ".meshcache";
+}
+
+/**
+* @brief	appends a stream to the file contents at the next aligned offset, shuffled and compressed if asked to
+* @return	the offset of the stream, its stored size goes into stored_size
+*/
+static uint64_t append_stream(std::vector<unsigned char> &contents, const void *data, size_t size, bool compress, uint64_t &stored_size)
+{
+	contents.resize(align_up(contents.size()));
+	uint64_t offset = contents.size();
+
+	if (!compress)
+	{
+		const unsigned char *bytes = (const unsigned char *)data;
+		contents.insert(contents.end(), bytes, bytes + size);
+		stored_size = size;
+		return offset;
+	}
+
+	std::vector<unsigned char> shuffled(size);
+	std::vector<unsigned char> compressed;
+	if (size)
+		shuffle_bytes((const unsigned char *)data, size, 4, shuffled.data());
+	lz_compress(shuffled.data(), size, compressed);
+	contents.insert(contents.end(), compressed.begin(), compressed.end());
+	stored_size = compressed.size();
+	return offset;
+}
+
+bool Mesh_Cache::write(const std::string &source_path, unsigned int import_flags, const std::vector<std::string> &dependencies, const std::vector<Mesh_Data> &meshes)
+{
+	Cache_Header header;
+	memset(&header, 0, sizeof(header));
+	if (!Asset_Pack::source_info(source_path, header.source_size, header.source_mtime))
+	{
+		printf("ERROR::MESH_CACHE::SOURCE_NOT_FOUND %s\n", source_path.c_str());
+		return false;
+	}
+
+	memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = cache_version;
+	header.flags = (s_compress ? compressed_flag : 0) | (Mesh_Optimizer::s_enabled ? optimized_flag : 0);
+	header.import_flags = import_flags;
+	header.vertex_size = sizeof(vertex);
+	header.lod_count = Mesh_Simplifier::s_lod_count;
+	header.lod_ratio = Mesh_Simplifier::s_lod_ratio;
+	header.mesh_count = meshes.size();
+
+	std::vector<Cache_Mesh_Record> mesh_records(meshes.size());
+	std::vector<Cache_Texture_Record> texture_records;
+	std::vector<char> strings;
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		const Mesh_Data &mesh = meshes[i];
+		Cache_Mesh_Record &record = mesh_records[i];
+		memset(&record, 0, sizeof(record));
+		record.vertex_count = mesh.vertices.size();
+		record.index_count = mesh.indices.size();
+		record.texture_first = texture_records.size();
+		record.texture_count = mesh.textures.size();
+		record.bounds[0] = mesh.bounds_min.x;
+		record.bounds[1] = mesh.bounds_min.y;
+		record.bounds[2] = mesh.bounds_min.z;
+		record.bounds[3] = mesh.bounds_max.x;
+		record.bounds[4] = mesh.bounds_max.y;
+		record.bounds[5] = mesh.bounds_max.z;
+
+		// a mesh without levels of detail stores its indices as the one full detail level
+		record.lod_count = mesh.lods.empty() ? 1 : (uint32_t)mesh.lods.size();
+		record.lods[0].first_index = 0;
+		record.lods[0].index_count = record.index_count;
+		record.lods[0].error = 0.0f;
+		for (size_t j = 0; j < mesh.lods.size(); j++)
+			record.lods[j] = mesh.lods[j];
+
+		for (int j = 0; j < mesh.textures.size(); j++)
+		{
+			Cache_Texture_Record texture_record;
+			texture_record.type = mesh.textures[j].type;
+			texture_record.path_offset = strings.size();
+			texture_records.push_back(texture_record);
+
+			const char *path = mesh.textures[j].path.C_Str();
+			strings.insert(strings.end(), path, path + strlen(path) + 1);
+		}
+	}
+	header.texture_count = texture_records.size();
+
+	std::vector<Cache_Dependency_Record> dependency_records;
+	for (size_t i = 0; i < dependencies.size(); i++)
+	{
+		Cache_Dependency_Record record;
+		memset(&record, 0, sizeof(record));
+		if (dependencies[i] == source_path || !Asset_Pack::source_info(dependencies[i], record.source_size, record.source_mtime))
+			continue;
+		record.path_offset = strings.size();
+		dependency_records.push_back(record);
+		strings.insert(strings.end(), dependencies[i].c_str(), dependencies[i].c_str() + dependencies[i].size() + 1);
+	}
+	header.dependency_count = dependency_records.size();
+
+	// the tables come first so the streams can be appended after them
+	size_t meshes_size = mesh_records.size() * sizeof(Cache_Mesh_Record);
+	size_t textures_size = texture_records.size() * sizeof(Cache_Texture_Record);
+	size_t dependencies_size = dependency_records.size() * sizeof(Cache_Dependency_Record);
+	header.meshes_offset = align_up(sizeof(Cache_Header));
+	header.textures_offset = align_up(header.meshes_offset + meshes_size);
+	header.dependencies_offset = align_up(header.textures_offset + textures_size);
+	header.strings_offset = header.dependencies_offset + dependencies_size;
+	header.strings_size = strings.size();
+
+	std::vector<unsigned char> contents(header.strings_offset + strings.size(), 0);
+	if (!strings.empty())
+		memcpy(&contents[header.strings_offset], strings.data(), strings.size());
+
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		const Mesh_Data &mesh = meshes[i];
+		Cache_Mesh_Record &record = mesh_records[i];
+		record.vertex_offset = append_stream(contents, mesh.vertices.data(), mesh.vertices.size() * sizeof(vertex), s_compress, record.vertex_stored_size);
+		record.index_offset = append_stream(contents, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), s_compress, record.index_stored_size);
+	}
+
+	header.file_size = contents.size();
+	memcpy(&contents[0], &header, sizeof(header));
+	if (meshes_size)
+		memcpy(&contents[header.meshes_offset], mesh_records.data(), meshes_size);
+	if (textures_size)
+		memcpy(&contents[header.textures_offset], texture_records.data(), textures_size);
+	if (dependencies_size)
+		memcpy(&contents[header.dependencies_offset], dependency_records.data(), dependencies_size);
+
+	std::string path = cache_path(source_path);
+	if (!write_file_replacing(path.c_str(), contents.data(), contents.size()))
+	{
+		printf("ERROR::MESH_CACHE::FILE_NOT_WRITTEN %s\n", path.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,451 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include "mesh_optimizer.h"
+#include "hash.h"
+#include "profiler.h"
+
+bool Mesh_Optimizer::s_enabled = true;
+
+static std::mutex statistics_mutex;
+static Mesh_Optimizer_Statistics counters;
+static std::vector<Mesh_Optimization_Report> mesh_reports;
+
+Vertex_Cache_Analysis analyze_vertex_cache(Span<unsigned int> indices, unsigned int vertex_count, unsigned int cache_size)
+{
+	// a vertex is in the FIFO while fewer than cache_size misses happened since it was added
+	std::vector<unsigned int> timestamps(vertex_count, 0);
+	unsigned int time = cache_size + 1;
+	Vertex_Cache_Analysis analysis;
+	analysis.transformed = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int v = indices[i];
+		if (time - timestamps[v] > cache_size)
+		{
+			timestamps[v] = time++;
+			analysis.transformed++;
+		}
+	}
+
+	size_t triangles = indices.size() / 3;
+	analysis.acmr = triangles ? (float)analysis.transformed / triangles : 0.0f;
+	analysis.atvr = vertex_count ? (float)analysis.transformed / vertex_count : 0.0f;
+	return analysis;
+}
+
+//	Welding --------------------------------------------------------------------
+
+unsigned int weld_vertices(std::vector<vertex> &vertices, std::vector<unsigned int> &indices)
+{
+	PROFILE_ZONE("weld_vertices");
+
+	// open addressing over the vertex bytes, the table holds the index of the first vertex with those bytes
+	size_t table_size = 16;
+	while (table_size < vertices.size() * 2)
+		table_size *= 2;
+	std::vector<unsigned int> table(table_size, ~0u);
+	std::vector<unsigned int> remap(vertices.size());
+
+	unsigned int count = 0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		size_t slot = fnv1a(&vertices[i], sizeof(vertex)) & (table_size - 1);
+		while (table[slot] != ~0u && memcmp(&vertices[table[slot]], &vertices[i], sizeof(vertex)) != 0)
+			slot = (slot + 1) & (table_size - 1);
+
+		if (table[slot] == ~0u)
+		{
+			// the vertices are compacted in place, the slot points at the kept copy
+			vertices[count] = vertices[i];
+			table[slot] = count++;
+		}
+		remap[i] = table[slot];
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+		if (a == b || b == c || c == a)
+			continue;
+		indices[kept++] = a;
+		indices[kept++] = b;
+		indices[kept++] = c;
+	}
+	indices.resize(kept);
+
+	unsigned int removed = (unsigned int)vertices.size() - count;
+	vertices.resize(count);
+	return removed;
+}
+
+//	Vertex cache ---------------------------------------------------------------
+//	Tom Forsyth, "Linear-Speed Vertex Cache Optimisation": every vertex is scored by its place in a simulated LRU cache and by how many of its
+//	triangles are left, each step emits the best scoring triangle that touches the cache
+
+static const int forsyth_cache_size = 32;
+static const int forsyth_max_valence = 32;		/**< valences above this use the score of this one, the boost is small by then */
+
+/**
+* @struct Forsyth_Scores
+* @brief	the score of every cache position and of every remaining valence, built on first use
+*/
+struct Forsyth_Scores
+{
+	float cache[forsyth_cache_size];
+	float valence[forsyth_max_valence + 1];
+
+	Forsyth_Scores()
+	{
+		for (int i = 0; i < forsyth_cache_size; i++)
+		{
+			// the last triangle's vertices get a fixed score so it doesn't matter which order they went in
+			cache[i] = i < 3 ? 0.75f : powf(1.0f - (i - 3) * (1.0f / (forsyth_cache_size - 3)), 1.5f);
+		}
+		valence[0] = 0.0f;
+		for (int i = 1; i <= forsyth_max_valence; i++)
+			valence[i] = 2.0f * powf((float)i, -0.5f);
+	}
+};
+
+static const Forsyth_Scores &forsyth_scores()
+{
+	static Forsyth_Scores scores;
+	return scores;
+}
+
+static float vertex_score(const Forsyth_Scores &scores, int cache_position, unsigned int remaining)
+{
+	if (remaining == 0)
+		return -1.0f;		// nothing left to draw with it
+	float score = cache_position >= 0 ? scores.cache[cache_position] : 0.0f;
+	return score + scores.valence[std::min(remaining, (unsigned int)forsyth_max_valence)];
+}
+
+void optimize_vertex_cache(std::vector<unsigned int> &indices, unsigned int vertex_count)
+{
+	PROFILE_ZONE("optimize_vertex_cache");
+
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+		return;
+	const Forsyth_Scores &scores = forsyth_scores();
+
+	// the triangles of every vertex, the first remaining[v] of them are the ones not emitted yet
+	std::vector<unsigned int> remaining(vertex_count, 0);
+	for (size_t i = 0; i < triangle_count * 3; i++)
+		remaining[indices[i]]++;
+	std::vector<unsigned int> first(vertex_count + 1, 0);
+	for (unsigned int v = 0; v < vertex_count; v++)
+		first[v + 1] = first[v] + remaining[v];
+	std::vector<unsigned int> adjacency(triangle_count * 3);
+	std::vector<unsigned int> filled(first.begin(), first.end() - 1);
+	for (size_t i = 0; i < triangle_count * 3; i++)
+		adjacency[filled[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (unsigned int v = 0; v < vertex_count; v++)
+		vertex_scores[v] = vertex_score(scores, -1, remaining[v]);
+
+	std::vector<float> triangle_scores(triangle_count);
+	std::vector<bool> emitted(triangle_count, false);
+	int best = 0;
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+		if (triangle_scores[t] > triangle_scores[best])
+			best = (int)t;
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(triangle_count * 3);
+	unsigned int cache[forsyth_cache_size + 3];
+	int cache_count = 0;
+	size_t cursor = 0;
+	while (output.size() < triangle_count * 3)
+	{
+		// nothing in the cache has triangles left, start again from the next one in the input order
+		if (best < 0)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = (int)cursor;
+		}
+
+		const unsigned int *triangle = &indices[best * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[best] = true;
+
+		// the triangle's vertices go to the front of the cache, the rest move back and the ones past the end are evicted
+		unsigned int next[forsyth_cache_size + 3];
+		int next_count = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int v = triangle[i];
+			unsigned int *begin = &adjacency[first[v]];
+			unsigned int *end = begin + remaining[v];
+			unsigned int *found = std::find(begin, end, (unsigned int)best);
+			std::swap(*found, *(end - 1));
+			remaining[v]--;
+			next[next_count++] = v;
+		}
+		for (int i = 0; i < cache_count; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				next[next_count++] = v;
+		}
+
+		// rescore the vertices that were or are in the cache, and every triangle they still have
+		for (int i = 0; i < next_count; i++)
+			cache_position[next[i]] = i < forsyth_cache_size ? i : -1;
+		best = -1;
+		float best_score = -1.0f;
+		for (int i = 0; i < next_count; i++)
+		{
+			unsigned int v = next[i];
+			float score = vertex_score(scores, cache_position[v], remaining[v]);
+			float delta = score - vertex_scores[v];
+			vertex_scores[v] = score;
+			for (unsigned int j = first[v]; j < first[v] + remaining[v]; j++)
+			{
+				unsigned int t = adjacency[j];
+				triangle_scores[t] += delta;
+				if (triangle_scores[t] > best_score)
+				{
+					best_score = triangle_scores[t];
+					best = (int)t;
+				}
+			}
+		}
+
+		cache_count = std::min(next_count, forsyth_cache_size);
+		memcpy(cache, next, cache_count * sizeof(unsigned int));
+	}
+
+	indices.swap(output);
+}
+
+//	Overdraw -------------------------------------------------------------------
+
+/**
+* @brief	adds a triangle to a FIFO cache simulation like analyze_vertex_cache
+* @return	the number of its vertices that missed
+*/
+static unsigned int simulate_triangle(const unsigned int *triangle, std::vector<unsigned int> &timestamps, unsigned int &time)
+{
+	unsigned int misses = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		if (time - timestamps[triangle[i]] > vertex_cache_size)
+		{
+			timestamps[triangle[i]] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+/**
+* @struct Overdraw_Cluster
+* @brief	a run of triangles that is drawn together, sorted by how far out of the mesh it faces
+*/
+struct Overdraw_Cluster
+{
+	size_t begin;		/**< the first triangle */
+	size_t end;			/**< one past the last triangle */
+	float sort_key;		/**< dot of the cluster's normal with the direction from the mesh's centroid to the cluster's */
+};
+
+void optimize_overdraw(std::vector<unsigned int> &indices, const std::vector<vertex> &vertices, float threshold)
+{
+	PROFILE_ZONE("optimize_overdraw");
+
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+		return;
+
+	// hard boundaries, the triangles all of whose vertices miss: the cache is cold there anyway
+	std::vector<unsigned int> timestamps(vertices.size(), 0);
+	unsigned int time = vertex_cache_size + 1;
+	std::vector<size_t> hard;
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		if (simulate_triangle(&indices[t * 3], timestamps, time) == 3 || t == 0)
+			hard.push_back(t);
+	}
+	hard.push_back(triangle_count);
+
+	// soft boundaries, each cluster is cut as soon as its ACMR from a cold cache is within threshold of the whole hard cluster's
+	std::vector<Overdraw_Cluster> clusters;
+	for (size_t h = 0; h + 1 < hard.size(); h++)
+	{
+		size_t begin = hard[h], end = hard[h + 1];
+		time += vertex_cache_size + 1;
+		unsigned int misses = 0;
+		for (size_t t = begin; t < end; t++)
+			misses += simulate_triangle(&indices[t * 3], timestamps, time);
+		float target = threshold * misses / (end - begin);
+
+		time += vertex_cache_size + 1;
+		size_t cluster_begin = begin;
+		unsigned int cluster_misses = 0;
+		for (size_t t = begin; t < end; t++)
+		{
+			cluster_misses += simulate_triangle(&indices[t * 3], timestamps, time);
+			if (t + 1 == end || (float)cluster_misses <= target * (t + 1 - cluster_begin))
+			{
+				Overdraw_Cluster cluster = { cluster_begin, t + 1, 0.0f };
+				clusters.push_back(cluster);
+				cluster_begin = t + 1;
+				cluster_misses = 0;
+				time += vertex_cache_size + 1;
+			}
+		}
+	}
+
+	// area weighted centroids and normals, the cross product's length is twice the triangle's area
+	std::vector<glm::vec3> centroids(clusters.size()), normals(clusters.size());
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[c].begin; t < clusters[c].end; t++)
+		{
+			const glm::vec3 &a = vertices[indices[t * 3]].position;
+			const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3 &p = vertices[indices[t * 3 + 2]].position;
+			glm::vec3 cross = glm::cross(b - a, p - a);
+			float triangle_area = glm::length(cross);
+			centroid += (a + b + p) * (triangle_area / 3.0f);
+			normal += cross;
+			area += triangle_area;
+		}
+		mesh_centroid += centroid;
+		mesh_area += area;
+		centroids[c] = area > 0.0f ? centroid / area : centroid;
+		normals[c] = normal;
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		float length = glm::length(normals[c]);
+		clusters[c].sort_key = length > 0.0f ? glm::dot(centroids[c] - mesh_centroid, normals[c] / length) : 0.0f;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Overdraw_Cluster &a, const Overdraw_Cluster &b) { return a.sort_key > b.sort_key; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+		output.insert(output.end(), indices.begin() + clusters[c].begin * 3, indices.begin() + clusters[c].end * 3);
+	indices.swap(output);
+}
+
+//	Vertex fetch ---------------------------------------------------------------
+
+void optimize_vertex_fetch(std::vector<vertex> &vertices, std::vector<unsigned int> &indices)
+{
+	PROFILE_ZONE("optimize_vertex_fetch");
+
+	std::vector<unsigned int> remap(vertices.size(), ~0u);
+	std::vector<vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int &target = remap[indices[i]];
+		if (target == ~0u)
+		{
+			target = (unsigned int)ordered.size();
+			ordered.push_back(vertices[indices[i]]);
+		}
+		indices[i] = target;
+	}
+	vertices.swap(ordered);
+}
+
+//	Mesh_Optimizer -------------------------------------------------------------
+
+void Mesh_Optimizer::optimize(Mesh_Data &data, const char *name)
+{
+	PROFILE_ZONE("Mesh_Optimizer::optimize");
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	Mesh_Optimization_Report report;
+	report.name = name;
+	report.vertices_before = (unsigned int)data.vertices.size();
+	report.before = analyze_vertex_cache(data.indices, report.vertices_before);
+
+	weld_vertices(data.vertices, data.indices);
+	optimize_vertex_cache(data.indices, (unsigned int)data.vertices.size());
+	optimize_overdraw(data.indices, data.vertices);
+	optimize_vertex_fetch(data.vertices, data.indices);
+	vertex_bounds(data.vertices, data.bounds_min, data.bounds_max);
+
+	report.triangles = (unsigned int)(data.indices.size() / 3);
+	report.vertices_after = (unsigned int)data.vertices.size();
+	report.before.atvr = report.vertices_after ? (float)report.before.transformed / report.vertices_after : 0.0f;
+	report.after = analyze_vertex_cache(data.indices, report.vertices_after);
+	report.optimize_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.meshes++;
+	counters.triangles += report.triangles;
+	counters.vertices_before += report.vertices_before;
+	counters.vertices_after += report.vertices_after;
+	counters.transformed_before += report.before.transformed;
+	counters.transformed_after += report.after.transformed;
+	counters.optimize_ms += report.optimize_ms;
+	mesh_reports.push_back(report);
+}
+
+Mesh_Optimizer_Statistics Mesh_Optimizer::statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return counters;
+}
+
+std::vector<Mesh_Optimization_Report> Mesh_Optimizer::reports()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return mesh_reports;
+}
+
+void Mesh_Optimizer::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	memset(&counters, 0, sizeof(counters));
+	mesh_reports.clear();
+}
+
+void Mesh_Optimizer::print()
+{
+	Mesh_Optimizer_Statistics s = statistics();
+	if (s.meshes == 0)
+	{
+		printf("mesh optimizer: no meshes imported\n");
+		return;
+	}
+
+	printf("mesh optimizer: %u meshes, %llu triangles, %llu vertices welded to %llu, %llu vertex shader invocations down to %llu (ACMR %.3f -> %.3f) in %.1f ms\n",
+		s.meshes, s.triangles, s.vertices_before, s.vertices_after, s.transformed_before, s.transformed_after,
+		s.triangles ? (double)s.transformed_before / s.triangles : 0.0, s.triangles ? (double)s.transformed_after / s.triangles : 0.0, s.optimize_ms);
+
+	std::vector<Mesh_Optimization_Report> meshes = reports();
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const Mesh_Optimization_Report &r = meshes[i];
+		std::string name = r.name.empty() ? "mesh " + std::to_string(i) : r.name;
+		printf("  %-24s %7u triangles %7u -> %7u vertices  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n",
+			name.c_str(), r.triangles, r.vertices_before, r.vertices_after, r.before.acmr, r.after.acmr, r.before.atvr, r.after.atvr);
+	}
+}
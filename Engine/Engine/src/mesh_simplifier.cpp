@@ -0,0 +1,421 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+#include "hash.h"
+#include "profiler.h"
+
+unsigned int Mesh_Simplifier::s_lod_count = 4;
+float Mesh_Simplifier::s_lod_ratio = 0.5f;
+float Mesh_Simplifier::s_error_threshold = 1.0f;
+float Mesh_Simplifier::s_hysteresis = 0.25f;
+
+static std::mutex statistics_mutex;
+static Mesh_Simplifier_Statistics counters;
+
+static const float border_weight = 10.0f;		/**< how much more a border holds its place than a surface, so open edges don't shrink */
+
+//	Quadrics -------------------------------------------------------------------
+
+/**
+* @struct Quadric
+* @brief	the sum of the weighted squared distances to a set of planes as a symmetric 4x4 matrix, and the sum of the weights
+*/
+struct Quadric
+{
+	double a00, a11, a22, a10, a20, a21;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+
+/**
+* @brief	the quadric of the plane through point with the unit normal, weighted
+*/
+static Quadric plane_quadric(glm::vec3 normal, glm::vec3 point, float weight)
+{
+	double x = normal.x, y = normal.y, z = normal.z;
+	double d = -(x * point.x + y * point.y + z * point.z);
+	Quadric q;
+	q.a00 = weight * x * x;
+	q.a11 = weight * y * y;
+	q.a22 = weight * z * z;
+	q.a10 = weight * y * x;
+	q.a20 = weight * z * x;
+	q.a21 = weight * z * y;
+	q.b0 = weight * x * d;
+	q.b1 = weight * y * d;
+	q.b2 = weight * z * d;
+	q.c = weight * d * d;
+	q.w = weight;
+	return q;
+}
+
+static void add_quadric(Quadric &q, const Quadric &other)
+{
+	q.a00 += other.a00;
+	q.a11 += other.a11;
+	q.a22 += other.a22;
+	q.a10 += other.a10;
+	q.a20 += other.a20;
+	q.a21 += other.a21;
+	q.b0 += other.b0;
+	q.b1 += other.b1;
+	q.b2 += other.b2;
+	q.c += other.c;
+	q.w += other.w;
+}
+
+/**
+* @brief	the weighted mean squared distance of a point to the planes of the quadrics a and b together
+*/
+static double quadric_error(const Quadric &a, const Quadric &b, glm::vec3 p)
+{
+	double x = p.x, y = p.y, z = p.z;
+	double r = (a.a00 + b.a00) * x * x + (a.a11 + b.a11) * y * y + (a.a22 + b.a22) * z * z
+		+ 2.0 * ((a.a10 + b.a10) * x * y + (a.a20 + b.a20) * x * z + (a.a21 + b.a21) * y * z)
+		+ 2.0 * ((a.b0 + b.b0) * x + (a.b1 + b.b1) * y + (a.b2 + b.b2) * z)
+		+ a.c + b.c;
+	double w = a.w + b.w;
+	return w > 0.0 ? fabs(r) / w : 0.0;
+}
+
+//	Simplification -------------------------------------------------------------
+
+enum Vertex_Kind
+{
+	KIND_MANIFOLD = 0,		/**< inside the surface, collapses onto any neighbour */
+	KIND_BORDER,			/**< on an open border, collapses along it */
+	KIND_LOCKED				/**< on a seam or non manifold, never collapses */
+};
+
+/**
+* @struct Collapse
+* @brief	moving vertex from onto vertex to, and what it costs
+*/
+struct Collapse
+{
+	unsigned int from;
+	unsigned int to;
+	double error;
+};
+
+static unsigned long long edge_key(unsigned int a, unsigned int b)
+{
+	return ((unsigned long long)a << 32) | b;
+}
+
+/**
+* @brief	maps every vertex to the first vertex with the same position, the vertices that only differ in normal or texture coordinates
+*/
+static std::vector<unsigned int> position_remap(Span<vertex> vertices)
+{
+	size_t table_size = 16;
+	while (table_size < vertices.size() * 2)
+		table_size *= 2;
+	std::vector<unsigned int> table(table_size, ~0u);
+	std::vector<unsigned int> remap(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		size_t slot = fnv1a(&vertices[i].position, sizeof(glm::vec3)) & (table_size - 1);
+		while (table[slot] != ~0u && memcmp(&vertices[table[slot]].position, &vertices[i].position, sizeof(glm::vec3)) != 0)
+			slot = (slot + 1) & (table_size - 1);
+		if (table[slot] == ~0u)
+			table[slot] = (unsigned int)i;
+		remap[i] = table[slot];
+	}
+	return remap;
+}
+
+/**
+* @brief	counts the uses of every directed edge between positions
+*/
+static void count_edges(const std::vector<unsigned int> &indices, const std::vector<unsigned int> &position, std::unordered_map<unsigned long long, unsigned int> &edges)
+{
+	edges.clear();
+	edges.reserve(indices.size() * 2);
+	for (size_t i = 0; i < indices.size(); i += 3)
+		for (int e = 0; e < 3; e++)
+			edges[edge_key(position[indices[i + e]], position[indices[i + (e + 1) % 3]])]++;
+}
+
+std::vector<unsigned int> simplify_mesh(Span<vertex> vertices, Span<unsigned int> indices, size_t target_index_count, float &error)
+{
+	PROFILE_ZONE("simplify_mesh");
+
+	error = 0.0f;
+	std::vector<unsigned int> result(indices.begin(), indices.end());
+	size_t vertex_count = vertices.size();
+	if (result.size() <= target_index_count || vertex_count == 0)
+		return result;
+
+	// the topology is looked at per position, so a seam's vertices count as one
+	std::vector<unsigned int> position = position_remap(vertices);
+	std::vector<unsigned int> wedges(vertex_count, 0);
+	std::vector<unsigned char> used(vertex_count, 0);
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		if (!used[result[i]])
+			wedges[position[result[i]]]++;
+		used[result[i]] = 1;
+	}
+
+	std::unordered_map<unsigned long long, unsigned int> edges;
+	count_edges(result, position, edges);
+
+	// an edge without its opposite is on a border, one used twice in the same direction is non manifold
+	std::vector<unsigned int> border_edges(vertex_count, 0);
+	std::vector<unsigned char> kind(vertex_count, KIND_MANIFOLD);
+	for (std::unordered_map<unsigned long long, unsigned int>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+	{
+		unsigned int a = (unsigned int)(it->first >> 32), b = (unsigned int)it->first;
+		if (it->second > 1)
+			kind[a] = kind[b] = KIND_LOCKED;
+		else if (edges.find(edge_key(b, a)) == edges.end())
+		{
+			border_edges[a]++;
+			border_edges[b]++;
+		}
+	}
+	for (size_t v = 0; v < vertex_count; v++)
+	{
+		unsigned int p = position[v];
+		if (wedges[p] > 1 || (border_edges[p] != 0 && border_edges[p] != 2))
+			kind[p] = KIND_LOCKED;
+		else if (border_edges[p] == 2 && kind[p] != KIND_LOCKED)
+			kind[p] = KIND_BORDER;
+	}
+
+	// every triangle adds its plane to its corners, weighted by its area, a border edge adds a plane through it perpendicular to the triangle
+	std::vector<Quadric> quadrics(vertex_count);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		glm::vec3 p[3] = { vertices[result[i]].position, vertices[result[i + 1]].position, vertices[result[i + 2]].position };
+		glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+		normal /= length;
+
+		Quadric q = plane_quadric(normal, p[0], length * 0.5f);
+		for (int e = 0; e < 3; e++)
+			add_quadric(quadrics[position[result[i + e]]], q);
+
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = position[result[i + e]], b = position[result[i + (e + 1) % 3]];
+			if (edges.find(edge_key(b, a)) != edges.end())
+				continue;
+			glm::vec3 edge = p[(e + 1) % 3] - p[e];
+			float edge_length = glm::length(edge);
+			if (edge_length == 0.0f)
+				continue;
+			Quadric border = plane_quadric(glm::normalize(glm::cross(edge, normal)), p[e], edge_length * edge_length * border_weight);
+			add_quadric(quadrics[a], border);
+			add_quadric(quadrics[b], border);
+		}
+	}
+
+	std::vector<unsigned int> triangle_offsets(vertex_count + 1);
+	std::vector<unsigned int> vertex_triangles;
+	std::vector<unsigned char> touched(vertex_count);
+	std::vector<unsigned int> remap(vertex_count);
+	std::vector<Collapse> collapses;
+	double max_error = 0.0;
+	while (result.size() > target_index_count)
+	{
+		// the triangles around each vertex
+		std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+		for (size_t i = 0; i < result.size(); i++)
+			triangle_offsets[result[i] + 1]++;
+		for (size_t v = 0; v < vertex_count; v++)
+			triangle_offsets[v + 1] += triangle_offsets[v];
+		vertex_triangles.resize(result.size());
+		std::vector<unsigned int> fill(triangle_offsets.begin(), triangle_offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			vertex_triangles[fill[result[i]]++] = (unsigned int)(i / 3);
+
+		// every direction of every edge that may collapse, cheapest first. The edges are counted again since the collapses made new ones
+		if (!collapses.empty())
+			count_edges(result, position, edges);
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = result[i + e], b = result[i + (e + 1) % 3];
+				unsigned int pa = position[a], pb = position[b];
+				bool border = edges.find(edge_key(pb, pa)) == edges.end() || edges.find(edge_key(pa, pb)) == edges.end();
+				for (int direction = 0; direction < 2; direction++)
+				{
+					unsigned int from = direction ? b : a, to = direction ? a : b;
+					unsigned char from_kind = kind[position[from]];
+					if (from_kind == KIND_LOCKED || (from_kind == KIND_BORDER && !border))
+						continue;
+					Collapse collapse = { from, to, quadric_error(quadrics[position[from]], quadrics[position[to]], vertices[to].position) };
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+
+		// a collapse takes two triangles with it, or one on a border, and locks the triangles around it for the rest of the pass
+		size_t goal = (result.size() - target_index_count) / 6 + 1;
+		size_t collapsed = 0;
+		for (size_t v = 0; v < vertex_count; v++)
+			remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), 0);
+		for (size_t c = 0; c < collapses.size() && collapsed < goal; c++)
+		{
+			const Collapse &collapse = collapses[c];
+			unsigned int from = collapse.from, to = collapse.to;
+			if (touched[position[from]] || touched[position[to]])
+				continue;
+
+			// skip it if a triangle that stays would turn over
+			glm::vec3 target_position = vertices[to].position;
+			bool flips = false;
+			for (unsigned int t = triangle_offsets[from]; t < triangle_offsets[from + 1] && !flips; t++)
+			{
+				const unsigned int *triangle = &result[vertex_triangles[t] * 3];
+				if (position[triangle[0]] == position[to] || position[triangle[1]] == position[to] || position[triangle[2]] == position[to])
+					continue;
+				glm::vec3 p[3] = { vertices[triangle[0]].position, vertices[triangle[1]].position, vertices[triangle[2]].position };
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (int k = 0; k < 3; k++)
+					if (triangle[k] == from)
+						p[k] = target_position;
+				glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+				flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+			}
+			if (flips)
+				continue;
+
+			remap[from] = to;
+			add_quadric(quadrics[position[to]], quadrics[position[from]]);
+			max_error = std::max(max_error, collapse.error);
+			for (unsigned int t = triangle_offsets[from]; t < triangle_offsets[from + 1]; t++)
+			{
+				const unsigned int *triangle = &result[vertex_triangles[t] * 3];
+				touched[position[triangle[0]]] = touched[position[triangle[1]]] = touched[position[triangle[2]]] = 1;
+			}
+			collapsed++;
+		}
+		if (!collapsed)
+			break;
+
+		// the triangles that lost an edge are gone
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a])
+				continue;
+			result[kept++] = a;
+			result[kept++] = b;
+			result[kept++] = c;
+		}
+		result.resize(kept);
+	}
+
+	error = (float)sqrt(max_error);
+	return result;
+}
+
+//	Mesh_Simplifier ------------------------------------------------------------
+
+void Mesh_Simplifier::build_lods(Mesh_Data &data)
+{
+	PROFILE_ZONE("Mesh_Simplifier::build_lods");
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	unsigned int lod_count = std::min(std::max(s_lod_count, 1u), max_lod_count);
+	std::vector<unsigned int> previous = data.indices;
+	data.lods.clear();
+	data.lods.push_back(Mesh_Lod());
+	data.lods[0].first_index = 0;
+	data.lods[0].index_count = (unsigned int)data.indices.size();
+	data.lods[0].error = 0.0f;
+
+	// each level starts from the one before it, so its error adds up along the chain
+	float error = 0.0f;
+	for (unsigned int level = 1; level < lod_count; level++)
+	{
+		size_t target = (size_t)(previous.size() / 3 * s_lod_ratio) * 3;
+		float level_error;
+		std::vector<unsigned int> lod = simplify_mesh(data.vertices, previous, target, level_error);
+		if (lod.empty() || lod.size() > previous.size() * 9 / 10)
+			break;
+		if (Mesh_Optimizer::s_enabled)
+			optimize_vertex_cache(lod, (unsigned int)data.vertices.size());
+
+		error += level_error;
+		Mesh_Lod entry;
+		entry.first_index = (unsigned int)data.indices.size();
+		entry.index_count = (unsigned int)lod.size();
+		entry.error = error;
+		data.lods.push_back(entry);
+		data.indices.insert(data.indices.end(), lod.begin(), lod.end());
+		previous.swap(lod);
+	}
+
+	double simplify_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.meshes++;
+	for (size_t i = 0; i < data.lods.size(); i++)
+	{
+		counters.level_triangles[i] += data.lods[i].index_count / 3;
+		counters.level_meshes[i]++;
+	}
+	counters.simplify_ms += simplify_ms;
+}
+
+void Mesh_Simplifier::record_selections(const unsigned int *level_selections, unsigned int selected_triangles, unsigned int full_triangles, unsigned int switches)
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	for (unsigned int i = 0; i < max_lod_count; i++)
+		counters.level_selections[i] += level_selections[i];
+	counters.selected_triangles += selected_triangles;
+	counters.full_triangles += full_triangles;
+	counters.switches += switches;
+}
+
+Mesh_Simplifier_Statistics Mesh_Simplifier::statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return counters;
+}
+
+void Mesh_Simplifier::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	memset(&counters, 0, sizeof(counters));
+}
+
+void Mesh_Simplifier::print()
+{
+	Mesh_Simplifier_Statistics s = statistics();
+	if (s.meshes)
+	{
+		printf("mesh lods: %u meshes simplified in %.2f ms, triangles per level:", s.meshes, s.simplify_ms);
+		for (unsigned int i = 0; i < max_lod_count && s.level_meshes[i]; i++)
+			printf(" %llu", s.level_triangles[i]);
+		printf("\n");
+	}
+	if (s.full_triangles)
+	{
+		printf("mesh lods: %.1f%% of the full detail triangles drawn, %llu level switches, picks per level:",
+			100.0 * s.selected_triangles / s.full_triangles, s.switches);
+		for (unsigned int i = 0; i < max_lod_count; i++)
+			printf(" %llu", s.level_selections[i]);
+		printf("\n");
+	}
+}
@@ -0,0 +1,521 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+#include "meshlet.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHLET_SSE2
+#include <emmintrin.h>
+#endif
+
+bool Meshlet_Culler::s_enabled = true;
+unsigned int Meshlet_Culler::s_grain = 256;
+
+static std::mutex statistics_mutex;
+static Meshlet_Culler_Statistics counters;
+
+static const unsigned int no_lod = ~0u;		/**< the draw_lod of a set that has no runs */
+static const float min_cone_dot = 0.1f;		/**< cones wider than about 84 degrees from the axis are never culled, hardly any viewpoint could cull them */
+static const float cone_weight = 1.0f;		/**< how much a triangle facing away from a meshlet's average normal counts against it, next to the vertices it adds */
+
+size_t Meshlet_Set::cpu_bytes() const
+{
+	size_t floats = center_x.capacity() + center_y.capacity() + center_z.capacity() + radius.capacity() +
+		cone_x.capacity() + cone_y.capacity() + cone_z.capacity() + cone_cutoff.capacity();
+	size_t uints = first_index.capacity() + index_count.capacity() + lod_meshlets.capacity() + draw_first.capacity() + draw_count.capacity();
+	return sizeof(Meshlet_Set) + floats * sizeof(float) + uints * sizeof(unsigned int) + visible.capacity();
+}
+
+//	Building -------------------------------------------------------------------
+
+/**
+* @brief	number of the triangle's distinct vertices that aren't in the meshlet yet
+* @param *triangle		the triangle's 3 indices
+* @param &marks			the meshlet each vertex was last added to
+* @param meshlet		the meshlet's number
+*/
+static unsigned int new_vertices(const unsigned int *triangle, const std::vector<unsigned int> &marks, unsigned int meshlet)
+{
+	unsigned int a = triangle[0], b = triangle[1], c = triangle[2];
+	return (marks[a] != meshlet) + (marks[b] != meshlet && b != a) + (marks[c] != meshlet && c != a && c != b);
+}
+
+/**
+* @brief	reorders the triangles of one level of detail into meshlets
+* @param vertex_count	number of vertices the indices refer to
+* @param *indices		the level's indices, reordered in place
+* @param index_count	number of indices of the level
+* @param vertices		the vertices, for the face normals
+*/
+static void cluster_level(unsigned int vertex_count, unsigned int *indices, unsigned int index_count, Span<vertex> vertices)
+{
+	unsigned int triangle_count = index_count / 3;
+	if (triangle_count == 0)
+		return;
+
+	// the triangles around each vertex
+	std::vector<unsigned int> offsets(vertex_count + 1, 0), adjacency(triangle_count * 3);
+	for (unsigned int i = 0; i < triangle_count * 3; i++)
+		offsets[indices[i] + 1]++;
+	for (unsigned int v = 0; v < vertex_count; v++)
+		offsets[v + 1] += offsets[v];
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int i = 0; i < triangle_count * 3; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<glm::vec3> normals(triangle_count);
+	for (unsigned int t = 0; t < triangle_count; t++)
+	{
+		glm::vec3 p0 = vertices[indices[t * 3]].position;
+		glm::vec3 normal = glm::cross(vertices[indices[t * 3 + 1]].position - p0, vertices[indices[t * 3 + 2]].position - p0);
+		float length = glm::length(normal);
+		normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+	}
+
+	std::vector<unsigned int> order, marks(vertex_count, ~0u), meshlet_vertices;
+	std::vector<unsigned char> emitted(triangle_count, 0);
+	order.reserve(triangle_count);
+	meshlet_vertices.reserve(meshlet_max_vertices);
+	unsigned int meshlet = 0, meshlet_triangles = 0, next_unused = 0;
+	glm::vec3 normal_sum(0.0f);
+	while (order.size() < triangle_count)
+	{
+		// the best triangle touching the meshlet
+		unsigned int best = ~0u;
+		float best_score = 0.0f;
+		if (meshlet_triangles < meshlet_max_triangles)
+		{
+			float sum_length = glm::length(normal_sum);
+			glm::vec3 axis = sum_length > 0.0f ? normal_sum / sum_length : glm::vec3(0.0f);
+			for (size_t i = 0; i < meshlet_vertices.size(); i++)
+			{
+				unsigned int v = meshlet_vertices[i];
+				for (unsigned int j = offsets[v]; j < offsets[v + 1]; j++)
+				{
+					unsigned int t = adjacency[j];
+					if (emitted[t])
+						continue;
+					unsigned int added = new_vertices(indices + t * 3, marks, meshlet);
+					if (meshlet_vertices.size() + added > meshlet_max_vertices)
+						continue;
+					float score = added + cone_weight * (1.0f - glm::dot(axis, normals[t]));
+					if (best == ~0u || score < best_score)
+					{
+						best = t;
+						best_score = score;
+					}
+				}
+			}
+		}
+
+		// nothing touching it fits, the next triangle in the cache order goes in if it fits and starts the next meshlet otherwise
+		if (best == ~0u)
+		{
+			while (emitted[next_unused])
+				next_unused++;
+			best = next_unused;
+			if (meshlet_triangles == meshlet_max_triangles || meshlet_vertices.size() + new_vertices(indices + best * 3, marks, meshlet) > meshlet_max_vertices)
+			{
+				meshlet++;
+				meshlet_triangles = 0;
+				meshlet_vertices.clear();
+				normal_sum = glm::vec3(0.0f);
+			}
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[best * 3 + k];
+			if (marks[v] != meshlet)
+			{
+				marks[v] = meshlet;
+				meshlet_vertices.push_back(v);
+			}
+		}
+		emitted[best] = 1;
+		order.push_back(best);
+		normal_sum += normals[best];
+		meshlet_triangles++;
+	}
+
+	std::vector<unsigned int> source(indices, indices + triangle_count * 3);
+	for (unsigned int t = 0; t < triangle_count; t++)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+			indices[t * 3 + k] = source[order[t] * 3 + k];
+	}
+}
+
+void cluster_meshlets(Mesh_Data &data)
+{
+	PROFILE_ZONE("cluster_meshlets");
+
+	if (data.lods.empty())
+		cluster_level((unsigned int)data.vertices.size(), data.indices.data(), (unsigned int)data.indices.size(), data.vertices);
+	for (size_t l = 0; l < data.lods.size(); l++)
+		cluster_level((unsigned int)data.vertices.size(), data.indices.data() + data.lods[l].first_index, data.lods[l].index_count, data.vertices);
+}
+
+/**
+* @brief	appends the bounds of the meshlet of the triangles in [begin, end) to the set
+* @param &meshlet_vertices		the vertices the triangles use, each once
+* @param &normals				scratch space for the triangle normals
+*/
+static void add_meshlet(Meshlet_Set &set, Span<vertex> vertices, Span<unsigned int> indices, unsigned int begin, unsigned int end,
+	const std::vector<unsigned int> &meshlet_vertices, std::vector<glm::vec3> &normals)
+{
+	// the sphere around the bounding box center, close enough to the smallest one for a few dozen vertices
+	glm::vec3 bounds_min = vertices[meshlet_vertices[0]].position, bounds_max = bounds_min;
+	for (size_t i = 1; i < meshlet_vertices.size(); i++)
+	{
+		bounds_min = glm::min(bounds_min, vertices[meshlet_vertices[i]].position);
+		bounds_max = glm::max(bounds_max, vertices[meshlet_vertices[i]].position);
+	}
+	glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+	float radius = 0.0f;
+	for (size_t i = 0; i < meshlet_vertices.size(); i++)
+		radius = std::max(radius, glm::length(vertices[meshlet_vertices[i]].position - center));
+
+	// the cone around the average of the counter clockwise face normals, degenerate triangles have none
+	normals.clear();
+	glm::vec3 sum(0.0f);
+	for (unsigned int i = begin; i < end; i += 3)
+	{
+		glm::vec3 p0 = vertices[indices[i]].position;
+		glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+		float length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		sum += normals.back();
+	}
+	float sum_length = glm::length(sum);
+	glm::vec3 axis = sum_length > 1e-6f ? sum / sum_length : glm::vec3(0.0f);
+	float min_dot = sum_length > 1e-6f ? 1.0f : -1.0f;
+	for (size_t i = 0; i < normals.size(); i++)
+		min_dot = std::min(min_dot, glm::dot(axis, normals[i]));
+
+	set.center_x.push_back(center.x);
+	set.center_y.push_back(center.y);
+	set.center_z.push_back(center.z);
+	set.radius.push_back(radius);
+	set.cone_x.push_back(axis.x);
+	set.cone_y.push_back(axis.y);
+	set.cone_z.push_back(axis.z);
+	set.cone_cutoff.push_back(min_dot <= min_cone_dot ? 1.0f : sqrtf(1.0f - min_dot * min_dot));
+	set.first_index.push_back(begin);
+	set.index_count.push_back(end - begin);
+}
+
+Meshlet_Set *build_meshlets(Span<vertex> vertices, Span<unsigned int> indices, Span<Mesh_Lod> lods)
+{
+	PROFILE_ZONE("build_meshlets");
+
+	Meshlet_Set *set = new Meshlet_Set();
+	set->draw_indices = 0;
+	set->draw_lod = no_lod;
+
+	// the meshlet each vertex was last added to, a meshlet's number is how many were finished before it
+	std::vector<unsigned int> marks(vertices.size(), ~0u);
+	std::vector<unsigned int> meshlet_vertices;
+	std::vector<glm::vec3> normals;
+	meshlet_vertices.reserve(meshlet_max_vertices);
+	normals.reserve(meshlet_max_triangles);
+	for (size_t l = 0; l < lods.size(); l++)
+	{
+		set->lod_meshlets.push_back((unsigned int)set->first_index.size());
+		unsigned int begin = lods[l].first_index, end = lods[l].first_index + lods[l].index_count;
+		unsigned int start = begin;
+		for (unsigned int i = begin; i + 3 <= end; i += 3)
+		{
+			// start a new meshlet when the triangle doesn't fit
+			unsigned int meshlet = (unsigned int)set->first_index.size();
+			unsigned int added = new_vertices(&indices[i], marks, meshlet);
+			if (meshlet_vertices.size() + added > meshlet_max_vertices || (i - start) / 3 + 1 > meshlet_max_triangles)
+			{
+				add_meshlet(*set, vertices, indices, start, i, meshlet_vertices, normals);
+				meshlet_vertices.clear();
+				start = i;
+				meshlet++;
+			}
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[i + k];
+				if (marks[v] != meshlet)
+				{
+					marks[v] = meshlet;
+					meshlet_vertices.push_back(v);
+				}
+			}
+		}
+		if (!meshlet_vertices.empty())
+		{
+			add_meshlet(*set, vertices, indices, start, end - (end - begin) % 3, meshlet_vertices, normals);
+			meshlet_vertices.clear();
+		}
+	}
+	set->lod_meshlets.push_back((unsigned int)set->first_index.size());
+	set->visible.assign(set->first_index.size(), 1);
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.meshes++;
+	counters.built_meshlets += set->first_index.size();
+	return set;
+}
+
+//	Culling --------------------------------------------------------------------
+
+/**
+* @struct Cull_Block
+* @brief	a run of one set's meshlets culled by one thread, and what it culled
+*/
+struct Cull_Block
+{
+	Meshlet_Set *set;
+	unsigned int begin;
+	unsigned int end;
+	unsigned int frustum_culled;
+	unsigned int cone_culled;
+};
+
+/**
+* @brief	the threads the meshlets are culled on, started on first use
+*/
+static Thread_Pool *culling_pool()
+{
+	static Thread_Pool pool;
+	return &pool;
+}
+
+/**
+* @brief	whether a meshlet is outside the frustum (1) or facing away from the viewpoint (2) or visible (0), the scalar version of the loop in cull_block
+*/
+static int cull_meshlet(const Meshlet_Set &set, unsigned int i, const Meshlet_Cull_View &view)
+{
+	glm::vec3 center(set.center_x[i], set.center_y[i], set.center_z[i]);
+	if (view.frustum)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if (glm::dot(glm::vec3(view.planes[p]), center) + view.planes[p].w < -set.radius[i])
+				return 1;
+		}
+	}
+
+	// every triangle faces away if the cone does from every point of the sphere
+	glm::vec3 to_center = center - view.viewpoint;
+	float distance = glm::length(to_center);
+	if (glm::dot(to_center, glm::vec3(set.cone_x[i], set.cone_y[i], set.cone_z[i])) >= set.cone_cutoff[i] * distance + set.radius[i])
+		return 2;
+	return 0;
+}
+
+/**
+* @brief	culls the meshlets of a block, writing their visibility and counting what was culled
+*/
+static void cull_block(Cull_Block &block, const Meshlet_Cull_View &view)
+{
+	const Meshlet_Set &set = *block.set;
+	unsigned char *visible = &block.set->visible[0];
+	unsigned int frustum_culled = 0, cone_culled = 0;
+	unsigned int i = block.begin;
+
+#ifdef MESHLET_SSE2
+	__m128 planes[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		for (int k = 0; k < 4; k++)
+			planes[p][k] = _mm_set1_ps(view.planes[p][k]);
+	}
+	__m128 view_x = _mm_set1_ps(view.viewpoint.x), view_y = _mm_set1_ps(view.viewpoint.y), view_z = _mm_set1_ps(view.viewpoint.z);
+	for (; i + 4 <= block.end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&set.center_x[i]);
+		__m128 y = _mm_loadu_ps(&set.center_y[i]);
+		__m128 z = _mm_loadu_ps(&set.center_z[i]);
+		__m128 radius = _mm_loadu_ps(&set.radius[i]);
+
+		__m128 outside = _mm_setzero_ps();
+		if (view.frustum)
+		{
+			__m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_radius));
+			}
+		}
+
+		__m128 dx = _mm_sub_ps(x, view_x), dy = _mm_sub_ps(y, view_y), dz = _mm_sub_ps(z, view_z);
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		__m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&set.cone_x[i])), _mm_mul_ps(dy, _mm_loadu_ps(&set.cone_y[i]))),
+			_mm_mul_ps(dz, _mm_loadu_ps(&set.cone_z[i])));
+		__m128 facing_away = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&set.cone_cutoff[i]), distance), radius));
+
+		int outside_mask = _mm_movemask_ps(outside);
+		int away_mask = _mm_movemask_ps(_mm_andnot_ps(outside, facing_away));
+		for (int k = 0; k < 4; k++)
+		{
+			frustum_culled += (outside_mask >> k) & 1;
+			cone_culled += (away_mask >> k) & 1;
+			visible[i + k] = !(((outside_mask | away_mask) >> k) & 1);
+		}
+	}
+#endif
+
+	for (; i < block.end; i++)
+	{
+		int culled = cull_meshlet(set, i, view);
+		frustum_culled += culled == 1;
+		cone_culled += culled == 2;
+		visible[i] = culled == 0;
+	}
+
+	block.frustum_culled = frustum_culled;
+	block.cone_culled = cone_culled;
+}
+
+Meshlet_Cull_View Meshlet_Culler::object_view(const glm::mat4 &transform, const glm::mat4 &view_projection, glm::vec3 viewpoint, bool frustum)
+{
+	Meshlet_Cull_View view;
+	view.viewpoint = glm::vec3(glm::inverse(transform) * glm::vec4(viewpoint, 1.0f));
+	view.frustum = frustum;
+
+	// the rows of the matrix added to and subtracted from the w row give the left, right, bottom, top, near and far planes
+	glm::mat4 m = view_projection * transform;
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+	for (int p = 0; p < 6; p++)
+	{
+		glm::vec4 plane = (p & 1) ? rows[3] - rows[p / 2] : rows[3] + rows[p / 2];
+		float length = glm::length(glm::vec3(plane));
+		view.planes[p] = length > 0.0f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	return view;
+}
+
+void Meshlet_Culler::cull(Mesh *meshes, size_t mesh_count, const Meshlet_Cull_View &view)
+{
+	PROFILE_ZONE("Meshlet_Culler::cull");
+
+	if (!s_enabled)
+	{
+		for (size_t m = 0; m < mesh_count; m++)
+		{
+			if (meshes[m].m_meshlets)
+				meshes[m].m_meshlets->draw_lod = no_lod;
+		}
+		return;
+	}
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	// the picked level of every mesh split into blocks, so a big mesh is spread over the threads and small ones share one
+	unsigned int grain = std::max(s_grain, 4u);
+	std::vector<Cull_Block> blocks;
+	for (size_t m = 0; m < mesh_count; m++)
+	{
+		Meshlet_Set *set = meshes[m].m_meshlets;
+		if (!set)
+			continue;
+		unsigned int lod = meshes[m].get_lod();
+		for (unsigned int i = set->lod_meshlets[lod]; i < set->lod_meshlets[lod + 1]; i += grain)
+		{
+			Cull_Block block = { set, i, std::min(i + grain, set->lod_meshlets[lod + 1]), 0, 0 };
+			blocks.push_back(block);
+		}
+	}
+
+	std::function<void(unsigned int, unsigned int)> job = [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b++)
+			cull_block(blocks[b], view);
+	};
+	if (blocks.size() > 1)
+		culling_pool()->parallel_for((unsigned int)blocks.size(), job);
+	else
+		job(0, (unsigned int)blocks.size());
+
+	// adjacent visible meshlets are adjacent in the index buffer too, they merge into one run
+	unsigned long long tested = 0, triangles = 0, drawn_triangles = 0, runs = 0, frustum_culled = 0, cone_culled = 0;
+	for (size_t m = 0; m < mesh_count; m++)
+	{
+		Meshlet_Set *set = meshes[m].m_meshlets;
+		if (!set)
+			continue;
+		unsigned int lod = meshes[m].get_lod();
+		set->draw_first.clear();
+		set->draw_count.clear();
+		set->draw_indices = 0;
+		set->draw_lod = lod;
+		for (unsigned int i = set->lod_meshlets[lod]; i < set->lod_meshlets[lod + 1]; i++)
+		{
+			triangles += set->index_count[i] / 3;
+			if (!set->visible[i])
+				continue;
+			if (!set->draw_first.empty() && set->draw_first.back() + set->draw_count.back() == set->first_index[i])
+				set->draw_count.back() += set->index_count[i];
+			else
+			{
+				set->draw_first.push_back(set->first_index[i]);
+				set->draw_count.push_back(set->index_count[i]);
+			}
+			set->draw_indices += set->index_count[i];
+		}
+		tested += set->lod_meshlets[lod + 1] - set->lod_meshlets[lod];
+		drawn_triangles += set->draw_indices / 3;
+		runs += set->draw_first.size();
+	}
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		frustum_culled += blocks[b].frustum_culled;
+		cone_culled += blocks[b].cone_culled;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.passes++;
+	counters.meshlets += tested;
+	counters.frustum_culled += frustum_culled;
+	counters.cone_culled += cone_culled;
+	counters.triangles += triangles;
+	counters.drawn_triangles += drawn_triangles;
+	counters.draw_runs += runs;
+	counters.cull_ms += ms;
+}
+
+//	Statistics -----------------------------------------------------------------
+
+Meshlet_Culler_Statistics Meshlet_Culler::statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return counters;
+}
+
+void Meshlet_Culler::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	memset(&counters, 0, sizeof(counters));
+}
+
+void Meshlet_Culler::print()
+{
+	Meshlet_Culler_Statistics s = statistics();
+	if (s.meshes)
+		printf("meshlets: %u meshes split into %llu meshlets\n", s.meshes, s.built_meshlets);
+	if (s.meshlets)
+	{
+		printf("meshlets: %.1f%% culled (%.1f%% outside the frustum, %.1f%% facing away), %.1f%% of the triangles drawn in %.1f runs per pass, %.3f ms per pass\n",
+			100.0 * (s.frustum_culled + s.cone_culled) / s.meshlets, 100.0 * s.frustum_culled / s.meshlets, 100.0 * s.cone_culled / s.meshlets,
+			s.triangles ? 100.0 * s.drawn_triangles / s.triangles : 0.0, (double)s.draw_runs / s.passes, s.cull_ms / s.passes);
+	}
+}
@@ -0,0 +1,217 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+
+#include "mip_chain.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_CHAIN_SSE2
+#include <emmintrin.h>
+#endif
+
+static const int linear_steps = 16384;		/**< entries of the linear to sRGB table, fine enough to round every dark value to the nearest sRGB byte */
+
+/**
+* @struct Srgb_Tables
+* @brief	the sRGB transfer function both ways, built on first use
+*/
+struct Srgb_Tables
+{
+	float to_linear[256];					/**< linear value of each sRGB byte */
+	unsigned char to_srgb[linear_steps];	/**< sRGB byte of each linear step */
+
+	Srgb_Tables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float srgb = i / 255.0f;
+			to_linear[i] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < linear_steps; i++)
+		{
+			float linear = i / (float)(linear_steps - 1);
+			float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+			to_srgb[i] = (unsigned char)(srgb * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const Srgb_Tables &srgb_tables()
+{
+	static Srgb_Tables tables;
+	return tables;
+}
+
+/**
+* @brief	runs job over [0, count) on the pool, or on the calling thread without one
+*/
+static void for_ranges(Thread_Pool *pool, unsigned int count, const std::function<void(unsigned int, unsigned int)> &job)
+{
+	if (pool)
+		pool->parallel_for(count, job);
+	else
+		job(0, count);
+}
+
+/**
+* @brief	averages 4 RGBA pixels as stored, rounding to nearest
+*/
+static void average_linear(const unsigned char *a, const unsigned char *b, const unsigned char *c, const unsigned char *d, unsigned char *out)
+{
+	for (int i = 0; i < 4; i++)
+		out[i] = (unsigned char)((a[i] + b[i] + c[i] + d[i] + 2) >> 2);
+}
+
+/**
+* @brief	averages 4 RGBA pixels with the colors in linear light, the alpha like average_linear
+*/
+static void average_srgb(const Srgb_Tables &tables, const unsigned char *a, const unsigned char *b, const unsigned char *c, const unsigned char *d, unsigned char *out)
+{
+	const float *to_linear = tables.to_linear;
+	const float scale = 0.25f * (linear_steps - 1);
+#ifdef MIP_CHAIN_SSE2
+	__m128 sum = _mm_add_ps(
+		_mm_add_ps(_mm_setr_ps(to_linear[a[0]], to_linear[a[1]], to_linear[a[2]], 0.0f), _mm_setr_ps(to_linear[b[0]], to_linear[b[1]], to_linear[b[2]], 0.0f)),
+		_mm_add_ps(_mm_setr_ps(to_linear[c[0]], to_linear[c[1]], to_linear[c[2]], 0.0f), _mm_setr_ps(to_linear[d[0]], to_linear[d[1]], to_linear[d[2]], 0.0f)));
+	int steps[4];
+	_mm_storeu_si128((__m128i *)steps, _mm_cvtps_epi32(_mm_mul_ps(sum, _mm_set1_ps(scale))));
+#else
+	int steps[4];
+	for (int i = 0; i < 3; i++)
+		steps[i] = (int)((to_linear[a[i]] + to_linear[b[i]] + to_linear[c[i]] + to_linear[d[i]]) * scale + 0.5f);
+#endif
+	for (int i = 0; i < 3; i++)
+		out[i] = tables.to_srgb[std::min(std::max(steps[i], 0), linear_steps - 1)];
+	out[3] = (unsigned char)((a[3] + b[3] + c[3] + d[3] + 2) >> 2);
+}
+
+/**
+* @brief	filters the pixels of an output row from x on, clamping the source columns at the edge
+*/
+static void downsample_row_tail(const unsigned char *row0, const unsigned char *row1, int width, unsigned char *out, int x, int out_width, Mip_Filter filter)
+{
+	const Srgb_Tables &tables = srgb_tables();
+	for (; x < out_width; x++)
+	{
+		int x0 = std::min(2 * x, width - 1) * 4;
+		int x1 = std::min(2 * x + 1, width - 1) * 4;
+		if (filter == MIP_FILTER_SRGB)
+			average_srgb(tables, row0 + x0, row0 + x1, row1 + x0, row1 + x1, out + x * 4);
+		else
+			average_linear(row0 + x0, row0 + x1, row1 + x0, row1 + x1, out + x * 4);
+	}
+}
+
+void downsample_rgba(const unsigned char *rgba, int width, int height, unsigned char *out, int out_width, int out_height, Mip_Filter filter, Thread_Pool *pool)
+{
+	for_ranges(pool, out_height, [&](unsigned int begin, unsigned int end)
+	{
+		const Srgb_Tables &tables = srgb_tables();
+		for (unsigned int y = begin; y < end; y++)
+		{
+			const unsigned char *row0 = rgba + (size_t)std::min(2 * (int)y, height - 1) * width * 4;
+			const unsigned char *row1 = rgba + (size_t)std::min(2 * (int)y + 1, height - 1) * width * 4;
+			unsigned char *out_row = out + (size_t)y * out_width * 4;
+
+			// the pixels whose 2x2 footprint is inside the row, the rest clamp
+			int x = 0;
+			int inside = std::min(out_width, width / 2);
+			if (filter == MIP_FILTER_LINEAR)
+			{
+#ifdef MIP_CHAIN_SSE2
+				// 4 source pixels of both rows make 2 output pixels: widened to 16 bits, the rows added, then each pixel to its neighbour
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i rounding = _mm_set1_epi16(2);
+				for (; x + 2 <= inside; x += 2)
+				{
+					__m128i top = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+					__m128i bottom = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+					__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+					__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+					low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+					high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+					__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), rounding), 2);
+					_mm_storel_epi64((__m128i *)(out_row + x * 4), _mm_packus_epi16(sum, zero));
+				}
+#endif
+				for (; x < inside; x++)
+					average_linear(row0 + x * 8, row0 + x * 8 + 4, row1 + x * 8, row1 + x * 8 + 4, out_row + x * 4);
+			}
+			else
+			{
+				for (; x < inside; x++)
+					average_srgb(tables, row0 + x * 8, row0 + x * 8 + 4, row1 + x * 8, row1 + x * 8 + 4, out_row + x * 4);
+			}
+
+			downsample_row_tail(row0, row1, width, out_row, x, out_width, filter);
+		}
+	});
+}
+
+void expand_to_rgba(const unsigned char *pixels, int width, int height, int components, std::vector<unsigned char> &rgba)
+{
+	size_t count = (size_t)width * height;
+	rgba.resize(count * 4);
+	if (components == 4)
+	{
+		memcpy(&rgba[0], pixels, count * 4);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned char *in = pixels + i * components;
+		unsigned char *out = &rgba[i * 4];
+		if (components >= 3)
+			out[0] = in[0], out[1] = in[1], out[2] = in[2];
+		else
+			out[0] = out[1] = out[2] = in[0];
+		out[3] = components == 2 ? in[1] : 255;
+	}
+}
+
+void generate_mip_chain(const unsigned char *pixels, int width, int height, int components, Mip_Filter filter, Mip_Chain &chain, Thread_Pool *pool)
+{
+	PROFILE_ZONE("generate_mip_chain");
+
+	chain.levels.clear();
+	size_t size = 0;
+	for (int level_width = width, level_height = height; level_width > 1 || level_height > 1;)
+	{
+		level_width = std::max(level_width / 2, 1);
+		level_height = std::max(level_height / 2, 1);
+
+		Mip_Level level;
+		level.width = level_width;
+		level.height = level_height;
+		level.offset = size;
+		chain.levels.push_back(level);
+		size += (size_t)level_width * level_height * 4;
+	}
+	chain.pixels.resize(size);
+	if (chain.levels.empty())
+		return;
+
+	// level 0 is only expanded when it isn't RGBA already
+	std::vector<unsigned char> expanded;
+	const unsigned char *source = pixels;
+	if (components != 4)
+	{
+		expand_to_rgba(pixels, width, height, components, expanded);
+		source = &expanded[0];
+	}
+
+	int source_width = width, source_height = height;
+	for (int i = 0; i < chain.levels.size(); i++)
+	{
+		const Mip_Level &level = chain.levels[i];
+		unsigned char *out = &chain.pixels[level.offset];
+		downsample_rgba(source, source_width, source_height, out, level.width, level.height, filter, pool);
+		source = out;
+		source_width = level.width;
+		source_height = level.height;
+	}
+}
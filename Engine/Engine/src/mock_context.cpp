@@ -0,0 +1,499 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "mock_context.h"
+#include "hash.h"
+
+static GLuint next_name = 1;									// object names handed out by the glGen* and glCreate* stubs
+static std::vector<unsigned char> scratch;						// stands in for the driver's copy of uploaded data
+static unsigned long long total_uploaded_bytes = 0;
+static unsigned long long total_uniform_lookups = 0;
+static std::unordered_map<GLuint, std::unordered_map<unsigned long long, GLint> > program_uniforms;	// uniform locations of each program, keyed by a hash of the name
+
+/**
+* @brief	a uniform declared in a shader's source, what glGetActiveUniform reports for it
+*/
+struct Mock_Uniform
+{
+	std::string name;
+	GLenum type;
+	GLint size;
+};
+
+/**
+* @brief	the uniforms and uniform blocks declared in a shader or linked into a program
+*/
+struct Mock_Declarations
+{
+	std::vector<Mock_Uniform> uniforms;
+	std::vector<std::string> blocks;
+};
+
+static std::unordered_map<GLuint, Mock_Declarations> shader_declarations;		// what each shader's source declares
+static std::unordered_map<GLuint, std::vector<GLuint> > program_shaders;		// the shaders attached to each program
+static std::unordered_map<GLuint, Mock_Declarations> program_declarations;		// the union of the attached shaders' declarations, made at link time
+
+/**
+* @brief	copies uploaded data into the scratch buffer
+*/
+static void upload(const void *data, size_t size)
+{
+	if (!data || size == 0)
+		return;
+	if (scratch.size() < size)
+		scratch.resize(size);
+	memcpy(&scratch[0], data, size);
+	total_uploaded_bytes += size;
+}
+
+static void APIENTRY mock_gen(GLsizei n, GLuint *names)
+{
+	for (GLsizei i = 0; i < n; i++)
+		names[i] = next_name++;
+}
+
+static GLuint APIENTRY mock_create_program()
+{
+	return next_name++;
+}
+
+static GLuint APIENTRY mock_create_shader(GLenum type)
+{
+	return next_name++;
+}
+
+static void APIENTRY mock_delete(GLsizei n, const GLuint *names) {}
+static void APIENTRY mock_object(GLuint name) {}
+static void APIENTRY mock_enum(GLenum value) {}
+static void APIENTRY mock_void() {}
+static void APIENTRY mock_bind(GLenum target, GLuint name) {}
+static void APIENTRY mock_bind_vertex_array(GLuint vertex_array) {}
+
+static void APIENTRY mock_attach(GLuint program, GLuint shader)
+{
+	program_shaders[program].push_back(shader);
+}
+
+static void APIENTRY mock_bitfield(GLbitfield mask) {}
+
+static void APIENTRY mock_link_program(GLuint program)
+{
+	program_uniforms[program].clear();
+
+	// a uniform declared by several stages is one uniform of the program
+	Mock_Declarations &declarations = program_declarations[program];
+	declarations = Mock_Declarations();
+	const std::vector<GLuint> &shaders = program_shaders[program];
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		const Mock_Declarations &shader = shader_declarations[shaders[i]];
+		for (size_t j = 0; j < shader.uniforms.size(); j++)
+		{
+			bool found = false;
+			for (size_t k = 0; k < declarations.uniforms.size() && !found; k++)
+				found = declarations.uniforms[k].name == shader.uniforms[j].name;
+			if (!found)
+				declarations.uniforms.push_back(shader.uniforms[j]);
+		}
+		for (size_t j = 0; j < shader.blocks.size(); j++)
+			if (std::find(declarations.blocks.begin(), declarations.blocks.end(), shader.blocks[j]) == declarations.blocks.end())
+				declarations.blocks.push_back(shader.blocks[j]);
+	}
+}
+
+/**
+* @brief	splits GLSL into identifiers, numbers and single punctuation characters, dropping comments.
+*			#define lines with a value are collected into defines instead, so array sizes given by a macro can be resolved
+*/
+static void tokenize(const char *source, size_t length, std::vector<std::string> &tokens, std::unordered_map<std::string, std::string> &defines)
+{
+	const char *c = source, *end = source + length;
+	while (c < end)
+	{
+		if (isspace((unsigned char)*c))
+			c++;
+		else if (c + 1 < end && c[0] == '/' && c[1] == '/')
+			while (c < end && *c != '\n')
+				c++;
+		else if (c + 1 < end && c[0] == '/' && c[1] == '*')
+		{
+			for (c += 2; c + 1 < end && !(c[0] == '*' && c[1] == '/'); c++);
+			c += 2;
+		}
+		else if (*c == '#')
+		{
+			const char *line_end = c;
+			while (line_end < end && *line_end != '\n')
+				line_end++;
+			std::vector<std::string> directive;
+			std::unordered_map<std::string, std::string> unused;
+			tokenize(c + 1, line_end - c - 1, directive, unused);
+			if (directive.size() >= 3 && directive[0] == "define")
+				defines[directive[1]] = directive[2];
+			c = line_end;
+		}
+		else if (isalnum((unsigned char)*c) || *c == '_')
+		{
+			const char *start = c;
+			while (c < end && (isalnum((unsigned char)*c) || *c == '_' || *c == '.'))
+				c++;
+			tokens.push_back(std::string(start, c));
+		}
+		else
+			tokens.push_back(std::string(c++, 1));
+	}
+}
+
+/**
+* @brief	the GL type of a GLSL type name, structs are expanded by the caller
+*/
+static GLenum uniform_type(const std::string &name)
+{
+	static const struct { const char *name; GLenum type; } types[] = {
+		{ "float", GL_FLOAT }, { "vec2", GL_FLOAT_VEC2 }, { "vec3", GL_FLOAT_VEC3 }, { "vec4", GL_FLOAT_VEC4 },
+		{ "int", GL_INT }, { "bool", GL_BOOL }, { "mat2", GL_FLOAT_MAT2 }, { "mat3", GL_FLOAT_MAT3 }, { "mat4", GL_FLOAT_MAT4 },
+		{ "sampler2D", GL_SAMPLER_2D }, { "samplerCube", GL_SAMPLER_CUBE }, { "sampler2DMS", GL_SAMPLER_2D_MULTISAMPLE }
+	};
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+		if (name == types[i].name)
+			return types[i].type;
+	return GL_FLOAT;
+}
+
+/**
+* @brief	adds a declared uniform the way a driver reports it, arrays as "name[0]" and structs as one uniform per member
+*/
+static void declare(Mock_Declarations &declarations, const std::unordered_map<std::string, std::vector<std::pair<std::string, std::string> > > &structs,
+	const std::string &type, const std::string &name, GLint size)
+{
+	std::unordered_map<std::string, std::vector<std::pair<std::string, std::string> > >::const_iterator it = structs.find(type);
+	if (it == structs.end())
+	{
+		Mock_Uniform uniform = { size > 1 ? name + "[0]" : name, uniform_type(type), size };
+		declarations.uniforms.push_back(uniform);
+		return;
+	}
+	for (GLint element = 0; element < size; element++)
+		for (size_t i = 0; i < it->second.size(); i++)
+			declare(declarations, structs, it->second[i].first, (size > 1 ? name + "[" + std::to_string(element) + "]" : name) + "." + it->second[i].second, 1);
+}
+
+static void APIENTRY mock_shader_source(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+	// only the declarations are parsed, enough for Shader's reflection to find every uniform and block the source declares
+	std::vector<std::string> tokens;
+	std::unordered_map<std::string, std::string> defines;
+	for (GLsizei i = 0; i < count; i++)
+		tokenize(string[i], length && length[i] >= 0 ? (size_t)length[i] : strlen(string[i]), tokens, defines);
+
+	Mock_Declarations &declarations = shader_declarations[shader];
+	declarations = Mock_Declarations();
+	std::unordered_map<std::string, std::vector<std::pair<std::string, std::string> > > structs;
+	for (size_t i = 0; i + 2 < tokens.size(); i++)
+	{
+		if (tokens[i] == "struct" && tokens[i + 2] == "{")
+		{
+			// members are "type name;", one per declaration
+			std::vector<std::pair<std::string, std::string> > &members = structs[tokens[i + 1]];
+			for (i += 3; i + 2 < tokens.size() && tokens[i] != "}"; i += 3)
+				members.push_back(std::make_pair(tokens[i], tokens[i + 1]));
+		}
+		else if (tokens[i] == "uniform" && tokens[i + 2] == "{")
+			declarations.blocks.push_back(tokens[i + 1]);
+		else if (tokens[i] == "uniform")
+		{
+			GLint size = 1;
+			if (i + 4 < tokens.size() && tokens[i + 3] == "[")
+			{
+				std::unordered_map<std::string, std::string>::const_iterator define = defines.find(tokens[i + 4]);
+				size = atoi(define != defines.end() ? define->second.c_str() : tokens[i + 4].c_str());
+			}
+			declare(declarations, structs, tokens[i + 1], tokens[i + 2], size);
+		}
+	}
+}
+
+static void APIENTRY mock_get_shader_iv(GLuint shader, GLenum name, GLint *params)
+{
+	*params = GL_TRUE;
+}
+
+static void APIENTRY mock_get_program_iv(GLuint program, GLenum name, GLint *params)
+{
+	const Mock_Declarations &declarations = program_declarations[program];
+	size_t longest = 0;
+	switch (name)
+	{
+	case GL_ACTIVE_UNIFORMS:
+		*params = (GLint)declarations.uniforms.size();
+		break;
+	case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+		for (size_t i = 0; i < declarations.uniforms.size(); i++)
+			longest = std::max(longest, declarations.uniforms[i].name.size() + 1);
+		*params = (GLint)longest;
+		break;
+	case GL_ACTIVE_UNIFORM_BLOCKS:
+		*params = (GLint)declarations.blocks.size();
+		break;
+	case GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH:
+		for (size_t i = 0; i < declarations.blocks.size(); i++)
+			longest = std::max(longest, declarations.blocks[i].size() + 1);
+		*params = (GLint)longest;
+		break;
+	default:
+		*params = GL_TRUE;
+	}
+}
+
+/**
+* @brief	copies a name into a caller's buffer like the glGetActive* calls do, truncated and terminated
+*/
+static void copy_name(const std::string &name, GLsizei buffer_size, GLsizei *length, GLchar *buffer)
+{
+	GLsizei copied = buffer_size > 0 ? std::min((GLsizei)name.size(), buffer_size - 1) : 0;
+	if (buffer_size > 0)
+	{
+		memcpy(buffer, name.c_str(), copied);
+		buffer[copied] = '\0';
+	}
+	if (length)
+		*length = copied;
+}
+
+static void APIENTRY mock_get_active_uniform(GLuint program, GLuint index, GLsizei buffer_size, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	const Mock_Uniform &uniform = program_declarations[program].uniforms[index];
+	copy_name(uniform.name, buffer_size, length, name);
+	*size = uniform.size;
+	*type = uniform.type;
+}
+
+static void APIENTRY mock_get_active_uniform_block_name(GLuint program, GLuint index, GLsizei buffer_size, GLsizei *length, GLchar *name)
+{
+	copy_name(program_declarations[program].blocks[index], buffer_size, length, name);
+}
+
+static void APIENTRY mock_get_active_uniform_block_iv(GLuint program, GLuint index, GLenum name, GLint *params)
+{
+	// the engine's only block holds the projection and view matrices
+	*params = name == GL_UNIFORM_BLOCK_DATA_SIZE ? 2 * 16 * sizeof(GLfloat) : 0;
+}
+
+static void APIENTRY mock_get_info_log(GLuint object, GLsizei max_length, GLsizei *length, GLchar *info_log)
+{
+	if (length)
+		*length = 0;
+	if (max_length > 0)
+		info_log[0] = '\0';
+}
+
+static GLint APIENTRY mock_get_uniform_location(GLuint program, const GLchar *name)
+{
+	// drivers hash the name, a map per program is close enough to their cost
+	// the name is hashed here (FNV-1a) rather than copied into a std::string, so the mock itself doesn't show up in the allocation counts
+	total_uniform_lookups++;
+	unsigned long long hash = fnv1a_string(name);
+
+	std::unordered_map<unsigned long long, GLint> &uniforms = program_uniforms[program];
+	std::unordered_map<unsigned long long, GLint>::iterator it = uniforms.find(hash);
+	if (it != uniforms.end())
+		return it->second;
+	GLint location = (GLint)uniforms.size();
+	uniforms[hash] = location;
+	return location;
+}
+
+static GLuint APIENTRY mock_get_uniform_block_index(GLuint program, const GLchar *name)
+{
+	return 0;
+}
+
+static void APIENTRY mock_uniform_block_binding(GLuint program, GLuint index, GLuint binding) {}
+static void APIENTRY mock_uniform_1i(GLint location, GLint v0) {}
+static void APIENTRY mock_uniform_1f(GLint location, GLfloat v0) {}
+static void APIENTRY mock_uniform_2f(GLint location, GLfloat v0, GLfloat v1) {}
+static void APIENTRY mock_uniform_3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {}
+static void APIENTRY mock_uniform_4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {}
+static void APIENTRY mock_uniform_fv(GLint location, GLsizei count, const GLfloat *value) {}
+static void APIENTRY mock_uniform_matrix_fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {}
+
+static void APIENTRY mock_buffer_data(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+	upload(data, size);
+}
+
+static void APIENTRY mock_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	upload(data, size);
+}
+
+static void APIENTRY mock_tex_image_2d(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+{
+	// the engine only uploads 8 bit textures
+	size_t components = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+	upload(pixels, (size_t)width * height * components);
+}
+
+static void APIENTRY mock_compressed_tex_image_2d(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height, GLint border, GLsizei size, const void *data)
+{
+	upload(data, size);
+}
+
+static void APIENTRY mock_tex_image_2d_multisample(GLenum target, GLsizei samples, GLenum internal_format, GLsizei width, GLsizei height, GLboolean fixed) {}
+static void APIENTRY mock_tex_parameter_i(GLenum target, GLenum name, GLint param) {}
+static void APIENTRY mock_vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) {}
+static void APIENTRY mock_enable_vertex_attrib_array(GLuint index) {}
+static void APIENTRY mock_draw_arrays(GLenum mode, GLint first, GLsizei count) {}
+static void APIENTRY mock_draw_elements(GLenum mode, GLsizei count, GLenum type, const void *indices) {}
+static void APIENTRY mock_draw_elements_base_vertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint base_vertex) {}
+static void APIENTRY mock_multi_draw_elements_base_vertex(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei draw_count, const GLint *base_vertex) {}
+static void APIENTRY mock_copy_buffer_sub_data(GLenum read_target, GLenum write_target, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size) {}
+static void APIENTRY mock_viewport(GLint x, GLint y, GLsizei width, GLsizei height) {}
+static void APIENTRY mock_clear_color(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {}
+static void APIENTRY mock_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {}
+static void APIENTRY mock_framebuffer_texture(GLenum target, GLenum attachment, GLuint texture, GLint level) {}
+static void APIENTRY mock_framebuffer_texture_2d(GLenum target, GLenum attachment, GLenum texture_target, GLuint texture, GLint level) {}
+static void APIENTRY mock_framebuffer_renderbuffer(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer) {}
+static void APIENTRY mock_renderbuffer_storage(GLenum target, GLenum internal_format, GLsizei width, GLsizei height) {}
+static void APIENTRY mock_renderbuffer_storage_multisample(GLenum target, GLsizei samples, GLenum internal_format, GLsizei width, GLsizei height) {}
+static void APIENTRY mock_blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum filter) {}
+
+static GLenum APIENTRY mock_check_framebuffer_status(GLenum target)
+{
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void APIENTRY mock_get_integer_v(GLenum name, GLint *data)
+{
+	*data = name == GL_MAX_SAMPLES ? 8 : name == GL_NUM_EXTENSIONS ? 1 : 0;
+}
+
+static const GLubyte *APIENTRY mock_get_string(GLenum name)
+{
+	return (const GLubyte *)"Mock_Context";
+}
+
+static const GLubyte *APIENTRY mock_get_string_i(GLenum name, GLuint index)
+{
+	// the one extension the engine looks for
+	return (const GLubyte *)"GL_EXT_texture_compression_s3tc";
+}
+
+static void APIENTRY mock_query_counter(GLuint id, GLenum target) {}
+static void APIENTRY mock_begin_query(GLenum target, GLuint id) {}
+
+static void APIENTRY mock_get_query_object_uiv(GLuint id, GLenum name, GLuint *params)
+{
+	*params = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY mock_get_query_object_ui64v(GLuint id, GLenum name, GLuint64 *params)
+{
+	*params = 0;
+}
+
+Mock_Context::Mock_Context()
+{
+	glad_glGenVertexArrays = mock_gen;
+	glad_glGenBuffers = mock_gen;
+	glad_glGenTextures = mock_gen;
+	glad_glGenFramebuffers = mock_gen;
+	glad_glGenRenderbuffers = mock_gen;
+	glad_glGenQueries = mock_gen;
+	glad_glDeleteVertexArrays = mock_delete;
+	glad_glDeleteBuffers = mock_delete;
+	glad_glDeleteTextures = mock_delete;
+	glad_glDeleteFramebuffers = mock_delete;
+	glad_glDeleteRenderbuffers = mock_delete;
+	glad_glDeleteQueries = mock_delete;
+	glad_glCreateProgram = mock_create_program;
+	glad_glCreateShader = mock_create_shader;
+	glad_glDeleteProgram = mock_object;
+	glad_glDeleteShader = mock_object;
+	glad_glShaderSource = mock_shader_source;
+	glad_glCompileShader = mock_object;
+	glad_glAttachShader = mock_attach;
+	glad_glLinkProgram = mock_link_program;
+	glad_glGetShaderiv = mock_get_shader_iv;
+	glad_glGetProgramiv = mock_get_program_iv;
+	glad_glGetActiveUniform = mock_get_active_uniform;
+	glad_glGetActiveUniformBlockName = mock_get_active_uniform_block_name;
+	glad_glGetActiveUniformBlockiv = mock_get_active_uniform_block_iv;
+	glad_glGetShaderInfoLog = mock_get_info_log;
+	glad_glGetProgramInfoLog = mock_get_info_log;
+	glad_glUseProgram = mock_object;
+	glad_glGetUniformLocation = mock_get_uniform_location;
+	glad_glGetUniformBlockIndex = mock_get_uniform_block_index;
+	glad_glUniformBlockBinding = mock_uniform_block_binding;
+	glad_glUniform1i = mock_uniform_1i;
+	glad_glUniform1f = mock_uniform_1f;
+	glad_glUniform2f = mock_uniform_2f;
+	glad_glUniform3f = mock_uniform_3f;
+	glad_glUniform4f = mock_uniform_4f;
+	glad_glUniform2fv = mock_uniform_fv;
+	glad_glUniform3fv = mock_uniform_fv;
+	glad_glUniform4fv = mock_uniform_fv;
+	glad_glUniformMatrix2fv = mock_uniform_matrix_fv;
+	glad_glUniformMatrix3fv = mock_uniform_matrix_fv;
+	glad_glUniformMatrix4fv = mock_uniform_matrix_fv;
+	glad_glBindVertexArray = mock_bind_vertex_array;
+	glad_glBindBuffer = mock_bind;
+	glad_glBindTexture = mock_bind;
+	glad_glBindFramebuffer = mock_bind;
+	glad_glBindRenderbuffer = mock_bind;
+	glad_glBindBufferRange = mock_bind_buffer_range;
+	glad_glActiveTexture = mock_enum;
+	glad_glEnable = mock_enum;
+	glad_glDisable = mock_enum;
+	glad_glDepthFunc = mock_enum;
+	glad_glDrawBuffer = mock_enum;
+	glad_glReadBuffer = mock_enum;
+	glad_glGenerateMipmap = mock_enum;
+	glad_glClear = mock_bitfield;
+	glad_glFinish = mock_void;
+	glad_glBufferData = mock_buffer_data;
+	glad_glBufferSubData = mock_buffer_sub_data;
+	glad_glTexImage2D = mock_tex_image_2d;
+	glad_glTexImage2DMultisample = mock_tex_image_2d_multisample;
+	glad_glCompressedTexImage2D = mock_compressed_tex_image_2d;
+	glad_glTexParameteri = mock_tex_parameter_i;
+	glad_glVertexAttribPointer = mock_vertex_attrib_pointer;
+	glad_glEnableVertexAttribArray = mock_enable_vertex_attrib_array;
+	glad_glDrawArrays = mock_draw_arrays;
+	glad_glDrawElements = mock_draw_elements;
+	glad_glDrawElementsBaseVertex = mock_draw_elements_base_vertex;
+	glad_glMultiDrawElementsBaseVertex = mock_multi_draw_elements_base_vertex;
+	glad_glCopyBufferSubData = mock_copy_buffer_sub_data;
+	glad_glViewport = mock_viewport;
+	glad_glClearColor = mock_clear_color;
+	glad_glFramebufferTexture = mock_framebuffer_texture;
+	glad_glFramebufferTexture2D = mock_framebuffer_texture_2d;
+	glad_glFramebufferRenderbuffer = mock_framebuffer_renderbuffer;
+	glad_glRenderbufferStorage = mock_renderbuffer_storage;
+	glad_glRenderbufferStorageMultisample = mock_renderbuffer_storage_multisample;
+	glad_glBlitFramebuffer = mock_blit_framebuffer;
+	glad_glCheckFramebufferStatus = mock_check_framebuffer_status;
+	glad_glGetIntegerv = mock_get_integer_v;
+	glad_glGetString = mock_get_string;
+	glad_glGetStringi = mock_get_string_i;
+	glad_glQueryCounter = mock_query_counter;
+	glad_glBeginQuery = mock_begin_query;
+	glad_glEndQuery = mock_enum;
+	glad_glGetQueryObjectuiv = mock_get_query_object_uiv;
+	glad_glGetQueryObjectui64v = mock_get_query_object_ui64v;
+}
+
+unsigned long long Mock_Context::uploaded_bytes()
+{
+	return total_uploaded_bytes;
+}
+
+unsigned long long Mock_Context::uniform_lookups()
+{
+	return total_uniform_lookups;
+}
@@ -1,8 +1,123 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
 #include <assimp/Importer.hpp>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include "model.h"
+#include "asset_pack.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet.h"
+#include "profiler.h"
+#include "texture_cache.h"
+
+static const unsigned int import_flags = aiProcess_Triangulate | aiProcess_FlipUVs;		/**< the Assimp post processing the models are imported with, part of the cache key */
+
+Vertex_Format Model::s_vertex_format = VERTEX_FLOAT;
+Mesh_Residency Model::s_mesh_residency = RESIDENCY_DISCARD;
+
+/**
+* @brief	the residency the models create their meshes with, paging in needs a Mesh_Cache to read from
+*/
+static Mesh_Residency mesh_residency()
+{
+	if (Model::s_mesh_residency == RESIDENCY_ON_DEMAND && !Mesh_Cache::s_enabled)
+		return RESIDENCY_KEEP;
+	return Model::s_mesh_residency;
+}
+
+
+//	Assimp file system ---------------------------------------------------------
+
+/**
+* @class Asset_IO_Stream
+* @brief	a file Assimp reads, through an Asset so it comes from the asset pack without a copy
+*/
+class Asset_IO_Stream : public Assimp::IOStream
+{
+public:
+	Asset_IO_Stream(const char *path) : m_asset(path), m_position(0) {}
+
+	bool is_valid() const { return m_asset.is_valid(); }
+
+	size_t Read(void *buffer, size_t size, size_t count)
+	{
+		if (!size)
+			return 0;
+		count = std::min(count, (m_asset.size() - m_position) / size);
+		memcpy(buffer, m_asset.data() + m_position, count * size);
+		m_position += count * size;
+		return count;
+	}
+
+	size_t Write(const void *buffer, size_t size, size_t count) { return 0; }
+
+	aiReturn Seek(size_t offset, aiOrigin origin)
+	{
+		size_t base = origin == aiOrigin_SET ? 0 : origin == aiOrigin_CUR ? m_position : m_asset.size();
+		if (offset > m_asset.size() - base)
+			return aiReturn_FAILURE;
+		m_position = base + offset;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const { return m_position; }
+	size_t FileSize() const { return m_asset.size(); }
+	void Flush() {}
+
+private:
+	Asset m_asset;			/**< the file */
+	size_t m_position;		/**< where the next read starts */
+};
+
+/**
+* @class Asset_IO_System
+* @brief	lets Assimp open the model and the files it references (the OBJ's material library) from the open asset pack, or the loose files,
+*			and lists every file it opened for the Mesh_Cache to check
+*/
+class Asset_IO_System : public Assimp::IOSystem
+{
+public:
+	Asset_IO_System(std::vector<std::string> *opened) : m_opened(opened) {}
+
+	bool Exists(const char *file) const
+	{
+		uint64_t size;
+		int64_t mtime;
+		return Asset_Pack::source_info(file, size, mtime);
+	}
+
+	char getOsSeparator() const { return '/'; }
+
+	Assimp::IOStream *Open(const char *file, const char *mode)
+	{
+		// the assets are read only
+		if (strchr(mode, 'w') || strchr(mode, 'a'))
+			return NULL;
+
+		Asset_IO_Stream *stream = new Asset_IO_Stream(file);
+		if (stream->is_valid())
+		{
+			if (std::find(m_opened->begin(), m_opened->end(), file) == m_opened->end())
+				m_opened->push_back(file);
+			return stream;
+		}
+		delete stream;
+		return NULL;
+	}
+
+	void Close(Assimp::IOStream *file) { delete file; }
+
+private:
+	std::vector<std::string> *m_opened;		/**< receives the path of every file opened, outlives the importer owning the system */
+};
 
 
 Model::Model(char *filepath)
@@ -10,54 +125,300 @@ Model::Model(char *filepath)
 	load_model(filepath);
 }
 
-void Model::draw(Shader shader, bool use_textures)
+Model::Model()
+{
+}
+
+Model::~Model()
+{
+	for (int i = 0; i < m_textures_loaded.size(); i++)
+		Texture_Registry::release(m_textures_loaded[i].id);
+}
+
+void Model::draw(const Shader &shader, bool use_textures) const
+{
+	unsigned int bound_vao = 0;
+	draw(shader, use_textures, bound_vao);
+	glBindVertexArray(0);
+}
+
+void Model::draw(const Shader &shader, bool use_textures, unsigned int &bound_vao) const
 {
+	// the meshes of a format mostly share one arena page, so the vertex array is bound once rather than per mesh
 	for (int i = 0; i < m_meshes.size(); i++)
 	{
-		m_meshes[i].draw(shader, use_textures);
+		m_meshes[i].draw(shader, use_textures, bound_vao);
+	}
+}
+
+void Model::select_lods(const glm::mat4 &transform, const Camera &camera, float viewport_height)
+{
+	PROFILE_ZONE("Model::select_lods");
+
+	// an object space unit at distance d covers scale * projection / d pixels, measured from the nearest point of each mesh's bounding sphere
+	float scale = sqrtf(std::max(std::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])), glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1]))),
+		glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))));
+	float projection = viewport_height / (2.0f * tanf(glm::radians(camera.m_zoom) * 0.5f));
+
+	unsigned int level_selections[max_lod_count] = { 0 };
+	unsigned int selected_triangles = 0, full_triangles = 0, switches = 0;
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		Mesh &mesh = m_meshes[i];
+		glm::vec3 center = glm::vec3(transform * glm::vec4((mesh.m_bounds_min + mesh.m_bounds_max) * 0.5f, 1.0f));
+		float radius = glm::length(mesh.m_bounds_max - mesh.m_bounds_min) * 0.5f * scale;
+		float distance = std::max(glm::length(center - camera.m_position) - radius, 0.1f);
+		if (mesh.select_lod(projection * scale / distance, Mesh_Simplifier::s_error_threshold, Mesh_Simplifier::s_hysteresis))
+			switches++;
+
+		level_selections[mesh.get_lod()]++;
+		selected_triangles += mesh.m_lods[mesh.get_lod()].index_count / 3;
+		full_triangles += mesh.m_lods[0].index_count / 3;
 	}
+	Mesh_Simplifier::record_selections(level_selections, selected_triangles, full_triangles, switches);
 }
 
-void Model::load_model(std::string filepath)
+void Model::cull_meshlets(const glm::mat4 &transform, const glm::mat4 &view_projection, glm::vec3 viewpoint, bool frustum)
 {
+	// the meshlet bounds stay in object space, the view moves there instead
+	Meshlet_Cull_View view = Meshlet_Culler::object_view(transform, view_projection, viewpoint, frustum);
+	Meshlet_Culler::cull(m_meshes.data(), m_meshes.size(), view);
+}
+
+bool Model::page_in(size_t index)
+{
+	Mesh &mesh = m_meshes[index];
+	if (mesh.is_resident())
+		return true;
+	if (mesh.m_residency != RESIDENCY_ON_DEMAND)
+		return false;
+
+	PROFILE_ZONE("Model::page_in");
+	Mesh_Cache cache(m_filepath, import_flags);
+	Cached_Mesh cached;
+	if (!cache.is_valid() || index >= cache.mesh_count() || !cache.read_mesh((unsigned int)index, cached) ||
+		cached.vertices.size() != mesh.m_vertex_count || cached.indices.size() != mesh.m_index_count)
+	{
+		printf("ERROR::MODEL::PAGE_IN mesh %zu isn't in %s\n", index, Mesh_Cache::cache_path(m_filepath).c_str());
+		return false;
+	}
+
+	mesh.page_in(std::vector<vertex>(cached.vertices.begin(), cached.vertices.end()), std::vector<unsigned int>(cached.indices.begin(), cached.indices.end()));
+	return true;
+}
+
+void Model::page_out(size_t index)
+{
+	m_meshes[index].page_out();
+}
+
+Memory_Usage Model::mesh_memory_usage() const
+{
+	Memory_Usage usage;
+	for (size_t i = 0; i < m_meshes.size(); i++)
+		usage += m_meshes[i].memory_usage();
+	return usage;
+}
+
+/**
+* @brief	check if a texture reference is the first one to its texture, m_textures_loaded has a reference per use
+*/
+static bool first_use(const std::vector<texture> &textures, size_t index)
+{
+	for (size_t i = 0; i < index; i++)
+	{
+		if (textures[i].id == textures[index].id)
+			return false;
+	}
+	return true;
+}
+
+Memory_Usage Model::texture_memory_usage() const
+{
+	Memory_Usage usage;
+	for (size_t i = 0; i < m_textures_loaded.size(); i++)
+	{
+		if (first_use(m_textures_loaded, i))
+			usage.gpu_bytes += Texture_Registry::gpu_bytes(m_textures_loaded[i].id);
+	}
+	return usage;
+}
+
+Memory_Usage Model::memory_usage() const
+{
+	Memory_Usage usage(sizeof(Model) + m_textures_loaded.capacity() * sizeof(texture) + m_directory.capacity() + m_filepath.capacity());
+	usage += mesh_memory_usage();
+	usage += texture_memory_usage();
+	return usage;
+}
+
+void Model::print_memory_usage() const
+{
+	Memory_Usage total = memory_usage();
+	printf("model memory: %.2f MB CPU, %.2f MB GPU (%s)\n", total.cpu_bytes / 1e6, total.gpu_bytes / 1e6, m_filepath.c_str());
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		Memory_Usage mesh = m_meshes[i].memory_usage();
+		printf("  mesh %zu: %.1f KB CPU, %.1f KB GPU, %u vertices, %s\n", i, mesh.cpu_bytes / 1e3, mesh.gpu_bytes / 1e3, m_meshes[i].m_vertex_count,
+			m_meshes[i].is_resident() && m_meshes[i].m_vertex_count ? "resident" : "paged out");
+	}
+	for (size_t i = 0; i < m_textures_loaded.size(); i++)
+	{
+		if (first_use(m_textures_loaded, i))
+			printf("  texture %s: %.1f KB GPU\n", m_textures_loaded[i].path.C_Str(), Texture_Registry::gpu_bytes(m_textures_loaded[i].id) / 1e3);
+	}
+}
+
+void Model::load_model(const std::string &filepath)
+{
+	PROFILE_ZONE("Model::load_model");
+
+	// niffty use of substr to get the directory of the model from the filepath
+	m_filepath = filepath;
+	m_directory = filepath.substr(0, filepath.find_last_of('/')); 
+
+	if (Mesh_Cache::s_enabled && load_cached_model(filepath))
+		return;
+
+	std::vector<Mesh_Data> meshes;
+	if (!import_model(filepath, meshes))
+		return;
+
+	m_meshes.reserve(meshes.size());
+	for (int i = 0; i < meshes.size(); i++)
+		m_meshes.push_back(create_mesh(std::move(meshes[i])));
+}
+
+bool Model::import_model(const std::string &filepath, std::vector<Mesh_Data> &meshes)
+{
+	PROFILE_ZONE("Model::import_model");
+
+	std::vector<std::string> opened;
 	Assimp::Importer import;
-	const aiScene *scene = import.ReadFile(filepath, aiProcess_Triangulate | aiProcess_FlipUVs);
+	import.SetIOHandler(new Asset_IO_System(&opened));		// the importer owns it
+	PROFILE_BEGIN(import, "Assimp::ReadFile");
+	const aiScene *scene = import.ReadFile(filepath, import_flags);
+	PROFILE_END(import);
 
 	// check if the scene and the root node of the scene are not null and check one of its flags to see if the returned data is incomplete
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
 		printf("ERROR::ASSIMP::%s\n", import.GetErrorString());
-		return;
+		return false;
 	}
 
-	// niffty use of substr to get the directory of the model from the filepath
-	m_directory = filepath.substr(0, filepath.find_last_of('/')); 
-
 	// recursively traverse Assimp's nodes
-	process_node(scene->mRootNode, scene);
+	meshes.reserve(scene->mNumMeshes);
+	process_node(scene->mRootNode, scene, meshes);
+
+	if (Mesh_Cache::s_enabled)
+	{
+		PROFILE_ZONE("Mesh_Cache::write");
+		Mesh_Cache::write(filepath, import_flags, opened, meshes);
+	}
+
+	return true;
 }
 
-void Model::process_node(aiNode *node, const aiScene *scene)
+bool Model::read_cached_model(const std::string &filepath, std::vector<Mesh_Data> &meshes)
+{
+	PROFILE_ZONE("Model::read_cached_model");
+
+	Mesh_Cache cache(filepath, import_flags);
+	if (!cache.is_valid())
+		return false;
+
+	meshes.resize(cache.mesh_count());
+	for (unsigned int i = 0; i < cache.mesh_count(); i++)
+	{
+		Cached_Mesh cached;
+		if (!cache.read_mesh(i, cached))
+		{
+			printf("ERROR::MESH_CACHE::CORRUPT_MESH %u in %s\n", i, Mesh_Cache::cache_path(filepath).c_str());
+			meshes.clear();
+			return false;
+		}
+
+		// the mapping is gone once this returns, so the streams are copied
+		Mesh_Data &data = meshes[i];
+		data.vertices.assign(cached.vertices.begin(), cached.vertices.end());
+		data.indices.assign(cached.indices.begin(), cached.indices.end());
+		data.lods.assign(cached.lods.begin(), cached.lods.end());
+		data.bounds_min = cached.bounds_min;
+		data.bounds_max = cached.bounds_max;
+		data.textures.resize(cached.texture_count);
+		for (unsigned int j = 0; j < cached.texture_count; j++)
+		{
+			data.textures[j].id = 0;
+			data.textures[j].type = cache.texture_type(cached.texture_first + j);
+			data.textures[j].path = aiString(cache.texture_path(cached.texture_first + j));
+		}
+	}
+
+	return true;
+}
+
+bool Model::load_cached_model(const std::string &filepath)
+{
+	PROFILE_ZONE("Model::load_cached_model");
+
+	Mesh_Cache cache(filepath, import_flags);
+	if (!cache.is_valid())
+		return false;
+
+	m_meshes.reserve(cache.mesh_count());
+	for (unsigned int i = 0; i < cache.mesh_count(); i++)
+	{
+		Cached_Mesh cached;
+		if (!cache.read_mesh(i, cached))
+		{
+			printf("ERROR::MESH_CACHE::CORRUPT_MESH %u in %s\n", i, Mesh_Cache::cache_path(filepath).c_str());
+			m_meshes.clear();
+			return false;
+		}
+
+		std::vector<texture> textures;
+		textures.reserve(cached.texture_count);
+		for (unsigned int j = 0; j < cached.texture_count; j++)
+			textures.push_back(get_texture(cache.texture_path(cached.texture_first + j), cache.texture_type(cached.texture_first + j)));
+
+		m_meshes.emplace_back(cached.vertices, cached.indices, std::move(textures), cached.bounds_min, cached.bounds_max, cached.lods, s_vertex_format, mesh_residency());
+	}
+
+	return true;
+}
+
+void Model::process_node(aiNode *node, const aiScene *scene, std::vector<Mesh_Data> &meshes)
 {
 	// process all the meshes from this node first
 	for (int i = 0; i < node->mNumMeshes; i++)
 	{
 		aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-		m_meshes.push_back(process_mesh(mesh, scene));
+		meshes.push_back(import_mesh(mesh, scene));
+		if (Mesh_Optimizer::s_enabled)
+			Mesh_Optimizer::optimize(meshes.back(), mesh->mName.C_Str());
+		if (Mesh_Simplifier::s_lod_count > 1)
+			Mesh_Simplifier::build_lods(meshes.back());
+		cluster_meshlets(meshes.back());
 	}
 
 	// after we've processed all the meshes then recursively process the children nodes
 	for (int i = 0; i < node->mNumChildren; i++)
 	{
-		process_node(node->mChildren[i], scene);
+		process_node(node->mChildren[i], scene, meshes);
 	}
 }
 
-Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
+Mesh_Data Model::import_mesh(aiMesh *mesh, const aiScene *scene)
 {
-	std::vector<vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<texture> textures;
+	PROFILE_ZONE("Model::import_mesh");
+
+	Mesh_Data data;
+	std::vector<vertex> &vertices = data.vertices;
+	std::vector<unsigned int> &indices = data.indices;
+	std::vector<texture> &textures = data.textures;
+	vertices.reserve(mesh->mNumVertices);
+	indices.reserve(mesh->mNumFaces * 3);		// the faces are triangulated on import
 
 	for (int i = 0; i < mesh->mNumVertices; i++)
 	{
@@ -101,7 +462,7 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
 	// now walk through each of the mesh's faces (a face of a mesh is its triangle) and retrieve the corresponding vertex indices.
 	for (int i = 0; i < mesh->mNumFaces; i++)
 	{
-		aiFace face = mesh->mFaces[i];
+		const aiFace &face = mesh->mFaces[i];
 
 		// get all the indices of the face and store them in the indices vector
 		for (int j = 0; j < face.mNumIndices; j++)
@@ -119,100 +480,158 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
 	// specular: "specular_map<N>"
 	// normal: "normal_map<N>"
 
+	textures.reserve(material->GetTextureCount(aiTextureType_DIFFUSE) + material->GetTextureCount(aiTextureType_SPECULAR)
+		+ material->GetTextureCount(aiTextureType_HEIGHT) + 2 * material->GetTextureCount(aiTextureType_AMBIENT));
 	// 1. diffuse maps
-	std::vector<texture> diffuse_maps = load_material_textures(material, aiTextureType_DIFFUSE, DIFFUSE_MAP);
-	textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
+	load_material_textures(material, aiTextureType_DIFFUSE, DIFFUSE_MAP, textures);
 	// 2. specular maps
-	std::vector<texture> specular_maps = load_material_textures(material, aiTextureType_SPECULAR, SPECULAR_MAP);
-	textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
+	load_material_textures(material, aiTextureType_SPECULAR, SPECULAR_MAP, textures);
 	// 3. normal maps
-	std::vector<texture> normal_maps = load_material_textures(material, aiTextureType_HEIGHT, NORMAL_MAP);
-	textures.insert(textures.end(), normal_maps.begin(), normal_maps.end());
+	load_material_textures(material, aiTextureType_HEIGHT, NORMAL_MAP, textures);
 	// 4. height maps
-	std::vector<texture> height_maps = load_material_textures(material, aiTextureType_AMBIENT, HEIGHT_MAP);
-	textures.insert(textures.end(), height_maps.begin(), height_maps.end());
+	load_material_textures(material, aiTextureType_AMBIENT, HEIGHT_MAP, textures);
 	// 5. reflection maps
-	std::vector<texture> reflection_maps = load_material_textures(material, aiTextureType_AMBIENT, REFLECTION_MAP);
-	textures.insert(textures.end(), reflection_maps.begin(), reflection_maps.end());
+	load_material_textures(material, aiTextureType_AMBIENT, REFLECTION_MAP, textures);
 
-	return Mesh(vertices, indices, textures);
+	vertex_bounds(vertices, data.bounds_min, data.bounds_max);
+	return data;
 }
 
-std::vector<texture> Model::load_material_textures(aiMaterial *material, aiTextureType type, Texture_Type type_name)
+Mesh Model::create_mesh(Mesh_Data &&data)
 {
-	std::vector<texture> textures;
+	// the imported textures only have a path and a type, swap them for the loaded ones
+	for (int i = 0; i < data.textures.size(); i++)
+		data.textures[i] = get_texture(data.textures[i].path.C_Str(), data.textures[i].type);
+
+	return Mesh(std::move(data), s_vertex_format, mesh_residency());
+}
 
+void Model::load_material_textures(aiMaterial *material, aiTextureType type, Texture_Type type_name, std::vector<texture> &textures)
+{
 	for (int i = 0; i < material->GetTextureCount(type); i++)
 	{
 		aiString s;
 		material->GetTexture(type, i, &s);
 
-		// check if texture already loaded, if so skip
-		bool skip = false;
-		for (int j = 0; j < m_textures_loaded.size(); j++)
-		{
-			if (std::strcmp(m_textures_loaded[j].path.C_Str(), s.C_Str()) == 0)
-			{
-				textures.push_back(m_textures_loaded[j]);
-				skip = true;
-				break;
-			}
-		}
-		if (!skip)
-		{
-			texture t;
-			t.id = load_texture_from_filepath(s.C_Str(), m_directory);
-			t.type = type_name;
-			t.path = s;
-			textures.push_back(t);
-			m_textures_loaded.push_back(t);
-		}
+		texture t;
+		t.id = 0;
+		t.type = type_name;
+		t.path = s;
+		textures.push_back(t);
 	}
+}
 
-	return textures;
+texture Model::get_texture(const char *path, Texture_Type type)
+{
+	// every use takes its own reference, a texture shared by several meshes is found in the registry after the first
+	std::string filepath = m_directory + '/' + path;
+
+	texture t;
+	t.id = Texture_Registry::acquire(filepath.c_str(), texture_parameters(type));
+	t.type = type;
+	t.path = aiString(path);
+	m_textures_loaded.push_back(t);
+	return t;
+}
+
+Texture_Parameters Model::texture_parameters(Texture_Type type)
+{
+	// normal maps are directions, not colors, so their levels are averaged as stored
+	Mip_Filter mip_filter = type == NORMAL_MAP ? MIP_FILTER_LINEAR : MIP_FILTER_SRGB;
+	if (!Texture_Cache::s_enabled)
+		return Texture_Parameters(false, WRAP_REPEAT, COMPRESS_NONE, mip_filter);
+	return Texture_Parameters(false, WRAP_REPEAT, type == NORMAL_MAP ? COMPRESS_NORMAL : COMPRESS_COLOR, mip_filter);
 }
 
 
 unsigned int load_texture_from_filepath(const char *filename, const std::string &directory)
 {
+	PROFILE_ZONE("load_texture_from_filepath");
+
 	std::string filepath = std::string(filename);
 	filepath = directory + '/' + filepath;
 
+	if (Texture_Cache::s_enabled && Texture_Cache::is_supported(false))
+	{
+		Compressed_Image compressed;
+		if (Texture_Cache::read(filepath, COMPRESS_COLOR, compressed))
+			return create_compressed_texture(compressed);
+	}
+
+	int width = 0, height = 0, nr_components = 0;
+	Asset file(filepath.c_str());
+	PROFILE_BEGIN(decode, "stbi_load_from_memory");
+	unsigned char *data = file.is_valid() ? stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &nr_components, 0) : NULL;
+	PROFILE_END(decode);
+	if (!data)
+		printf("Texture failed to load at path: %s\n", filepath.c_str());
+
+	unsigned int texture_id = create_texture(data, width, height, nr_components);
+	stbi_image_free(data);
+	return texture_id;
+}
+
+unsigned int create_texture(const unsigned char *data, int width, int height, int nr_components, const Texture_Parameters &parameters, const Mip_Chain *mips)
+{
 	unsigned int texture_id;
 	glGenTextures(1, &texture_id);
 
-	int width, height, nr_components;
-	unsigned char *data = stbi_load(filepath.c_str(), &width, &height, &nr_components, 0);
 	if (data)
 	{
-		GLenum format;
+		// gray and alpha is created as RGBA, the layout its mip levels are built in
+		std::vector<unsigned char> expanded;
+		if (nr_components == 2)
+		{
+			expand_to_rgba(data, width, height, nr_components, expanded);
+			data = expanded.data();
+			nr_components = 4;
+		}
+
+		GLenum internal_format, format;
 		if (nr_components == 1)
-			format = GL_RED;
+			internal_format = format = GL_RED;
 		else if (nr_components == 3)
 		{
+			internal_format = parameters.srgb ? GL_SRGB : GL_RGB;
 			format = GL_RGB;
 		}
 		else if (nr_components == 4)
 		{
+			internal_format = parameters.srgb ? GL_SRGB_ALPHA : GL_RGBA;
 			format = GL_RGBA;
 		}
+		else
+		{
+			printf("ERROR::TEXTURE::UNSUPPORTED_COMPONENTS %d\n", nr_components);
+			return texture_id;
+		}
 
+		GLint wrap = GL_REPEAT;
+		if (parameters.wrap == WRAP_CLAMP_TO_EDGE || (parameters.wrap == WRAP_CLAMP_IF_ALPHA && format == GL_RGBA))
+			wrap = GL_CLAMP_TO_EDGE;
+
+		Mip_Chain generated;
+		if (!mips)
+		{
+			generate_mip_chain(data, width, height, nr_components, parameters.mip_filter, generated);
+			mips = &generated;
+		}
+
+		// the levels below 0 are RGBA whatever the image has, the internal format stays the same
 		glBindTexture(GL_TEXTURE_2D, texture_id);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		for (int i = 0; i < mips->levels.size(); i++)
+		{
+			const Mip_Level &level = mips->levels[i];
+			glTexImage2D(GL_TEXTURE_2D, i + 1, internal_format, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &mips->pixels[level.offset]);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mips->levels.size());
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		printf("Texture failed to load at path: %s\n", filepath);
-		stbi_image_free(data);
 	}
 
 	return texture_id;
-}
\ No newline at end of file
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include "model_loader.h"
+#include "mesh_cache.h"
+#include "profiler.h"
+#include "texture_cache.h"
+
+/**
+* @struct Loader_Texture
+* @brief	a texture of a model in flight, found in the Texture_Registry or decoded (or read from its Texture_Cache) on a worker and created on the GL thread or by the Texture_Uploader
+*/
+struct Loader_Texture
+{
+	std::string path;			/**< the path relative to the model's directory, as stored in the material */
+	std::string filepath;		/**< the path the registry knows it by */
+	Texture_Parameters parameters;	/**< how the texture is created, Model::texture_parameters of the first mesh texture using the path */
+	const Decoded_Image *image;	/**< the decoded image waiting for the GL thread, NULL once created or if it was found in the registry */
+	Mip_Chain *mips;			/**< the image's mip levels, built on the worker next to the decode */
+	Compressed_Image *compressed;	/**< the compressed image waiting for the GL thread instead, they are small enough to be uploaded there even with a Texture_Uploader */
+	unsigned int id;			/**< the registered texture once there is one, the request holds a reference until the model has its own */
+};
+
+/**
+* @struct Model_Request
+* @brief	a model in flight, the workers fill in the meshes and textures and the GL thread turns them into the Model
+*/
+struct Model_Request
+{
+	std::string filepath;							/**< the path to the model */
+	std::string directory;							/**< the directory of the model, the textures are relative to it */
+	std::chrono::high_resolution_clock::time_point start;	/**< when the load was requested */
+
+	// written by the workers, read by the GL thread once pending_jobs is 0
+	std::vector<Mesh_Data> meshes;					/**< the imported meshes */
+	std::vector<Loader_Texture> textures;			/**< every distinct texture of the meshes */
+	bool failed;									/**< if the import failed */
+	bool compress_textures;							/**< if the context supports the block formats, checked on the GL thread */
+	std::atomic<int> pending_jobs;					/**< the import, texture decodes and background uploads still running, the GL steps start at 0 */
+	std::atomic<bool> cancelled;					/**< the handle was deleted, the jobs still queued skip their work */
+
+	// only touched by the GL thread
+	Model_Handle *handle;							/**< the handle to complete, NULL once it is deleted */
+	Model *model;									/**< the model being assembled */
+	size_t next_texture;							/**< the next texture to upload */
+	size_t next_mesh;								/**< the next mesh to create */
+};
+
+static double milliseconds_since(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/**
+* @brief	finds one texture of a request in the registry or decodes it on a worker, and hands it to the uploader if there is one
+*/
+static void decode_texture(Model_Request *request, size_t index, Texture_Uploader *uploader, Thread_Pool *pool)
+{
+	Loader_Texture &t = request->textures[index];
+	if (!request->cancelled.load(std::memory_order_relaxed))
+	{
+		PROFILE_ZONE("Model_Loader::decode_texture");
+		t.id = Texture_Registry::find(t.filepath.c_str(), t.parameters);
+		if (!t.id && t.parameters.compression != COMPRESS_NONE && request->compress_textures)
+		{
+			t.compressed = new Compressed_Image();
+			if (!Texture_Cache::load(t.filepath, t.parameters.compression, *t.compressed, pool))
+			{
+				delete t.compressed;
+				t.compressed = NULL;
+			}
+		}
+		if (!t.id && !t.compressed)
+			t.image = Texture_Registry::decode(t.filepath.c_str());
+		if (t.image)
+		{
+			t.mips = new Mip_Chain();
+			generate_mip_chain(t.image->pixels, t.image->width, t.image->height, t.image->components, t.parameters.mip_filter, *t.mips, pool);
+		}
+
+		if (t.image && uploader)
+		{
+			// the job stays pending until the texture is complete, the completion registers it and publishes the id to the GL thread
+			uploader->upload(t.image->pixels, t.image->width, t.image->height, t.image->components, t.parameters, t.mips, [request, index](unsigned int id) {
+				Loader_Texture &t = request->textures[index];
+				t.id = Texture_Registry::insert(t.filepath.c_str(), t.parameters, id);
+				if (t.id != id)
+					glDeleteTextures(1, &id);		// another model registered it first, the upload thread's context can delete it
+				request->pending_jobs.fetch_sub(1, std::memory_order_acq_rel);
+			});
+			Texture_Registry::release_image(t.image);
+			delete t.mips;
+			t.image = NULL;
+			t.mips = NULL;
+			return;
+		}
+	}
+
+	// publishes the image or id to the GL thread
+	request->pending_jobs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+/**
+* @brief	drops what a request holds on to (the decoded and compressed images and its texture references), on the GL thread
+*/
+static void release_textures(Model_Request *request)
+{
+	for (int i = 0; i < request->textures.size(); i++)
+	{
+		Loader_Texture &t = request->textures[i];
+		if (t.image)
+			Texture_Registry::release_image(t.image);
+		delete t.mips;
+		delete t.compressed;
+		Texture_Registry::release(t.id);
+		t.image = NULL;
+		t.mips = NULL;
+		t.compressed = NULL;
+		t.id = 0;
+	}
+}
+
+//	Model_Handle ---------------------------------------------------------------
+
+Model_Handle::Model_Handle(Model_Request *request)
+	: m_request(request), m_model(NULL), m_failed(false), m_load_ms(0.0)
+{
+}
+
+Model_Handle::~Model_Handle()
+{
+	// the loader deletes the request once its jobs are done
+	if (m_request)
+	{
+		m_request->handle = NULL;
+		m_request->cancelled.store(true, std::memory_order_relaxed);
+	}
+	delete m_model;
+}
+
+//	Model_Loader ---------------------------------------------------------------
+
+Model_Loader::Model_Loader(unsigned int thread_count, Texture_Uploader *uploader)
+	: m_uploader(uploader)
+{
+	m_pool = new Thread_Pool(thread_count);
+}
+
+Model_Loader::~Model_Loader()
+{
+	// the queued jobs skip their work, then the workers are joined so nothing touches the requests anymore
+	for (int i = 0; i < m_requests.size(); i++)
+		m_requests[i]->cancelled.store(true, std::memory_order_relaxed);
+	delete m_pool;
+	if (m_uploader)
+		m_uploader->finish();
+
+	for (int i = 0; i < m_requests.size(); i++)
+	{
+		Model_Request *request = m_requests[i];
+		release_textures(request);
+		delete request->model;
+		if (request->handle)
+		{
+			request->handle->m_request = NULL;
+			request->handle->m_failed = true;
+		}
+		delete request;
+	}
+}
+
+Model_Handle *Model_Loader::load(const char *filepath)
+{
+	Model_Request *request = new Model_Request();
+	request->filepath = filepath;
+	request->directory = request->filepath.substr(0, request->filepath.find_last_of('/'));
+	request->start = std::chrono::high_resolution_clock::now();
+	request->failed = false;
+	request->compress_textures = Texture_Cache::is_supported(false);
+	request->pending_jobs.store(1);
+	request->cancelled.store(false);
+	request->model = NULL;
+	request->next_texture = 0;
+	request->next_mesh = 0;
+
+	Model_Handle *handle = new Model_Handle(request);
+	request->handle = handle;
+	m_requests.push_back(request);
+
+	m_pool->submit([this, request] { import(request); });
+	return handle;
+}
+
+void Model_Loader::import(Model_Request *request)
+{
+	if (!request->cancelled.load(std::memory_order_relaxed))
+	{
+		PROFILE_ZONE("Model_Loader::import");
+
+		if (!(Mesh_Cache::s_enabled && Model::read_cached_model(request->filepath, request->meshes)) && !Model::import_model(request->filepath, request->meshes))
+			request->failed = true;
+
+		// one decode per distinct path and compression, meshes sharing a texture share the upload like they do through Model::get_texture
+		for (int i = 0; i < request->meshes.size(); i++)
+		{
+			const std::vector<texture> &textures = request->meshes[i].textures;
+			for (int j = 0; j < textures.size(); j++)
+			{
+				Texture_Parameters parameters = Model::texture_parameters(textures[j].type);
+				bool found = false;
+				for (int k = 0; k < request->textures.size() && !found; k++)
+					found = request->textures[k].path == textures[j].path.C_Str() && request->textures[k].parameters.compression == parameters.compression;
+				if (found)
+					continue;
+
+				Loader_Texture t;
+				t.path = textures[j].path.C_Str();
+				t.filepath = request->directory + '/' + t.path;
+				t.parameters = parameters;
+				t.image = NULL;
+				t.mips = NULL;
+				t.compressed = NULL;
+				t.id = 0;
+				request->textures.push_back(t);
+			}
+		}
+
+		// the textures vector is complete before any decode starts, so the jobs can hold on to their element
+		request->pending_jobs.fetch_add((int)request->textures.size(), std::memory_order_relaxed);
+		Texture_Uploader *uploader = m_uploader;
+		Thread_Pool *pool = m_pool;
+		for (size_t i = 0; i < request->textures.size(); i++)
+			m_pool->submit([request, i, uploader, pool] { decode_texture(request, i, uploader, pool); });
+	}
+
+	request->pending_jobs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool Model_Loader::step(Model_Request *request)
+{
+	if (!request->handle)
+	{
+		release_textures(request);
+		delete request->model;
+		return true;
+	}
+
+	if (request->failed)
+	{
+		request->handle->m_failed = true;
+		request->handle->m_request = NULL;
+		request->handle->m_load_ms = milliseconds_since(request->start);
+		return true;
+	}
+
+	if (!request->model)
+	{
+		request->model = new Model();
+		request->model->m_directory = request->directory;
+		request->model->m_filepath = request->filepath;
+		request->model->m_meshes.reserve(request->meshes.size());
+	}
+
+	// textures first, so create_mesh finds every texture in the registry
+	if (request->next_texture < request->textures.size())
+	{
+		Loader_Texture &t = request->textures[request->next_texture++];
+		if (t.image || t.compressed)
+		{
+			PROFILE_ZONE("Model_Loader::upload_texture");
+			unsigned int id;
+			if (t.compressed)
+				id = create_compressed_texture(*t.compressed, t.parameters);
+			else
+				id = create_texture(t.image->pixels, t.image->width, t.image->height, t.image->components, t.parameters, t.mips);
+			t.id = Texture_Registry::insert(t.filepath.c_str(), t.parameters, id);
+			if (t.id != id)
+				glDeleteTextures(1, &id);
+			if (t.image)
+				Texture_Registry::release_image(t.image);
+			delete t.mips;
+			delete t.compressed;
+			t.image = NULL;
+			t.mips = NULL;
+			t.compressed = NULL;
+		}
+		return false;
+	}
+
+	if (request->next_mesh < request->meshes.size())
+	{
+		PROFILE_ZONE("Model_Loader::create_mesh");
+		Mesh_Data &data = request->meshes[request->next_mesh++];
+		request->model->m_meshes.push_back(request->model->create_mesh(std::move(data)));
+		return false;
+	}
+
+	// the meshes took their own references
+	release_textures(request);
+
+	request->handle->m_model = request->model;
+	request->handle->m_request = NULL;
+	request->handle->m_load_ms = milliseconds_since(request->start);
+	request->model = NULL;
+	return true;
+}
+
+void Model_Loader::update(double budget_ms)
+{
+	PROFILE_ZONE("Model_Loader::update");
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	std::vector<Model_Request *>::iterator it = m_requests.begin();
+	while (it != m_requests.end())
+	{
+		Model_Request *request = *it;
+		if (request->pending_jobs.load(std::memory_order_acquire) != 0)
+		{
+			++it;
+			continue;
+		}
+
+		bool finished;
+		do
+		{
+			finished = step(request);
+		} while (!finished && milliseconds_since(start) < budget_ms);
+
+		if (finished)
+		{
+			delete request;
+			it = m_requests.erase(it);
+		}
+
+		if (milliseconds_since(start) >= budget_ms)
+			return;
+	}
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "profiler.h"
+
+std::atomic<bool> Profiler::s_enabled(false);
+std::atomic<unsigned int> Profiler::s_frame(0);
+
+/**
+* @struct Profile_Block
+* @brief	a fixed size chunk of a thread's events, written only by that thread
+*/
+struct Profile_Block
+{
+	static const unsigned int capacity = 4096;	/**< number of events per block */
+
+	Profile_Event events[capacity];				/**< the events, only the first count are valid */
+	std::atomic<unsigned int> count;			/**< number of events published, stored after each event is written */
+	std::atomic<Profile_Block *> next;			/**< the block recorded after this one, NULL for the last */
+
+	Profile_Block() : count(0), next(NULL) {}
+};
+
+/**
+* @struct Profile_Thread
+* @brief	the event buffer of one thread
+*/
+struct Profile_Thread
+{
+	unsigned int id;		/**< id of the thread in the trace */
+	std::string name;		/**< name of the thread in the trace, guarded by the registry mutex */
+	Profile_Block *first;	/**< first block, read by write_chrome_trace */
+	Profile_Block *last;	/**< block being written, only used by the owning thread */
+};
+
+static std::mutex registry_mutex;							/**< guards the list of threads and their names */
+static std::vector<Profile_Thread *> registered_threads;	/**< every thread that has recorded something */
+static thread_local Profile_Thread *current_thread = NULL;	/**< the buffer of the calling thread */
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+/**
+* @brief	the buffer of the calling thread, registering it the first time
+*/
+static Profile_Thread *get_thread()
+{
+	if (!current_thread)
+	{
+		Profile_Thread *thread = new Profile_Thread;
+		thread->first = thread->last = new Profile_Block;
+
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		registered_threads.push_back(thread);
+		thread->id = registered_threads.size();
+		current_thread = thread;
+	}
+	return current_thread;
+}
+
+/**
+* @brief	appends an event to the buffer of the calling thread and publishes it
+*/
+static void record(const Profile_Event &e)
+{
+	Profile_Thread *thread = get_thread();
+	Profile_Block *block = thread->last;
+	unsigned int count = block->count.load(std::memory_order_relaxed);
+	if (count == Profile_Block::capacity)
+	{
+		Profile_Block *next = new Profile_Block;
+		block->next.store(next, std::memory_order_release);
+		thread->last = block = next;
+		count = 0;
+	}
+
+	block->events[count] = e;
+	block->count.store(count + 1, std::memory_order_release);
+}
+
+long long Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void Profiler::zone(const char *name, long long start_ns, long long end_ns)
+{
+	Profile_Event e = { name, 'X', start_ns, end_ns - start_ns, 0.0 };
+	record(e);
+}
+
+void Profiler::counter(const char *name, double value)
+{
+	Profile_Event e = { name, 'C', now(), 0, value };
+	record(e);
+}
+
+void Profiler::frame_marker()
+{
+	Profile_Event e = { "frame", 'i', now(), 0, (double)s_frame.fetch_add(1, std::memory_order_relaxed) };
+	record(e);
+}
+
+void Profiler::set_thread_name(const char *name)
+{
+	Profile_Thread *thread = get_thread();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	thread->name = name;
+}
+
+bool Profiler::write_chrome_trace(const char *filepath)
+{
+	FILE *file = fopen(filepath, "w");
+	if (!file)
+	{
+		printf("ERROR::PROFILER::FAILED_TO_OPEN %s\n", filepath);
+		return false;
+	}
+
+	// the threads keep recording while this runs, only the events published before each block is read are written
+	std::vector<Profile_Thread *> threads;
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		threads = registered_threads;
+		for (unsigned int i = 0; i < threads.size(); i++)
+			names.push_back(threads[i]->name);
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"displayTimeUnit\": \"ms\",\n");
+	fprintf(file, "\t\"traceEvents\": [\n");
+	fprintf(file, "\t\t{ \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": { \"name\": \"Engine\" } }");
+
+	for (unsigned int i = 0; i < threads.size(); i++)
+	{
+		unsigned int tid = threads[i]->id;
+		if (!names[i].empty())
+			fprintf(file, ",\n\t\t{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": { \"name\": \"%s\" } }", tid, names[i].c_str());
+
+		for (Profile_Block *block = threads[i]->first; block; block = block->next.load(std::memory_order_acquire))
+		{
+			unsigned int count = block->count.load(std::memory_order_acquire);
+			for (unsigned int j = 0; j < count; j++)
+			{
+				const Profile_Event &e = block->events[j];
+				double ts = e.start_ns / 1000.0;
+				switch (e.type)
+				{
+				case 'X':
+					fprintf(file, ",\n\t\t{ \"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u }",
+						e.name, ts, e.duration_ns / 1000.0, tid);
+					break;
+				case 'C':
+					fprintf(file, ",\n\t\t{ \"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u, \"args\": { \"value\": %g } }",
+						e.name, ts, tid, e.value);
+					break;
+				case 'i':
+					fprintf(file, ",\n\t\t{ \"name\": \"%s\", \"ph\": \"i\", \"s\": \"g\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u, \"args\": { \"frame\": %u } }",
+						e.name, ts, tid, (unsigned int)e.value);
+					break;
+				}
+			}
+		}
+	}
+
+	fprintf(file, "\n\t]\n");
+	fprintf(file, "}\n");
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "program_cache.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "profiler.h"
+
+bool Program_Cache::s_enabled = true;
+
+//	File format ----------------------------------------------------------------
+//	header | binary, bump cache_version when the header changes
+
+static const char cache_magic[8] = { 'E', 'P', 'R', 'G', 'C', 'A', 'C', 'H' };
+static const uint32_t cache_version = 1;
+
+struct Cache_Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t binary_format;		/**< the format glGetProgramBinary returned, handed back to glProgramBinary */
+	uint64_t key;				/**< Program_Cache::key of the sources and the driver */
+	uint64_t binary_size;
+	double compile_ms;			/**< how long compiling and linking took when the binary was written */
+};
+
+static std::mutex statistics_mutex;
+static Program_Cache_Statistics counters;
+
+/**
+* @brief	the hash of the driver's vendor, renderer and version strings, a binary is only valid for the driver that made it
+*/
+static unsigned long long driver_key()
+{
+	static unsigned long long key = 0;
+	if (!key)
+	{
+		const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		key = fnv1a_offset;
+		for (int i = 0; i < 3; i++)
+		{
+			const char *string = (const char *)glGetString(names[i]);
+			key = fnv1a_string(string ? string : "", key);
+			key = fnv1a("\n", 1, key);
+		}
+	}
+	return key;
+}
+
+bool Program_Cache::is_supported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		GLint formats = 0;
+		if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		supported = formats > 0;
+	}
+	return supported != 0;
+}
+
+unsigned long long Program_Cache::key(const char *const *sources, const int *lengths, unsigned int count)
+{
+	unsigned long long key = driver_key();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		// the length goes in first so moving text from one stage to the next changes the key
+		key = hash_combine(key, (unsigned long long)lengths[i]);
+		key = fnv1a(sources[i], lengths[i], key);
+	}
+	return key;
+}
+
+unsigned int Program_Cache::load(const std::string &cache_path, unsigned long long key)
+{
+	PROFILE_ZONE("Program_Cache::load");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	Mapped_File file(cache_path.c_str());
+	Cache_Header header;
+	bool valid = file.is_valid() && file.size() >= sizeof(Cache_Header);
+	if (valid)
+	{
+		memcpy(&header, file.data(), sizeof(header));
+		valid = memcmp(header.magic, cache_magic, sizeof(cache_magic)) == 0 && header.version == cache_version
+			&& header.key == key && header.binary_size == file.size() - sizeof(Cache_Header);
+	}
+	if (!valid)
+	{
+		std::lock_guard<std::mutex> lock(statistics_mutex);
+		counters.misses++;
+		return 0;
+	}
+
+	unsigned int program = glCreateProgram();
+	glProgramBinary(program, header.binary_format, file.data() + sizeof(Cache_Header), (GLsizei)header.binary_size);
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		std::lock_guard<std::mutex> lock(statistics_mutex);
+		counters.rejected++;
+		return 0;
+	}
+
+	double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.hits++;
+	counters.load_ms += load_ms;
+	counters.saved_ms += header.compile_ms - load_ms;
+	return program;
+}
+
+bool Program_Cache::write(const std::string &cache_path, unsigned long long key, unsigned int program, double compile_ms)
+{
+	PROFILE_ZONE("Program_Cache::write");
+	{
+		std::lock_guard<std::mutex> lock(statistics_mutex);
+		counters.compile_ms += compile_ms;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	std::vector<unsigned char> contents(sizeof(Cache_Header) + length);
+	GLenum binary_format = 0;
+	GLsizei written_length = 0;
+	glGetProgramBinary(program, length, &written_length, &binary_format, &contents[sizeof(Cache_Header)]);
+	if (written_length <= 0)
+		return false;
+	contents.resize(sizeof(Cache_Header) + written_length);
+
+	Cache_Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = cache_version;
+	header.binary_format = binary_format;
+	header.key = key;
+	header.binary_size = written_length;
+	header.compile_ms = compile_ms;
+	memcpy(&contents[0], &header, sizeof(header));
+
+	if (!write_file_replacing(cache_path.c_str(), contents.data(), contents.size()))
+	{
+		printf("ERROR::PROGRAM_CACHE::FILE_NOT_WRITTEN %s\n", cache_path.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.writes++;
+	return true;
+}
+
+/**
+* @brief	the file name of a path, after its last slash
+*/
+static const char *file_name(const char *path)
+{
+	const char *name = path;
+	for (const char *c = path; *c; c++)
+		if (*c == '/' || *c == '\\')
+			name = c + 1;
+	return name;
+}
+
+std::string Program_Cache::cache_path(const char *vertex_path, const char *fragment_path, const char *geometry_path, const char *defines)
+{
+	std::string path = std::string(vertex_path) + '.' + file_name(fragment_path);
+	if (*geometry_path)
+		path = path + '.' + file_name(geometry_path);
+	if (*defines)
+	{
+		char variant[16];
+		snprintf(variant, sizeof(variant), ".%08x", (unsigned int)fnv1a_string(defines));
+		path += variant;
+	}
+	return path + ".program";
+}
+
+Program_Cache_Statistics Program_Cache::statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return counters;
+}
+
+void Program_Cache::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	memset(&counters, 0, sizeof(counters));
+}
+
+void Program_Cache::print()
+{
+	Program_Cache_Statistics s = statistics();
+	printf("program cache: %u restored in %.2f ms (%.2f ms saved), %u compiled in %.2f ms (%u binaries rejected), %u written\n",
+		s.hits, s.load_ms, s.saved_ms, s.misses + s.rejected, s.compile_ms, s.rejected, s.writes);
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+
+#include "range_allocator.h"
+
+/**
+* @brief	index of the highest set bit, x has to be more than 0
+*/
+static int highest_bit(uint64_t x)
+{
+	int bit = 0;
+	while (x >>= 1)
+		bit++;
+	return bit;
+}
+
+/**
+* @brief	index of the lowest set bit, x has to be more than 0
+*/
+static int lowest_bit(uint64_t x)
+{
+	int bit = 0;
+	while (!(x & 1))
+	{
+		x >>= 1;
+		bit++;
+	}
+	return bit;
+}
+
+Range_Allocator::Range_Allocator(size_t capacity)
+{
+	reset(capacity);
+}
+
+void Range_Allocator::reset(size_t capacity)
+{
+	m_capacity = capacity;
+	m_used = 0;
+	m_free_count = 0;
+	m_blocks.clear();
+	m_unused = -1;
+	m_allocated.clear();
+	m_fl_bitmap = 0;
+	for (int fl = 0; fl < fl_count; fl++)
+	{
+		m_sl_bitmap[fl] = 0;
+		for (int sl = 0; sl < sl_count; sl++)
+			m_heads[fl][sl] = -1;
+	}
+
+	if (capacity == 0)
+		return;
+	int block = new_block();
+	m_blocks[block].offset = 0;
+	m_blocks[block].size = capacity;
+	m_blocks[block].previous = -1;
+	m_blocks[block].next = -1;
+	insert_free(block);
+}
+
+void Range_Allocator::mapping(size_t size, int &fl, int &sl)
+{
+	// sizes below sl_count get a class each, above it every power of two is split into sl_count classes
+	if (size < (size_t)sl_count)
+	{
+		fl = 0;
+		sl = (int)size;
+		return;
+	}
+	int log = highest_bit(size);
+	fl = log - sl_bits + 1;
+	sl = (int)((size >> (log - sl_bits)) - sl_count);
+}
+
+int Range_Allocator::new_block()
+{
+	if (m_unused >= 0)
+	{
+		int block = m_unused;
+		m_unused = m_blocks[block].next;
+		return block;
+	}
+	m_blocks.push_back(Block());
+	return (int)m_blocks.size() - 1;
+}
+
+void Range_Allocator::insert_free(int block)
+{
+	Block &b = m_blocks[block];
+	int fl, sl;
+	mapping(b.size, fl, sl);
+	b.free = true;
+	b.previous_free = -1;
+	b.next_free = m_heads[fl][sl];
+	if (b.next_free >= 0)
+		m_blocks[b.next_free].previous_free = block;
+	m_heads[fl][sl] = block;
+	m_fl_bitmap |= 1ull << fl;
+	m_sl_bitmap[fl] |= 1u << sl;
+	m_free_count++;
+}
+
+void Range_Allocator::remove_free(int block)
+{
+	Block &b = m_blocks[block];
+	int fl, sl;
+	mapping(b.size, fl, sl);
+	if (b.previous_free >= 0)
+		m_blocks[b.previous_free].next_free = b.next_free;
+	else
+		m_heads[fl][sl] = b.next_free;
+	if (b.next_free >= 0)
+		m_blocks[b.next_free].previous_free = b.previous_free;
+
+	if (m_heads[fl][sl] < 0)
+	{
+		m_sl_bitmap[fl] &= ~(1u << sl);
+		if (!m_sl_bitmap[fl])
+			m_fl_bitmap &= ~(1ull << fl);
+	}
+	b.free = false;
+	m_free_count--;
+}
+
+int Range_Allocator::find_free(int fl, int sl) const
+{
+	if (fl >= fl_count)
+		return -1;
+	uint32_t sl_map = sl < sl_count ? m_sl_bitmap[fl] & (~0u << sl) : 0;
+	if (!sl_map)
+	{
+		// nothing big enough in this power of two, take the smallest class of the next non empty one
+		uint64_t fl_map = fl + 1 < fl_count ? m_fl_bitmap & (~0ull << (fl + 1)) : 0;
+		if (!fl_map)
+			return -1;
+		fl = lowest_bit(fl_map);
+		sl_map = m_sl_bitmap[fl];
+	}
+	return m_heads[fl][lowest_bit(sl_map)];
+}
+
+bool Range_Allocator::allocate(size_t size, size_t &offset)
+{
+	if (size == 0 || size > m_capacity - m_used)
+		return false;
+
+	// rounded up to the next class boundary so every block of the class found fits, a good fit rather than the best
+	size_t rounded = size;
+	if (size >= (size_t)sl_count)
+		rounded += ((size_t)1 << (highest_bit(size) - sl_bits)) - 1;
+	int fl, sl;
+	mapping(rounded, fl, sl);
+	int block = find_free(fl, sl);
+	if (block < 0)
+	{
+		// the rounding can skip the one block that would fit exactly, look through its own class before giving up
+		mapping(size, fl, sl);
+		for (block = m_heads[fl][sl]; block >= 0 && m_blocks[block].size < size; block = m_blocks[block].next_free)
+			;
+		if (block < 0)
+			return false;
+	}
+	remove_free(block);
+
+	// the rest goes back as a free block of its own
+	if (m_blocks[block].size > size)
+	{
+		int rest = new_block();
+		Block &b = m_blocks[block];
+		Block &r = m_blocks[rest];
+		r.offset = b.offset + size;
+		r.size = b.size - size;
+		r.previous = block;
+		r.next = b.next;
+		if (r.next >= 0)
+			m_blocks[r.next].previous = rest;
+		b.next = rest;
+		b.size = size;
+		insert_free(rest);
+	}
+
+	offset = m_blocks[block].offset;
+	m_used += size;
+	m_allocated[offset] = block;
+	return true;
+}
+
+void Range_Allocator::free(size_t offset)
+{
+	std::unordered_map<size_t, int>::iterator found = m_allocated.find(offset);
+	if (found == m_allocated.end())
+	{
+		printf("ERROR::RANGE_ALLOCATOR::NOT_ALLOCATED %zu\n", offset);
+		return;
+	}
+	int block = found->second;
+	m_allocated.erase(found);
+	m_used -= m_blocks[block].size;
+
+	// merged with the free neighbours, the merged away blocks are recycled
+	int next = m_blocks[block].next;
+	if (next >= 0 && m_blocks[next].free)
+	{
+		remove_free(next);
+		m_blocks[block].size += m_blocks[next].size;
+		m_blocks[block].next = m_blocks[next].next;
+		if (m_blocks[block].next >= 0)
+			m_blocks[m_blocks[block].next].previous = block;
+		m_blocks[next].next = m_unused;
+		m_unused = next;
+	}
+	int previous = m_blocks[block].previous;
+	if (previous >= 0 && m_blocks[previous].free)
+	{
+		remove_free(previous);
+		m_blocks[previous].size += m_blocks[block].size;
+		m_blocks[previous].next = m_blocks[block].next;
+		if (m_blocks[previous].next >= 0)
+			m_blocks[m_blocks[previous].next].previous = previous;
+		m_blocks[block].next = m_unused;
+		m_unused = block;
+		block = previous;
+	}
+	insert_free(block);
+}
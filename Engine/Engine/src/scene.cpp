@@ -0,0 +1,674 @@
+#include <stdio.h>
+#include <math.h>
+
+#include <stb_image.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "scene.h"
+#include "asset_pack.h"
+#include "geometry_arena.h"
+#include "gpu_timer.h"
+#include "gl_statistics.h"
+#include "profiler.h"
+
+// the uniforms the scene sets, hashed at compile time
+static constexpr Uniform_Name model_uniform("model");
+static constexpr Uniform_Name reverse_normals_uniform("reverse_normals");
+static constexpr Uniform_Name view_position_uniform("view_position");
+static constexpr Uniform_Name light_position_uniform("light_position");
+static constexpr Uniform_Name far_plane_uniform("far_plane");
+static constexpr Uniform_Name screen_texture_uniform("screen_texture");
+static constexpr Uniform_Name diffuse_texture_uniform("diffuse_texture");
+static constexpr Uniform_Name depth_cube_map_uniform("depth_cube_map");
+static constexpr Uniform_Name view_no_translation_uniform("view_no_translation");
+static constexpr Uniform_Name shadow_matrix_uniforms[6] = { "shadow_matrices[0]", "shadow_matrices[1]", "shadow_matrices[2]", "shadow_matrices[3]", "shadow_matrices[4]", "shadow_matrices[5]" };
+static constexpr Uniform_Name matrices_block("matrices");
+
+// the compile time features of point_shadow_mapping.fs, in key order
+static const Shader_Feature point_shadows_features[] = { { "SHADOWS", 1 }, { "DIFFUSE_TEXTURE", 1 } };
+enum Point_Shadows_Feature
+{
+	POINT_SHADOWS_SHADOWS = 0,			/**< sample the depth cubemap, without it the lit pass has no shadow lookups at all */
+	POINT_SHADOWS_DIFFUSE_TEXTURE		/**< sample diffuse_texture, without it the surfaces take the diffuse_color uniform */
+};
+
+/**
+* @brief	marks the start of a pass for the GPU timer and the GL call statistics
+* @param *name		name of the pass, has to be a string literal
+*/
+static void begin_pass(const char *name)
+{
+	Gpu_Timer::begin_pass(name);
+	Gl_Statistics::begin_pass(name);
+}
+
+/**
+* @brief	marks the end of the current pass
+*/
+static void end_pass()
+{
+	Gpu_Timer::end_pass();
+	Gl_Statistics::end_pass();
+}
+
+Scene::Scene(unsigned int width, unsigned int height, unsigned int samples)
+	: m_effect(0), m_shadows(true), m_model(NULL), m_width(width), m_height(height), m_shadow_width(1024), m_shadow_height(1024), m_light_position(-2.0f, 4.0f, -1.0f),
+	m_simple_shader("shaders/simple.vs", "shaders/simple.fs"),
+	m_post_processing_shader("shaders/simple.vs", "shaders/kernel.fs"),
+	m_skybox_shader("shaders/skybox.vs", "shaders/skybox.fs"),
+	m_lamp_shader("shaders/lamp.vs", "shaders/lamp.fs"),
+	m_cube_map_depth_shader("shaders/cube_map_depth.vs", "shaders/cube_map_depth.fs", "shaders/cube_map_depth.gs"),
+	m_point_shadows_variants("shaders/point_shadow_mapping.vs", "shaders/point_shadow_mapping.fs", "", point_shadows_features, 2), m_point_shadows_set_up(0)
+{
+	// submit the lit pass variants m_shadows switches between before anything waits on a program, they compile with the programs
+	// above while the rest is set up, and are finished by render() as the driver is done with them
+	unsigned int warm_up_keys[] = {
+		m_point_shadows_variants.key(POINT_SHADOWS_SHADOWS, 1) | m_point_shadows_variants.key(POINT_SHADOWS_DIFFUSE_TEXTURE, 1),
+		m_point_shadows_variants.key(POINT_SHADOWS_SHADOWS, 0) | m_point_shadows_variants.key(POINT_SHADOWS_DIFFUSE_TEXTURE, 1)
+	};
+	m_point_shadows_variants.warm_up(warm_up_keys, 2);
+
+	// --------------------------------------------------------------------------
+	//	vertex data -------------------------------------------------------------
+	// --------------------------------------------------------------------------
+
+	// vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
+	float simple_quad_vertices[] = {
+		// positions   // texCoords
+		-1.0f,  1.0f,  0.0f, 1.0f,
+		-1.0f, -1.0f,  0.0f, 0.0f,
+		1.0f, -1.0f,  1.0f, 0.0f,
+
+		-1.0f,  1.0f,  0.0f, 1.0f,
+		1.0f, -1.0f,  1.0f, 0.0f,
+		1.0f,  1.0f,  1.0f, 1.0f
+	};
+
+	float skybox_vertices[] = {
+		// positions          
+		-1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f,
+		1.0f, -1.0f, -1.0f,
+		1.0f, -1.0f, -1.0f,
+		1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,
+
+		-1.0f, -1.0f,  1.0f,
+		-1.0f, -1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f,  1.0f,
+		-1.0f, -1.0f,  1.0f,
+
+		1.0f, -1.0f, -1.0f,
+		1.0f, -1.0f,  1.0f,
+		1.0f,  1.0f,  1.0f,
+		1.0f,  1.0f,  1.0f,
+		1.0f,  1.0f, -1.0f,
+		1.0f, -1.0f, -1.0f,
+
+		-1.0f, -1.0f,  1.0f,
+		-1.0f,  1.0f,  1.0f,
+		1.0f,  1.0f,  1.0f,
+		1.0f,  1.0f,  1.0f,
+		1.0f, -1.0f,  1.0f,
+		-1.0f, -1.0f,  1.0f,
+
+		-1.0f,  1.0f, -1.0f,
+		1.0f,  1.0f, -1.0f,
+		1.0f,  1.0f,  1.0f,
+		1.0f,  1.0f,  1.0f,
+		-1.0f,  1.0f,  1.0f,
+		-1.0f,  1.0f, -1.0f,
+
+		-1.0f, -1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,
+		1.0f, -1.0f, -1.0f,
+		1.0f, -1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,
+		1.0f, -1.0f,  1.0f
+	};
+
+	std::vector<std::string> skybox_faces_filepaths = {
+		"resources/textures/skybox/right.jpg",
+		"resources/textures/skybox/left.jpg",
+		"resources/textures/skybox/top.jpg",
+		"resources/textures/skybox/bottom.jpg",
+		"resources/textures/skybox/back.jpg",
+		"resources/textures/skybox/front.jpg"
+	};
+
+	// depth mapping
+	float plane_vertices[] = {
+		// positions            // normals         // texcoords
+		25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
+		-25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,   0.0f,  0.0f,
+		-25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
+
+		25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
+		-25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
+		25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,  25.0f, 25.0f
+	};
+
+	// cubes
+	float cube_vertices[] = {
+		// positions        // normals            // texels
+		// back face
+		-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+		1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+		1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
+		1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+		-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+		-1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
+		// front face
+		-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+		1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
+		1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+		1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+		-1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
+		-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+		// left face
+		-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+		-1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
+		-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+		-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+		-1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+		-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+		// right face
+		1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+		1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+		1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
+		1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+		1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+		1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
+		// bottom face
+		-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+		1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
+		1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+		1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+		-1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+		-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+		// top face
+		-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+		1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+		1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
+		1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+		-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+		-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
+	};
+
+	// --------------------------------------------------------------------------
+	//	vertex array buffer configurations --------------------------------------
+	// --------------------------------------------------------------------------
+
+	// screen quad vao
+	glGenVertexArrays(1, &m_quad_vao);
+	glGenBuffers(1, &m_quad_vbo);
+
+	glBindVertexArray(m_quad_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_quad_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(simple_quad_vertices), &simple_quad_vertices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
+	// skybox vbo, vao, and vertices
+	glGenVertexArrays(1, &m_skybox_vao);
+	glGenBuffers(1, &m_skybox_vbo);
+
+	glBindVertexArray(m_skybox_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_skybox_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(skybox_vertices), &skybox_vertices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	// the floor plane and the cube have the layout of struct vertex, so they go into the arena next to the model's meshes and share its vertex array
+	unsigned short cube_indices[36];
+	for (int i = 0; i < 36; i++)
+		cube_indices[i] = (unsigned short)i;
+	m_plane_range = Geometry_Arena::allocate(VERTEX_FLOAT, plane_vertices, 6, cube_indices, 6, GL_UNSIGNED_SHORT);
+	m_cube_range = Geometry_Arena::allocate(VERTEX_FLOAT, cube_vertices, 36, cube_indices, 36, GL_UNSIGNED_SHORT);
+
+	glBindVertexArray(0);
+
+	// --------------------------------------------------------------------------
+	//	Uniform Buffer Objects Configuration -----------------------------------
+	// --------------------------------------------------------------------------
+
+	// first set the uniform block of the vertex shaders equal to the binding point (0)
+	unsigned int uniform_block_index_skybox = m_skybox_shader.uniform_block(matrices_block);
+	unsigned int uniform_block_index_lamp = m_lamp_shader.uniform_block(matrices_block);
+
+	glUniformBlockBinding(m_skybox_shader.m_program_id, uniform_block_index_skybox, 0);
+	glUniformBlockBinding(m_lamp_shader.m_program_id, uniform_block_index_lamp, 0);
+
+	// next create the actual uniform buffer object and bind the buffer to the binding point (0)
+	// the projection and view matrices are filled in with glBufferSubData each frame in render
+	glGenBuffers(1, &m_ubo_matrices);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_ubo_matrices);
+	glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_ubo_matrices, 0, 2 * sizeof(glm::mat4));
+
+	// --------------------------------------------------------------------------
+	//	load textures -----------------------------------------------------------
+	// --------------------------------------------------------------------------
+
+	// not sure why these are don't need to be flipped but loading them unflipped fixes this quick issue
+	bool flip_on_load = Texture_Registry::flip_on_load();
+	Texture_Registry::set_flip_on_load(false);
+	m_skybox_texture = load_cubemap(skybox_faces_filepaths);
+	Texture_Registry::set_flip_on_load(flip_on_load);
+	m_wood_texture = load_texture("resources/textures/wood.png", false);
+	m_wood_texture_gamma_corrected = load_texture("resources/textures/wood.png", true);
+
+	// --------------------------------------------------------------------------
+	//	framebuffer configuration -----------------------------------------------
+	// --------------------------------------------------------------------------
+
+	// depth map fbo
+	glGenFramebuffers(1, &m_depth_map_fbo);
+
+	// create depth cubemap texture
+	glGenTextures(1, &m_depth_cube_map);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_depth_cube_map);
+	for (int i = 0; i < 6; i++)
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, m_shadow_width, m_shadow_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	//attach the depth texture as FBO's depth buffer
+	glBindFramebuffer(GL_FRAMEBUFFER, m_depth_map_fbo);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth_cube_map, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+
+	// configure MSAA frambuffer
+	glGenFramebuffers(1, &m_framebuffer_object);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer_object);
+
+		// create color buffer texture
+		glGenTextures(1, &m_texture_color_buffer_multisampled);
+		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_texture_color_buffer_multisampled);
+			glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, GL_RGB, m_width, m_height, GL_TRUE);
+		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+		// attach the color buffer texture to the currently bound framebuffer object
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, m_texture_color_buffer_multisampled, 0);
+
+		// create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
+		glGenRenderbuffers(1, &m_renderbuffer_object);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer_object);
+			glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, m_width, m_height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		// attach the renderbuffer to the currently bound framebuffer object
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffer_object);
+
+		// now check that the framebuffer object is complete and we can use it
+		// in order to be complete it needs the following
+		//	1. We have to attach at least one buffer (color, depth or stencil buffer).
+		//	2. There should be at least one color attachment.
+		//	3. All attachments should be complete as well(reserved memory).
+		//	4. Each buffer should have the same number of samples.
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n");
+
+	// unbind the framebuffer to make sure we're not accidentally rendering to the wrong framebuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	//configure second post-processing framebuffer
+	glGenFramebuffers(1, &m_intermediate_framebuffer_object);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_intermediate_framebuffer_object);
+
+		//create a color attachment texture
+		glGenTextures(1, &m_screen_texture);
+		glBindTexture(GL_TEXTURE_2D, m_screen_texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_width, m_height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_screen_texture, 0); // we only need a color buffer here
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glEnable(GL_MULTISAMPLE);
+
+	m_simple_shader.use();
+	m_simple_shader.set_int(screen_texture_uniform, 0);
+
+	m_post_processing_shader.use();
+	m_post_processing_shader.set_int(screen_texture_uniform, 0);
+
+	// set up the variant drawn by default up front, the others are set up when the settings first ask for them
+	point_shadows_shader();
+
+	glEnable(GL_DEPTH_TEST);
+}
+
+Scene::~Scene()
+{
+	glDeleteVertexArrays(1, &m_quad_vao);
+	glDeleteBuffers(1, &m_quad_vbo);
+	glDeleteVertexArrays(1, &m_skybox_vao);
+	glDeleteBuffers(1, &m_skybox_vbo);
+	Geometry_Arena::release(m_plane_range);
+	Geometry_Arena::release(m_cube_range);
+	glDeleteBuffers(1, &m_ubo_matrices);
+
+	glDeleteTextures(1, &m_skybox_texture);
+	Texture_Registry::release(m_wood_texture);
+	Texture_Registry::release(m_wood_texture_gamma_corrected);
+
+	glDeleteFramebuffers(1, &m_depth_map_fbo);
+	glDeleteTextures(1, &m_depth_cube_map);
+	glDeleteFramebuffers(1, &m_framebuffer_object);
+	glDeleteTextures(1, &m_texture_color_buffer_multisampled);
+	glDeleteRenderbuffers(1, &m_renderbuffer_object);
+	glDeleteFramebuffers(1, &m_intermediate_framebuffer_object);
+	glDeleteTextures(1, &m_screen_texture);
+
+	glDeleteProgram(m_simple_shader.m_program_id);
+	glDeleteProgram(m_post_processing_shader.m_program_id);
+	glDeleteProgram(m_skybox_shader.m_program_id);
+	glDeleteProgram(m_lamp_shader.m_program_id);
+	glDeleteProgram(m_cube_map_depth_shader.m_program_id);
+}
+
+void Scene::render(Camera &camera, float current_time, unsigned int output_framebuffer)
+{
+	PROFILE_ZONE("Scene::render");
+
+	// finish the warmed up variants once they have compiled, without waiting for them
+	m_point_shadows_variants.poll();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer);
+	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// the shadow and the lit pass draw the model at the same levels of detail
+	if (m_model)
+		m_model->select_lods(m_model_transform, camera, (float)m_height);
+
+	// 0. create depth cubemap transformation matrices
+	float near_plane = 1.0f;
+	float far_plane = 25.0f;
+	std::vector<glm::mat4> shadow_matrices = shadow_transformations(m_light_position, (float)m_shadow_width / (float)m_shadow_height, near_plane, far_plane);
+
+
+	// 1. render depth of scene to cubemap (from light's perspective), skipped when the lit pass has no shadow lookups
+	if (m_shadows)
+	{
+		PROFILE_BEGIN(depth, "depth_cube_map");
+		begin_pass("depth_cube_map");
+		glViewport(0, 0, m_shadow_width, m_shadow_height);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_depth_map_fbo);
+
+			glEnable(GL_DEPTH_TEST);
+
+			glClear(GL_DEPTH_BUFFER_BIT);
+			m_cube_map_depth_shader.use();
+
+			m_cube_map_depth_shader.set_float(far_plane_uniform, far_plane);
+			m_cube_map_depth_shader.set_vec3(light_position_uniform, m_light_position);
+			for (int i = 0; i < 6; i++)
+				m_cube_map_depth_shader.set_mat4(shadow_matrix_uniforms[i], shadow_matrices[i]);
+
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, m_wood_texture);
+
+			// the cube map sees every direction, only the meshlets facing away from the light are culled
+			if (m_model)
+				m_model->cull_meshlets(m_model_transform, glm::mat4(), m_light_position, false);
+
+			render_scene(m_cube_map_depth_shader, current_time, false);
+
+		end_pass();
+		PROFILE_END(depth);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer);
+
+	// reset viewport
+	glViewport(0, 0, m_width, m_height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// 2. render scene to normal framebuffer
+
+	// bind to framebuffer and draw scene using the generated depth/shadow map
+	PROFILE_BEGIN(lit, "lit_msaa");
+	begin_pass("lit_msaa");
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer_object);
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+		// update the projection and view matrices inside the uniform block
+		glm::mat4 projection = glm::perspective(glm::radians(camera.m_zoom), (float)m_width / (float)m_height, 0.1f, 1000.0f);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_ubo_matrices);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		glm::mat4 view = camera.get_view_matrix();
+		glBindBuffer(GL_UNIFORM_BUFFER, m_ubo_matrices);
+		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		if (m_model)
+			m_model->cull_meshlets(m_model_transform, projection * view, camera.m_position, true);
+
+		Shader &lit_shader = point_shadows_shader();
+		lit_shader.use();
+		lit_shader.set_vec3(view_position_uniform, camera.m_position);
+		lit_shader.set_vec3(light_position_uniform, m_light_position);
+		lit_shader.set_float(far_plane_uniform, far_plane);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_wood_texture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_depth_cube_map);
+
+		render_scene(lit_shader, current_time, true);
+
+		m_lamp_shader.use();
+		glm::mat4 model = glm::mat4();
+		model = glm::translate(model, m_light_position);
+		model = glm::scale(model, glm::vec3(0.25f));
+		m_lamp_shader.set_mat4(model_uniform, model);
+		m_lamp_shader.flush();
+		unsigned int bound_vao = 0;
+		Geometry_Arena::draw(m_cube_range, bound_vao);
+		glBindVertexArray(0);
+
+		/*
+		glDepthFunc(GL_LEQUAL);
+		m_skybox_shader.use();
+		glm::mat4 view_no_translation = glm::mat4(glm::mat3(camera.get_view_matrix()));
+		m_skybox_shader.set_mat4(view_no_translation_uniform, view_no_translation);
+		m_skybox_shader.flush();
+		glBindVertexArray(m_skybox_vao);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_skybox_texture);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glDepthFunc(GL_LESS);
+		*/
+
+	end_pass();
+	PROFILE_END(lit);
+
+	// --------------------------------------------------------------------------
+	//	Finished Drawing "Scene" ------------------------------------------------
+	// --------------------------------------------------------------------------
+
+	// after drawing scene blit multisampled buffers to normal colorbuffer of intermediate fbo
+	PROFILE_BEGIN(resolve, "msaa_resolve");
+	begin_pass("msaa_resolve");
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer_object);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_intermediate_framebuffer_object);
+	glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	end_pass();
+	PROFILE_END(resolve);
+
+	// next render qaud with the scene's visuals as it's texture image
+	PROFILE_BEGIN(post, "post_processing");
+	begin_pass("post_processing");
+	glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer);
+	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_DEPTH_TEST);
+
+	switch (m_effect)
+	{
+	case 0:
+		m_simple_shader.use();
+		break;
+	case 1:
+		m_post_processing_shader.use();
+		break;
+	}
+
+	glBindVertexArray(m_quad_vao);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_screen_texture);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	end_pass();
+	PROFILE_END(post);
+}
+
+Shader &Scene::point_shadows_shader()
+{
+	unsigned int key = m_point_shadows_variants.key(POINT_SHADOWS_SHADOWS, m_shadows) | m_point_shadows_variants.key(POINT_SHADOWS_DIFFUSE_TEXTURE, 1);
+	Shader &shader = m_point_shadows_variants.get(key);
+
+	// a variant asked for the first time is set up like the other programs were in the constructor, the samplers are uploaded by its next use
+	if (!(m_point_shadows_set_up & (1u << key)))
+	{
+		m_point_shadows_set_up |= 1u << key;
+		glUniformBlockBinding(shader.m_program_id, shader.uniform_block(matrices_block), 0);
+		shader.set_int(diffuse_texture_uniform, 0);
+		shader.set_int(depth_cube_map_uniform, 1);
+	}
+	return shader;
+}
+
+void Scene::render_scene(Shader &shader, float current_time, bool use_textures)
+{
+	PROFILE_ZONE("Scene::render_scene");
+
+	// the cubes and the model are in the same arena page, its vertex array is bound once for all of them
+	unsigned int bound_vao = 0;
+
+	// room
+	glm::mat4 model;
+	model = glm::scale(model, glm::vec3(5.0f));
+	shader.set_mat4(model_uniform, model);
+	glDisable(GL_CULL_FACE);
+	shader.set_bool(reverse_normals_uniform, 1);
+	shader.flush();
+	Geometry_Arena::draw(m_cube_range, bound_vao);
+	shader.set_bool(reverse_normals_uniform, 0);
+	glEnable(GL_CULL_FACE);
+	// cubes
+	model = glm::mat4();
+	model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0f));
+	model = glm::scale(model, glm::vec3((sin(current_time) + 1.0) / 2.0));
+	shader.set_mat4(model_uniform, model);
+	shader.flush();
+	Geometry_Arena::draw(m_cube_range, bound_vao);
+
+	model = glm::mat4();
+	model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
+	model = glm::scale(model, glm::vec3(0.5f));
+	shader.set_mat4(model_uniform, model);
+	shader.flush();
+	Geometry_Arena::draw(m_cube_range, bound_vao);
+
+	model = glm::mat4();
+	model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
+	model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)));
+	model = glm::scale(model, glm::vec3(0.25f));
+	shader.set_mat4(model_uniform, model);
+	shader.flush();
+	Geometry_Arena::draw(m_cube_range, bound_vao);
+
+	if (m_model)
+	{
+		shader.set_mat4(model_uniform, m_model_transform);
+		m_model->draw(shader, use_textures, bound_vao);
+	}
+	glBindVertexArray(0);
+}
+
+// utility function for loading a 2D texture from file
+// ---------------------------------------------------
+unsigned int load_texture(char const * path, bool gamma_correction)
+{
+	PROFILE_ZONE("load_texture");
+
+	// the linear and the sRGB texture of the same image share its decode
+	return Texture_Registry::acquire(path, Texture_Parameters(gamma_correction, WRAP_CLAMP_IF_ALPHA));
+}
+
+unsigned int load_cubemap(std::vector<std::string> faces)
+{
+	PROFILE_ZONE("load_cubemap");
+
+	unsigned int texture_id;
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
+
+	int width, height, nr_channels;
+	for (int i = 0; i < faces.size(); i++)
+	{
+		Asset file(faces[i].c_str());
+		unsigned char *data = file.is_valid() ? stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &nr_channels, 0) : NULL;
+		if (data)
+		{
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+			stbi_image_free(data);
+		}
+		else
+		{
+			printf("Cubemap texture failed to load at filepath: %s\n", faces[i].c_str());
+			stbi_image_free(data);
+		}
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	return texture_id;
+}
+
+std::vector<glm::mat4> shadow_transformations(glm::vec3 light_position, float aspect, float near_plane, float far_plane)
+{
+	glm::mat4 shadow_projection = glm::perspective(glm::radians(90.0f), aspect, near_plane, far_plane);
+	std::vector<glm::mat4> shadow_transformations;
+
+	shadow_transformations.push_back(shadow_projection * glm::lookAt(light_position, light_position + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+	shadow_transformations.push_back(shadow_projection * glm::lookAt(light_position, light_position + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+	shadow_transformations.push_back(shadow_projection * glm::lookAt(light_position, light_position + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+	shadow_transformations.push_back(shadow_projection * glm::lookAt(light_position, light_position + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
+	shadow_transformations.push_back(shadow_projection * glm::lookAt(light_position, light_position + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+	shadow_transformations.push_back(shadow_projection * glm::lookAt(light_position, light_position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+
+	return shadow_transformations;
+}
@@ -1,160 +1,579 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
 #include "shader.h"
+#include "asset_pack.h"
+#include "gl_capabilities.h"
+#include "gl_statistics.h"
+#include "profiler.h"
+#include "program_cache.h"
+
+
+//	Preprocessor ---------------------------------------------------------------
+
+static const int max_include_depth = 16;
+
+/**
+* @brief	the directory part of a path with its trailing slash, empty for a bare file name
+*/
+static std::string directory_of(const std::string &path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+/**
+* @brief	appends a source to out with every #include "file" line replaced by the file, read through Asset like the stage itself and
+*			resolved against the including file's directory. A file already in the stage is included once, so includes need no guards.
+*			#line directives keep the driver's messages pointing at the right line, the source string number is the index in files
+* @param &path			path of the source
+* @param *source		the text, not terminated
+* @param length			length of the text
+* @param first_line		line number of the text's first line
+* @param &out			the expanded source
+* @param &files			every file in the stage so far, the source's own path included
+* @param depth			how deep the source is nested
+* @return	false if an included file is missing or the includes nest too deep
+*/
+static bool expand_includes(const std::string &path, const char *source, size_t length, int first_line, std::string &out, std::vector<std::string> &files, int depth)
+{
+	int file_index = (int)(std::find(files.begin(), files.end(), path) - files.begin());
+	bool expanded = true;
+	const char *line = source, *end = source + length;
+	for (int line_number = first_line; line < end; line_number++)
+	{
+		const char *line_end = (const char *)memchr(line, '\n', end - line);
+		line_end = line_end ? line_end + 1 : end;
+		const char *c = line;
+		while (c < line_end && (*c == ' ' || *c == '\t'))
+			c++;
+
+		const char *open = NULL, *close = NULL;
+		if (line_end - c > 8 && strncmp(c, "#include", 8) == 0)
+			open = (const char *)memchr(c + 8, '"', line_end - c - 8);
+		if (open)
+			close = (const char *)memchr(open + 1, '"', line_end - open - 1);
+		if (!close)
+		{
+			out.append(line, line_end);
+			line = line_end;
+			continue;
+		}
+
+		// the #include line itself becomes an empty line, or the included file between two #line directives
+		std::string include_path = directory_of(path) + std::string(open + 1, close);
+		bool included = std::find(files.begin(), files.end(), include_path) != files.end();
+		Asset file(included ? "" : include_path.c_str());
+		if (file.is_valid() && depth < max_include_depth)
+		{
+			files.push_back(include_path);
+			char directive[32];
+			snprintf(directive, sizeof(directive), "#line 1 %d\n", (int)files.size() - 1);
+			out += directive;
+			expanded = expand_includes(include_path, (const char *)file.data(), file.size(), 1, out, files, depth + 1) && expanded;
+			if (out[out.size() - 1] != '\n')
+				out += '\n';
+			snprintf(directive, sizeof(directive), "#line %d %d\n", line_number + 1, file_index);
+			out += directive;
+		}
+		else
+		{
+			if (!included)
+			{
+				printf("ERROR::SHADER::%s %s included by %s\n", file.is_valid() ? "INCLUDES_TOO_DEEP" : "INCLUDE_NOT_FOUND", include_path.c_str(), path.c_str());
+				expanded = false;
+			}
+			out += '\n';
+		}
+		line = line_end;
+	}
+	return expanded;
+}
 
+/**
+* @brief	the source of a stage as it is compiled: the defines injected after its #version line and its includes expanded
+* @param *path			path of the stage's source
+* @param &file			the stage's source
+* @param *defines		#define lines to inject, may be empty
+* @param &files			set to every file the stage is made of, the stage's own first
+*/
+static std::string preprocess(const char *path, const Asset &file, const char *defines, std::vector<std::string> &files)
+{
+	files.assign(1, path);
+	std::string out;
+	if (!file.is_valid())
+		return out;
 
-Shader::Shader(const GLchar *vertex_path, const GLchar*fragment_path, const GLchar* geometry_path)
-{
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertex_code;
-	std::string fragment_code;
-	std::string geometry_code;
-	std::ifstream v_shader_file;
-	std::ifstream f_shader_file;
-	std::ifstream g_shader_file;
-	// ensure ifstream objects can throw exceptions:
-	v_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	f_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	g_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	bool has_geometry = geometry_path != "";
-	try
-	{
-		// open files
-		v_shader_file.open(vertex_path);
-		f_shader_file.open(fragment_path);
-		if (has_geometry)
-			g_shader_file.open(geometry_path);
-
-		std::stringstream v_shader_stream, f_shader_stream, g_shader_stream;
-		// read file's buffer contents into streams
-		v_shader_stream << v_shader_file.rdbuf();
-		f_shader_stream << f_shader_file.rdbuf();
-		if(has_geometry)
-			g_shader_stream << g_shader_file.rdbuf();
-
-		// close file handlers
-		v_shader_file.close();
-		f_shader_file.close();
-		if (has_geometry)
-			g_shader_file.close();
-		// convert stream into string
-		vertex_code = v_shader_stream.str();
-		fragment_code = f_shader_stream.str();
-		if (has_geometry)
-			geometry_code = g_shader_stream.str();
-	}
-	catch (std::ifstream::failure e)
+	// #version has to come before anything else
+	const char *source = (const char *)file.data();
+	size_t length = file.size();
+	int first_line = 1;
+	if (length > 8 && strncmp(source, "#version", 8) == 0)
+	{
+		const char *version_end = (const char *)memchr(source, '\n', length);
+		version_end = version_end ? version_end + 1 : source + length;
+		out.append(source, version_end);
+		length -= version_end - source;
+		source = version_end;
+		first_line = 2;
+	}
+	if (*defines)
 	{
+		out += defines;
+		if (out[out.size() - 1] != '\n')
+			out += '\n';
+		char directive[32];
+		snprintf(directive, sizeof(directive), "#line %d 0\n", first_line);
+		out += directive;
+	}
+	expand_includes(path, source, length, first_line, out, files, 0);
+	return out;
+}
+
+/**
+* @brief	prints which file each source string number of a stage's messages stands for, when the stage has includes
+*/
+static void print_source_files(const std::vector<std::string> &files)
+{
+	if (files.size() < 2)
+		return;
+	for (size_t i = 0; i < files.size(); i++)
+		printf("  source %d: %s\n", (int)i, files[i].c_str());
+}
+
+//	Shader ---------------------------------------------------------------------
+
+// GL_KHR_parallel_shader_compile, which a GL 3.3 core loader doesn't define
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// the compile statistics, Shader is only used on the GL thread
+static Shader_Compile_Statistics compile_counters;
+
+Shader::Shader(const GLchar *vertex_path, const GLchar*fragment_path, const GLchar* geometry_path, const char *defines)
+	: m_pending(false), m_cache_key(0), m_submit_ms(0.0)
+{
+	PROFILE_ZONE("Shader::Shader");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_stages[0] = m_stages[1] = m_stages[2] = 0;
+
+	// 1. retrieve the vertex/fragment source code from the asset pack, or the loose files
+	bool has_geometry = geometry_path[0] != '\0';
+	Asset v_shader_file(vertex_path);
+	Asset f_shader_file(fragment_path);
+	Asset g_shader_file(has_geometry ? geometry_path : "");
+	if (!v_shader_file.is_valid() || !f_shader_file.is_valid() || (has_geometry && !g_shader_file.is_valid()))
 		printf("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ\n");
+
+	// inject the defines and expand the includes, the sources are compiled and cached as they come out of this
+	std::vector<std::string> v_files, f_files, g_files;
+	std::string v_shader_source = preprocess(vertex_path, v_shader_file, defines, v_files);
+	std::string f_shader_source = preprocess(fragment_path, f_shader_file, defines, f_files);
+	std::string g_shader_source = has_geometry ? preprocess(geometry_path, g_shader_file, defines, g_files) : std::string();
+	const char* v_shader_code = v_shader_source.c_str();
+	const char* f_shader_code = f_shader_source.c_str();
+	const char* g_shader_code = g_shader_source.c_str();
+	GLint v_shader_length = (GLint)v_shader_source.size();
+	GLint f_shader_length = (GLint)f_shader_source.size();
+	GLint g_shader_length = (GLint)g_shader_source.size();
+
+	// 2. restore the program from its cached binary if it is up to date
+	const char *sources[] = { v_shader_code, f_shader_code, g_shader_code };
+	GLint lengths[] = { v_shader_length, f_shader_length, g_shader_length };
+	bool cached = Program_Cache::s_enabled && Program_Cache::is_supported();
+	std::string cache_path;
+	unsigned long long cache_key = 0;
+	if (cached)
+	{
+		cache_path = Program_Cache::cache_path(vertex_path, fragment_path, geometry_path, defines);
+		cache_key = Program_Cache::key(sources, lengths, has_geometry ? 3 : 2);
+		this->m_program_id = Program_Cache::load(cache_path, cache_key);
+		if (this->m_program_id)
+		{
+			reflect();
+			return;
+		}
 	}
-	const char* v_shader_code = vertex_code.c_str();
-	const char* f_shader_code = fragment_code.c_str();
-	const char* g_shader_code;
-	if(has_geometry)
-		g_shader_code = geometry_code.c_str();
-
-	// 2. compile shaders
-	unsigned int vertex, fragment, geometry;
-
-	// vertex shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &v_shader_code, NULL);
-	glCompileShader(vertex);
-	check_compile_error(vertex, VERTEX);
-
-	// fragment shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &f_shader_code, NULL);
-	glCompileShader(fragment);
-	check_compile_error(fragment, FRAGMENT);
-
-	// geometry shader
-	if (has_geometry)
-	{
-		geometry = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(geometry, 1, &g_shader_code, NULL);
-		glCompileShader(geometry);
-		check_compile_error(geometry, GEOMETRY);
-	}
-	
-	// shader Program
+
+	// 3. submit the compile and link, the status is checked by finish() when the program is first needed
+	unsigned int stage_types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
 	this->m_program_id = glCreateProgram();
-	glAttachShader(this->m_program_id, vertex);
-	glAttachShader(this->m_program_id, fragment);
-	if (has_geometry)
-		glAttachShader(this->m_program_id, geometry);
+	for (int i = 0; i < (has_geometry ? 3 : 2); i++)
+	{
+		m_stages[i] = glCreateShader(stage_types[i]);
+		glShaderSource(m_stages[i], 1, &sources[i], &lengths[i]);
+		glCompileShader(m_stages[i]);
+		glAttachShader(this->m_program_id, m_stages[i]);
+	}
+	if (cached)
+		glProgramParameteri(this->m_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(this->m_program_id);
-	check_compile_error(this->m_program_id, PROGRAM);
 
-	// delete the shaders as they're linked into our program now and no longer necessery
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+	m_stage_files[0].swap(v_files);
+	m_stage_files[1].swap(f_files);
+	m_stage_files[2].swap(g_files);
+	m_cache_path = cache_path;
+	m_cache_key = cache_key;
+	m_submit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	m_pending = true;
+	compile_counters.submitted++;
+	compile_counters.submit_ms += m_submit_ms;
 }
 
 void Shader::use()
 {
+	finish();
 	glUseProgram(m_program_id);
+	flush();
+}
+
+void Shader::flush() const
+{
+	finish();
+	for (size_t i = 0; i < m_dirty.size(); i++)
+	{
+		Shader_Uniform_Value &value = m_values[m_dirty[i]];
+		const unsigned int *words = &m_value_words[value.offset];
+		const GLfloat *floats = (const GLfloat *)words;
+		switch (value.type)
+		{
+		case GL_FLOAT:			glUniform1f(value.location, floats[0]); break;
+		case GL_FLOAT_VEC2:		glUniform2fv(value.location, 1, floats); break;
+		case GL_FLOAT_VEC3:		glUniform3fv(value.location, 1, floats); break;
+		case GL_FLOAT_VEC4:		glUniform4fv(value.location, 1, floats); break;
+		case GL_FLOAT_MAT2:		glUniformMatrix2fv(value.location, 1, GL_FALSE, floats); break;
+		case GL_FLOAT_MAT3:		glUniformMatrix3fv(value.location, 1, GL_FALSE, floats); break;
+		case GL_FLOAT_MAT4:		glUniformMatrix4fv(value.location, 1, GL_FALSE, floats); break;
+		default:				glUniform1i(value.location, (GLint)words[0]); break;	// int, bool and the samplers
+		}
+		value.dirty = false;
+	}
+	m_dirty.clear();
+}
+
+/**
+* @brief	32 bit words a value of a uniform type takes, the types the setters have no overload for take one and are set as an int
+*/
+static unsigned int value_words(GLenum type)
+{
+	switch (type)
+	{
+	case GL_FLOAT_VEC2:		return 2;
+	case GL_FLOAT_VEC3:		return 3;
+	case GL_FLOAT_VEC4:		return 4;
+	case GL_FLOAT_MAT2:		return 4;
+	case GL_FLOAT_MAT3:		return 9;
+	case GL_FLOAT_MAT4:		return 16;
+	default:				return 1;
+	}
+}
+
+/**
+* @brief	the scalar type the setters write a uniform type with, the float types are uploaded with glUniform*f and the rest with glUniform1i
+*/
+static GLenum value_scalar(GLenum type)
+{
+	switch (type)
+	{
+	case GL_FLOAT:
+	case GL_FLOAT_VEC2:
+	case GL_FLOAT_VEC3:
+	case GL_FLOAT_VEC4:
+	case GL_FLOAT_MAT2:
+	case GL_FLOAT_MAT3:
+	case GL_FLOAT_MAT4:		return GL_FLOAT;
+	default:				return GL_INT;
+	}
+}
+
+void Shader::finish_pending() const
+{
+	PROFILE_ZONE("Shader::finish");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool ready = is_parallel_compile_supported() && is_ready();
+	m_pending = false;
+
+	static const Shader_Type types[] = { VERTEX, FRAGMENT, GEOMETRY };
+	for (int i = 0; i < 3; i++)
+	{
+		if (m_stages[i] && !check_compile_error(m_stages[i], types[i]))
+			print_source_files(m_stage_files[i]);
+	}
+	bool linked = check_compile_error(m_program_id, PROGRAM);
+
+	// delete the shaders as they're linked into our program now and no longer necessery
+	for (int i = 0; i < 3; i++)
+	{
+		if (m_stages[i])
+			glDeleteShader(m_stages[i]);
+		m_stages[i] = 0;
+		std::vector<std::string>().swap(m_stage_files[i]);
+	}
+
+	double wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	compile_counters.finished++;
+	compile_counters.ready += ready ? 1 : 0;
+	compile_counters.wait_ms += wait_ms;
+
+	// cache the binary for the next run, with the time the GL thread spent on the program
+	if (!m_cache_path.empty() && linked)
+		Program_Cache::write(m_cache_path, m_cache_key, m_program_id, m_submit_ms + wait_ms);
+
+	// reflect the uniforms so the setters don't ask the driver
+	reflect();
+}
+
+bool Shader::is_ready() const
+{
+	if (!m_pending || !is_parallel_compile_supported())
+		return true;
+	GLint complete = GL_TRUE;
+	glGetProgramiv(m_program_id, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete != GL_FALSE;
+}
+
+bool Shader::is_parallel_compile_supported()
+{
+	return Gl_Capabilities::has_extension("GL_KHR_parallel_shader_compile") || Gl_Capabilities::has_extension("GL_ARB_parallel_shader_compile");
+}
+
+Shader_Compile_Statistics Shader::compile_statistics()
+{
+	return compile_counters;
+}
+
+void Shader::reset_compile_statistics()
+{
+	memset(&compile_counters, 0, sizeof(compile_counters));
+}
+
+void Shader::print_compile_statistics()
+{
+	printf("Shader compiles: %u submitted, %u finished (%u ready before needed), %.2f ms submitting, %.2f ms waiting, parallel compile %s\n",
+		compile_counters.submitted, compile_counters.finished, compile_counters.ready, compile_counters.submit_ms, compile_counters.wait_ms,
+		is_parallel_compile_supported() ? "on" : "off");
+}
+
+/**
+* @brief	orders the reflection table by hash for the binary search
+*/
+static bool uniform_less(const Shader_Uniform &a, const Shader_Uniform &b)
+{
+	return a.hash < b.hash;
+}
+
+void Shader::reflect() const
+{
+	PROFILE_ZONE("Shader::reflect");
+	m_uniforms.clear();
+	m_uniform_blocks.clear();
+	m_values.clear();
+	m_value_words.clear();
+	m_dirty.clear();
+	m_value_names.clear();
+
+	GLint count = 0, max_length = 0;
+	glGetProgramiv(m_program_id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	std::vector<char> name(max_length + 16);
+	std::vector<std::pair<GLint, std::string> > location_names;		// the first name of each location, an array's bare name for its first element
+	for (GLint i = 0; i < count; i++)
+	{
+		GLint size = 0;
+		GLenum type = 0;
+		GLsizei length = 0;
+		glGetActiveUniform(m_program_id, i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+		name[length] = '\0';
+
+		// uniforms in blocks have no location, they are set through the block's buffer
+		GLint location = glGetUniformLocation(m_program_id, &name[0]);
+		if (location < 0)
+			continue;
+
+		// arrays are reported as "name[0]", every element gets an entry and the bare name stands for the first one
+		char *bracket = length > 3 && strcmp(&name[length - 3], "[0]") == 0 ? &name[length - 3] : NULL;
+		if (!bracket)
+		{
+			Shader_Uniform entry = { fnv1a_string(&name[0]), location, type, 1, -1 };
+			m_uniforms.push_back(entry);
+			location_names.push_back(std::make_pair(location, std::string(&name[0])));
+			continue;
+		}
+
+		*bracket = '\0';
+		Shader_Uniform entry = { fnv1a_string(&name[0]), location, type, size, -1 };
+		m_uniforms.push_back(entry);
+		location_names.push_back(std::make_pair(location, std::string(&name[0])));
+		for (GLint element = 0; element < size; element++)
+		{
+			snprintf(bracket, name.size() - (bracket - &name[0]), "[%d]", element);
+			Shader_Uniform element_entry = { fnv1a_string(&name[0]), glGetUniformLocation(m_program_id, &name[0]), type, size - element, -1 };
+			m_uniforms.push_back(element_entry);
+			if (element > 0)
+				location_names.push_back(std::make_pair(element_entry.location, std::string(&name[0])));
+		}
+	}
+	std::sort(m_uniforms.begin(), m_uniforms.end(), uniform_less);
+	for (size_t i = 1; i < m_uniforms.size(); i++)
+		if (m_uniforms[i].hash == m_uniforms[i - 1].hash && m_uniforms[i].location != m_uniforms[i - 1].location)
+			printf("ERROR::SHADER::UNIFORM_HASH_COLLISION in program %u\n", m_program_id);
+
+	// a value per location, an array's bare name and its "[0]" share one
+	for (size_t i = 0; i < m_uniforms.size(); i++)
+	{
+		Shader_Uniform &entry = m_uniforms[i];
+		entry.slot = -1;
+		for (size_t j = 0; j < m_values.size() && entry.slot < 0; j++)
+			if (m_values[j].location == entry.location)
+				entry.slot = (int)j;
+		if (entry.slot >= 0)
+			continue;
+
+		Shader_Uniform_Value value = { entry.location, entry.type, value_scalar(entry.type), (unsigned int)m_value_words.size(), value_words(entry.type), false, false, false };
+		entry.slot = (int)m_values.size();
+		m_values.push_back(value);
+		m_value_words.resize(m_value_words.size() + value.words);
+		std::string value_name;
+		for (size_t j = 0; j < location_names.size() && value_name.empty(); j++)
+			if (location_names[j].first == entry.location)
+				value_name = location_names[j].second;
+		m_value_names.push_back(value_name);
+	}
+
+	GLint block_count = 0, max_block_length = 0;
+	glGetProgramiv(m_program_id, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+	glGetProgramiv(m_program_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_block_length);
+	name.resize(max_block_length + 1);
+	for (GLint i = 0; i < block_count; i++)
+	{
+		GLsizei length = 0;
+		GLint data_size = 0;
+		glGetActiveUniformBlockName(m_program_id, i, (GLsizei)name.size(), &length, &name[0]);
+		name[length] = '\0';
+		glGetActiveUniformBlockiv(m_program_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+		Shader_Uniform_Block block = { fnv1a_string(&name[0]), (unsigned int)i, data_size };
+		m_uniform_blocks.push_back(block);
+	}
+}
+
+Uniform_Handle Shader::uniform(Uniform_Name name) const
+{
+	finish();
+	Shader_Uniform key;
+	key.hash = name.hash;
+	std::vector<Shader_Uniform>::const_iterator it = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), key, uniform_less);
+	Uniform_Handle handle = { it != m_uniforms.end() && it->hash == name.hash ? (int)(it - m_uniforms.begin()) : -1 };
+	return handle;
+}
+
+unsigned int Shader::uniform_block(Uniform_Name name) const
+{
+	finish();
+	for (size_t i = 0; i < m_uniform_blocks.size(); i++)
+		if (m_uniform_blocks[i].hash == name.hash)
+			return m_uniform_blocks[i].index;
+	return GL_INVALID_INDEX;
+}
+
+void Shader::set_value(Uniform_Handle uniform, const void *value, unsigned int words, GLenum scalar) const
+{
+	if (uniform.index < 0)
+		return;
+	Shader_Uniform_Value &shadow = m_values[m_uniforms[uniform.index].slot];
+	if (shadow.words != words || shadow.scalar != scalar)
+	{
+		// GL would reject it with GL_INVALID_OPERATION, once per uniform so a set in the frame loop doesn't flood the output
+		if (!shadow.reported)
+			printf("ERROR::SHADER::UNIFORM_TYPE_MISMATCH %s in program %u, set with %u words of %s\n", m_value_names[m_uniforms[uniform.index].slot].c_str(),
+				m_program_id, words, scalar == GL_FLOAT ? "float" : "int");
+		shadow.reported = true;
+		return;
+	}
+
+	unsigned int *stored = &m_value_words[shadow.offset];
+	if (shadow.known && memcmp(stored, value, words * sizeof(unsigned int)) == 0)
+	{
+		Gl_Statistics::record_skipped(UNIFORM_CALL);
+		return;
+	}
+	memcpy(stored, value, words * sizeof(unsigned int));
+	shadow.known = true;
+	if (!shadow.dirty)
+	{
+		shadow.dirty = true;
+		m_dirty.push_back(m_uniforms[uniform.index].slot);
+	}
 }
 
-void Shader::set_bool(const std::string &name, bool value) const
+void Shader::set_bool(Uniform_Handle uniform, bool value) const
 {
-	glUniform1i(glGetUniformLocation(m_program_id, name.c_str()), (int)value);
+	GLint v = (GLint)value;
+	set_value(uniform, &v, 1, GL_INT);
 }
-void Shader::set_int(const std::string &name, int value) const
+void Shader::set_int(Uniform_Handle uniform, int value) const
 {
-	glUniform1i(glGetUniformLocation(m_program_id, name.c_str()), value);
+	GLint v = value;
+	set_value(uniform, &v, 1, GL_INT);
 }
-void Shader::set_float(const std::string &name, float value) const
+void Shader::set_float(Uniform_Handle uniform, float value) const
 {
-	glUniform1f(glGetUniformLocation(m_program_id, name.c_str()), value);
+	set_value(uniform, &value, 1, GL_FLOAT);
 }
 
-void Shader::set_vec2(const std::string &name, const glm::vec2 &value) const
+void Shader::set_vec2(Uniform_Handle uniform, const glm::vec2 &value) const
 {
-	glUniform2fv(glGetUniformLocation(m_program_id, name.c_str()), 1, &value[0]);
+	set_value(uniform, &value[0], 2, GL_FLOAT);
 }
 
-void Shader::set_vec2(const std::string &name, float x, float y) const
+void Shader::set_vec2(Uniform_Handle uniform, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(m_program_id, name.c_str()), x, y);
+	GLfloat v[2] = { x, y };
+	set_value(uniform, v, 2, GL_FLOAT);
 }
 
-void Shader::set_vec3(const std::string &name, const glm::vec3 &value) const
+void Shader::set_vec3(Uniform_Handle uniform, const glm::vec3 &value) const
 {
-	glUniform3fv(glGetUniformLocation(m_program_id, name.c_str()), 1, &value[0]);
+	set_value(uniform, &value[0], 3, GL_FLOAT);
 }
 
-void Shader::set_vec3(const std::string &name, float x, float y, float z) const
+void Shader::set_vec3(Uniform_Handle uniform, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(m_program_id, name.c_str()), x, y, z);
+	GLfloat v[3] = { x, y, z };
+	set_value(uniform, v, 3, GL_FLOAT);
 }
 
-void Shader::set_vec4(const std::string &name, const glm::vec4 &value) const
+void Shader::set_vec4(Uniform_Handle uniform, const glm::vec4 &value) const
 {
-	glUniform4fv(glGetUniformLocation(m_program_id, name.c_str()), 1, &value[0]);
+	set_value(uniform, &value[0], 4, GL_FLOAT);
 }
 
-void Shader::set_vec4(const std::string &name, float x, float y, float z, float w) const
+void Shader::set_vec4(Uniform_Handle uniform, float x, float y, float z, float w) const
 {
-	glUniform4f(glGetUniformLocation(m_program_id, name.c_str()), x, y, z, w);
+	GLfloat v[4] = { x, y, z, w };
+	set_value(uniform, v, 4, GL_FLOAT);
 }
 
-void Shader::set_mat2(const std::string &name, const glm::mat2 &mat) const
+void Shader::set_mat2(Uniform_Handle uniform, const glm::mat2 &mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(m_program_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	set_value(uniform, &mat[0][0], 4, GL_FLOAT);
 }
 
-void Shader::set_mat3(const std::string &name, const glm::mat3 &mat) const
+void Shader::set_mat3(Uniform_Handle uniform, const glm::mat3 &mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(m_program_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	set_value(uniform, &mat[0][0], 9, GL_FLOAT);
 }
 
-void Shader::set_mat4(const std::string &name, const glm::mat4 &mat) const
+void Shader::set_mat4(Uniform_Handle uniform, const glm::mat4 &mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(m_program_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	set_value(uniform, &mat[0][0], 16, GL_FLOAT);
 }
 
 
-void Shader::check_compile_error(unsigned int shader, Shader_Type type)
+bool Shader::check_compile_error(unsigned int shader, Shader_Type type)
 {
 	int success;
 	char info_log[1024];
@@ -178,5 +597,5 @@ void Shader::check_compile_error(unsigned int shader, Shader_Type type)
 		}
 	}
 
-	
+	return success != 0;
 }
@@ -0,0 +1,107 @@
+#include <assert.h>
+#include <stdio.h>
+#include <tuple>
+
+#include "shader_variants.h"
+#include "profiler.h"
+
+/**
+* @brief	the values a feature's bits hold
+*/
+static unsigned int feature_mask(const Shader_Feature &feature)
+{
+	return feature.bits >= 32 ? 0xFFFFFFFFu : (1u << feature.bits) - 1;
+}
+
+Shader_Variants::Shader_Variants(const char *vertex_path, const char *fragment_path, const char *geometry_path, const Shader_Feature *features, unsigned int feature_count)
+	: m_vertex_path(vertex_path), m_fragment_path(fragment_path), m_geometry_path(geometry_path)
+{
+	// a feature past the 32 bits of the key would shift out of it and collide with the others, it keeps its index with no bits
+	// and is left to the shader's default
+	unsigned int shift = 0;
+	for (unsigned int i = 0; i < feature_count; i++)
+	{
+		m_features.push_back(features[i]);
+		m_shifts.push_back(shift);
+		if (features[i].bits == 0 || features[i].bits > 32 - shift)
+		{
+			printf("ERROR::SHADER_VARIANTS::KEY_TOO_LONG %s feature %s takes %u bits, %u are left\n", fragment_path, features[i].define, features[i].bits, 32 - shift);
+			assert(false);
+			m_features.back().bits = 0;
+		}
+		shift += m_features.back().bits;
+	}
+}
+
+Shader_Variants::~Shader_Variants()
+{
+	for (std::unordered_map<unsigned int, Shader>::iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+		glDeleteProgram(it->second.m_program_id);
+}
+
+unsigned int Shader_Variants::key(unsigned int feature, unsigned int value) const
+{
+	if (feature >= m_features.size())
+	{
+		printf("ERROR::SHADER_VARIANTS::NO_SUCH_FEATURE %s feature %u\n", m_fragment_path.c_str(), feature);
+		assert(false);
+		return 0;
+	}
+	if (m_features[feature].bits == 0)
+		return 0;
+	unsigned int mask = feature_mask(m_features[feature]);
+	if (value > mask)
+	{
+		printf("ERROR::SHADER_VARIANTS::VALUE_TOO_BIG %s %s %u doesn't fit in %u bits\n", m_fragment_path.c_str(), m_features[feature].define, value, m_features[feature].bits);
+		assert(false);
+		value = mask;
+	}
+	return value << m_shifts[feature];
+}
+
+Shader &Shader_Variants::get(unsigned int key)
+{
+	std::unordered_map<unsigned int, Shader>::iterator it = m_variants.find(key);
+	if (it != m_variants.end())
+		return it->second;
+
+	// built in place, a Shader isn't copyable
+	PROFILE_ZONE("Shader_Variants::get");
+	std::string variant_defines = defines(key);
+	return m_variants.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+		std::forward_as_tuple(m_vertex_path.c_str(), m_fragment_path.c_str(), m_geometry_path.c_str(), variant_defines.c_str())).first->second;
+}
+
+void Shader_Variants::warm_up(const unsigned int *keys, unsigned int count)
+{
+	PROFILE_ZONE("Shader_Variants::warm_up");
+	for (unsigned int i = 0; i < count; i++)
+		get(keys[i]);
+}
+
+bool Shader_Variants::poll()
+{
+	bool finished = true;
+	for (std::unordered_map<unsigned int, Shader>::iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if (it->second.is_ready())
+			it->second.finish();
+		else
+			finished = false;
+	}
+	return finished;
+}
+
+std::string Shader_Variants::defines(unsigned int key) const
+{
+	std::string lines;
+	char line[160];
+	for (size_t i = 0; i < m_features.size(); i++)
+	{
+		if (m_features[i].bits == 0)
+			continue;
+		snprintf(line, sizeof(line), "#define %s %u\n", m_features[i].define, (key >> m_shifts[i]) & feature_mask(m_features[i]));
+		lines += line;
+	}
+	return lines;
+}
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+
+#include <glad/glad.h>
+
+#include "texture_cache.h"
+#include "asset_pack.h"
+#include "gl_capabilities.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+// S3TC is an extension, glad only has the core profile
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+bool Texture_Cache::s_enabled = false;
+
+static const unsigned char ktx_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint32_t ktx_endianness = 0x04030201;
+static const char source_key[] = "engine.source";		// the key of the key/value entry holding a Ktx_Source
+static const uint32_t cache_version = 2;
+
+/**
+* @struct Ktx_Header
+* @brief	the header of a KTX 1.1 file, the identifier is followed by 13 32 bit fields
+*/
+struct Ktx_Header
+{
+	unsigned char identifier[12];
+	uint32_t endianness;
+	uint32_t gl_type;					/**< 0 for compressed formats */
+	uint32_t gl_type_size;				/**< 1 for compressed formats */
+	uint32_t gl_format;					/**< 0 for compressed formats */
+	uint32_t gl_internal_format;		/**< the compressed format */
+	uint32_t gl_base_internal_format;	/**< GL_RGB, GL_RGBA or GL_RG */
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;				/**< 0 for 2D textures */
+	uint32_t array_elements;			/**< 0 for a texture that isn't an array */
+	uint32_t faces;						/**< 1 for a texture that isn't a cube map */
+	uint32_t mip_levels;
+	uint32_t key_value_bytes;
+};
+
+/**
+* @struct Ktx_Source
+* @brief	the value of the engine.source entry, what the cache was built from
+*/
+struct Ktx_Source
+{
+	uint64_t source_size;		/**< size of the source image when the cache was built */
+	int64_t source_mtime;		/**< modification time of the source image when the cache was built */
+	uint32_t version;			/**< cache_version when the cache was built */
+	uint32_t compression;		/**< the Texture_Compression it was built with */
+	uint32_t flipped;			/**< the flip on load setting it was built with */
+	uint32_t padding;
+};
+
+static std::mutex statistics_mutex;
+static Texture_Cache_Statistics counters;
+
+static uint32_t internal_format(Block_Format format)
+{
+	if (format == BLOCK_BC1)
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	if (format == BLOCK_BC3)
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	return GL_COMPRESSED_RG_RGTC2;
+}
+
+static uint32_t base_internal_format(Block_Format format)
+{
+	if (format == BLOCK_BC1)
+		return GL_RGB;
+	if (format == BLOCK_BC3)
+		return GL_RGBA;
+	return GL_RG;
+}
+
+/**
+* @brief	the threads load compresses on when the caller has none, started on first use
+*/
+static Thread_Pool *compression_pool()
+{
+	static Thread_Pool pool;
+	return &pool;
+}
+
+bool Texture_Cache::load(const std::string &source_path, Texture_Compression compression, Compressed_Image &image, Thread_Pool *pool)
+{
+	if (read(source_path, compression, image))
+		return true;
+
+	PROFILE_ZONE("Texture_Cache::build");
+	const Decoded_Image *decoded = Texture_Registry::decode(source_path.c_str());
+	if (!decoded->pixels)
+	{
+		Texture_Registry::release_image(decoded);
+		return false;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	compress_image(decoded->pixels, decoded->width, decoded->height, decoded->components, block_format(compression, *decoded), mip_filter(compression), image,
+		pool ? pool : compression_pool());
+	double compress_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Texture_Registry::release_image(decoded);
+
+	write(source_path, compression, image);
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.builds++;
+	counters.compress_ms += compress_ms;
+	return true;
+}
+
+bool Texture_Cache::read(const std::string &source_path, Texture_Compression compression, Compressed_Image &image)
+{
+	PROFILE_ZONE("Texture_Cache::read");
+
+	uint64_t source_size;
+	int64_t source_mtime;
+	if (!Asset_Pack::source_info(source_path, source_size, source_mtime))
+		return false;
+
+	Mapped_File file(cache_path(source_path).c_str());
+	if (!file.is_valid() || file.size() < sizeof(Ktx_Header))
+		return false;
+
+	Ktx_Header header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.identifier, ktx_identifier, sizeof(ktx_identifier)) != 0 || header.endianness != ktx_endianness
+		|| header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth != 0 || header.array_elements != 0 || header.faces != 1
+		|| header.mip_levels == 0 || header.key_value_bytes > file.size() - sizeof(Ktx_Header))
+		return false;
+
+	Block_Format format;
+	if (header.gl_internal_format == internal_format(BLOCK_BC1))
+		format = BLOCK_BC1;
+	else if (header.gl_internal_format == internal_format(BLOCK_BC3))
+		format = BLOCK_BC3;
+	else if (header.gl_internal_format == internal_format(BLOCK_BC5))
+		format = BLOCK_BC5;
+	else
+		return false;
+
+	// the cache is only good for the source, settings and encoder it was built with
+	bool up_to_date = false;
+	const unsigned char *entry = file.data() + sizeof(Ktx_Header);
+	const unsigned char *entries_end = entry + header.key_value_bytes;
+	while (entry + sizeof(uint32_t) <= entries_end)
+	{
+		uint32_t entry_size;
+		memcpy(&entry_size, entry, sizeof(entry_size));
+		entry += sizeof(uint32_t);
+		if (entry_size > (size_t)(entries_end - entry))
+			return false;
+
+		if (entry_size == sizeof(source_key) + sizeof(Ktx_Source) && memcmp(entry, source_key, sizeof(source_key)) == 0)
+		{
+			Ktx_Source source;
+			memcpy(&source, entry + sizeof(source_key), sizeof(source));
+			up_to_date = source.source_size == source_size && source.source_mtime == source_mtime && source.version == cache_version
+				&& source.compression == (uint32_t)compression && source.flipped == (uint32_t)Texture_Registry::flip_on_load();
+		}
+		entry += (entry_size + 3) & ~3u;
+	}
+	if (!up_to_date)
+		return false;
+
+	image.format = format;
+	image.width = header.pixel_width;
+	image.height = header.pixel_height;
+	image.levels.resize(header.mip_levels);
+
+	size_t offset = sizeof(Ktx_Header) + header.key_value_bytes;
+	size_t size = 0;
+	int width = image.width, height = image.height;
+	for (uint32_t i = 0; i < header.mip_levels; i++)
+	{
+		Compressed_Level &level = image.levels[i];
+		level.width = width;
+		level.height = height;
+		level.offset = size;
+		level.size = (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+
+		uint32_t image_size;
+		if (offset + sizeof(uint32_t) > file.size())
+			return false;
+		memcpy(&image_size, file.data() + offset, sizeof(image_size));
+		if (image_size != level.size || offset + sizeof(uint32_t) + image_size > file.size())
+			return false;
+
+		offset += sizeof(uint32_t) + ((image_size + 3) & ~3u);
+		size += level.size;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	// the levels are copied out of the mapping, the uploads need them after the file is closed
+	image.data.resize(size);
+	offset = sizeof(Ktx_Header) + header.key_value_bytes;
+	for (uint32_t i = 0; i < header.mip_levels; i++)
+	{
+		memcpy(&image.data[image.levels[i].offset], file.data() + offset + sizeof(uint32_t), image.levels[i].size);
+		offset += sizeof(uint32_t) + ((image.levels[i].size + 3) & ~(size_t)3);
+	}
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.hits++;
+	return true;
+}
+
+bool Texture_Cache::write(const std::string &source_path, Texture_Compression compression, const Compressed_Image &image)
+{
+	Ktx_Source source;
+	memset(&source, 0, sizeof(source));
+	if (!Asset_Pack::source_info(source_path, source.source_size, source.source_mtime))
+	{
+		printf("ERROR::TEXTURE_CACHE::SOURCE_NOT_FOUND %s\n", source_path.c_str());
+		return false;
+	}
+	source.version = cache_version;
+	source.compression = compression;
+	source.flipped = Texture_Registry::flip_on_load();
+
+	uint32_t entry_size = sizeof(source_key) + sizeof(Ktx_Source);
+	uint32_t padded_entry_size = (entry_size + 3) & ~3u;
+
+	Ktx_Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.identifier, ktx_identifier, sizeof(ktx_identifier));
+	header.endianness = ktx_endianness;
+	header.gl_type_size = 1;
+	header.gl_internal_format = internal_format(image.format);
+	header.gl_base_internal_format = base_internal_format(image.format);
+	header.pixel_width = image.width;
+	header.pixel_height = image.height;
+	header.faces = 1;
+	header.mip_levels = image.levels.size();
+	header.key_value_bytes = sizeof(uint32_t) + padded_entry_size;
+
+	std::vector<unsigned char> contents(sizeof(Ktx_Header) + header.key_value_bytes, 0);
+	memcpy(&contents[0], &header, sizeof(header));
+	memcpy(&contents[sizeof(Ktx_Header)], &entry_size, sizeof(entry_size));
+	memcpy(&contents[sizeof(Ktx_Header) + sizeof(uint32_t)], source_key, sizeof(source_key));
+	memcpy(&contents[sizeof(Ktx_Header) + sizeof(uint32_t) + sizeof(source_key)], &source, sizeof(source));
+
+	// every level is its size followed by its blocks, padded to 4 bytes (which blocks always are)
+	for (int i = 0; i < image.levels.size(); i++)
+	{
+		const Compressed_Level &level = image.levels[i];
+		uint32_t image_size = level.size;
+		const unsigned char *size_bytes = (const unsigned char *)&image_size;
+		contents.insert(contents.end(), size_bytes, size_bytes + sizeof(image_size));
+		contents.insert(contents.end(), image.data.begin() + level.offset, image.data.begin() + level.offset + level.size);
+	}
+
+	std::string path = cache_path(source_path);
+	if (!write_file_replacing(path.c_str(), contents.data(), contents.size()))
+	{
+		printf("ERROR::TEXTURE_CACHE::FILE_NOT_WRITTEN %s\n", path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+std::string Texture_Cache::cache_path(const std::string &source_path)
+{
+	return source_path + ".ktx";
+}
+
+Mip_Filter Texture_Cache::mip_filter(Texture_Compression compression)
+{
+	return compression == COMPRESS_NORMAL ? MIP_FILTER_LINEAR : MIP_FILTER_SRGB;
+}
+
+Block_Format Texture_Cache::block_format(Texture_Compression compression, const Decoded_Image &image)
+{
+	if (compression == COMPRESS_NORMAL)
+		return BLOCK_BC5;
+	if (image.components != 2 && image.components != 4)
+		return BLOCK_BC1;
+
+	// alpha is the last channel
+	size_t count = (size_t)image.width * image.height;
+	for (size_t i = 0; i < count; i++)
+		if (image.pixels[i * image.components + image.components - 1] != 255)
+			return BLOCK_BC3;
+	return BLOCK_BC1;
+}
+
+bool Texture_Cache::is_supported(bool srgb)
+{
+	if (!Gl_Capabilities::has_extension("GL_EXT_texture_compression_s3tc"))
+		return false;
+	return !srgb || Gl_Capabilities::has_extension("GL_EXT_texture_sRGB") || Gl_Capabilities::has_extension("GL_EXT_texture_compression_s3tc_srgb");
+}
+
+Texture_Cache_Statistics Texture_Cache::statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	return counters;
+}
+
+void Texture_Cache::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	memset(&counters, 0, sizeof(counters));
+}
+
+void Texture_Cache::print()
+{
+	Texture_Cache_Statistics s = statistics();
+	printf("texture cache: %u compressed textures (%.1f MB, %.1f MB uncompressed, %.1fx smaller), %u read from cache, %u built in %.1f ms\n",
+		s.textures, s.bytes / 1e6, s.raw_bytes / 1e6, s.bytes ? (double)s.raw_bytes / s.bytes : 0.0, s.hits, s.builds, s.compress_ms);
+}
+
+unsigned int create_compressed_texture(const Compressed_Image &image, const Texture_Parameters &parameters)
+{
+	PROFILE_ZONE("create_compressed_texture");
+
+	GLenum format = internal_format(image.format);
+	if (parameters.srgb && image.format == BLOCK_BC1)
+		format = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+	else if (parameters.srgb && image.format == BLOCK_BC3)
+		format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+
+	GLint wrap = GL_REPEAT;
+	if (parameters.wrap == WRAP_CLAMP_TO_EDGE || (parameters.wrap == WRAP_CLAMP_IF_ALPHA && image.format == BLOCK_BC3))
+		wrap = GL_CLAMP_TO_EDGE;
+
+	unsigned int texture_id;
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+
+	unsigned long long raw_bytes = 0;
+	size_t pixel_size = image.format == BLOCK_BC3 ? 4 : 3;
+	for (int i = 0; i < image.levels.size(); i++)
+	{
+		const Compressed_Level &level = image.levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, (GLsizei)level.size, &image.data[level.offset]);
+		raw_bytes += (unsigned long long)level.width * level.height * pixel_size;
+	}
+
+	// the chain is complete, so the texture is too without glGenerateMipmap
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	counters.textures++;
+	counters.bytes += image.data.size();
+	counters.raw_bytes += raw_bytes;
+	return texture_id;
+}
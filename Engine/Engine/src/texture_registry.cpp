@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "texture_registry.h"
+#include "asset_pack.h"
+#include "hash.h"
+#include "model.h"
+#include "profiler.h"
+#include "texture_cache.h"
+
+size_t Texture_Registry::s_image_cache_bytes = 64 << 20;
+
+/**
+* @struct Registered_Texture
+* @brief	a texture in the registry
+*/
+struct Registered_Texture
+{
+	unsigned int id;			/**< the GL texture */
+	unsigned int references;	/**< acquires and finds not released yet */
+	size_t bytes;				/**< GPU bytes of every level, 0 until gpu_bytes asks */
+};
+
+/**
+* @struct Cached_Image
+* @brief	a decoded image in the cache, the Decoded_Image comes first so the pointers handed out can be cast back
+*/
+struct Cached_Image
+{
+	Decoded_Image image;		/**< what decode hands out */
+	unsigned long long key;		/**< hash of the file contents and the flip setting */
+	unsigned int references;	/**< decodes not released yet */
+	unsigned long long last_use;	/**< use_clock when it was last handed out, the least recently used is evicted first */
+	bool ready;					/**< decoded, threads asking for it before wait */
+};
+
+static std::mutex texture_mutex;											// guards the textures and their counters
+static std::unordered_map<unsigned long long, Registered_Texture> textures;	// by texture key
+static std::unordered_map<unsigned int, unsigned long long> texture_keys;	// texture key of each texture ID
+
+static std::mutex image_mutex;												// guards the images and their counters
+static std::condition_variable image_decoded;								// signaled when an image is ready
+static std::unordered_map<unsigned long long, Cached_Image *> images;		// by contents key
+static std::unordered_map<unsigned long long, unsigned long long> content_keys;	// contents key last seen for each path key
+static unsigned long long use_clock = 0;
+static size_t image_bytes = 0;												// pixel bytes of every cached image
+
+static bool flip = false;													// stbi's flip setting, it can't be read back
+static Decoded_Image failed_image = { NULL, 0, 0, 0 };						// handed out when a file can't be read
+
+static Texture_Registry_Statistics counters;								// lookups and texture_hits under texture_mutex, the decode counts under image_mutex
+
+/**
+* @brief	writes the normalized path to out, which must hold strlen(path) + 1 characters, it is never longer than that
+* @return	the length of the normalized path
+*/
+static size_t normalize(const char *path, char *out)
+{
+	size_t length = 0;
+	size_t base = 0;		// the start of the first part, after the / of an absolute path
+	if (*path == '/' || *path == '\\')
+		out[length++] = '/', base = 1;
+
+	const char *part = path;
+	for (const char *c = path;; c++)
+	{
+		if (*c && *c != '/' && *c != '\\')
+			continue;
+
+		size_t part_length = c - part;
+		bool dot_dot = part_length == 2 && part[0] == '.' && part[1] == '.';
+		bool last_is_dot_dot = length >= base + 2 && out[length - 1] == '.' && out[length - 2] == '.' && (length == base + 2 || out[length - 3] == '/');
+		if (dot_dot && length > base && !last_is_dot_dot)
+		{
+			// drops the last part
+			while (length > base && out[length - 1] != '/')
+				length--;
+			if (length > base)
+				length--;
+		}
+		else if (dot_dot && base)
+		{
+			// .. of the root is the root
+		}
+		else if (part_length > 0 && !(part_length == 1 && part[0] == '.'))
+		{
+			// a leading .. of a relative path can't be resolved, it is kept like any other part
+			if (length > base)
+				out[length++] = '/';
+			memcpy(out + length, part, part_length);
+			length += part_length;
+		}
+
+		if (!*c)
+			break;
+		part = c + 1;
+	}
+
+	out[length] = '\0';
+	return length;
+}
+
+/**
+* @brief	the key of a path under the current flip setting, normalized on the stack so lookups don't allocate
+*/
+static unsigned long long path_key(const char *path)
+{
+	size_t size = strlen(path) + 1;
+	char buffer[256];
+	std::vector<char> large;
+	char *normalized = buffer;
+	if (size > sizeof(buffer))
+	{
+		large.resize(size);
+		normalized = &large[0];
+	}
+
+	size_t length = normalize(path, normalized);
+	return hash_combine(fnv1a(normalized, length), flip);
+}
+
+/**
+* @brief	the key of a texture, its path key and the parameters
+*/
+static unsigned long long texture_key(const char *path, const Texture_Parameters &parameters)
+{
+	unsigned long long key = hash_combine(hash_combine(path_key(path), parameters.srgb), parameters.wrap);
+	return hash_combine(hash_combine(key, parameters.compression), parameters.mip_filter);
+}
+
+static size_t pixel_bytes(const Decoded_Image &image)
+{
+	return (size_t)image.width * image.height * image.components;
+}
+
+/**
+* @brief	frees the least recently used images nobody references until the unreferenced ones fit in the budget, image_mutex must be held
+*/
+static void evict_images()
+{
+	for (;;)
+	{
+		size_t unused_bytes = 0;
+		Cached_Image *oldest = NULL;
+		for (std::unordered_map<unsigned long long, Cached_Image *>::iterator it = images.begin(); it != images.end(); ++it)
+		{
+			Cached_Image *cached = it->second;
+			if (cached->references || !cached->ready)
+				continue;
+			unused_bytes += pixel_bytes(cached->image);
+			if (!oldest || cached->last_use < oldest->last_use)
+				oldest = cached;
+		}
+
+		if (!oldest || unused_bytes <= Texture_Registry::s_image_cache_bytes)
+			return;
+
+		image_bytes -= pixel_bytes(oldest->image);
+		images.erase(oldest->key);
+		stbi_image_free(oldest->image.pixels);
+		delete oldest;
+	}
+}
+
+/**
+* @brief	hands out a cached image, waiting for it if another thread is still decoding it, image_mutex must be held by lock
+*/
+static const Decoded_Image *use_image(Cached_Image *cached, std::unique_lock<std::mutex> &lock)
+{
+	cached->references++;
+	cached->last_use = ++use_clock;
+	image_decoded.wait(lock, [cached] { return cached->ready; });
+	return &cached->image;
+}
+
+unsigned int Texture_Registry::acquire(const char *path, const Texture_Parameters &parameters)
+{
+	unsigned int id = find(path, parameters);
+	if (id)
+		return id;
+
+	PROFILE_ZONE("Texture_Registry::acquire");
+	Compressed_Image compressed;
+	if (parameters.compression != COMPRESS_NONE && Texture_Cache::is_supported(parameters.srgb) && Texture_Cache::load(path, parameters.compression, compressed))
+	{
+		id = create_compressed_texture(compressed, parameters);
+	}
+	else
+	{
+		const Decoded_Image *image = decode(path);
+		id = create_texture(image->pixels, image->width, image->height, image->components, parameters);
+		release_image(image);
+	}
+
+	unsigned int registered = insert(path, parameters, id);
+	if (registered != id)
+		glDeleteTextures(1, &id);
+	return registered;
+}
+
+unsigned int Texture_Registry::find(const char *path, const Texture_Parameters &parameters)
+{
+	unsigned long long key = texture_key(path, parameters);
+
+	std::lock_guard<std::mutex> lock(texture_mutex);
+	counters.lookups++;
+	std::unordered_map<unsigned long long, Registered_Texture>::iterator it = textures.find(key);
+	if (it == textures.end())
+		return 0;
+
+	counters.texture_hits++;
+	it->second.references++;
+	return it->second.id;
+}
+
+unsigned int Texture_Registry::insert(const char *path, const Texture_Parameters &parameters, unsigned int id)
+{
+	unsigned long long key = texture_key(path, parameters);
+
+	std::lock_guard<std::mutex> lock(texture_mutex);
+	std::unordered_map<unsigned long long, Registered_Texture>::iterator it = textures.find(key);
+	if (it != textures.end())
+	{
+		it->second.references++;
+		return it->second.id;
+	}
+
+	Registered_Texture &texture = textures[key];
+	texture.id = id;
+	texture.references = 1;
+	texture.bytes = 0;
+	texture_keys[id] = key;
+	return id;
+}
+
+void Texture_Registry::release(unsigned int id)
+{
+	if (!id)
+		return;
+
+	std::lock_guard<std::mutex> lock(texture_mutex);
+	std::unordered_map<unsigned int, unsigned long long>::iterator key = texture_keys.find(id);
+	if (key == texture_keys.end())
+	{
+		printf("ERROR::TEXTURE_REGISTRY::RELEASE texture %u isn't registered\n", id);
+		return;
+	}
+
+	Registered_Texture &texture = textures[key->second];
+	if (--texture.references == 0)
+	{
+		textures.erase(key->second);
+		texture_keys.erase(key);
+		glDeleteTextures(1, &id);
+	}
+}
+
+/**
+* @brief	adds up the levels of a 2D texture as the driver reports them, the compressed size or the bits of every component of each texel
+*/
+static size_t query_texture_bytes(unsigned int id)
+{
+	GLint previous = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(GL_TEXTURE_2D, id);
+
+	size_t bytes = 0;
+	for (GLint level = 0; level < 32; level++)
+	{
+		GLint width = 0, height = 0, compressed = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+		if (width <= 0 || height <= 0)
+			break;
+
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed)
+		{
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size;
+			continue;
+		}
+
+		const GLenum component_sizes[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE };
+		GLint bits = 0;
+		for (int i = 0; i < 5; i++)
+		{
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, component_sizes[i], &size);
+			bits += size;
+		}
+		bytes += (size_t)width * height * ((bits + 7) / 8);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, previous);
+	return bytes;
+}
+
+size_t Texture_Registry::gpu_bytes(unsigned int id)
+{
+	if (!id)
+		return 0;
+
+	{
+		std::lock_guard<std::mutex> lock(texture_mutex);
+		std::unordered_map<unsigned int, unsigned long long>::iterator key = texture_keys.find(id);
+		if (key != texture_keys.end() && textures[key->second].bytes)
+			return textures[key->second].bytes;
+	}
+
+	size_t bytes = query_texture_bytes(id);
+
+	std::lock_guard<std::mutex> lock(texture_mutex);
+	std::unordered_map<unsigned int, unsigned long long>::iterator key = texture_keys.find(id);
+	if (key != texture_keys.end())
+		textures[key->second].bytes = bytes;
+	return bytes;
+}
+
+const Decoded_Image *Texture_Registry::decode(const char *path)
+{
+	unsigned long long by_path = path_key(path);
+
+	// a path seen before goes straight to its image, without reading the file
+	std::unique_lock<std::mutex> lock(image_mutex);
+	std::unordered_map<unsigned long long, unsigned long long>::iterator content = content_keys.find(by_path);
+	if (content != content_keys.end())
+	{
+		std::unordered_map<unsigned long long, Cached_Image *>::iterator it = images.find(content->second);
+		if (it != images.end())
+		{
+			counters.image_hits++;
+			return use_image(it->second, lock);
+		}
+	}
+	lock.unlock();
+
+	PROFILE_ZONE("Texture_Registry::decode");
+	Asset file(path);
+	if (!file.is_valid())
+	{
+		printf("Texture failed to load at path: %s\n", path);
+		return &failed_image;
+	}
+
+	unsigned long long key;
+	{
+		PROFILE_ZONE("Texture_Registry::hash_contents");
+		key = hash_combine(fnv1a(file.data(), file.size()), flip);
+	}
+
+	lock.lock();
+	content_keys[by_path] = key;
+	std::unordered_map<unsigned long long, Cached_Image *>::iterator it = images.find(key);
+	if (it != images.end())
+	{
+		counters.image_hits++;
+		counters.content_hits++;
+		return use_image(it->second, lock);
+	}
+
+	// in the cache before it is decoded, so other threads asking for it wait instead of decoding it again
+	Cached_Image *cached = new Cached_Image();
+	cached->image = failed_image;
+	cached->key = key;
+	cached->references = 1;
+	cached->last_use = ++use_clock;
+	cached->ready = false;
+	images[key] = cached;
+	lock.unlock();
+
+	Decoded_Image image;
+	{
+		PROFILE_ZONE("stbi_load_from_memory");
+		image.pixels = stbi_load_from_memory(file.data(), (int)file.size(), &image.width, &image.height, &image.components, 0);
+	}
+	if (!image.pixels)
+	{
+		printf("Texture failed to load at path: %s\n", path);
+		image = failed_image;
+	}
+
+	lock.lock();
+	cached->image = image;
+	cached->ready = true;
+	image_bytes += pixel_bytes(image);
+	counters.decodes++;
+	lock.unlock();
+	image_decoded.notify_all();
+	return &cached->image;
+}
+
+void Texture_Registry::release_image(const Decoded_Image *image)
+{
+	if (image == &failed_image)
+		return;
+
+	std::lock_guard<std::mutex> lock(image_mutex);
+	Cached_Image *cached = (Cached_Image *)image;
+	cached->references--;
+	evict_images();
+}
+
+void Texture_Registry::trim_images()
+{
+	std::lock_guard<std::mutex> lock(image_mutex);
+	size_t budget = s_image_cache_bytes;
+	s_image_cache_bytes = 0;
+	evict_images();
+	s_image_cache_bytes = budget;
+}
+
+void Texture_Registry::set_flip_on_load(bool flip_on_load)
+{
+	flip = flip_on_load;
+	stbi_set_flip_vertically_on_load(flip_on_load);
+}
+
+bool Texture_Registry::flip_on_load()
+{
+	return flip;
+}
+
+std::string Texture_Registry::normalize_path(const char *path)
+{
+	std::string normalized(strlen(path) + 1, '\0');
+	normalized.resize(normalize(path, &normalized[0]));
+	return normalized;
+}
+
+Texture_Registry_Statistics Texture_Registry::statistics()
+{
+	Texture_Registry_Statistics statistics;
+	{
+		std::lock_guard<std::mutex> lock(image_mutex);
+		statistics.decodes = counters.decodes;
+		statistics.image_hits = counters.image_hits;
+		statistics.content_hits = counters.content_hits;
+		statistics.images = images.size();
+		statistics.image_bytes = image_bytes;
+	}
+
+	std::lock_guard<std::mutex> lock(texture_mutex);
+	statistics.lookups = counters.lookups;
+	statistics.texture_hits = counters.texture_hits;
+	statistics.textures = textures.size();
+	return statistics;
+}
+
+void Texture_Registry::print()
+{
+	Texture_Registry_Statistics s = statistics();
+	printf("texture registry: %u textures, %llu lookups (%llu hits), %llu decodes, %llu decodes saved (%llu by contents), %u images cached (%.1f MB)\n",
+		s.textures, s.lookups, s.texture_hits, s.decodes, s.image_hits, s.content_hits, s.images, s.image_bytes / 1e6);
+}
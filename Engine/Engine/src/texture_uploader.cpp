@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "texture_uploader.h"
+#include "profiler.h"
+
+static long long now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+* @brief	the format and internal format create_texture picks for the number of channels and the parameters
+*/
+static GLenum texture_format(int components, const Texture_Parameters &parameters, GLenum *internal_format)
+{
+	if (components == 1)
+	{
+		*internal_format = GL_RED;
+		return GL_RED;
+	}
+	if (components == 3)
+	{
+		*internal_format = parameters.srgb ? GL_SRGB : GL_RGB;
+		return GL_RGB;
+	}
+	*internal_format = parameters.srgb ? GL_SRGB_ALPHA : GL_RGBA;
+	return GL_RGBA;
+}
+
+Texture_Uploader::Texture_Uploader(Shared_Context *context, unsigned int buffer_count, unsigned int buffer_size)
+	: m_context(context), m_buffer_size(buffer_size), m_buffers(buffer_count, 0), m_mapped(buffer_count, (unsigned char *)NULL),
+	m_started(false), m_valid(false), m_stopping(false)
+{
+	memset(&m_statistics, 0, sizeof(m_statistics));
+
+	m_thread = std::thread(&Texture_Uploader::run, this);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_condition.wait(lock, [this] { return m_started; });
+}
+
+Texture_Uploader::~Texture_Uploader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_work_condition.notify_one();
+	m_thread.join();
+
+	delete m_context;
+}
+
+void Texture_Uploader::upload(const unsigned char *pixels, int width, int height, int components, const Texture_Parameters &parameters, const Mip_Chain *mips, Completion on_complete)
+{
+	PROFILE_ZONE("Texture_Uploader::upload");
+
+	// gray and alpha is uploaded as RGBA like create_texture does
+	std::vector<unsigned char> expanded;
+	if (pixels && components == 2)
+	{
+		expand_to_rgba(pixels, width, height, components, expanded);
+		pixels = expanded.data();
+		components = 4;
+	}
+
+	Pending_Upload *upload = new Pending_Upload();
+	upload->buffer = -1;
+	upload->empty = pixels == NULL;
+	upload->width = width;
+	upload->height = height;
+	upload->components = components;
+	upload->parameters = parameters;
+	upload->on_complete = on_complete;
+	upload->submitted_ns = now_ns();
+	upload->texture = 0;
+	upload->fence = 0;
+
+	size_t size = upload->empty ? 0 : (size_t)width * height * components;
+	size_t mip_size = 0;
+	upload->mip_offset = (size + 3) & ~(size_t)3;		// RGBA rows stay 4 byte aligned
+	if (mips && !upload->empty)
+	{
+		upload->mip_levels = mips->levels;
+		mip_size = mips->pixels.size();
+	}
+
+	size_t total_size = mip_size ? upload->mip_offset + mip_size : size;
+	unsigned char *destination = NULL;
+	if (total_size > m_buffer_size)
+	{
+		upload->client_pixels.resize(total_size);
+		destination = upload->client_pixels.data();
+	}
+	else if (size > 0)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_free_buffers.empty())
+		{
+			PROFILE_ZONE("Texture_Uploader::wait_for_buffer");
+			m_statistics.stalls++;
+			m_done_condition.wait(lock, [this] { return !m_free_buffers.empty(); });
+		}
+		upload->buffer = m_free_buffers.back();
+		m_free_buffers.pop_back();
+		lock.unlock();
+
+		// the buffer stays mapped while it is free, so the decoder writes the pixels straight into GL's memory
+		destination = m_mapped[upload->buffer];
+		if (!destination)
+		{
+			// mapping it failed, the pixels go through client memory and the upload thread maps the buffer again once it is done
+			upload->client_pixels.resize(total_size);
+			destination = upload->client_pixels.data();
+		}
+	}
+
+	if (destination)
+	{
+		memcpy(destination, pixels, size);
+		if (mip_size)
+			memcpy(destination + upload->mip_offset, mips->pixels.data(), mip_size);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queued.push_back(upload);
+		m_statistics.queue_depth++;
+		if (m_statistics.queue_depth > m_statistics.max_queue_depth)
+			m_statistics.max_queue_depth = m_statistics.queue_depth;
+	}
+	m_work_condition.notify_one();
+}
+
+void Texture_Uploader::finish()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done_condition.wait(lock, [this] { return m_statistics.queue_depth == 0; });
+}
+
+Texture_Upload_Statistics Texture_Uploader::statistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_statistics;
+}
+
+void Texture_Uploader::reset_statistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	unsigned int queue_depth = m_statistics.queue_depth;
+	memset(&m_statistics, 0, sizeof(m_statistics));
+	m_statistics.queue_depth = m_statistics.max_queue_depth = queue_depth;
+}
+
+void Texture_Uploader::run()
+{
+	PROFILE_THREAD("texture uploader");
+
+	bool current = m_context->make_current();
+	if (current)
+	{
+		// tightly packed rows like stbi_load returns them, this context's unpack state is only ours
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		glGenBuffers((GLsizei)m_buffers.size(), &m_buffers[0]);
+		for (int i = 0; i < m_buffers.size(); i++)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[i]);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, m_buffer_size, NULL, GL_STREAM_DRAW);
+			m_mapped[i] = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_buffer_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			m_free_buffers.push_back(i);		// even unmapped, so upload never waits on a buffer that can't come back
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_started = true;
+		m_valid = current;
+	}
+	m_done_condition.notify_all();
+	if (!current)
+		return;
+
+	std::vector<Pending_Upload *> in_flight;
+	std::deque<Pending_Upload *> queued;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (in_flight.empty())
+				m_work_condition.wait(lock, [this] { return m_stopping || !m_queued.empty(); });
+			else if (m_queued.empty())
+				m_work_condition.wait_for(lock, std::chrono::milliseconds(1));		// poll the fences
+
+			if (m_stopping && m_queued.empty() && in_flight.empty())
+				break;
+			queued.swap(m_queued);
+			PROFILE_COUNTER("texture upload queue", m_statistics.queue_depth);
+		}
+
+		for (int i = 0; i < queued.size(); i++)
+		{
+			start_upload(queued[i]);
+			in_flight.push_back(queued[i]);
+		}
+		if (!queued.empty())
+			glFlush();		// so the fences get signaled without waiting on more commands
+		queued.clear();
+
+		for (std::vector<Pending_Upload *>::iterator it = in_flight.begin(); it != in_flight.end();)
+		{
+			GLenum status = glClientWaitSync((*it)->fence, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			{
+				finish_upload(*it);
+				it = in_flight.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	for (int i = 0; i < m_buffers.size(); i++)
+	{
+		if (!m_mapped[i])
+			continue;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[i]);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers((GLsizei)m_buffers.size(), &m_buffers[0]);
+	m_context->release();
+}
+
+void Texture_Uploader::start_upload(Pending_Upload *upload)
+{
+	PROFILE_ZONE("Texture_Uploader::start_upload");
+	long long start = now_ns();
+
+	glGenTextures(1, &upload->texture);
+	if (!upload->empty)
+	{
+		const unsigned char *pixels = upload->client_pixels.data();
+		if (upload->buffer >= 0 && upload->client_pixels.empty())
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[upload->buffer]);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			m_mapped[upload->buffer] = NULL;
+			pixels = NULL;		// offset 0 into the bound buffer
+		}
+
+		GLenum internal_format;
+		GLenum format = texture_format(upload->components, upload->parameters, &internal_format);
+		GLint wrap = GL_REPEAT;
+		if (upload->parameters.wrap == WRAP_CLAMP_TO_EDGE || (upload->parameters.wrap == WRAP_CLAMP_IF_ALPHA && format == GL_RGBA))
+			wrap = GL_CLAMP_TO_EDGE;
+
+		glBindTexture(GL_TEXTURE_2D, upload->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, upload->width, upload->height, 0, format, GL_UNSIGNED_BYTE, pixels);
+		if (upload->mip_levels.empty())
+			glGenerateMipmap(GL_TEXTURE_2D);
+		for (int i = 0; i < upload->mip_levels.size(); i++)
+		{
+			const Mip_Level &level = upload->mip_levels[i];
+			glTexImage2D(GL_TEXTURE_2D, i + 1, internal_format, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels + upload->mip_offset + level.offset);
+		}
+		if (!upload->mip_levels.empty())
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)upload->mip_levels.size());
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	upload->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_statistics.busy_ms += (now_ns() - start) / 1e6;
+	if (!upload->empty)
+	{
+		m_statistics.bytes += (unsigned long long)upload->width * upload->height * upload->components;
+		if (!upload->mip_levels.empty())
+		{
+			const Mip_Level &last = upload->mip_levels.back();
+			m_statistics.bytes += last.offset + (unsigned long long)last.width * last.height * 4;
+		}
+		if (upload->buffer >= 0 && upload->client_pixels.empty())
+			m_statistics.buffered_uploads++;
+		else
+			m_statistics.direct_uploads++;
+	}
+}
+
+void Texture_Uploader::finish_upload(Pending_Upload *upload)
+{
+	glDeleteSync(upload->fence);
+
+	// the buffer's copy into the texture is done, map it again for the next decoder (or retry a map that failed)
+	if (upload->buffer >= 0)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[upload->buffer]);
+		m_mapped[upload->buffer] = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_buffer_size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (!m_mapped[upload->buffer])
+			printf("ERROR::TEXTURE_UPLOADER::MAP_FAILED buffer %d, its next upload goes through client memory\n", upload->buffer);
+	}
+
+	upload->on_complete(upload->texture);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (upload->buffer >= 0)
+			m_free_buffers.push_back(upload->buffer);
+		m_statistics.textures++;
+		m_statistics.latency_ms += (now_ns() - upload->submitted_ns) / 1e6;
+		m_statistics.queue_depth--;
+	}
+	m_done_condition.notify_all();
+	delete upload;
+}
+
+void Texture_Uploader::print()
+{
+	Texture_Upload_Statistics s = statistics();
+	printf("texture uploads: %u textures, %.1f MB in %.1f ms (%.1f MB/s), %u from pixel buffers, %u direct\n",
+		s.textures, s.bytes / 1e6, s.busy_ms, s.bandwidth_mb_s(), s.buffered_uploads, s.direct_uploads);
+	printf("  mean latency %.2f ms, max queue depth %u, %u decoder stalls on %u pixel buffers\n",
+		s.textures ? s.latency_ms / s.textures : 0.0, s.max_queue_depth, s.stalls, (unsigned int)m_buffers.size());
+}
+
+std::string Texture_Uploader::json_members(const char *indent)
+{
+	Texture_Upload_Statistics s = statistics();
+	char json[512];
+	snprintf(json, sizeof(json),
+		"%s\"texture_uploads\": {\"textures\": %u, \"bytes\": %llu, \"busy_ms\": %.3f, \"bandwidth_mb_s\": %.1f, \"mean_latency_ms\": %.3f, "
+		"\"max_queue_depth\": %u, \"stalls\": %u, \"buffered\": %u, \"direct\": %u},\n",
+		indent, s.textures, s.bytes, s.busy_ms, s.bandwidth_mb_s(), s.textures ? s.latency_ms / s.textures : 0.0,
+		s.max_queue_depth, s.stalls, s.buffered_uploads, s.direct_uploads);
+	return json;
+}
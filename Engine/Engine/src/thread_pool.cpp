@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "thread_pool.h"
+#include "profiler.h"
+
+Thread_Pool::Thread_Pool(unsigned int thread_count)
+	: m_stopping(false)
+{
+	if (thread_count == 0)
+		thread_count = default_thread_count();
+
+	for (unsigned int i = 0; i < thread_count; i++)
+		m_threads.push_back(std::thread(&Thread_Pool::work, this, i));
+}
+
+Thread_Pool::~Thread_Pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (int i = 0; i < m_threads.size(); i++)
+		m_threads[i].join();
+}
+
+void Thread_Pool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_condition.notify_one();
+}
+
+/**
+* @struct Parallel_Range_State
+* @brief	the ranges of a parallel_for, shared with the helper jobs since they can run after it returned (and then find nothing left)
+*/
+struct Parallel_Range_State
+{
+	std::function<void(unsigned int, unsigned int)> job;	/**< the job run on every range */
+	unsigned int count;										/**< number of items */
+	unsigned int range;										/**< items per range */
+	std::atomic<unsigned int> next;							/**< the first item not taken yet */
+	std::atomic<unsigned int> done;							/**< items finished */
+	std::mutex mutex;										/**< guards the wait on finished */
+	std::condition_variable finished;						/**< signaled when the last range is done */
+};
+
+/**
+* @brief	takes ranges until none are left
+*/
+static void run_ranges(Parallel_Range_State &state)
+{
+	for (;;)
+	{
+		unsigned int begin = state.next.fetch_add(state.range);
+		if (begin >= state.count)
+			return;
+
+		unsigned int end = std::min(begin + state.range, state.count);
+		state.job(begin, end);
+		if (state.done.fetch_add(end - begin) + (end - begin) == state.count)
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			state.finished.notify_all();
+		}
+	}
+}
+
+void Thread_Pool::parallel_for(unsigned int count, std::function<void(unsigned int begin, unsigned int end)> job, unsigned int grain)
+{
+	if (count == 0)
+		return;
+
+	// a few ranges per thread so a slow one doesn't hold up the rest
+	unsigned int threads = thread_count() + 1;
+	unsigned int range = std::max(std::max(grain, 1u), (count + threads * 4 - 1) / (threads * 4));
+	unsigned int ranges = (count + range - 1) / range;
+
+	std::shared_ptr<Parallel_Range_State> state = std::make_shared<Parallel_Range_State>();
+	state->job = std::move(job);
+	state->count = count;
+	state->range = range;
+	state->next = 0;
+	state->done = 0;
+
+	unsigned int helpers = std::min(ranges - 1, thread_count());
+	for (unsigned int i = 0; i < helpers; i++)
+		submit([state] { run_ranges(*state); });
+
+	run_ranges(*state);
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state] { return state->done.load() == state->count; });
+}
+
+unsigned int Thread_Pool::default_thread_count()
+{
+	// hardware_concurrency is allowed to return 0 when it doesn't know
+	unsigned int hardware_threads = std::thread::hardware_concurrency();
+	return hardware_threads > 1 ? hardware_threads - 1 : 1;
+}
+
+void Thread_Pool::work(unsigned int index)
+{
+	std::string name = "worker " + std::to_string(index);
+	PROFILE_THREAD(name.c_str());
+
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+			if (m_jobs.empty())
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}